@@ -1,4 +1,24 @@
 SRC_FILES= \
 	$(SRC_DIR)/protobuf2json/protobuf2json.c \
 	$(SRC_DIR)/protobuf-json.c \
-	$(SRC_DIR)/parse.c
\ No newline at end of file
+	$(SRC_DIR)/profile.c \
+	$(SRC_DIR)/alloc-stats.c \
+	$(SRC_DIR)/test-hooks.c \
+	$(SRC_DIR)/lexer.c \
+	$(SRC_DIR)/limits.c \
+	$(SRC_DIR)/common.c \
+	$(SRC_DIR)/node-walker.c \
+	$(SRC_DIR)/batch.c \
+	$(SRC_DIR)/buffer.c \
+	$(SRC_DIR)/metrics.c \
+	$(SRC_DIR)/extract-constants.c \
+	$(SRC_DIR)/extract-comments.c \
+	$(SRC_DIR)/catalog.c \
+	$(SRC_DIR)/dependencies.c \
+	$(SRC_DIR)/rewrite.c \
+	$(SRC_DIR)/format.c \
+	$(SRC_DIR)/round-trip.c \
+	$(SRC_DIR)/template.c \
+	$(SRC_DIR)/archive.c \
+	$(SRC_DIR)/arrow.c \
+	$(SRC_DIR)/parse.c
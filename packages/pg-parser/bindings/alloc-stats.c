@@ -0,0 +1,106 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "macros.h"
+
+// Heap allocation counters for allocation-budget tests.
+//
+// When built with PG_PARSER_ALLOC_STATS (the default for non-release WASM
+// builds, see Makefile), this file overrides the libc allocator entry points
+// and forwards to Emscripten's builtin dlmalloc. Every allocation made inside
+// WASM - by libpg_query, protobuf-c, jansson, the bindings, or JS via
+// _malloc/_free - is counted. Without it (release builds) alloc_stats()
+// and alloc_stats_reset() aren't exported at all, and JS feature-detects
+// them.
+//
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  int32_t mallocs;   // malloc, calloc, realloc(NULL, n), aligned allocs
+  int32_t frees;     // free of a non-NULL pointer, realloc(p, 0)
+  int32_t reallocs;  // realloc of an existing pointer
+  int32_t bytes;     // total bytes requested (including reallocs)
+} AllocStats;
+
+#if defined(PG_PARSER_ALLOC_STATS) && defined(__EMSCRIPTEN__)
+
+#include <emscripten/heap.h>
+#include <errno.h>
+
+static AllocStats stats;
+
+void *malloc(size_t size) {
+  void *ptr = emscripten_builtin_malloc(size);
+  if (ptr) {
+    stats.mallocs++;
+    stats.bytes += (int32_t)size;
+  }
+  return ptr;
+}
+
+void *calloc(size_t count, size_t size) {
+  void *ptr = emscripten_builtin_calloc(count, size);
+  if (ptr) {
+    stats.mallocs++;
+    stats.bytes += (int32_t)(count * size);
+  }
+  return ptr;
+}
+
+void *realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return malloc(size);
+  }
+
+  void *new_ptr = emscripten_builtin_realloc(ptr, size);
+  if (size == 0) {
+    // dlmalloc frees the block when shrinking to zero
+    stats.frees++;
+  } else if (new_ptr) {
+    stats.reallocs++;
+    stats.bytes += (int32_t)size;
+  }
+  return new_ptr;
+}
+
+void free(void *ptr) {
+  if (ptr) {
+    stats.frees++;
+  }
+  emscripten_builtin_free(ptr);
+}
+
+// Aligned allocations are freed with free(), so count them too or the
+// malloc/free totals drift apart.
+void *memalign(size_t alignment, size_t size) {
+  void *ptr = emscripten_builtin_memalign(alignment, size);
+  if (ptr) {
+    stats.mallocs++;
+    stats.bytes += (int32_t)size;
+  }
+  return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void **result, size_t alignment, size_t size) {
+  void *ptr = memalign(alignment, size);
+  if (!ptr) {
+    return ENOMEM;
+  }
+  *result = ptr;
+  return 0;
+}
+
+EXPORT("alloc_stats")
+AllocStats *alloc_stats(void) {
+  return &stats;
+}
+
+EXPORT("alloc_stats_reset")
+void alloc_stats_reset(void) {
+  stats = (AllocStats){0};
+}
+
+#endif
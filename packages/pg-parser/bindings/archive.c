@@ -0,0 +1,336 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <jansson.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "common.h"
+#include "macros.h"
+#include "pg_query.h"
+#include "protobuf2json.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Writes parse trees into a random-access archive that JS can read one
+// statement at a time (see src/archive.ts for the reader). Little-endian:
+//
+//   header    magic "PGAR", format version, PG version, counts, and the
+//             offsets of the sections below (PG_ARCHIVE_HEADER_SIZE bytes)
+//   records   one encoded RawStmt per statement, back to back
+//   strings   u32 offsets[n_strings + 1], then the UTF-8 bytes; every
+//             object key and string value in the archive is stored once
+//   types     u32 string ids: per statement, the sorted distinct node
+//             types its tree contains
+//   index     PG_ARCHIVE_ENTRY_SIZE bytes per statement: record offset
+//             (u64) and length, query, stmt_location, stmt_len, root node
+//             type, and its slice of `types`
+//
+// Records encode the same JSON that parse() returns, as a tag byte per
+// value followed by its payload (see PgArchiveTag), so a statement
+// decodes without touching any other.
+
+#define PG_ARCHIVE_MAGIC "PGAR"
+#define PG_ARCHIVE_FORMAT 1
+#define PG_ARCHIVE_HEADER_SIZE 48
+#define PG_ARCHIVE_ENTRY_SIZE 36
+
+// Order is ABI: src/archive.ts decodes values by these tags.
+typedef enum {
+  PG_ARCHIVE_NULL = 0,
+  PG_ARCHIVE_FALSE,
+  PG_ARCHIVE_TRUE,
+  PG_ARCHIVE_INTEGER,  // zigzag varint
+  PG_ARCHIVE_REAL,     // float64
+  PG_ARCHIVE_STRING,   // varint string id
+  PG_ARCHIVE_ARRAY,    // varint count, then the items
+  PG_ARCHIVE_OBJECT,   // varint count, then (varint key id, value) pairs
+} PgArchiveTag;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  uint8_t *data;
+  int32_t length;
+  int32_t failed_query;  // index of the query that failed to parse, or -1
+  PgQueryError *error;
+} PgArchiveResult;
+
+typedef struct {
+  PgBuffer records;
+  PgBuffer string_bytes;
+  PgBuffer string_offsets;    // u32 per string
+  PgBuffer types;             // u32 per (statement, node type)
+  PgBuffer index;
+  json_t *string_ids;         // string -> integer id
+  json_t *statement_types;    // node types seen in the current statement
+  uint32_t n_strings;
+  uint32_t n_types;
+  uint32_t n_statements;
+  int failed;
+} ArchiveWriter;
+
+// Returns the id of `string`, adding it to the table on first use.
+static uint32_t intern(ArchiveWriter *writer, const char *string, size_t length) {
+  json_t *id = json_object_getn(writer->string_ids, string, length);
+  if (id) {
+    return (uint32_t)json_integer_value(id);
+  }
+
+  uint32_t new_id = writer->n_strings++;
+  if (json_object_setn_new(writer->string_ids, string, length, json_integer(new_id)) != 0) {
+    writer->failed = 1;
+  }
+
+  pg_buffer_put_u32(&writer->string_offsets, (uint32_t)writer->string_bytes.length);
+  pg_buffer_put_bytes(&writer->string_bytes, string, length);
+  return new_id;
+}
+
+static int is_node_type(const char *key) {
+  return key[0] >= 'A' && key[0] <= 'Z';
+}
+
+static void write_value(ArchiveWriter *writer, json_t *value) {
+  PgBuffer *out = &writer->records;
+
+  switch (json_typeof(value)) {
+    case JSON_NULL:
+      pg_buffer_put_u8(out, PG_ARCHIVE_NULL);
+      break;
+    case JSON_FALSE:
+      pg_buffer_put_u8(out, PG_ARCHIVE_FALSE);
+      break;
+    case JSON_TRUE:
+      pg_buffer_put_u8(out, PG_ARCHIVE_TRUE);
+      break;
+    case JSON_INTEGER: {
+      int64_t integer = (int64_t)json_integer_value(value);
+      pg_buffer_put_u8(out, PG_ARCHIVE_INTEGER);
+      pg_buffer_put_varint(out, ((uint64_t)integer << 1) ^ (uint64_t)(integer >> 63));
+      break;
+    }
+    case JSON_REAL:
+      pg_buffer_put_u8(out, PG_ARCHIVE_REAL);
+      pg_buffer_put_f64(out, json_real_value(value));
+      break;
+    case JSON_STRING: {
+      uint32_t id = intern(writer, json_string_value(value), json_string_length(value));
+      pg_buffer_put_u8(out, PG_ARCHIVE_STRING);
+      pg_buffer_put_varint(out, id);
+      break;
+    }
+    case JSON_ARRAY: {
+      size_t i;
+      json_t *item;
+      pg_buffer_put_u8(out, PG_ARCHIVE_ARRAY);
+      pg_buffer_put_varint(out, json_array_size(value));
+      json_array_foreach(value, i, item) {
+        write_value(writer, item);
+      }
+      break;
+    }
+    case JSON_OBJECT: {
+      const char *key;
+      size_t key_length;
+      json_t *field;
+
+      pg_buffer_put_u8(out, PG_ARCHIVE_OBJECT);
+      pg_buffer_put_varint(out, json_object_size(value));
+      json_object_keylen_foreach(value, key, key_length, field) {
+        uint32_t id = intern(writer, key, key_length);
+
+        // Nodes are wrapped as {"SelectStmt": {...}}
+        if (json_object_size(value) == 1 && is_node_type(key)) {
+          json_object_setn_new(writer->statement_types, key, key_length, json_integer(id));
+        }
+
+        pg_buffer_put_varint(out, id);
+        write_value(writer, field);
+      }
+      break;
+    }
+  }
+}
+
+static int compare_ids(const void *a, const void *b) {
+  uint32_t id_a = *(const uint32_t *)a;
+  uint32_t id_b = *(const uint32_t *)b;
+  return (id_a > id_b) - (id_a < id_b);
+}
+
+static void write_statement(ArchiveWriter *writer, json_t *statement, int32_t query) {
+  size_t offset = writer->records.length;
+  json_t *stmt = json_object_get(statement, "stmt");
+  uint32_t root_type = UINT32_MAX;
+
+  if (json_is_object(stmt) && json_object_size(stmt) == 1) {
+    const char *key = json_object_iter_key(json_object_iter(stmt));
+    root_type = intern(writer, key, strlen(key));
+  }
+
+  json_object_clear(writer->statement_types);
+  write_value(writer, statement);
+
+  // Sorted, so readers can binary search a statement's types
+  size_t n_types = json_object_size(writer->statement_types);
+  uint32_t *ids = (uint32_t *)malloc((n_types ? n_types : 1) * sizeof(uint32_t));
+  if (!ids) {
+    writer->failed = 1;
+    return;
+  }
+
+  const char *key;
+  json_t *id;
+  size_t i = 0;
+  json_object_foreach(writer->statement_types, key, id) {
+    ids[i++] = (uint32_t)json_integer_value(id);
+  }
+  qsort(ids, n_types, sizeof(uint32_t), compare_ids);
+
+  uint32_t types_start = writer->n_types;
+  for (i = 0; i < n_types; i++) {
+    pg_buffer_put_u32(&writer->types, ids[i]);
+  }
+  writer->n_types += (uint32_t)n_types;
+  free(ids);
+
+  json_t *location = json_object_get(statement, "stmt_location");
+  json_t *length = json_object_get(statement, "stmt_len");
+
+  pg_buffer_put_u64(&writer->index, offset);
+  pg_buffer_put_u32(&writer->index, (uint32_t)(writer->records.length - offset));
+  pg_buffer_put_u32(&writer->index, (uint32_t)query);
+  pg_buffer_put_u32(&writer->index, (uint32_t)(location ? json_integer_value(location) : 0));
+  pg_buffer_put_u32(&writer->index, (uint32_t)(length ? json_integer_value(length) : 0));
+  pg_buffer_put_u32(&writer->index, root_type);
+  pg_buffer_put_u32(&writer->index, types_start);
+  pg_buffer_put_u32(&writer->index, (uint32_t)n_types);
+  writer->n_statements++;
+}
+
+// Appends every statement of one query. Returns its parse error, if any.
+static PgQueryError *write_query(ArchiveWriter *writer, const char *sql, int32_t query, int32_t *version) {
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    return parsed.error;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(
+    NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    writer->failed = 1;
+    return NULL;
+  }
+
+  *version = tree->version;
+
+  for (size_t i = 0; i < tree->n_stmts && !writer->failed; i++) {
+    json_t *statement = NULL;
+    char error[256];
+
+    if (protobuf2json_object(&tree->stmts[i]->base, &statement, error, sizeof(error)) != 0) {
+      writer->failed = 1;
+    } else {
+      write_statement(writer, statement, query);
+    }
+    json_decref(statement);
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+  return NULL;
+}
+
+static void free_writer(ArchiveWriter *writer) {
+  free(writer->records.data);
+  free(writer->string_bytes.data);
+  free(writer->string_offsets.data);
+  free(writer->types.data);
+  free(writer->index.data);
+  json_decref(writer->string_ids);
+  json_decref(writer->statement_types);
+}
+
+// Lays the sections out after the header into one buffer.
+static void assemble(ArchiveWriter *writer, int32_t version, int32_t count, PgArchiveResult *result) {
+  PgBuffer out = {NULL, 0, 0, 0};
+
+  // Close the string offsets with the end of the last string
+  pg_buffer_put_u32(&writer->string_offsets, (uint32_t)writer->string_bytes.length);
+
+  uint64_t strings_offset = PG_ARCHIVE_HEADER_SIZE + writer->records.length;
+  uint64_t types_offset = strings_offset + writer->string_offsets.length + writer->string_bytes.length;
+  uint64_t index_offset = types_offset + writer->types.length;
+
+  pg_buffer_put_bytes(&out, PG_ARCHIVE_MAGIC, 4);
+  pg_buffer_put_u32(&out, PG_ARCHIVE_FORMAT);
+  pg_buffer_put_u32(&out, (uint32_t)version);
+  pg_buffer_put_u32(&out, writer->n_statements);
+  pg_buffer_put_u32(&out, writer->n_strings);
+  pg_buffer_put_u32(&out, (uint32_t)count);
+  pg_buffer_put_u64(&out, strings_offset);
+  pg_buffer_put_u64(&out, types_offset);
+  pg_buffer_put_u64(&out, index_offset);
+
+  pg_buffer_put_bytes(&out, writer->records.data, writer->records.length);
+  pg_buffer_put_bytes(&out, writer->string_offsets.data, writer->string_offsets.length);
+  pg_buffer_put_bytes(&out, writer->string_bytes.data, writer->string_bytes.length);
+  pg_buffer_put_bytes(&out, writer->types.data, writer->types.length);
+  pg_buffer_put_bytes(&out, writer->index.data, writer->index.length);
+
+  if (out.failed) {
+    free(out.data);
+    result->error = pg_make_error("out of memory writing archive");
+    return;
+  }
+
+  result->data = out.data;
+  result->length = (int32_t)out.length;
+}
+
+// `sql` holds `count` null-terminated queries back to back. The first
+// query that fails to parse aborts the archive.
+EXPORT("build_archive")
+PgArchiveResult *build_archive(char *sql, int32_t count) {
+  PgArchiveResult *result = (PgArchiveResult *)calloc(1, sizeof(PgArchiveResult));
+  ArchiveWriter writer = {0};
+  int32_t version = PG_VERSION_NUM;
+
+  result->failed_query = -1;
+  writer.string_ids = json_object();
+  writer.statement_types = json_object();
+
+  for (int32_t i = 0; i < count && !writer.failed; i++) {
+    PgQueryError *error = write_query(&writer, sql, i, &version);
+    if (error) {
+      result->error = error;
+      result->failed_query = i;
+      free_writer(&writer);
+      return result;
+    }
+    sql += strlen(sql) + 1;
+  }
+
+  if (writer.failed || writer.records.failed || writer.string_bytes.failed ||
+      writer.string_offsets.failed || writer.types.failed || writer.index.failed) {
+    result->error = pg_make_error("out of memory writing archive");
+  } else {
+    assemble(&writer, version, count, result);
+  }
+
+  free_writer(&writer);
+  return result;
+}
+
+EXPORT("free_archive_result")
+void free_archive_result(PgArchiveResult *result) {
+  free(result->data);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
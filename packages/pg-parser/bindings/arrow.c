@@ -0,0 +1,728 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "buffer.h"
+#include "common.h"
+#include "macros.h"
+#include "metrics.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Per-statement facts for a batch of queries, written straight from the
+// protobuf walk as an Arrow IPC stream: a schema message, one record batch
+// per `batch_rows` rows, then the end-of-stream marker. See
+// https://arrow.apache.org/docs/format/Columnar.html#serialization-and-interprocess-communication-ipc
+//
+// Message metadata is a flatbuffer (format/Message.fbs and format/Schema.fbs
+// in the Arrow repo). It is small, so it is written front to back by hand
+// rather than with the flatbuffers library: every object is written after
+// the one that points to it, which keeps all uoffsets positive.
+
+// Arrow metadata constants, from format/Schema.fbs and format/Message.fbs
+#define ARROW_METADATA_V5 4
+#define ARROW_HEADER_SCHEMA 1
+#define ARROW_HEADER_RECORD_BATCH 3
+#define ARROW_TYPE_INT 2
+#define ARROW_TYPE_UTF8 5
+#define ARROW_TYPE_LIST 12
+#define ARROW_CONTINUATION 0xffffffffu
+
+typedef enum {
+  PG_ARROW_INT32,
+  PG_ARROW_UINT64,
+  PG_ARROW_UTF8,
+  PG_ARROW_UTF8_LIST,
+} PgArrowType;
+
+// Column order is ABI: exportArrow() in src/pg-parser.ts documents it.
+enum {
+  PG_ARROW_COL_QUERY = 0,
+  PG_ARROW_COL_STATEMENT_TYPE,
+  PG_ARROW_COL_FINGERPRINT,
+  PG_ARROW_COL_TABLES,
+  PG_ARROW_COL_PARAMS,
+  PG_ARROW_COL_METRICS,  // one column per PG_METRIC_*
+  PG_ARROW_COL_ERROR = PG_ARROW_COL_METRICS + PG_METRIC_COUNT,
+  PG_ARROW_COL_COUNT,
+};
+
+typedef struct {
+  const char *name;
+  PgArrowType type;
+  int nullable;
+} ArrowField;
+
+static const ArrowField arrow_fields[PG_ARROW_COL_COUNT] = {
+    [PG_ARROW_COL_QUERY] = {"query", PG_ARROW_INT32, 0},
+    [PG_ARROW_COL_STATEMENT_TYPE] = {"statement_type", PG_ARROW_UTF8, 1},
+    [PG_ARROW_COL_FINGERPRINT] = {"fingerprint", PG_ARROW_UINT64, 1},
+    [PG_ARROW_COL_TABLES] = {"tables", PG_ARROW_UTF8_LIST, 1},
+    [PG_ARROW_COL_PARAMS] = {"params", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_NODES] = {"nodes", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_DEPTH] = {"depth", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_JOINS] = {"joins", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_SUBQUERIES] = {"subqueries", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_CTES] = {"ctes", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_SET_OPERATIONS] = {"set_operations", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_METRICS + PG_METRIC_FUNCTIONS] = {"functions", PG_ARROW_INT32, 1},
+    [PG_ARROW_COL_ERROR] = {"error", PG_ARROW_UTF8, 1},
+};
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12, 16).
+typedef struct {
+  uint8_t *data;
+  int32_t length;
+  int32_t n_rows;
+  PgQueryError *error;
+  int32_t *duplicate_of;  // with `distinct`, per query: its first occurrence
+} PgArrowResult;
+
+// One column of the current record batch, in Arrow's own buffer layout.
+// Lists of strings keep their string child in `items`.
+typedef struct {
+  PgBuffer validity;  // one bit per row
+  PgBuffer values;    // fixed-width values, or int32 offsets
+  PgBuffer bytes;     // UTF-8 data
+  int64_t length;
+  int64_t null_count;
+  PgBuffer item_offsets;
+  PgBuffer item_bytes;
+  int64_t n_items;
+} ArrowColumn;
+
+typedef struct {
+  PgBuffer out;
+  ArrowColumn columns[PG_ARROW_COL_COUNT];
+  int64_t n_rows;      // in the current batch
+  int32_t total_rows;
+  int32_t batch_rows;  // flush after this many rows, or never if 0
+} ArrowWriter;
+
+// Facts gathered while walking one statement
+typedef struct {
+  const char *type;
+  int32_t metrics[PG_METRIC_COUNT];
+  int32_t params;
+  char **tables;  // distinct, as written (`schema.table` or `table`)
+  size_t n_tables;
+  size_t tables_capacity;
+  const char **ctes;
+  size_t n_ctes;
+  size_t ctes_capacity;
+  int failed;
+} StatementFacts;
+
+// Flatbuffers
+
+// A table field: a little-endian scalar of `size` bytes, or a uoffset to
+// an object written after the table. `slot` receives the offset's
+// position, to point it at the object with set_offset().
+typedef struct {
+  uint8_t size;  // 0 if absent
+  uint8_t is_offset;
+  uint64_t value;
+  size_t slot;
+} FbField;
+
+#define FB_ABSENT {0, 0, 0, 0}
+#define FB_SCALAR(size, value) {size, 0, value, 0}
+#define FB_OFFSET {4, 1, 0, 0}
+#define FB_MAX_FIELDS 8
+
+static void set_offset(PgBuffer *buffer, size_t slot, size_t target) {
+  pg_buffer_set_uint(buffer, slot, target - slot, 4);
+}
+
+// Writes a vtable and the table right after it. Fields are laid out
+// largest first after the vtable offset, so with the table 8-aligned
+// every field is naturally aligned.
+static size_t put_table(PgBuffer *buffer, FbField *fields, int n_fields) {
+  uint16_t positions[FB_MAX_FIELDS] = {0};
+  size_t size = 4;
+
+  for (uint8_t width = 8; width > 0; width /= 2) {
+    for (int i = 0; i < n_fields; i++) {
+      if (fields[i].size == width) {
+        size = (size + width - 1) / width * width;
+        positions[i] = (uint16_t)size;
+        size += width;
+      }
+    }
+  }
+
+  pg_buffer_pad_to(buffer, 2);
+  size_t vtable = buffer->length;
+  pg_buffer_put_u16(buffer, (uint16_t)(4 + 2 * n_fields));
+  pg_buffer_put_u16(buffer, (uint16_t)size);
+  for (int i = 0; i < n_fields; i++) {
+    pg_buffer_put_u16(buffer, positions[i]);
+  }
+
+  pg_buffer_pad_to(buffer, 8);
+  size_t table = buffer->length;
+  pg_buffer_put_zeros(buffer, size);
+
+  // The vtable sits `soffset` bytes before the table
+  pg_buffer_set_uint(buffer, table, table - vtable, 4);
+
+  for (int i = 0; i < n_fields; i++) {
+    if (fields[i].is_offset) {
+      fields[i].slot = table + positions[i];
+    } else if (fields[i].size > 0) {
+      pg_buffer_set_uint(buffer, table + positions[i], fields[i].value, fields[i].size);
+    }
+  }
+
+  return table;
+}
+
+static void put_string(PgBuffer *buffer, size_t slot, const char *string) {
+  size_t length = strlen(string);
+
+  pg_buffer_pad_to(buffer, 4);
+  set_offset(buffer, slot, buffer->length);
+  pg_buffer_put_u32(buffer, (uint32_t)length);
+  pg_buffer_put_bytes(buffer, string, length);
+  pg_buffer_put_u8(buffer, 0);
+}
+
+// Writes the length of a vector of offsets and returns the position of
+// its first element, one u32 slot per element.
+static size_t put_offset_vector(PgBuffer *buffer, size_t slot, size_t length) {
+  pg_buffer_pad_to(buffer, 4);
+  set_offset(buffer, slot, buffer->length);
+  pg_buffer_put_u32(buffer, (uint32_t)length);
+
+  size_t items = buffer->length;
+  pg_buffer_put_zeros(buffer, 4 * length);
+  return items;
+}
+
+// Writes a vector of 16-byte structs (FieldNode and Buffer), whose
+// elements must be 8-aligned, so the length goes 4 bytes before that.
+static void put_struct_vector(PgBuffer *buffer, size_t slot, const PgBuffer *structs) {
+  pg_buffer_pad_to(buffer, 4);
+  if (buffer->length % 8 == 0) {
+    pg_buffer_put_u32(buffer, 0);
+  }
+  set_offset(buffer, slot, buffer->length);
+  pg_buffer_put_u32(buffer, (uint32_t)(structs->length / 16));
+  pg_buffer_put_bytes(buffer, structs->data, structs->length);
+}
+
+// Field { name, nullable, type_type, type, children }
+static void put_field(PgBuffer *buffer, size_t slot, const char *name, PgArrowType type, int nullable) {
+  uint8_t type_type = type == PG_ARROW_UTF8 ? ARROW_TYPE_UTF8 : type == PG_ARROW_UTF8_LIST ? ARROW_TYPE_LIST : ARROW_TYPE_INT;
+  FbField fields[] = {
+      FB_OFFSET,
+      FB_SCALAR(1, nullable),
+      FB_SCALAR(1, type_type),
+      FB_OFFSET,
+      FB_ABSENT,
+      FB_OFFSET,
+  };
+
+  size_t table = put_table(buffer, fields, 6);
+  set_offset(buffer, slot, table);
+  put_string(buffer, fields[0].slot, name);
+
+  // Int { bitWidth, is_signed }; Utf8 and List have no fields
+  if (type == PG_ARROW_INT32 || type == PG_ARROW_UINT64) {
+    FbField int_fields[] = {
+        FB_SCALAR(4, type == PG_ARROW_INT32 ? 32 : 64),
+        FB_SCALAR(1, type == PG_ARROW_INT32),
+    };
+    set_offset(buffer, fields[3].slot, put_table(buffer, int_fields, 2));
+  } else {
+    set_offset(buffer, fields[3].slot, put_table(buffer, NULL, 0));
+  }
+
+  // Readers require `children`, even when empty
+  if (type == PG_ARROW_UTF8_LIST) {
+    size_t items = put_offset_vector(buffer, fields[5].slot, 1);
+    put_field(buffer, items, "item", PG_ARROW_UTF8, 0);
+  } else {
+    put_offset_vector(buffer, fields[5].slot, 0);
+  }
+}
+
+// Starts the Message flatbuffer of an IPC message and returns the slot
+// of its `header`, for the caller to point at the Schema or RecordBatch.
+static size_t begin_message(PgBuffer *metadata, uint8_t header_type, int64_t body_length) {
+  FbField fields[] = {
+      FB_SCALAR(2, ARROW_METADATA_V5),
+      FB_SCALAR(1, header_type),
+      FB_OFFSET,
+      FB_SCALAR(8, body_length),
+  };
+
+  // Root offset, then the Message table
+  pg_buffer_put_u32(metadata, 0);
+  set_offset(metadata, 0, put_table(metadata, fields, 4));
+  return fields[2].slot;
+}
+
+// Writes the IPC message: continuation marker, metadata length, the
+// padded Message flatbuffer, then the body.
+static void end_message(PgBuffer *out, PgBuffer *metadata, const PgBuffer *body) {
+  // The metadata is padded so the body starts 8-aligned
+  pg_buffer_pad_to(metadata, 8);
+
+  pg_buffer_put_u32(out, ARROW_CONTINUATION);
+  pg_buffer_put_u32(out, (uint32_t)metadata->length);
+  pg_buffer_put_bytes(out, metadata->data, metadata->length);
+  if (body) {
+    pg_buffer_put_bytes(out, body->data, body->length);
+  }
+
+  if (metadata->failed || (body && body->failed)) {
+    out->failed = 1;
+  }
+  free(metadata->data);
+}
+
+static void write_schema(PgBuffer *out) {
+  PgBuffer metadata = {0};
+  size_t header = begin_message(&metadata, ARROW_HEADER_SCHEMA, 0);
+
+  // Schema { endianness (little, the default), fields }
+  FbField fields[] = {FB_ABSENT, FB_OFFSET};
+  set_offset(&metadata, header, put_table(&metadata, fields, 2));
+
+  size_t items = put_offset_vector(&metadata, fields[1].slot, PG_ARROW_COL_COUNT);
+  for (int i = 0; i < PG_ARROW_COL_COUNT; i++) {
+    put_field(&metadata, items + 4 * i, arrow_fields[i].name, arrow_fields[i].type, arrow_fields[i].nullable);
+  }
+
+  end_message(out, &metadata, NULL);
+}
+
+// Record batches
+
+static void init_column(ArrowColumn *column, PgArrowType type) {
+  memset(column, 0, sizeof(*column));
+
+  // Offsets start at 0
+  if (type == PG_ARROW_UTF8 || type == PG_ARROW_UTF8_LIST) {
+    pg_buffer_put_u32(&column->values, 0);
+  }
+  if (type == PG_ARROW_UTF8_LIST) {
+    pg_buffer_put_u32(&column->item_offsets, 0);
+  }
+}
+
+static void free_column(ArrowColumn *column) {
+  free(column->validity.data);
+  free(column->values.data);
+  free(column->bytes.data);
+  free(column->item_offsets.data);
+  free(column->item_bytes.data);
+}
+
+static int column_failed(const ArrowColumn *column) {
+  return column->validity.failed || column->values.failed || column->bytes.failed || column->item_offsets.failed ||
+         column->item_bytes.failed;
+}
+
+static void append_validity(ArrowColumn *column, int valid) {
+  if (column->length % 8 == 0) {
+    pg_buffer_put_u8(&column->validity, 0);
+  }
+  if (valid && !column->validity.failed) {
+    column->validity.data[column->length / 8] |= (uint8_t)(1 << (column->length % 8));
+  } else if (!valid) {
+    column->null_count++;
+  }
+  column->length++;
+}
+
+static void append_int32(ArrowColumn *column, int32_t value, int valid) {
+  append_validity(column, valid);
+  pg_buffer_put_u32(&column->values, valid ? (uint32_t)value : 0);
+}
+
+static void append_uint64(ArrowColumn *column, uint64_t value, int valid) {
+  append_validity(column, valid);
+  pg_buffer_put_u64(&column->values, valid ? value : 0);
+}
+
+static void append_utf8(ArrowColumn *column, const char *value) {
+  append_validity(column, value != NULL);
+  if (value) {
+    pg_buffer_put_bytes(&column->bytes, value, strlen(value));
+  }
+  pg_buffer_put_u32(&column->values, (uint32_t)column->bytes.length);
+}
+
+static void append_utf8_list(ArrowColumn *column, char **items, size_t n_items, int valid) {
+  append_validity(column, valid);
+  for (size_t i = 0; valid && i < n_items; i++) {
+    pg_buffer_put_bytes(&column->item_bytes, items[i], strlen(items[i]));
+    pg_buffer_put_u32(&column->item_offsets, (uint32_t)column->item_bytes.length);
+    column->n_items++;
+  }
+  pg_buffer_put_u32(&column->values, (uint32_t)column->n_items);
+}
+
+static void add_node(PgBuffer *nodes, int64_t length, int64_t null_count) {
+  pg_buffer_put_u64(nodes, (uint64_t)length);
+  pg_buffer_put_u64(nodes, (uint64_t)null_count);
+}
+
+// Appends a body buffer, 8-aligned, and its Buffer { offset, length }
+static void add_buffer(PgBuffer *body, PgBuffer *buffers, const void *data, size_t length) {
+  pg_buffer_pad_to(body, 8);
+  pg_buffer_put_u64(buffers, body->length);
+  pg_buffer_put_u64(buffers, length);
+  pg_buffer_put_bytes(body, data, length);
+}
+
+// Columns without nulls may leave out their validity bitmap
+static void add_validity(PgBuffer *body, PgBuffer *buffers, const ArrowColumn *column) {
+  if (column->null_count > 0) {
+    add_buffer(body, buffers, column->validity.data, column->validity.length);
+  } else {
+    add_buffer(body, buffers, NULL, 0);
+  }
+}
+
+static void flush_batch(ArrowWriter *writer) {
+  PgBuffer body = {0};
+  PgBuffer nodes = {0};
+  PgBuffer buffers = {0};
+
+  // Nodes and buffers are in depth-first field order
+  for (int i = 0; i < PG_ARROW_COL_COUNT; i++) {
+    ArrowColumn *column = &writer->columns[i];
+
+    add_node(&nodes, column->length, column->null_count);
+    add_validity(&body, &buffers, column);
+    add_buffer(&body, &buffers, column->values.data, column->values.length);
+
+    if (arrow_fields[i].type == PG_ARROW_UTF8) {
+      add_buffer(&body, &buffers, column->bytes.data, column->bytes.length);
+    } else if (arrow_fields[i].type == PG_ARROW_UTF8_LIST) {
+      add_node(&nodes, column->n_items, 0);
+      add_buffer(&body, &buffers, NULL, 0);
+      add_buffer(&body, &buffers, column->item_offsets.data, column->item_offsets.length);
+      add_buffer(&body, &buffers, column->item_bytes.data, column->item_bytes.length);
+    }
+
+    if (column_failed(column)) {
+      body.failed = 1;
+    }
+    free_column(column);
+    init_column(column, arrow_fields[i].type);
+  }
+  pg_buffer_pad_to(&body, 8);
+
+  PgBuffer metadata = {0};
+  size_t header = begin_message(&metadata, ARROW_HEADER_RECORD_BATCH, (int64_t)body.length);
+
+  // RecordBatch { length, nodes, buffers }
+  FbField fields[] = {
+      FB_SCALAR(8, writer->n_rows),
+      FB_OFFSET,
+      FB_OFFSET,
+  };
+  set_offset(&metadata, header, put_table(&metadata, fields, 3));
+  put_struct_vector(&metadata, fields[1].slot, &nodes);
+  put_struct_vector(&metadata, fields[2].slot, &buffers);
+
+  if (nodes.failed || buffers.failed) {
+    metadata.failed = 1;
+  }
+  end_message(&writer->out, &metadata, &body);
+
+  free(body.data);
+  free(nodes.data);
+  free(buffers.data);
+  writer->n_rows = 0;
+}
+
+// Statement facts
+
+static void add_table(StatementFacts *facts, PgQuery__RangeVar *relation) {
+  size_t schema_length = relation->schemaname && *relation->schemaname ? strlen(relation->schemaname) : 0;
+  size_t name_length = strlen(relation->relname);
+  char *table = (char *)malloc(schema_length + name_length + 2);
+
+  if (!table) {
+    facts->failed = 1;
+    return;
+  }
+
+  if (schema_length > 0) {
+    memcpy(table, relation->schemaname, schema_length);
+    table[schema_length++] = '.';
+  }
+  memcpy(table + schema_length, relation->relname, name_length + 1);
+
+  for (size_t i = 0; i < facts->n_tables; i++) {
+    if (strcmp(facts->tables[i], table) == 0) {
+      free(table);
+      return;
+    }
+  }
+
+  if (facts->n_tables == facts->tables_capacity) {
+    size_t capacity = facts->tables_capacity ? facts->tables_capacity * 2 : 8;
+    char **tables = (char **)realloc(facts->tables, capacity * sizeof(char *));
+    if (!tables) {
+      free(table);
+      facts->failed = 1;
+      return;
+    }
+    facts->tables = tables;
+    facts->tables_capacity = capacity;
+  }
+
+  facts->tables[facts->n_tables++] = table;
+}
+
+static void add_cte(StatementFacts *facts, const char *name) {
+  if (facts->n_ctes == facts->ctes_capacity) {
+    size_t capacity = facts->ctes_capacity ? facts->ctes_capacity * 2 : 8;
+    const char **ctes = (const char **)realloc(facts->ctes, capacity * sizeof(char *));
+    if (!ctes) {
+      facts->failed = 1;
+      return;
+    }
+    facts->ctes = ctes;
+    facts->ctes_capacity = capacity;
+  }
+
+  facts->ctes[facts->n_ctes++] = name;
+}
+
+static PgWalkAction collect_facts(ProtobufCMessage *message, int32_t depth, void *context) {
+  StatementFacts *facts = (StatementFacts *)context;
+
+  pg_count_metrics(message, depth, facts->metrics);
+
+  if (depth == 0) {
+    facts->type = message->descriptor->short_name;
+  }
+
+  if (pg_is_message(message, &pg_query__range_var__descriptor)) {
+    PgQuery__RangeVar *relation = (PgQuery__RangeVar *)message;
+    if (relation->relname && *relation->relname) {
+      add_table(facts, relation);
+    }
+  } else if (pg_is_message(message, &pg_query__common_table_expr__descriptor)) {
+    PgQuery__CommonTableExpr *cte = (PgQuery__CommonTableExpr *)message;
+    if (cte->ctename) {
+      add_cte(facts, cte->ctename);
+    }
+  } else if (pg_is_message(message, &pg_query__param_ref__descriptor)) {
+    PgQuery__ParamRef *param = (PgQuery__ParamRef *)message;
+    if (param->number > facts->params) {
+      facts->params = param->number;
+    }
+  }
+
+  return facts->failed ? PG_WALK_STOP : PG_WALK_CONTINUE;
+}
+
+// Unqualified references to a CTE of the same statement aren't tables.
+// Scoping is approximate: a CTE name shadows the table everywhere in
+// the statement.
+static void drop_cte_references(StatementFacts *facts) {
+  size_t kept = 0;
+
+  for (size_t i = 0; i < facts->n_tables; i++) {
+    int is_cte = 0;
+    for (size_t j = 0; j < facts->n_ctes && !is_cte; j++) {
+      is_cte = strcmp(facts->tables[i], facts->ctes[j]) == 0;
+    }
+
+    if (is_cte) {
+      free(facts->tables[i]);
+    } else {
+      facts->tables[kept++] = facts->tables[i];
+    }
+  }
+
+  facts->n_tables = kept;
+}
+
+static void free_facts(StatementFacts *facts) {
+  for (size_t i = 0; i < facts->n_tables; i++) {
+    free(facts->tables[i]);
+  }
+  free(facts->tables);
+  free(facts->ctes);
+}
+
+// Fingerprints one statement of `sql` on its own, so statements of a
+// multi-statement query get the same fingerprint as when logged alone.
+static int fingerprint_statement(const char *sql, PgQuery__RawStmt *raw, uint64_t *fingerprint) {
+  size_t location = (size_t)raw->stmt_location;
+  size_t length = raw->stmt_len > 0 ? (size_t)raw->stmt_len : strlen(sql + location);
+  char *text = (char *)malloc(length + 1);
+
+  if (!text) {
+    return -1;
+  }
+  memcpy(text, sql + location, length);
+  text[length] = '\0';
+
+  PgQueryFingerprintResult result = pg_query_fingerprint(text);
+  int status = result.error ? -1 : 0;
+  *fingerprint = result.fingerprint;
+
+  pg_query_free_fingerprint_result(result);
+  free(text);
+  return status;
+}
+
+static void add_row(ArrowWriter *writer, int32_t query, const StatementFacts *facts, const uint64_t *fingerprint,
+                    const char *error) {
+  ArrowColumn *columns = writer->columns;
+  int valid = facts != NULL;
+
+  append_int32(&columns[PG_ARROW_COL_QUERY], query, 1);
+  append_utf8(&columns[PG_ARROW_COL_STATEMENT_TYPE], valid ? facts->type : NULL);
+  append_uint64(&columns[PG_ARROW_COL_FINGERPRINT], fingerprint ? *fingerprint : 0, fingerprint != NULL);
+  append_utf8_list(&columns[PG_ARROW_COL_TABLES], valid ? facts->tables : NULL, valid ? facts->n_tables : 0, valid);
+  append_int32(&columns[PG_ARROW_COL_PARAMS], valid ? facts->params : 0, valid);
+  for (int i = 0; i < PG_METRIC_COUNT; i++) {
+    append_int32(&columns[PG_ARROW_COL_METRICS + i], valid ? facts->metrics[i] : 0, valid);
+  }
+  append_utf8(&columns[PG_ARROW_COL_ERROR], error);
+
+  writer->n_rows++;
+  writer->total_rows++;
+
+  if (writer->batch_rows > 0 && writer->n_rows >= writer->batch_rows) {
+    flush_batch(writer);
+  }
+}
+
+// Returns -1 if out of memory
+static int write_query(ArrowWriter *writer, const char *sql, int32_t query) {
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    add_row(writer, query, NULL, NULL, parsed.error->message);
+    pg_query_free_error(parsed.error);
+    free(parsed.parse_tree.data);
+    return 0;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    add_row(writer, query, NULL, NULL, "failed to unpack parse tree");
+    return 0;
+  }
+
+  int status = 0;
+
+  for (size_t i = 0; i < tree->n_stmts && status == 0; i++) {
+    StatementFacts facts = {0};
+    uint64_t fingerprint;
+
+    if (pg_walk((ProtobufCMessage *)tree->stmts[i]->stmt, collect_facts, &facts) != 0 || facts.failed) {
+      status = -1;
+    } else {
+      drop_cte_references(&facts);
+      int fingerprinted = fingerprint_statement(sql, tree->stmts[i], &fingerprint) == 0;
+      add_row(writer, query, &facts, fingerprinted ? &fingerprint : NULL, NULL);
+    }
+
+    free_facts(&facts);
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+  return status;
+}
+
+// `sql` holds `count` null-terminated queries back to back. Each statement
+// is a row; a query that fails to parse is a single row with only `query`
+// and `error` set, so one bad log line doesn't fail the batch. Record
+// batches hold up to `batch_rows` rows, or all of them if it is 0.
+//
+// With `distinct`, only the first occurrence of each distinct query text
+// is parsed and written, and `duplicate_of` maps every query to it.
+EXPORT("export_arrow")
+PgArrowResult *export_arrow(char *sql, int32_t count, int32_t batch_rows, int32_t distinct) {
+  PgArrowResult *result = (PgArrowResult *)calloc(1, sizeof(PgArrowResult));
+  ArrowWriter writer = {0};
+  int failed = 0;
+
+  writer.batch_rows = batch_rows;
+  for (int i = 0; i < PG_ARROW_COL_COUNT; i++) {
+    init_column(&writer.columns[i], arrow_fields[i].type);
+  }
+
+  write_schema(&writer.out);
+
+  if (distinct) {
+    PgBatch batch;
+
+    if (pg_batch_dedupe(sql, count, &batch) != 0) {
+      failed = 1;
+    } else {
+      for (int32_t i = 0; i < batch.n_unique && !failed; i++) {
+        failed = write_query(&writer, batch.unique[i], batch.first[i]) != 0;
+      }
+
+      result->duplicate_of = (int32_t *)malloc(((size_t)count + 1) * sizeof(int32_t));
+      if (result->duplicate_of) {
+        for (int32_t i = 0; i < count; i++) {
+          result->duplicate_of[i] = batch.first[batch.indexes[i]];
+        }
+      } else {
+        failed = 1;
+      }
+
+      pg_batch_free(&batch);
+    }
+  } else {
+    for (int32_t i = 0; i < count && !failed; i++) {
+      failed = write_query(&writer, sql, i) != 0;
+      sql += strlen(sql) + 1;
+    }
+  }
+
+  if (writer.n_rows > 0) {
+    flush_batch(&writer);
+  }
+
+  // End of stream
+  pg_buffer_put_u32(&writer.out, ARROW_CONTINUATION);
+  pg_buffer_put_u32(&writer.out, 0);
+
+  for (int i = 0; i < PG_ARROW_COL_COUNT; i++) {
+    free_column(&writer.columns[i]);
+  }
+
+  if (failed || writer.out.failed) {
+    free(writer.out.data);
+    free(result->duplicate_of);
+    result->duplicate_of = NULL;
+    result->error = pg_make_error("out of memory writing arrow stream");
+    return result;
+  }
+
+  result->data = writer.out.data;
+  result->length = (int32_t)writer.out.length;
+  result->n_rows = writer.total_rows;
+  return result;
+}
+
+EXPORT("free_arrow_result")
+void free_arrow_result(PgArrowResult *result) {
+  free(result->data);
+  free(result->duplicate_of);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
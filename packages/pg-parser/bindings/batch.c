@@ -0,0 +1,84 @@
+#include "batch.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  uint64_t hash;
+  size_t length;
+} QueryKey;
+
+// FNV-1a over the query, also finding its length
+static QueryKey hash_query(const char *sql) {
+  QueryKey key = {14695981039346656037ull, 0};
+
+  for (const unsigned char *c = (const unsigned char *)sql; *c; c++) {
+    key.hash = (key.hash ^ *c) * 1099511628211ull;
+    key.length++;
+  }
+
+  return key;
+}
+
+int pg_batch_dedupe(const char *sql, int32_t count, PgBatch *batch) {
+  memset(batch, 0, sizeof(*batch));
+
+  // Open addressing, at most half full
+  size_t capacity = 16;
+  while (capacity < (size_t)count * 2) {
+    capacity *= 2;
+  }
+
+  int32_t *slots = (int32_t *)calloc(capacity, sizeof(int32_t));  // position + 1, 0 if empty
+  QueryKey *keys = (QueryKey *)malloc(((size_t)count + 1) * sizeof(QueryKey));
+  batch->unique = (const char **)malloc(((size_t)count + 1) * sizeof(char *));
+  batch->first = (int32_t *)malloc(((size_t)count + 1) * sizeof(int32_t));
+  batch->indexes = (int32_t *)malloc(((size_t)count + 1) * sizeof(int32_t));
+
+  if (!slots || !keys || !batch->unique || !batch->first || !batch->indexes) {
+    free(slots);
+    free(keys);
+    pg_batch_free(batch);
+    return -1;
+  }
+
+  for (int32_t i = 0; i < count; i++) {
+    QueryKey key = hash_query(sql);
+    size_t slot = (size_t)key.hash & (capacity - 1);
+
+    for (;;) {
+      int32_t position = slots[slot] - 1;
+
+      if (position < 0) {
+        position = batch->n_unique++;
+        slots[slot] = position + 1;
+        keys[position] = key;
+        batch->unique[position] = sql;
+        batch->first[position] = i;
+        batch->indexes[i] = position;
+        break;
+      }
+
+      if (keys[position].hash == key.hash && keys[position].length == key.length &&
+          memcmp(batch->unique[position], sql, key.length) == 0) {
+        batch->indexes[i] = position;
+        break;
+      }
+
+      slot = (slot + 1) & (capacity - 1);
+    }
+
+    sql += key.length + 1;
+  }
+
+  free(slots);
+  free(keys);
+  return 0;
+}
+
+void pg_batch_free(PgBatch *batch) {
+  free(batch->unique);
+  free(batch->first);
+  free(batch->indexes);
+  memset(batch, 0, sizeof(*batch));
+}
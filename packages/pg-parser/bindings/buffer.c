@@ -0,0 +1,89 @@
+#include "buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int pg_buffer_reserve(PgBuffer *buffer, size_t size) {
+  if (buffer->failed) {
+    return -1;
+  }
+  if (buffer->length + size <= buffer->capacity) {
+    return 0;
+  }
+
+  size_t capacity = buffer->capacity ? buffer->capacity : 256;
+  while (capacity < buffer->length + size) {
+    capacity *= 2;
+  }
+
+  uint8_t *data = (uint8_t *)realloc(buffer->data, capacity);
+  if (!data) {
+    buffer->failed = 1;
+    return -1;
+  }
+  buffer->data = data;
+  buffer->capacity = capacity;
+  return 0;
+}
+
+void pg_buffer_put_bytes(PgBuffer *buffer, const void *bytes, size_t size) {
+  if (size > 0 && pg_buffer_reserve(buffer, size) == 0) {
+    memcpy(buffer->data + buffer->length, bytes, size);
+    buffer->length += size;
+  }
+}
+
+void pg_buffer_put_zeros(PgBuffer *buffer, size_t size) {
+  if (size > 0 && pg_buffer_reserve(buffer, size) == 0) {
+    memset(buffer->data + buffer->length, 0, size);
+    buffer->length += size;
+  }
+}
+
+void pg_buffer_set_uint(PgBuffer *buffer, size_t position, uint64_t value, size_t size) {
+  if (!buffer->failed) {
+    for (size_t i = 0; i < size; i++) {
+      buffer->data[position + i] = (uint8_t)(value >> (8 * i));
+    }
+  }
+}
+
+void pg_buffer_put_uint(PgBuffer *buffer, uint64_t value, size_t size) {
+  size_t position = buffer->length;
+  pg_buffer_put_zeros(buffer, size);
+  pg_buffer_set_uint(buffer, position, value, size);
+}
+
+void pg_buffer_put_u8(PgBuffer *buffer, uint8_t value) {
+  pg_buffer_put_bytes(buffer, &value, 1);
+}
+
+void pg_buffer_put_u16(PgBuffer *buffer, uint16_t value) {
+  pg_buffer_put_uint(buffer, value, 2);
+}
+
+void pg_buffer_put_u32(PgBuffer *buffer, uint32_t value) {
+  pg_buffer_put_uint(buffer, value, 4);
+}
+
+void pg_buffer_put_u64(PgBuffer *buffer, uint64_t value) {
+  pg_buffer_put_uint(buffer, value, 8);
+}
+
+void pg_buffer_put_f64(PgBuffer *buffer, double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  pg_buffer_put_u64(buffer, bits);
+}
+
+void pg_buffer_put_varint(PgBuffer *buffer, uint64_t value) {
+  while (value >= 0x80) {
+    pg_buffer_put_u8(buffer, (uint8_t)(value | 0x80));
+    value >>= 7;
+  }
+  pg_buffer_put_u8(buffer, (uint8_t)value);
+}
+
+void pg_buffer_pad_to(PgBuffer *buffer, size_t alignment) {
+  pg_buffer_put_zeros(buffer, (alignment - buffer->length % alignment) % alignment);
+}
@@ -0,0 +1,801 @@
+#include <jansson.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "macros.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Builds a schema catalog (schemas, tables, columns, constraints, indexes,
+// types, sequences and functions) from a DDL script in one pass over its
+// top-level statements, and returns it as compact JSON. Type names and
+// expressions are rendered with the node deparser so they come out in
+// canonical form (e.g. `int`, `varchar(255)`).
+//
+// Statements are replayed in order: CREATE adds objects and ALTER TABLE /
+// ALTER SEQUENCE updates them. CREATE OR REPLACE (and a repeated CREATE)
+// replaces the existing entry in place, and CREATE ... IF NOT EXISTS
+// leaves it alone. DROP and RENAME aren't modelled.
+
+// Field order is ABI: JS reads these by byte offset (0, 4).
+typedef struct {
+  char *json;
+  PgQueryError *error;
+} PgCatalogResult;
+
+typedef struct {
+  json_t *schemas;
+  json_t *tables;
+  json_t *indexes;
+  json_t *types;
+  json_t *sequences;
+  json_t *functions;
+
+  // Lookups for ALTER statements, keyed by object_key(). Values are
+  // borrowed from the arrays above.
+  json_t *tables_by_name;
+  json_t *sequences_by_name;
+} PgCatalog;
+
+// Unqualified names in a script without a surrounding CREATE SCHEMA
+// resolve against the default search_path.
+#define PG_CATALOG_DEFAULT_SCHEMA "public"
+
+static json_t *string_or_null(const char *value) {
+  return value && *value ? json_string(value) : json_null();
+}
+
+static char *object_key(const char *schema, const char *name) {
+  size_t schema_length = strlen(schema);
+  size_t name_length = strlen(name);
+
+  // Unit separator can't appear in an identifier
+  char *key = (char *)malloc(schema_length + name_length + 2);
+  memcpy(key, schema, schema_length);
+  key[schema_length] = '\x1f';
+  memcpy(key + schema_length + 1, name, name_length + 1);
+  return key;
+}
+
+static json_t *find_object(json_t *index, const char *schema, const char *name) {
+  char *key = object_key(schema, name);
+  json_t *object = json_object_get(index, key);
+  free(key);
+  return object;
+}
+
+static void index_object(json_t *index, const char *schema, const char *name, json_t *object) {
+  char *key = object_key(schema, name);
+  json_object_set(index, key, object);
+  free(key);
+}
+
+// Puts `object` where `existing` is in `array`, or appends it if there is
+// no existing entry. Steals the reference to `object`.
+static void put_object(json_t *array, json_t *existing, json_t *object) {
+  size_t i;
+  json_t *value;
+
+  if (existing) {
+    json_array_foreach(array, i, value) {
+      if (value == existing) {
+        json_array_set_new(array, i, object);
+        return;
+      }
+    }
+  }
+  json_array_append_new(array, object);
+}
+
+static const char *relation_schema(PgQuery__RangeVar *relation, const char *default_schema) {
+  return relation->schemaname && *relation->schemaname ? relation->schemaname : default_schema;
+}
+
+// Splits a `[catalog.][schema.]name` list as used by CREATE TYPE and
+// CREATE FUNCTION.
+static int split_name(PgQuery__Node **items, size_t n_items, const char *default_schema, const char **schema, const char **name) {
+  if (n_items == 0 || !pg_string_value(items[n_items - 1])) {
+    return 0;
+  }
+
+  *name = pg_string_value(items[n_items - 1]);
+  *schema = n_items > 1 && pg_string_value(items[n_items - 2]) ? pg_string_value(items[n_items - 2]) : default_schema;
+  return 1;
+}
+
+// Renders a node back to SQL with the node deparser, or null if it
+// can't be deparsed.
+static json_t *deparse_json(PgQuery__Node *node) {
+  if (!node) {
+    return json_null();
+  }
+
+  size_t length = pg_query__node__get_packed_size(node);
+  uint8_t *data = (uint8_t *)malloc(length);
+  pg_query__node__pack(node, data);
+
+  PgQueryProtobuf protobuf = {length, (char *)data};
+  PgQueryDeparseResult deparsed = pg_query_deparse_node_protobuf(protobuf);
+  free(data);
+
+  json_t *value = deparsed.error || !deparsed.query ? json_null() : json_string(deparsed.query);
+  pg_query_free_deparse_result(deparsed);
+  return value;
+}
+
+static json_t *deparse_type(PgQuery__TypeName *type_name) {
+  if (!type_name) {
+    return json_null();
+  }
+
+  PgQuery__Node node = PG_QUERY__NODE__INIT;
+  node.node_case = PG_QUERY__NODE__NODE_TYPE_NAME;
+  node.type_name = type_name;
+  return deparse_json(&node);
+}
+
+static json_t *name_list(PgQuery__Node **items, size_t n_items) {
+  json_t *names = json_array();
+  for (size_t i = 0; i < n_items; i++) {
+    const char *name = pg_string_value(items[i]);
+    if (name) {
+      json_array_append_new(names, json_string(name));
+    }
+  }
+  return names;
+}
+
+// Index and exclusion elements are either a column name or an expression.
+static json_t *index_elem_json(PgQuery__IndexElem *elem) {
+  if (elem->name && *elem->name) {
+    return json_string(elem->name);
+  }
+  return deparse_json(elem->expr);
+}
+
+static int find_by_name(json_t *array, const char *name, size_t *position) {
+  size_t i;
+  json_t *item;
+
+  json_array_foreach(array, i, item) {
+    const char *item_name = json_string_value(json_object_get(item, "name"));
+    if (item_name && strcmp(item_name, name) == 0) {
+      *position = i;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static json_t *find_column(json_t *table, const char *name) {
+  json_t *columns = json_object_get(table, "columns");
+  size_t position;
+
+  return find_by_name(columns, name, &position) ? json_array_get(columns, position) : NULL;
+}
+
+static void mark_not_null(json_t *table, json_t *columns) {
+  size_t i;
+  json_t *name;
+
+  json_array_foreach(columns, i, name) {
+    json_t *column = json_string_value(name) ? find_column(table, json_string_value(name)) : NULL;
+    if (column) {
+      json_object_set(column, "notNull", json_true());
+    }
+  }
+}
+
+static const char *constraint_type(PgQuery__ConstrType contype) {
+  switch (contype) {
+    case PG_QUERY__CONSTR_TYPE__CONSTR_PRIMARY:
+      return "primary_key";
+    case PG_QUERY__CONSTR_TYPE__CONSTR_UNIQUE:
+      return "unique";
+    case PG_QUERY__CONSTR_TYPE__CONSTR_FOREIGN:
+      return "foreign_key";
+    case PG_QUERY__CONSTR_TYPE__CONSTR_CHECK:
+      return "check";
+    case PG_QUERY__CONSTR_TYPE__CONSTR_EXCLUSION:
+      return "exclusion";
+    default:
+      return NULL;
+  }
+}
+
+// Converts a table constraint, or a column constraint when `column` is
+// set. Returns NULL for constraints that only affect a column (NOT NULL,
+// DEFAULT, ...).
+static json_t *constraint_json(PgQuery__Constraint *constraint, const char *column, const char *default_schema) {
+  const char *type = constraint_type(constraint->contype);
+  if (!type) {
+    return NULL;
+  }
+
+  json_t *columns;
+  if (column) {
+    columns = json_array();
+    json_array_append_new(columns, json_string(column));
+  } else if (constraint->contype == PG_QUERY__CONSTR_TYPE__CONSTR_FOREIGN) {
+    columns = name_list(constraint->fk_attrs, constraint->n_fk_attrs);
+  } else if (constraint->contype == PG_QUERY__CONSTR_TYPE__CONSTR_EXCLUSION) {
+    // Each exclusion is a (IndexElem, operator name list) pair
+    columns = json_array();
+    for (size_t i = 0; i < constraint->n_exclusions; i++) {
+      PgQuery__Node *pair = constraint->exclusions[i];
+      if (pair->node_case == PG_QUERY__NODE__NODE_LIST && pair->list->n_items > 0 &&
+          pair->list->items[0]->node_case == PG_QUERY__NODE__NODE_INDEX_ELEM) {
+        json_array_append_new(columns, index_elem_json(pair->list->items[0]->index_elem));
+      }
+    }
+  } else {
+    columns = name_list(constraint->keys, constraint->n_keys);
+  }
+
+  json_t *references = json_null();
+  if (constraint->contype == PG_QUERY__CONSTR_TYPE__CONSTR_FOREIGN && constraint->pktable) {
+    references = json_pack(
+        "{s:s, s:s, s:o}",
+        "schema", relation_schema(constraint->pktable, default_schema),
+        "table", constraint->pktable->relname,
+        "columns", name_list(constraint->pk_attrs, constraint->n_pk_attrs));
+  }
+
+  return json_pack(
+      "{s:o, s:s, s:o, s:o, s:o}",
+      "name", string_or_null(constraint->conname),
+      "type", type,
+      "columns", columns,
+      "expression", constraint->contype == PG_QUERY__CONSTR_TYPE__CONSTR_CHECK ? deparse_json(constraint->raw_expr) : json_null(),
+      "references", references);
+}
+
+static void add_constraint(json_t *table, PgQuery__Constraint *constraint, const char *column, const char *default_schema) {
+  json_t *converted = constraint_json(constraint, column, default_schema);
+  if (!converted) {
+    return;
+  }
+
+  // A primary key implies NOT NULL on its columns
+  if (constraint->contype == PG_QUERY__CONSTR_TYPE__CONSTR_PRIMARY) {
+    mark_not_null(table, json_object_get(converted, "columns"));
+  }
+
+  json_array_append_new(json_object_get(table, "constraints"), converted);
+}
+
+static void add_column(json_t *table, PgQuery__ColumnDef *def, const char *default_schema) {
+  json_t *column = json_pack(
+      "{s:s, s:o, s:b, s:o}",
+      "name", def->colname,
+      "type", deparse_type(def->type_name),
+      "notNull", def->is_not_null,
+      "default", deparse_json(def->raw_default));
+
+  json_array_append_new(json_object_get(table, "columns"), column);
+
+  for (size_t i = 0; i < def->n_constraints; i++) {
+    if (def->constraints[i]->node_case != PG_QUERY__NODE__NODE_CONSTRAINT) {
+      continue;
+    }
+
+    PgQuery__Constraint *constraint = def->constraints[i]->constraint;
+    switch (constraint->contype) {
+      case PG_QUERY__CONSTR_TYPE__CONSTR_NOTNULL:
+        json_object_set(column, "notNull", json_true());
+        break;
+      case PG_QUERY__CONSTR_TYPE__CONSTR_NULL:
+        json_object_set(column, "notNull", json_false());
+        break;
+      case PG_QUERY__CONSTR_TYPE__CONSTR_DEFAULT:
+        json_object_set_new(column, "default", deparse_json(constraint->raw_expr));
+        break;
+      default:
+        add_constraint(table, constraint, def->colname, default_schema);
+        break;
+    }
+  }
+}
+
+// Returns the new relation, or NULL for IF NOT EXISTS on one that exists.
+static json_t *add_relation(PgCatalog *catalog, PgQuery__RangeVar *relation, const char *kind, int if_not_exists, const char *default_schema) {
+  const char *schema = relation_schema(relation, default_schema);
+  json_t *existing = find_object(catalog->tables_by_name, schema, relation->relname);
+
+  if (existing && if_not_exists) {
+    return NULL;
+  }
+
+  json_t *table = json_pack(
+      "{s:s, s:s, s:s, s:[], s:[]}",
+      "schema", schema,
+      "name", relation->relname,
+      "kind", kind,
+      "columns",
+      "constraints");
+
+  put_object(catalog->tables, existing, table);
+  index_object(catalog->tables_by_name, schema, relation->relname, table);
+  return table;
+}
+
+static void add_create_stmt(PgCatalog *catalog, PgQuery__CreateStmt *stmt, const char *kind, const char *default_schema) {
+  json_t *table = add_relation(catalog, stmt->relation, kind, stmt->if_not_exists, default_schema);
+  if (!table) {
+    return;
+  }
+
+  for (size_t i = 0; i < stmt->n_table_elts; i++) {
+    PgQuery__Node *elt = stmt->table_elts[i];
+
+    if (elt->node_case == PG_QUERY__NODE__NODE_COLUMN_DEF) {
+      add_column(table, elt->column_def, default_schema);
+    } else if (elt->node_case == PG_QUERY__NODE__NODE_CONSTRAINT) {
+      add_constraint(table, elt->constraint, NULL, default_schema);
+    }
+  }
+
+  for (size_t i = 0; i < stmt->n_constraints; i++) {
+    if (stmt->constraints[i]->node_case == PG_QUERY__NODE__NODE_CONSTRAINT) {
+      add_constraint(table, stmt->constraints[i]->constraint, NULL, default_schema);
+    }
+  }
+}
+
+static void remove_by_name(json_t *array, const char *name) {
+  size_t position;
+  if (name && find_by_name(array, name, &position)) {
+    json_array_remove(array, position);
+  }
+}
+
+static void alter_table(PgCatalog *catalog, PgQuery__AlterTableStmt *stmt, const char *default_schema) {
+  json_t *table = find_object(catalog->tables_by_name, relation_schema(stmt->relation, default_schema), stmt->relation->relname);
+  if (!table) {
+    return;
+  }
+
+  for (size_t i = 0; i < stmt->n_cmds; i++) {
+    if (stmt->cmds[i]->node_case != PG_QUERY__NODE__NODE_ALTER_TABLE_CMD) {
+      continue;
+    }
+
+    PgQuery__AlterTableCmd *cmd = stmt->cmds[i]->alter_table_cmd;
+    PgQuery__Node *def = cmd->def;
+    json_t *column = cmd->name && *cmd->name ? find_column(table, cmd->name) : NULL;
+
+    switch (cmd->subtype) {
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_AddColumn:
+        if (def && def->node_case == PG_QUERY__NODE__NODE_COLUMN_DEF) {
+          add_column(table, def->column_def, default_schema);
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_DropColumn:
+        remove_by_name(json_object_get(table, "columns"), cmd->name);
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_ColumnDefault:
+        if (column) {
+          json_object_set_new(column, "default", deparse_json(def));
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_SetNotNull:
+        if (column) {
+          json_object_set(column, "notNull", json_true());
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_DropNotNull:
+        if (column) {
+          json_object_set(column, "notNull", json_false());
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_AlterColumnType:
+        if (column && def && def->node_case == PG_QUERY__NODE__NODE_COLUMN_DEF) {
+          json_object_set_new(column, "type", deparse_type(def->column_def->type_name));
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_AddConstraint:
+        if (def && def->node_case == PG_QUERY__NODE__NODE_CONSTRAINT) {
+          add_constraint(table, def->constraint, NULL, default_schema);
+        }
+        break;
+      case PG_QUERY__ALTER_TABLE_TYPE__AT_DropConstraint:
+        remove_by_name(json_object_get(table, "constraints"), cmd->name);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+static json_t *find_index(PgCatalog *catalog, const char *schema, const char *name) {
+  size_t i;
+  json_t *index;
+
+  json_array_foreach(catalog->indexes, i, index) {
+    if (json_is_string(json_object_get(index, "name")) &&
+        strcmp(json_string_value(json_object_get(index, "schema")), schema) == 0 &&
+        strcmp(json_string_value(json_object_get(index, "name")), name) == 0) {
+      return index;
+    }
+  }
+  return NULL;
+}
+
+static void add_index(PgCatalog *catalog, PgQuery__IndexStmt *stmt, const char *default_schema) {
+  const char *schema = relation_schema(stmt->relation, default_schema);
+
+  // Unnamed indexes get a generated name, so only named ones can clash
+  if (stmt->if_not_exists && stmt->idxname && *stmt->idxname && find_index(catalog, schema, stmt->idxname)) {
+    return;
+  }
+
+  json_t *columns = json_array();
+  for (size_t i = 0; i < stmt->n_index_params; i++) {
+    if (stmt->index_params[i]->node_case == PG_QUERY__NODE__NODE_INDEX_ELEM) {
+      json_array_append_new(columns, index_elem_json(stmt->index_params[i]->index_elem));
+    }
+  }
+
+  // Indexes always live in their table's schema
+  json_array_append_new(
+      catalog->indexes,
+      json_pack(
+          "{s:s, s:o, s:s, s:s, s:b, s:o, s:o}",
+          "schema", schema,
+          "name", string_or_null(stmt->idxname),
+          "table", stmt->relation->relname,
+          "method", stmt->access_method && *stmt->access_method ? stmt->access_method : "btree",
+          "unique", stmt->unique || stmt->primary,
+          "columns", columns,
+          "predicate", deparse_json(stmt->where_clause)));
+}
+
+static json_t *owned_by_json(PgQuery__Node *arg) {
+  if (!arg || arg->node_case != PG_QUERY__NODE__NODE_LIST || arg->list->n_items < 2) {
+    // OWNED BY NONE
+    return json_null();
+  }
+
+  PgQuery__Node **items = arg->list->items;
+  size_t n_items = arg->list->n_items;
+  const char *column = pg_string_value(items[n_items - 1]);
+  const char *table = pg_string_value(items[n_items - 2]);
+  const char *schema = n_items > 2 ? pg_string_value(items[n_items - 3]) : NULL;
+
+  if (!column || !table) {
+    return json_null();
+  }
+
+  return json_pack("{s:o, s:s, s:s}", "schema", string_or_null(schema), "table", table, "column", column);
+}
+
+static void apply_sequence_options(json_t *sequence, PgQuery__Node **options, size_t n_options) {
+  for (size_t i = 0; i < n_options; i++) {
+    if (options[i]->node_case != PG_QUERY__NODE__NODE_DEF_ELEM) {
+      continue;
+    }
+
+    PgQuery__DefElem *option = options[i]->def_elem;
+    if (strcmp(option->defname, "owned_by") == 0) {
+      json_object_set_new(sequence, "ownedBy", owned_by_json(option->arg));
+    }
+  }
+}
+
+static void add_sequence(PgCatalog *catalog, PgQuery__CreateSeqStmt *stmt, const char *default_schema) {
+  const char *schema = relation_schema(stmt->sequence, default_schema);
+  json_t *existing = find_object(catalog->sequences_by_name, schema, stmt->sequence->relname);
+
+  if (existing && stmt->if_not_exists) {
+    return;
+  }
+
+  json_t *sequence = json_pack("{s:s, s:s, s:n}", "schema", schema, "name", stmt->sequence->relname, "ownedBy");
+  apply_sequence_options(sequence, stmt->options, stmt->n_options);
+
+  put_object(catalog->sequences, existing, sequence);
+  index_object(catalog->sequences_by_name, schema, stmt->sequence->relname, sequence);
+}
+
+static void alter_sequence(PgCatalog *catalog, PgQuery__AlterSeqStmt *stmt, const char *default_schema) {
+  json_t *sequence = find_object(catalog->sequences_by_name, relation_schema(stmt->sequence, default_schema), stmt->sequence->relname);
+  if (sequence) {
+    apply_sequence_options(sequence, stmt->options, stmt->n_options);
+  }
+}
+
+static void add_type(PgCatalog *catalog, const char *schema, const char *name, const char *kind, const char *key, json_t *value) {
+  json_t *type = json_pack("{s:s, s:s, s:s}", "schema", schema, "name", name, "kind", kind);
+  json_object_set_new(type, key, value);
+  json_array_append_new(catalog->types, type);
+}
+
+static void add_named_type(PgCatalog *catalog, PgQuery__Node **names, size_t n_names, const char *kind, const char *default_schema, const char *key, json_t *value) {
+  const char *schema;
+  const char *name;
+
+  if (split_name(names, n_names, default_schema, &schema, &name)) {
+    add_type(catalog, schema, name, kind, key, value);
+  } else {
+    json_decref(value);
+  }
+}
+
+static json_t *range_subtype(PgQuery__CreateRangeStmt *stmt) {
+  for (size_t i = 0; i < stmt->n_params; i++) {
+    if (stmt->params[i]->node_case != PG_QUERY__NODE__NODE_DEF_ELEM) {
+      continue;
+    }
+
+    PgQuery__DefElem *param = stmt->params[i]->def_elem;
+    if (strcmp(param->defname, "subtype") == 0 && param->arg && param->arg->node_case == PG_QUERY__NODE__NODE_TYPE_NAME) {
+      return deparse_type(param->arg->type_name);
+    }
+  }
+  return json_null();
+}
+
+static json_t *attributes_json(PgQuery__Node **coldeflist, size_t n_coldeflist) {
+  json_t *attributes = json_array();
+  for (size_t i = 0; i < n_coldeflist; i++) {
+    if (coldeflist[i]->node_case == PG_QUERY__NODE__NODE_COLUMN_DEF) {
+      PgQuery__ColumnDef *def = coldeflist[i]->column_def;
+      json_array_append_new(attributes, json_pack("{s:s, s:o}", "name", def->colname, "type", deparse_type(def->type_name)));
+    }
+  }
+  return attributes;
+}
+
+static const char *parameter_mode(PgQuery__FunctionParameterMode mode) {
+  switch (mode) {
+    case PG_QUERY__FUNCTION_PARAMETER_MODE__FUNC_PARAM_OUT:
+      return "out";
+    case PG_QUERY__FUNCTION_PARAMETER_MODE__FUNC_PARAM_INOUT:
+      return "inout";
+    case PG_QUERY__FUNCTION_PARAMETER_MODE__FUNC_PARAM_VARIADIC:
+      return "variadic";
+    case PG_QUERY__FUNCTION_PARAMETER_MODE__FUNC_PARAM_TABLE:
+      return "table";
+    default:
+      return "in";
+  }
+}
+
+static int is_input(json_t *argument) {
+  const char *mode = json_string_value(json_object_get(argument, "mode"));
+  return strcmp(mode, "out") != 0 && strcmp(mode, "table") != 0;
+}
+
+// Functions are identified by name and input argument types, so
+// overloads are separate entries.
+static int same_signature(json_t *function, const char *schema, const char *name, json_t *arguments) {
+  if (strcmp(json_string_value(json_object_get(function, "schema")), schema) != 0 ||
+      strcmp(json_string_value(json_object_get(function, "name")), name) != 0) {
+    return 0;
+  }
+
+  json_t *existing = json_object_get(function, "arguments");
+  size_t i = 0;
+  size_t j = 0;
+
+  for (;;) {
+    while (i < json_array_size(existing) && !is_input(json_array_get(existing, i))) {
+      i++;
+    }
+    while (j < json_array_size(arguments) && !is_input(json_array_get(arguments, j))) {
+      j++;
+    }
+
+    if (i == json_array_size(existing) || j == json_array_size(arguments)) {
+      return i == json_array_size(existing) && j == json_array_size(arguments);
+    }
+
+    if (!json_equal(json_object_get(json_array_get(existing, i), "type"), json_object_get(json_array_get(arguments, j), "type"))) {
+      return 0;
+    }
+    i++;
+    j++;
+  }
+}
+
+static void add_function(PgCatalog *catalog, PgQuery__CreateFunctionStmt *stmt, const char *default_schema) {
+  const char *schema;
+  const char *name;
+
+  if (!split_name(stmt->funcname, stmt->n_funcname, default_schema, &schema, &name)) {
+    return;
+  }
+
+  json_t *arguments = json_array();
+  for (size_t i = 0; i < stmt->n_parameters; i++) {
+    if (stmt->parameters[i]->node_case != PG_QUERY__NODE__NODE_FUNCTION_PARAMETER) {
+      continue;
+    }
+
+    PgQuery__FunctionParameter *parameter = stmt->parameters[i]->function_parameter;
+    json_array_append_new(
+        arguments,
+        json_pack(
+            "{s:o, s:o, s:s}",
+            "name", string_or_null(parameter->name),
+            "type", deparse_type(parameter->arg_type),
+            "mode", parameter_mode(parameter->mode)));
+  }
+
+  json_t *existing = NULL;
+  size_t i;
+  json_t *function;
+
+  json_array_foreach(catalog->functions, i, function) {
+    if (same_signature(function, schema, name, arguments)) {
+      existing = function;
+      break;
+    }
+  }
+
+  put_object(
+      catalog->functions,
+      existing,
+      json_pack(
+          "{s:s, s:s, s:s, s:o, s:o}",
+          "schema", schema,
+          "name", name,
+          "kind", stmt->is_procedure ? "procedure" : "function",
+          "arguments", arguments,
+          "returns", deparse_type(stmt->return_type)));
+}
+
+static void add_schema(PgCatalog *catalog, const char *name) {
+  size_t i;
+  json_t *schema;
+
+  // CREATE SCHEMA IF NOT EXISTS may repeat a schema
+  json_array_foreach(catalog->schemas, i, schema) {
+    if (strcmp(json_string_value(schema), name) == 0) {
+      return;
+    }
+  }
+  json_array_append_new(catalog->schemas, json_string(name));
+}
+
+static void add_statement(PgCatalog *catalog, PgQuery__Node *stmt, const char *default_schema) {
+  switch (stmt->node_case) {
+    case PG_QUERY__NODE__NODE_CREATE_SCHEMA_STMT: {
+      PgQuery__CreateSchemaStmt *create = stmt->create_schema_stmt;
+      if (!create->schemaname || !*create->schemaname) {
+        break;
+      }
+
+      add_schema(catalog, create->schemaname);
+
+      // Unqualified objects created inside CREATE SCHEMA belong to it
+      for (size_t i = 0; i < create->n_schema_elts; i++) {
+        add_statement(catalog, create->schema_elts[i], create->schemaname);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_STMT:
+      add_create_stmt(catalog, stmt->create_stmt, "table", default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_FOREIGN_TABLE_STMT:
+      add_create_stmt(catalog, stmt->create_foreign_table_stmt->base_stmt, "foreign_table", default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_VIEW_STMT:
+      add_relation(catalog, stmt->view_stmt->view, "view", 0, default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_TABLE_AS_STMT: {
+      PgQuery__CreateTableAsStmt *create = stmt->create_table_as_stmt;
+      const char *kind = create->objtype == PG_QUERY__OBJECT_TYPE__OBJECT_MATVIEW ? "materialized_view" : "table";
+      add_relation(catalog, create->into->rel, kind, create->if_not_exists, default_schema);
+      break;
+    }
+    case PG_QUERY__NODE__NODE_ALTER_TABLE_STMT:
+      alter_table(catalog, stmt->alter_table_stmt, default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_INDEX_STMT:
+      add_index(catalog, stmt->index_stmt, default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_SEQ_STMT:
+      add_sequence(catalog, stmt->create_seq_stmt, default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_SEQ_STMT:
+      alter_sequence(catalog, stmt->alter_seq_stmt, default_schema);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_ENUM_STMT: {
+      PgQuery__CreateEnumStmt *create = stmt->create_enum_stmt;
+      add_named_type(catalog, create->type_name, create->n_type_name, "enum", default_schema, "values", name_list(create->vals, create->n_vals));
+      break;
+    }
+    case PG_QUERY__NODE__NODE_COMPOSITE_TYPE_STMT: {
+      PgQuery__CompositeTypeStmt *create = stmt->composite_type_stmt;
+      add_type(catalog, relation_schema(create->typevar, default_schema), create->typevar->relname, "composite", "attributes", attributes_json(create->coldeflist, create->n_coldeflist));
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_DOMAIN_STMT: {
+      PgQuery__CreateDomainStmt *create = stmt->create_domain_stmt;
+      add_named_type(catalog, create->domainname, create->n_domainname, "domain", default_schema, "baseType", deparse_type(create->type_name));
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_RANGE_STMT: {
+      PgQuery__CreateRangeStmt *create = stmt->create_range_stmt;
+      add_named_type(catalog, create->type_name, create->n_type_name, "range", default_schema, "subtype", range_subtype(create));
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_FUNCTION_STMT:
+      add_function(catalog, stmt->create_function_stmt, default_schema);
+      break;
+    default:
+      break;
+  }
+}
+
+EXPORT("build_catalog")
+PgCatalogResult *build_catalog(char *sql) {
+  PgCatalogResult *result = (PgCatalogResult *)calloc(1, sizeof(PgCatalogResult));
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    result->error = parsed.error;
+    return result;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    result->error = pg_make_error("failed to unpack parse tree");
+    return result;
+  }
+
+  PgCatalog catalog = {
+      .schemas = json_array(),
+      .tables = json_array(),
+      .indexes = json_array(),
+      .types = json_array(),
+      .sequences = json_array(),
+      .functions = json_array(),
+      .tables_by_name = json_object(),
+      .sequences_by_name = json_object(),
+  };
+
+  for (size_t i = 0; i < tree->n_stmts; i++) {
+    add_statement(&catalog, tree->stmts[i]->stmt, PG_CATALOG_DEFAULT_SCHEMA);
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+
+  json_t *root = json_pack(
+      "{s:o, s:o, s:o, s:o, s:o, s:o}",
+      "schemas", catalog.schemas,
+      "tables", catalog.tables,
+      "indexes", catalog.indexes,
+      "types", catalog.types,
+      "sequences", catalog.sequences,
+      "functions", catalog.functions);
+
+  json_decref(catalog.tables_by_name);
+  json_decref(catalog.sequences_by_name);
+
+  result->json = root ? json_dumps(root, JSON_COMPACT) : NULL;
+  json_decref(root);
+
+  if (!result->json) {
+    result->error = pg_make_error("failed to serialize catalog");
+  }
+
+  return result;
+}
+
+EXPORT("free_catalog_result")
+void free_catalog_result(PgCatalogResult *result) {
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->json);
+  free(result);
+}
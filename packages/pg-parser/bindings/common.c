@@ -0,0 +1,28 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+PgQueryError *pg_make_error(const char *message) {
+  PgQueryError *error = (PgQueryError *)calloc(1, sizeof(PgQueryError));
+  if (!error) {
+    return NULL;
+  }
+
+  error->message = strdup(message);
+  if (!error->message) {
+    free(error);
+    return NULL;
+  }
+
+  return error;
+}
+
+const char *pg_string_value(PgQuery__Node *node) {
+  if (node && node->node_case == PG_QUERY__NODE__NODE_STRING) {
+    return node->string->sval;
+  }
+  return NULL;
+}
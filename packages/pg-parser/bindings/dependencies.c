@@ -0,0 +1,773 @@
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "lexer.h"
+#include "macros.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Statement-level dependency graph for DDL scripts, so independent
+// statements can be applied in parallel.
+//
+// Each statement writes the objects it creates or alters (its targets)
+// and reads every other object it mentions: relations, types, functions
+// and schemas found anywhere in its tree, plus `'name'::regclass` casts.
+// Dependencies follow the usual read/write hazards per object: a read
+// waits for the last write, and a write waits for the last write and for
+// every read since. Statements whose effects can't be attributed to named
+// objects (SET, SELECT, CREATE EXTENSION, DO, ...) are barriers: they
+// wait for everything before them, and everything after waits for them.
+//
+// Function bodies are opaque strings, so objects used only inside a body
+// aren't tracked (Postgres doesn't resolve them at creation time either,
+// as long as check_function_bodies is off, which pg_dump ensures).
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12, 16).
+typedef struct {
+  int32_t n_stmts;
+  int32_t n_layers;
+  int32_t length;  // number of int32s in `data`
+  int32_t *data;   // per statement: start, end, layer, barrier, n_deps, deps...
+  PgQueryError *error;
+} PgDependencyResult;
+
+// Unqualified names resolve against the default search_path.
+#define PG_DEPENDENCY_DEFAULT_SCHEMA "public"
+
+// Object namespaces. Relations (tables, views, sequences, indexes, ...)
+// share one namespace in Postgres, as do all types.
+#define PG_OBJECT_RELATION 'r'
+#define PG_OBJECT_TYPE 't'
+#define PG_OBJECT_FUNCTION 'f'
+#define PG_OBJECT_SCHEMA 'n'
+#define PG_OBJECT_EVENT_TRIGGER 'e'
+#define PG_OBJECT_PUBLICATION 'p'
+
+typedef struct {
+  int32_t *items;
+  int32_t length;
+  int32_t capacity;
+} IntList;
+
+typedef struct {
+  char *key;
+  int32_t writer;     // last statement that wrote the object, -1 if none
+  IntList readers;    // statements that read it since that write
+} ObjectState;
+
+// Open-addressing hash map from object key to its hazard state.
+typedef struct {
+  ObjectState *slots;
+  size_t capacity;
+  size_t count;
+} ObjectMap;
+
+typedef struct {
+  char *key;
+  int write;
+} Access;
+
+typedef struct {
+  Access *items;
+  int32_t length;
+  int32_t capacity;
+  const char *default_schema;
+  int barrier;
+  int failed;
+} AccessList;
+
+static int int_list_push(IntList *list, int32_t value) {
+  if (list->length == list->capacity) {
+    int32_t capacity = list->capacity ? list->capacity * 2 : 8;
+    int32_t *items = (int32_t *)realloc(list->items, capacity * sizeof(int32_t));
+    if (!items) {
+      return -1;
+    }
+    list->items = items;
+    list->capacity = capacity;
+  }
+
+  list->items[list->length++] = value;
+  return 0;
+}
+
+static uint32_t hash_key(const char *key) {
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+  for (const unsigned char *c = (const unsigned char *)key; *c; c++) {
+    hash = (hash ^ *c) * 16777619u;
+  }
+  return hash;
+}
+
+static ObjectState *find_slot(ObjectState *slots, size_t capacity, const char *key) {
+  size_t i = hash_key(key) & (capacity - 1);
+  while (slots[i].key && strcmp(slots[i].key, key) != 0) {
+    i = (i + 1) & (capacity - 1);
+  }
+  return &slots[i];
+}
+
+// Returns the state for `key`, creating it if needed. The pointer is only
+// valid until the next call.
+static ObjectState *object_state(ObjectMap *map, const char *key) {
+  if ((map->count + 1) * 2 > map->capacity) {
+    size_t capacity = map->capacity ? map->capacity * 2 : 256;
+    ObjectState *slots = (ObjectState *)calloc(capacity, sizeof(ObjectState));
+    if (!slots) {
+      return NULL;
+    }
+
+    for (size_t i = 0; i < map->capacity; i++) {
+      if (map->slots[i].key) {
+        *find_slot(slots, capacity, map->slots[i].key) = map->slots[i];
+      }
+    }
+
+    free(map->slots);
+    map->slots = slots;
+    map->capacity = capacity;
+  }
+
+  ObjectState *state = find_slot(map->slots, map->capacity, key);
+  if (!state->key) {
+    state->key = strdup(key);
+    state->writer = -1;
+    map->count++;
+  }
+  return state;
+}
+
+static void free_object_map(ObjectMap *map) {
+  for (size_t i = 0; i < map->capacity; i++) {
+    free(map->slots[i].key);
+    free(map->slots[i].readers.items);
+  }
+  free(map->slots);
+}
+
+static void add_access(AccessList *list, char kind, const char *schema, const char *name, int write) {
+  if (!name || !*name || list->failed) {
+    return;
+  }
+
+  size_t schema_length = schema ? strlen(schema) : 0;
+  size_t name_length = strlen(name);
+
+  // kind, then `schema<US>name` or just `name` for unqualified namespaces
+  char *key = (char *)malloc(schema_length + name_length + 3);
+  if (!key) {
+    list->failed = 1;
+    return;
+  }
+
+  char *end = key;
+  *end++ = kind;
+  if (schema) {
+    memcpy(end, schema, schema_length);
+    end += schema_length;
+    *end++ = '\x1f';
+  }
+  memcpy(end, name, name_length + 1);
+
+  if (list->length == list->capacity) {
+    int32_t capacity = list->capacity ? list->capacity * 2 : 16;
+    Access *items = (Access *)realloc(list->items, capacity * sizeof(Access));
+    if (!items) {
+      free(key);
+      list->failed = 1;
+      return;
+    }
+    list->items = items;
+    list->capacity = capacity;
+  }
+
+  list->items[list->length].key = key;
+  list->items[list->length].write = write;
+  list->length++;
+
+  // Anything in an explicit schema depends on that schema existing
+  if (schema && schema != list->default_schema) {
+    add_access(list, PG_OBJECT_SCHEMA, NULL, schema, 0);
+  }
+}
+
+static void add_qualified(AccessList *list, char kind, const char *schema, const char *name, int write) {
+  add_access(list, kind, schema && *schema ? schema : list->default_schema, name, write);
+}
+
+// Adds a `[catalog.][schema.]name` list, ignoring the last `drop_last`
+// items (e.g. the column in `schema.table.column`).
+static void add_name_list(AccessList *list, char kind, PgQuery__Node **items, size_t n_items, size_t drop_last, int write) {
+  if (n_items <= drop_last) {
+    return;
+  }
+
+  n_items -= drop_last;
+  const char *name = pg_string_value(items[n_items - 1]);
+  const char *schema = n_items > 1 ? pg_string_value(items[n_items - 2]) : NULL;
+
+  add_qualified(list, kind, schema, name, write);
+}
+
+static void add_range_var(AccessList *list, PgQuery__RangeVar *relation, int write) {
+  if (relation) {
+    add_qualified(list, PG_OBJECT_RELATION, relation->schemaname, relation->relname, write);
+  }
+}
+
+// Adds a relation and its row type, for statements that create both.
+static void add_relation_with_type(AccessList *list, PgQuery__RangeVar *relation) {
+  add_range_var(list, relation, 1);
+  if (relation) {
+    add_qualified(list, PG_OBJECT_TYPE, relation->schemaname, relation->relname, 1);
+  }
+}
+
+// Adds an object named by the generic `object` field of COMMENT, DROP,
+// ALTER ... OWNER etc. Marks the statement as a barrier when the object
+// kind isn't tracked, so it is never reordered incorrectly.
+static void add_object(AccessList *list, PgQuery__ObjectType type, PgQuery__Node *object, int write) {
+  PgQuery__Node **items = NULL;
+  size_t n_items = 0;
+
+  if (!object) {
+    list->barrier = 1;
+    return;
+  }
+
+  switch (object->node_case) {
+    case PG_QUERY__NODE__NODE_RANGE_VAR:
+      add_range_var(list, object->range_var, write);
+      return;
+    case PG_QUERY__NODE__NODE_STRING:
+      items = &object;
+      n_items = 1;
+      break;
+    case PG_QUERY__NODE__NODE_LIST:
+      items = object->list->items;
+      n_items = object->list->n_items;
+      break;
+    case PG_QUERY__NODE__NODE_TYPE_NAME:
+      items = object->type_name->names;
+      n_items = object->type_name->n_names;
+      break;
+    case PG_QUERY__NODE__NODE_OBJECT_WITH_ARGS:
+      items = object->object_with_args->objname;
+      n_items = object->object_with_args->n_objname;
+      break;
+    default:
+      list->barrier = 1;
+      return;
+  }
+
+  switch (type) {
+    case PG_QUERY__OBJECT_TYPE__OBJECT_TABLE:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_VIEW:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_MATVIEW:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_SEQUENCE:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_INDEX:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_FOREIGN_TABLE:
+      add_name_list(list, PG_OBJECT_RELATION, items, n_items, 0, write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_COLUMN:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_TABCONSTRAINT:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_TRIGGER:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_POLICY:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_RULE:
+      // `[schema.]table.member`: the member belongs to its table
+      add_name_list(list, PG_OBJECT_RELATION, items, n_items, 1, write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_TYPE:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_DOMAIN:
+      add_name_list(list, PG_OBJECT_TYPE, items, n_items, 0, write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_FUNCTION:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_PROCEDURE:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_ROUTINE:
+    case PG_QUERY__OBJECT_TYPE__OBJECT_AGGREGATE:
+      add_name_list(list, PG_OBJECT_FUNCTION, items, n_items, 0, write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_SCHEMA:
+      add_access(list, PG_OBJECT_SCHEMA, NULL, pg_string_value(items[0]), write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_EVENT_TRIGGER:
+      add_access(list, PG_OBJECT_EVENT_TRIGGER, NULL, pg_string_value(items[0]), write);
+      break;
+    case PG_QUERY__OBJECT_TYPE__OBJECT_PUBLICATION:
+      add_access(list, PG_OBJECT_PUBLICATION, NULL, pg_string_value(items[0]), write);
+      break;
+    default:
+      list->barrier = 1;
+      break;
+  }
+}
+
+// Adds the relation named by a `'[schema.]name'::regclass` literal,
+// folding unquoted identifiers to lower case like Postgres does.
+static void add_regclass(AccessList *list, const char *value) {
+  size_t length = strlen(value);
+  char *parts[2] = {NULL, NULL};
+  int n_parts = 0;
+
+  char *buffer = (char *)malloc(length + 1);
+  if (!buffer) {
+    list->failed = 1;
+    return;
+  }
+
+  const char *c = value;
+  char *out = buffer;
+
+  while (n_parts < 2) {
+    char *part = out;
+
+    if (*c == '"') {
+      for (c++; *c && !(*c == '"' && c[1] != '"'); c++) {
+        *out++ = *c;
+        if (*c == '"') {
+          c++;
+        }
+      }
+      if (*c == '"') {
+        c++;
+      }
+    } else {
+      for (; *c && *c != '.'; c++) {
+        *out++ = (char)tolower((unsigned char)*c);
+      }
+    }
+
+    *out++ = '\0';
+    parts[n_parts++] = part;
+
+    if (*c != '.') {
+      break;
+    }
+    c++;
+  }
+
+  if (*c == '\0') {
+    if (n_parts == 2) {
+      add_qualified(list, PG_OBJECT_RELATION, parts[0], parts[1], 0);
+    } else {
+      add_qualified(list, PG_OBJECT_RELATION, NULL, parts[0], 0);
+    }
+  }
+
+  free(buffer);
+}
+
+static PgWalkAction collect_reads(ProtobufCMessage *message, int32_t depth, void *context) {
+  AccessList *list = (AccessList *)context;
+  (void)depth;
+
+  if (pg_is_message(message, &pg_query__range_var__descriptor)) {
+    add_range_var(list, (PgQuery__RangeVar *)message, 0);
+  } else if (pg_is_message(message, &pg_query__type_name__descriptor)) {
+    PgQuery__TypeName *type_name = (PgQuery__TypeName *)message;
+
+    // `table.column%TYPE` names a column, not a type
+    if (type_name->pct_type) {
+      add_name_list(list, PG_OBJECT_RELATION, type_name->names, type_name->n_names, 1, 0);
+    } else {
+      add_name_list(list, PG_OBJECT_TYPE, type_name->names, type_name->n_names, 0, 0);
+    }
+  } else if (pg_is_message(message, &pg_query__func_call__descriptor)) {
+    PgQuery__FuncCall *call = (PgQuery__FuncCall *)message;
+    add_name_list(list, PG_OBJECT_FUNCTION, call->funcname, call->n_funcname, 0, 0);
+  } else if (pg_is_message(message, &pg_query__type_cast__descriptor)) {
+    PgQuery__TypeCast *cast = (PgQuery__TypeCast *)message;
+    PgQuery__TypeName *type_name = cast->type_name;
+
+    if (type_name && type_name->n_names > 0 && cast->arg && cast->arg->node_case == PG_QUERY__NODE__NODE_A_CONST &&
+        cast->arg->a_const->val_case == PG_QUERY__A__CONST__VAL_SVAL) {
+      const char *type = pg_string_value(type_name->names[type_name->n_names - 1]);
+      if (type && strcmp(type, "regclass") == 0) {
+        add_regclass(list, cast->arg->a_const->sval->sval);
+      }
+    }
+  }
+
+  return PG_WALK_CONTINUE;
+}
+
+static void add_sequence_owner(AccessList *list, PgQuery__Node **options, size_t n_options) {
+  for (size_t i = 0; i < n_options; i++) {
+    if (options[i]->node_case != PG_QUERY__NODE__NODE_DEF_ELEM) {
+      continue;
+    }
+
+    PgQuery__DefElem *option = options[i]->def_elem;
+    if (strcmp(option->defname, "owned_by") == 0 && option->arg && option->arg->node_case == PG_QUERY__NODE__NODE_LIST) {
+      // `OWNED BY [schema.]table.column` (or NONE, a single item)
+      add_name_list(list, PG_OBJECT_RELATION, option->arg->list->items, option->arg->list->n_items, 1, 0);
+    }
+  }
+}
+
+// Adds the objects a statement creates or alters. Anything not handled
+// here is a barrier.
+static void collect_writes(AccessList *list, PgQuery__Node *stmt) {
+  switch (stmt->node_case) {
+    case PG_QUERY__NODE__NODE_CREATE_SCHEMA_STMT: {
+      PgQuery__CreateSchemaStmt *create = stmt->create_schema_stmt;
+      if (!create->schemaname || !*create->schemaname) {
+        list->barrier = 1;
+        break;
+      }
+
+      add_access(list, PG_OBJECT_SCHEMA, NULL, create->schemaname, 1);
+
+      // Unqualified objects created inside CREATE SCHEMA belong to it
+      list->default_schema = create->schemaname;
+      for (size_t i = 0; i < create->n_schema_elts; i++) {
+        collect_writes(list, create->schema_elts[i]);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_STMT:
+      add_relation_with_type(list, stmt->create_stmt->relation);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_FOREIGN_TABLE_STMT:
+      add_relation_with_type(list, stmt->create_foreign_table_stmt->base_stmt->relation);
+      break;
+    case PG_QUERY__NODE__NODE_VIEW_STMT:
+      add_relation_with_type(list, stmt->view_stmt->view);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_TABLE_AS_STMT:
+      add_relation_with_type(list, stmt->create_table_as_stmt->into->rel);
+      break;
+    case PG_QUERY__NODE__NODE_COMPOSITE_TYPE_STMT:
+      add_relation_with_type(list, stmt->composite_type_stmt->typevar);
+      break;
+    case PG_QUERY__NODE__NODE_INDEX_STMT: {
+      // The index lives in its table's schema. The table itself is a read,
+      // unless the index is unique: a later foreign key that references
+      // the table needs it, so that has to wait for this statement.
+      PgQuery__IndexStmt *index = stmt->index_stmt;
+      if (index->idxname && *index->idxname) {
+        add_qualified(list, PG_OBJECT_RELATION, index->relation->schemaname, index->idxname, 1);
+      }
+      if (index->unique || index->primary) {
+        add_range_var(list, index->relation, 1);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_SEQ_STMT:
+      add_range_var(list, stmt->create_seq_stmt->sequence, 1);
+      add_sequence_owner(list, stmt->create_seq_stmt->options, stmt->create_seq_stmt->n_options);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_SEQ_STMT:
+      add_range_var(list, stmt->alter_seq_stmt->sequence, 1);
+      add_sequence_owner(list, stmt->alter_seq_stmt->options, stmt->alter_seq_stmt->n_options);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_TABLE_STMT:
+      add_range_var(list, stmt->alter_table_stmt->relation, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_ENUM_STMT:
+      add_name_list(list, PG_OBJECT_TYPE, stmt->create_enum_stmt->type_name, stmt->create_enum_stmt->n_type_name, 0, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_DOMAIN_STMT:
+      add_name_list(list, PG_OBJECT_TYPE, stmt->create_domain_stmt->domainname, stmt->create_domain_stmt->n_domainname, 0, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_RANGE_STMT:
+      add_name_list(list, PG_OBJECT_TYPE, stmt->create_range_stmt->type_name, stmt->create_range_stmt->n_type_name, 0, 1);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_ENUM_STMT:
+      add_name_list(list, PG_OBJECT_TYPE, stmt->alter_enum_stmt->type_name, stmt->alter_enum_stmt->n_type_name, 0, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_FUNCTION_STMT:
+      add_name_list(list, PG_OBJECT_FUNCTION, stmt->create_function_stmt->funcname, stmt->create_function_stmt->n_funcname, 0, 1);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_FUNCTION_STMT: {
+      PgQuery__ObjectWithArgs *func = stmt->alter_function_stmt->func;
+      add_name_list(list, PG_OBJECT_FUNCTION, func->objname, func->n_objname, 0, 1);
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_TRIG_STMT: {
+      PgQuery__CreateTrigStmt *create = stmt->create_trig_stmt;
+      add_range_var(list, create->relation, 1);
+      add_name_list(list, PG_OBJECT_FUNCTION, create->funcname, create->n_funcname, 0, 0);
+      break;
+    }
+    case PG_QUERY__NODE__NODE_CREATE_EVENT_TRIG_STMT: {
+      PgQuery__CreateEventTrigStmt *create = stmt->create_event_trig_stmt;
+      add_access(list, PG_OBJECT_EVENT_TRIGGER, NULL, create->trigname, 1);
+      add_name_list(list, PG_OBJECT_FUNCTION, create->funcname, create->n_funcname, 0, 0);
+      break;
+    }
+    case PG_QUERY__NODE__NODE_ALTER_EVENT_TRIG_STMT:
+      add_access(list, PG_OBJECT_EVENT_TRIGGER, NULL, stmt->alter_event_trig_stmt->trigname, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_POLICY_STMT:
+      add_range_var(list, stmt->create_policy_stmt->table, 1);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_POLICY_STMT:
+      add_range_var(list, stmt->alter_policy_stmt->table, 1);
+      break;
+    case PG_QUERY__NODE__NODE_RULE_STMT:
+      add_range_var(list, stmt->rule_stmt->relation, 1);
+      break;
+    case PG_QUERY__NODE__NODE_CREATE_PUBLICATION_STMT:
+      add_access(list, PG_OBJECT_PUBLICATION, NULL, stmt->create_publication_stmt->pubname, 1);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_PUBLICATION_STMT:
+      add_access(list, PG_OBJECT_PUBLICATION, NULL, stmt->alter_publication_stmt->pubname, 1);
+      break;
+    case PG_QUERY__NODE__NODE_COMMENT_STMT:
+      add_object(list, stmt->comment_stmt->objtype, stmt->comment_stmt->object, 1);
+      break;
+    case PG_QUERY__NODE__NODE_ALTER_OWNER_STMT: {
+      PgQuery__AlterOwnerStmt *alter = stmt->alter_owner_stmt;
+      if (alter->relation) {
+        add_range_var(list, alter->relation, 1);
+      } else {
+        add_object(list, alter->object_type, alter->object, 1);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_ALTER_OBJECT_SCHEMA_STMT: {
+      PgQuery__AlterObjectSchemaStmt *alter = stmt->alter_object_schema_stmt;
+      if (alter->relation) {
+        add_range_var(list, alter->relation, 1);
+      } else {
+        add_object(list, alter->object_type, alter->object, 1);
+      }
+      add_access(list, PG_OBJECT_SCHEMA, NULL, alter->newschema, 0);
+      break;
+    }
+    case PG_QUERY__NODE__NODE_RENAME_STMT: {
+      PgQuery__RenameStmt *rename = stmt->rename_stmt;
+      if (rename->relation) {
+        add_range_var(list, rename->relation, 1);
+
+        // The relation is known by its new name from here on
+        if (rename->rename_type != PG_QUERY__OBJECT_TYPE__OBJECT_COLUMN &&
+            rename->rename_type != PG_QUERY__OBJECT_TYPE__OBJECT_TABCONSTRAINT) {
+          add_qualified(list, PG_OBJECT_RELATION, rename->relation->schemaname, rename->newname, 1);
+        }
+      } else {
+        add_object(list, rename->rename_type, rename->object, 1);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_DROP_STMT: {
+      PgQuery__DropStmt *drop = stmt->drop_stmt;
+      for (size_t i = 0; i < drop->n_objects; i++) {
+        add_object(list, drop->remove_type, drop->objects[i], 1);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_GRANT_STMT: {
+      PgQuery__GrantStmt *grant = stmt->grant_stmt;
+      if (grant->targtype != PG_QUERY__GRANT_TARGET_TYPE__ACL_TARGET_OBJECT) {
+        list->barrier = 1;
+        break;
+      }
+      for (size_t i = 0; i < grant->n_objects; i++) {
+        add_object(list, grant->objtype, grant->objects[i], 1);
+      }
+      break;
+    }
+    case PG_QUERY__NODE__NODE_INSERT_STMT:
+      add_range_var(list, stmt->insert_stmt->relation, 1);
+      break;
+    case PG_QUERY__NODE__NODE_UPDATE_STMT:
+      add_range_var(list, stmt->update_stmt->relation, 1);
+      break;
+    case PG_QUERY__NODE__NODE_DELETE_STMT:
+      add_range_var(list, stmt->delete_stmt->relation, 1);
+      break;
+    case PG_QUERY__NODE__NODE_COPY_STMT:
+      if (stmt->copy_stmt->relation) {
+        add_range_var(list, stmt->copy_stmt->relation, 1);
+      } else {
+        list->barrier = 1;
+      }
+      break;
+    default:
+      // SET, SELECT, CREATE EXTENSION, DO, ALTER DEFAULT PRIVILEGES, ...
+      list->barrier = 1;
+      break;
+  }
+}
+
+static void clear_accesses(AccessList *list) {
+  for (int32_t i = 0; i < list->length; i++) {
+    free(list->items[i].key);
+  }
+  list->length = 0;
+  list->barrier = 0;
+}
+
+// Records a dependency of statement `stmt` on `dep`, once.
+static int add_dep(IntList *deps, int32_t *seen, int32_t stmt, int32_t dep) {
+  if (dep < 0 || dep == stmt || seen[dep] == stmt) {
+    return 0;
+  }
+  seen[dep] = stmt;
+  return int_list_push(deps, dep);
+}
+
+// Trims leading whitespace and comments (which the parser attaches to the
+// following statement) and trailing whitespace from a statement's span.
+static void trim_statement(const char *sql, int32_t *start, int32_t *end) {
+  PgLexer lexer;
+  pg_lexer_init(&lexer, sql + *start, *end - *start);
+
+  for (;;) {
+    PgLexToken token = pg_lexer_next(&lexer);
+    if (token.kind != PG_LEX_LINE_COMMENT && token.kind != PG_LEX_BLOCK_COMMENT) {
+      if (token.kind != PG_LEX_EOF) {
+        *start += token.start;
+      }
+      break;
+    }
+  }
+
+  while (*end > *start && isspace((unsigned char)sql[*end - 1])) {
+    (*end)--;
+  }
+}
+
+EXPORT("build_dependency_graph")
+PgDependencyResult *build_dependency_graph(char *sql) {
+  PgDependencyResult *result = (PgDependencyResult *)calloc(1, sizeof(PgDependencyResult));
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    result->error = parsed.error;
+    return result;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    result->error = pg_make_error("failed to unpack parse tree");
+    return result;
+  }
+
+  int32_t n_stmts = (int32_t)tree->n_stmts;
+  int32_t sql_length = (int32_t)strlen(sql);
+
+  ObjectMap objects = {NULL, 0, 0};
+  AccessList accesses = {NULL, 0, 0, PG_DEPENDENCY_DEFAULT_SCHEMA, 0, 0};
+  IntList deps = {NULL, 0, 0};
+  IntList data = {NULL, 0, 0};
+  int32_t *seen = (int32_t *)malloc((n_stmts + 1) * sizeof(int32_t));
+  int32_t *layers = (int32_t *)malloc((n_stmts + 1) * sizeof(int32_t));
+  int32_t last_barrier = -1;
+  int32_t n_layers = 0;
+  int failed = !seen || !layers;
+
+  for (int32_t s = 0; s < n_stmts && !failed; s++) {
+    PgQuery__RawStmt *raw = tree->stmts[s];
+
+    seen[s] = -1;
+    deps.length = 0;
+    accesses.default_schema = PG_DEPENDENCY_DEFAULT_SCHEMA;
+
+    collect_writes(&accesses, raw->stmt);
+    if (pg_walk((ProtobufCMessage *)raw->stmt, collect_reads, &accesses) != 0 || accesses.failed) {
+      failed = 1;
+      break;
+    }
+
+    if (accesses.barrier) {
+      // Waits for everything since (and including) the previous barrier
+      for (int32_t i = last_barrier < 0 ? 0 : last_barrier; i < s && !failed; i++) {
+        failed = add_dep(&deps, seen, s, i) != 0;
+      }
+    } else {
+      failed = add_dep(&deps, seen, s, last_barrier) != 0;
+    }
+
+    for (int32_t i = 0; i < accesses.length && !failed; i++) {
+      ObjectState *state = object_state(&objects, accesses.items[i].key);
+      if (!state) {
+        failed = 1;
+        break;
+      }
+
+      failed = add_dep(&deps, seen, s, state->writer) != 0;
+
+      if (accesses.items[i].write) {
+        for (int32_t r = 0; r < state->readers.length && !failed; r++) {
+          failed = add_dep(&deps, seen, s, state->readers.items[r]) != 0;
+        }
+        state->writer = s;
+        state->readers.length = 0;
+      } else if (state->readers.length == 0 || state->readers.items[state->readers.length - 1] != s) {
+        failed = failed || int_list_push(&state->readers, s) != 0;
+      }
+    }
+
+    int32_t barrier = accesses.barrier;
+    if (barrier) {
+      last_barrier = s;
+    }
+    clear_accesses(&accesses);
+
+    // Dependencies always point backwards, so layers resolve in one pass
+    int32_t layer = 0;
+    for (int32_t i = 0; i < deps.length; i++) {
+      if (layers[deps.items[i]] + 1 > layer) {
+        layer = layers[deps.items[i]] + 1;
+      }
+    }
+    layers[s] = layer;
+    if (layer + 1 > n_layers) {
+      n_layers = layer + 1;
+    }
+
+    int32_t start = raw->stmt_location;
+    int32_t end = raw->stmt_len ? start + raw->stmt_len : sql_length;
+    trim_statement(sql, &start, &end);
+
+    failed = failed || int_list_push(&data, start) != 0 || int_list_push(&data, end) != 0 ||
+             int_list_push(&data, layer) != 0 || int_list_push(&data, barrier) != 0 ||
+             int_list_push(&data, deps.length) != 0;
+
+    for (int32_t i = 0; i < deps.length && !failed; i++) {
+      failed = int_list_push(&data, deps.items[i]) != 0;
+    }
+  }
+
+  clear_accesses(&accesses);
+  free(accesses.items);
+  free_object_map(&objects);
+  free(deps.items);
+  free(seen);
+  free(layers);
+  pg_query__parse_result__free_unpacked(tree, NULL);
+
+  if (failed) {
+    free(data.items);
+    result->error = pg_make_error("out of memory building dependency graph");
+    return result;
+  }
+
+  result->n_stmts = n_stmts;
+  result->n_layers = n_layers;
+  result->length = data.length;
+  result->data = data.items;
+  return result;
+}
+
+EXPORT("free_dependency_result")
+void free_dependency_result(PgDependencyResult *result) {
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->data);
+  free(result);
+}
@@ -0,0 +1,185 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "lexer.h"
+#include "macros.h"
+
+// Extracts comment spans and sqlcommenter tags (/*key='value',...*/)
+// with the lightweight lexer - no parse, no per-token allocations.
+//
+// Results are a flat int32 buffer of byte offsets into the input, so JS
+// can slice what it needs from the bytes it already has:
+//
+//   per comment: kind, start, end, n_tags,
+//                then n_tags * (key_start, key_end, value_start, value_end)
+//
+// Value spans exclude the surrounding quotes and are still URL-encoded
+// and meta-escaped, as on the wire.
+
+enum {
+  PG_COMMENT_LINE = 0,
+  PG_COMMENT_BLOCK = 1,
+};
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  int32_t n_comments;
+  int32_t length;  // number of int32s in data
+  int32_t *data;
+  PgQueryError *error;
+} PgCommentsResult;
+
+typedef struct {
+  int32_t *data;
+  int32_t length;
+  int32_t capacity;
+  int failed;
+} IntBuffer;
+
+static void append(IntBuffer *buffer, int32_t value) {
+  if (buffer->failed) {
+    return;
+  }
+
+  if (buffer->length == buffer->capacity) {
+    int32_t capacity = buffer->capacity ? buffer->capacity * 2 : 32;
+    int32_t *data = (int32_t *)realloc(buffer->data, capacity * sizeof(int32_t));
+    if (!data) {
+      buffer->failed = 1;
+      return;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+  }
+
+  buffer->data[buffer->length++] = value;
+}
+
+static int is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int32_t skip_space(const char *sql, int32_t pos, int32_t end) {
+  while (pos < end && is_space(sql[pos])) {
+    pos++;
+  }
+  return pos;
+}
+
+// Parses `key='value',key='value'` between `start` and `end`, appending
+// four offsets per tag. Returns the number of tags, or 0 (appending
+// nothing) if the comment isn't in sqlcommenter format.
+static int32_t parse_tags(const char *sql, int32_t start, int32_t end, IntBuffer *buffer) {
+  int32_t mark = buffer->length;
+  int32_t n_tags = 0;
+  int32_t pos = skip_space(sql, start, end);
+
+  while (pos < end) {
+    int32_t key_start = pos;
+    while (pos < end && sql[pos] != '=' && sql[pos] != ',' && !is_space(sql[pos])) {
+      pos++;
+    }
+    int32_t key_end = pos;
+
+    pos = skip_space(sql, pos, end);
+    if (key_end == key_start || pos >= end || sql[pos] != '=') {
+      goto fail;
+    }
+
+    pos = skip_space(sql, pos + 1, end);
+    if (pos >= end || sql[pos] != '\'') {
+      goto fail;
+    }
+
+    int32_t value_start = ++pos;
+    while (pos < end && sql[pos] != '\'') {
+      pos += sql[pos] == '\\' ? 2 : 1;
+    }
+    if (pos >= end) {
+      goto fail;
+    }
+    int32_t value_end = pos++;
+
+    append(buffer, key_start);
+    append(buffer, key_end);
+    append(buffer, value_start);
+    append(buffer, value_end);
+    n_tags++;
+
+    pos = skip_space(sql, pos, end);
+    if (pos < end) {
+      if (sql[pos] != ',') {
+        goto fail;
+      }
+      pos = skip_space(sql, pos + 1, end);
+    }
+  }
+
+  return n_tags;
+
+fail:
+  buffer->length = mark;
+  return 0;
+}
+
+EXPORT("extract_comments")
+PgCommentsResult *extract_comments(char *sql) {
+  PgCommentsResult *result = (PgCommentsResult *)calloc(1, sizeof(PgCommentsResult));
+  IntBuffer buffer = {NULL, 0, 0, 0};
+
+  PgLexer lexer;
+  pg_lexer_init(&lexer, sql, (int32_t)strlen(sql));
+
+  for (;;) {
+    PgLexToken token = pg_lexer_next(&lexer);
+
+    if (token.kind == PG_LEX_EOF) {
+      break;
+    }
+
+    if (token.kind != PG_LEX_LINE_COMMENT && token.kind != PG_LEX_BLOCK_COMMENT) {
+      continue;
+    }
+
+    int block = token.kind == PG_LEX_BLOCK_COMMENT;
+
+    append(&buffer, block ? PG_COMMENT_BLOCK : PG_COMMENT_LINE);
+    append(&buffer, token.start);
+    append(&buffer, token.end);
+
+    int32_t n_tags_index = buffer.length;
+    append(&buffer, 0);
+
+    if (block && !buffer.failed) {
+      // Tags live between the /* and */ delimiters
+      int32_t n_tags = parse_tags(sql, token.start + 2, token.end - 2, &buffer);
+      if (!buffer.failed) {
+        buffer.data[n_tags_index] = n_tags;
+      }
+    }
+
+    result->n_comments++;
+  }
+
+  if (buffer.failed) {
+    free(buffer.data);
+    result->n_comments = 0;
+    result->error = pg_make_error("out of memory extracting comments");
+    return result;
+  }
+
+  result->length = buffer.length;
+  result->data = buffer.data;
+  return result;
+}
+
+EXPORT("free_comments_result")
+void free_comments_result(PgCommentsResult *result) {
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->data);
+  free(result);
+}
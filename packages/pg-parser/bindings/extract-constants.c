@@ -0,0 +1,543 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "common.h"
+#include "lexer.h"
+#include "macros.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Extracts every literal (A_Const) and parameter reference (ParamRef)
+// with its source span, for a batch of queries in one call. The same
+// pass also backs parameterize_sql(), which swaps literals for $n.
+
+// Order is ABI: JS maps these by index (see CONSTANT_KINDS in pg-parser.ts).
+typedef enum {
+  PG_CONSTANT_INTEGER = 0,
+  PG_CONSTANT_FLOAT,
+  PG_CONSTANT_STRING,
+  PG_CONSTANT_BITSTRING,
+  PG_CONSTANT_BOOLEAN,
+  PG_CONSTANT_NULL,
+  PG_CONSTANT_PARAM,
+} PgConstantKind;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  int32_t location;  // byte offset of the constant in its query
+  int32_t length;    // byte length of the constant's source text
+  int32_t kind;      // PgConstantKind
+  char *value;       // normalized value, NULL for SQL NULL
+} PgConstant;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8).
+typedef struct {
+  int32_t n_constants;
+  PgConstant *constants;
+  PgQueryError *error;
+} PgConstantsQuery;
+
+// Field order is ABI: JS reads these by byte offset (0, 4).
+typedef struct {
+  int32_t n_queries;
+  PgConstantsQuery *queries;
+} PgConstantsResult;
+
+typedef struct {
+  PgConstant *constants;
+  int32_t length;
+  int32_t capacity;
+  int failed;
+} ConstantList;
+
+static void add_constant(ConstantList *list, int32_t location, PgConstantKind kind, const char *value) {
+  // Constants synthesized by the grammar have no source location
+  if (location < 0 || list->failed) {
+    return;
+  }
+
+  if (list->length == list->capacity) {
+    int32_t capacity = list->capacity ? list->capacity * 2 : 16;
+    PgConstant *constants = (PgConstant *)realloc(list->constants, capacity * sizeof(PgConstant));
+    if (!constants) {
+      list->failed = 1;
+      return;
+    }
+    list->constants = constants;
+    list->capacity = capacity;
+  }
+
+  PgConstant *constant = &list->constants[list->length++];
+  constant->location = location;
+  constant->length = 0;
+  constant->kind = kind;
+  constant->value = value ? strdup(value) : NULL;
+}
+
+static void add_number(ConstantList *list, int32_t location, PgConstantKind kind, int32_t value) {
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "%d", value);
+  add_constant(list, location, kind, buffer);
+}
+
+static void add_a_const(ConstantList *list, PgQuery__AConst *constant) {
+  if (constant->isnull) {
+    add_constant(list, constant->location, PG_CONSTANT_NULL, NULL);
+    return;
+  }
+
+  switch (constant->val_case) {
+    case PG_QUERY__A__CONST__VAL_IVAL:
+      add_number(list, constant->location, PG_CONSTANT_INTEGER, constant->ival->ival);
+      break;
+    case PG_QUERY__A__CONST__VAL_FVAL:
+      add_constant(list, constant->location, PG_CONSTANT_FLOAT, constant->fval->fval);
+      break;
+    case PG_QUERY__A__CONST__VAL_BOOLVAL:
+      add_constant(list, constant->location, PG_CONSTANT_BOOLEAN, constant->boolval->boolval ? "true" : "false");
+      break;
+    case PG_QUERY__A__CONST__VAL_SVAL:
+      add_constant(list, constant->location, PG_CONSTANT_STRING, constant->sval->sval);
+      break;
+    case PG_QUERY__A__CONST__VAL_BSVAL:
+      add_constant(list, constant->location, PG_CONSTANT_BITSTRING, constant->bsval->bsval);
+      break;
+    default:
+      break;
+  }
+}
+
+static PgWalkAction collect_constant(ProtobufCMessage *message, int32_t depth, void *context) {
+  ConstantList *list = (ConstantList *)context;
+  (void)depth;
+
+  if (pg_is_message(message, &pg_query__param_ref__descriptor)) {
+    PgQuery__ParamRef *param = (PgQuery__ParamRef *)message;
+    add_number(list, param->location, PG_CONSTANT_PARAM, param->number);
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  if (pg_is_message(message, &pg_query__a__const__descriptor)) {
+    add_a_const(list, (PgQuery__AConst *)message);
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  return PG_WALK_CONTINUE;
+}
+
+static int compare_location(const void *a, const void *b) {
+  return ((const PgConstant *)a)->location - ((const PgConstant *)b)->location;
+}
+
+// The next token that isn't a comment.
+static PgLexToken next_code_token(PgLexer *lexer) {
+  PgLexToken token;
+  do {
+    token = pg_lexer_next(lexer);
+  } while (token.kind == PG_LEX_LINE_COMMENT || token.kind == PG_LEX_BLOCK_COMMENT);
+  return token;
+}
+
+// The tree only records where a constant starts. Its length is the length
+// of the token there, plus the number for negated constants like `- 1`,
+// whose location points at the minus sign.
+static void measure_constants(const char *sql, ConstantList *list) {
+  PgLexer lexer;
+  pg_lexer_init(&lexer, sql, (int32_t)strlen(sql));
+
+  for (int32_t i = 0; i < list->length; i++) {
+    PgConstant *constant = &list->constants[i];
+
+    lexer.pos = constant->location;
+    PgLexToken token = pg_lexer_next(&lexer);
+
+    if (token.kind == PG_LEX_OPERATOR && token.end - token.start == 1 && sql[token.start] == '-') {
+      token.end = pg_lexer_next(&lexer).end;
+    }
+
+    // Quoted strings separated only by whitespace with a newline are one
+    // constant ('foo'\n'bar' is 'foobar')
+    while (token.kind == PG_LEX_STRING) {
+      PgLexToken next = pg_lexer_next(&lexer);
+      if (next.kind != PG_LEX_STRING || sql[next.start] != '\'' ||
+          !memchr(sql + token.end, '\n', next.start - token.end)) {
+        break;
+      }
+      token.end = next.end;
+    }
+
+    // U&'d!0061t!+000061' UESCAPE '!' includes its escape clause
+    if (token.kind == PG_LEX_STRING && (sql[token.start] == 'u' || sql[token.start] == 'U') && sql[token.start + 1] == '&') {
+      lexer.pos = token.end;
+      PgLexToken keyword = next_code_token(&lexer);
+      PgLexToken escape = next_code_token(&lexer);
+      if (keyword.kind == PG_LEX_IDENT && keyword.end - keyword.start == 7 &&
+          strncasecmp(sql + keyword.start, "uescape", 7) == 0 && escape.kind == PG_LEX_STRING) {
+        token.end = escape.end;
+      }
+    }
+
+    constant->length = token.end - constant->location;
+  }
+}
+
+static void extract_query(const char *sql, PgConstantsQuery *query) {
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    query->error = parsed.error;
+    return;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    query->error = pg_make_error("failed to unpack parse tree");
+    return;
+  }
+
+  ConstantList list = {NULL, 0, 0, 0};
+
+  for (size_t i = 0; i < tree->n_stmts && !list.failed; i++) {
+    if (pg_walk((ProtobufCMessage *)tree->stmts[i]->stmt, collect_constant, &list) != 0) {
+      list.failed = 1;
+    }
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+
+  if (list.failed) {
+    for (int32_t i = 0; i < list.length; i++) {
+      free(list.constants[i].value);
+    }
+    free(list.constants);
+    query->error = pg_make_error("out of memory extracting constants");
+    return;
+  }
+
+  // The walk follows field order, not source order
+  qsort(list.constants, list.length, sizeof(PgConstant), compare_location);
+  measure_constants(sql, &list);
+
+  query->n_constants = list.length;
+  query->constants = list.constants;
+}
+
+// `sql` holds `count` null-terminated queries back to back, so a whole
+// batch crosses into WASM in one copy and one call.
+EXPORT("extract_constants")
+PgConstantsResult *extract_constants(char *sql, int32_t count) {
+  PgConstantsResult *result = (PgConstantsResult *)malloc(sizeof(PgConstantsResult));
+  result->n_queries = count;
+  result->queries = (PgConstantsQuery *)calloc(count > 0 ? count : 1, sizeof(PgConstantsQuery));
+
+  for (int32_t i = 0; i < count; i++) {
+    extract_query(sql, &result->queries[i]);
+    sql += strlen(sql) + 1;
+  }
+
+  return result;
+}
+
+EXPORT("free_constants_result")
+void free_constants_result(PgConstantsResult *result) {
+  for (int32_t i = 0; i < result->n_queries; i++) {
+    PgConstantsQuery *query = &result->queries[i];
+
+    for (int32_t j = 0; j < query->n_constants; j++) {
+      free(query->constants[j].value);
+    }
+    free(query->constants);
+
+    if (query->error) {
+      pg_query_free_error(query->error);
+    }
+  }
+
+  free(result->queries);
+  free(result);
+}
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12, 16).
+typedef struct {
+  char *sql;            // query with its literals replaced by $n
+  int32_t first_param;  // number of the first new parameter
+  int32_t n_params;
+  PgConstant *params;   // replaced literals, in parameter order
+  PgQueryError *error;
+} PgParameterizedQuery;
+
+// Field order is ABI: JS reads these by byte offset (0, 4).
+typedef struct {
+  int32_t n_queries;
+  PgParameterizedQuery *queries;
+} PgParameterizeResult;
+
+typedef struct {
+  ConstantList list;
+  int32_t max_param;
+  // Integer constants that refer to output columns by position
+  // (ORDER BY 1, GROUP BY 1, DISTINCT ON (1)), by location
+  int32_t *positional;
+  int32_t n_positional;
+  int failed;
+} ParameterizeContext;
+
+static void add_positional(ParameterizeContext *context, PgQuery__Node *node) {
+  if (node && node->node_case == PG_QUERY__NODE__NODE_SORT_BY) {
+    node = node->sort_by->node;
+  }
+  if (!node || node->node_case != PG_QUERY__NODE__NODE_A_CONST ||
+      node->a_const->val_case != PG_QUERY__A__CONST__VAL_IVAL) {
+    return;
+  }
+
+  int32_t *positional = (int32_t *)realloc(context->positional, (context->n_positional + 1) * sizeof(int32_t));
+  if (!positional) {
+    context->failed = 1;
+    return;
+  }
+  context->positional = positional;
+  context->positional[context->n_positional++] = node->a_const->location;
+}
+
+static int is_positional(ParameterizeContext *context, int32_t location) {
+  for (int32_t i = 0; i < context->n_positional; i++) {
+    if (context->positional[i] == location) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static PgWalkAction collect_parameter(ProtobufCMessage *message, int32_t depth, void *context) {
+  ParameterizeContext *ctx = (ParameterizeContext *)context;
+  (void)depth;
+
+  if (pg_is_message(message, &pg_query__param_ref__descriptor)) {
+    PgQuery__ParamRef *param = (PgQuery__ParamRef *)message;
+    if (param->number > ctx->max_param) {
+      ctx->max_param = param->number;
+    }
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  // Type modifiers and array bounds must stay literal
+  if (pg_is_message(message, &pg_query__type_name__descriptor)) {
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  // So must typed literals like date '2024-01-01' and interval '1 day',
+  // where the type name comes first
+  if (pg_is_message(message, &pg_query__type_cast__descriptor)) {
+    PgQuery__TypeCast *cast = (PgQuery__TypeCast *)message;
+    if (cast->arg && cast->arg->node_case == PG_QUERY__NODE__NODE_A_CONST && cast->type_name &&
+        cast->type_name->location >= 0 && cast->type_name->location < cast->arg->a_const->location) {
+      return PG_WALK_SKIP_CHILDREN;
+    }
+    return PG_WALK_CONTINUE;
+  }
+
+  if (pg_is_message(message, &pg_query__select_stmt__descriptor)) {
+    PgQuery__SelectStmt *select = (PgQuery__SelectStmt *)message;
+    for (size_t i = 0; i < select->n_sort_clause; i++) {
+      add_positional(ctx, select->sort_clause[i]);
+    }
+    for (size_t i = 0; i < select->n_group_clause; i++) {
+      add_positional(ctx, select->group_clause[i]);
+    }
+    for (size_t i = 0; i < select->n_distinct_clause; i++) {
+      add_positional(ctx, select->distinct_clause[i]);
+    }
+    return ctx->failed ? PG_WALK_STOP : PG_WALK_CONTINUE;
+  }
+
+  if (pg_is_message(message, &pg_query__a__const__descriptor)) {
+    PgQuery__AConst *constant = (PgQuery__AConst *)message;
+    // NULL has no type to bind, and leaving it keeps IS NULL-style plans
+    if (!constant->isnull && !is_positional(ctx, constant->location)) {
+      add_a_const(&ctx->list, constant);
+    }
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  return PG_WALK_CONTINUE;
+}
+
+static int is_parameterizable(PgQuery__Node *stmt) {
+  switch (stmt->node_case) {
+    case PG_QUERY__NODE__NODE_SELECT_STMT:
+    case PG_QUERY__NODE__NODE_INSERT_STMT:
+    case PG_QUERY__NODE__NODE_UPDATE_STMT:
+    case PG_QUERY__NODE__NODE_DELETE_STMT:
+    case PG_QUERY__NODE__NODE_MERGE_STMT:
+      return 1;
+    default:
+      return 0;
+  }
+}
+
+// The grammar also makes constants out of keywords (the field name in
+// EXTRACT(YEAR FROM ...), for example); only literal tokens can become
+// parameters.
+static int is_literal(const char *sql, const PgConstant *constant) {
+  PgLexer lexer;
+  pg_lexer_init(&lexer, sql, constant->location + constant->length);
+  lexer.pos = constant->location;
+  PgLexToken token = pg_lexer_next(&lexer);
+
+  switch (constant->kind) {
+    case PG_CONSTANT_INTEGER:
+    case PG_CONSTANT_FLOAT:
+      if (token.kind == PG_LEX_OPERATOR) {
+        token = pg_lexer_next(&lexer);
+      }
+      return token.kind == PG_LEX_NUMBER;
+    case PG_CONSTANT_STRING:
+      return token.kind == PG_LEX_STRING || token.kind == PG_LEX_DOLLAR_STRING;
+    case PG_CONSTANT_BITSTRING:
+      return token.kind == PG_LEX_STRING;
+    case PG_CONSTANT_BOOLEAN:
+      return token.kind == PG_LEX_IDENT && token.end - token.start == (constant->value[0] == 't' ? 4 : 5);
+    default:
+      return 0;
+  }
+}
+
+// `params` must be sorted by location and must not overlap.
+static char *replace_literals(const char *sql, const PgConstant *params, int32_t n_params, int32_t first_param) {
+  size_t length = strlen(sql);
+  // Every placeholder ($ plus at most 10 digits) fits in 11 bytes
+  char *out = (char *)malloc(length + (size_t)n_params * 11 + 1);
+  if (!out) {
+    return NULL;
+  }
+
+  char *cursor = out;
+  int32_t pos = 0;
+
+  for (int32_t i = 0; i < n_params; i++) {
+    memcpy(cursor, sql + pos, params[i].location - pos);
+    cursor += params[i].location - pos;
+    cursor += sprintf(cursor, "$%d", first_param + i);
+    pos = params[i].location + params[i].length;
+  }
+
+  memcpy(cursor, sql + pos, length - pos + 1);
+  return out;
+}
+
+static void parameterize_query(const char *sql, PgParameterizedQuery *query) {
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    query->error = parsed.error;
+    return;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    query->error = pg_make_error("failed to unpack parse tree");
+    return;
+  }
+
+  ParameterizeContext context = {{NULL, 0, 0, 0}, 0, NULL, 0, 0};
+
+  for (size_t i = 0; i < tree->n_stmts && !context.failed; i++) {
+    PgQuery__Node *stmt = tree->stmts[i]->stmt;
+    // Utility statements are left as written
+    if (!stmt || !is_parameterizable(stmt)) {
+      continue;
+    }
+    if (pg_walk((ProtobufCMessage *)stmt, collect_parameter, &context) != 0) {
+      context.failed = 1;
+    }
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+  free(context.positional);
+
+  ConstantList *list = &context.list;
+  char *out = NULL;
+
+  if (!context.failed && !list->failed) {
+    qsort(list->constants, list->length, sizeof(PgConstant), compare_location);
+    measure_constants(sql, list);
+
+    // Constants the grammar made up can share a span with a literal;
+    // only the first constant in any stretch of text is replaced
+    int32_t n_params = 0;
+    int32_t end = 0;
+    for (int32_t i = 0; i < list->length; i++) {
+      if (list->constants[i].location >= end && is_literal(sql, &list->constants[i])) {
+        end = list->constants[i].location + list->constants[i].length;
+        list->constants[n_params++] = list->constants[i];
+      } else {
+        free(list->constants[i].value);
+      }
+    }
+    list->length = n_params;
+
+    out = replace_literals(sql, list->constants, list->length, context.max_param + 1);
+  }
+
+  if (!out) {
+    for (int32_t i = 0; i < list->length; i++) {
+      free(list->constants[i].value);
+    }
+    free(list->constants);
+    query->error = pg_make_error("out of memory parameterizing query");
+    return;
+  }
+
+  query->sql = out;
+  query->first_param = context.max_param + 1;
+  query->n_params = list->length;
+  query->params = list->constants;
+}
+
+// Same batch layout as extract_constants().
+EXPORT("parameterize_sql")
+PgParameterizeResult *parameterize_sql(char *sql, int32_t count) {
+  PgParameterizeResult *result = (PgParameterizeResult *)malloc(sizeof(PgParameterizeResult));
+  result->n_queries = count;
+  result->queries = (PgParameterizedQuery *)calloc(count > 0 ? count : 1, sizeof(PgParameterizedQuery));
+
+  for (int32_t i = 0; i < count; i++) {
+    parameterize_query(sql, &result->queries[i]);
+    sql += strlen(sql) + 1;
+  }
+
+  return result;
+}
+
+EXPORT("free_parameterize_result")
+void free_parameterize_result(PgParameterizeResult *result) {
+  for (int32_t i = 0; i < result->n_queries; i++) {
+    PgParameterizedQuery *query = &result->queries[i];
+
+    free(query->sql);
+    for (int32_t j = 0; j < query->n_params; j++) {
+      free(query->params[j].value);
+    }
+    free(query->params);
+
+    if (query->error) {
+      pg_query_free_error(query->error);
+    }
+  }
+
+  free(result->queries);
+  free(result);
+}
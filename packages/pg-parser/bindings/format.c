@@ -0,0 +1,255 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "lexer.h"
+#include "macros.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Pretty-prints a SQL script: parse once, deparse with the script's
+// comments put back, all in one call.
+//
+// libpg_query 17 ships a pretty-printing deparser that indents, wraps
+// long lines and re-attaches comments to the nodes they were next to, so
+// on Postgres 17 it does all the work. Older deparsers only print single
+// line SQL: there each statement is deparsed on its own line, and each
+// comment is kept on its own line before the statement it was in, or
+// after the statement's semicolon if it was on the same line.
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8).
+typedef struct {
+  char *sql;
+  PgQueryError *error;
+  int32_t parsed;  // whether `error` happened after parsing (deparse)
+} PgFormatResult;
+
+typedef struct {
+  int32_t indent_size;
+  int32_t max_line_length;
+  int32_t commas_start_of_line;
+  int32_t trailing_newline;
+} PgFormatOptions;
+
+#if PG_VERSION_NUM >= 170000
+
+static void format_pretty(const char *sql, PgQueryProtobuf tree, const PgFormatOptions *options, PgFormatResult *result) {
+  PgQueryDeparseCommentsResult comments = pg_query_deparse_comments_for_query(sql);
+
+  if (comments.error) {
+    result->error = comments.error;
+    comments.error = NULL;
+    pg_query_free_deparse_comments_result(comments);
+    return;
+  }
+
+  PostgresDeparseOpts opts;
+  memset(&opts, 0, sizeof(opts));
+  opts.pretty_print = true;
+  opts.comments = comments.comments;
+  opts.comment_count = comments.comment_count;
+  opts.indent_size = options->indent_size;
+  opts.max_line_length = options->max_line_length;
+  opts.trailing_newline = options->trailing_newline != 0;
+  opts.commas_start_of_line = options->commas_start_of_line != 0;
+
+  PgQueryDeparseResult deparsed = pg_query_deparse_protobuf_opts(tree, opts);
+  pg_query_free_deparse_comments_result(comments);
+
+  if (deparsed.error) {
+    result->error = deparsed.error;
+    deparsed.error = NULL;
+  } else {
+    result->sql = deparsed.query;
+    deparsed.query = NULL;
+  }
+  pg_query_free_deparse_result(deparsed);
+}
+
+#else
+
+typedef struct {
+  FILE *out;
+  const char *sql;
+  int32_t pos;       // input before this offset has been written
+  int separate;      // write a blank line before the next statement or comment
+} FormatWriter;
+
+static int is_comment(PgLexToken token) {
+  return token.kind == PG_LEX_LINE_COMMENT || token.kind == PG_LEX_BLOCK_COMMENT;
+}
+
+static void begin_block(FormatWriter *writer) {
+  if (writer->separate) {
+    fputc('\n', writer->out);
+    writer->separate = 0;
+  }
+}
+
+// Writes the comments in [pos, end) one per line.
+static void write_comments(FormatWriter *writer, int32_t end) {
+  PgLexer lexer;
+  pg_lexer_init(&lexer, writer->sql, end);
+  lexer.pos = writer->pos;
+
+  for (PgLexToken token = pg_lexer_next(&lexer); token.kind != PG_LEX_EOF; token = pg_lexer_next(&lexer)) {
+    if (is_comment(token)) {
+      begin_block(writer);
+      fwrite(writer->sql + token.start, 1, token.end - token.start, writer->out);
+      fputc('\n', writer->out);
+    }
+  }
+
+  if (end > writer->pos) {
+    writer->pos = end;
+  }
+}
+
+// Writes a comment that follows the statement's semicolon on the same
+// line, as in `SELECT 1; -- one`.
+static void write_trailing_comment(FormatWriter *writer, int32_t length) {
+  PgLexer lexer;
+  pg_lexer_init(&lexer, writer->sql, length);
+  lexer.pos = writer->pos;
+
+  PgLexToken token = pg_lexer_next(&lexer);
+  if (token.kind == PG_LEX_PUNCT && writer->sql[token.start] == ';') {
+    token = pg_lexer_next(&lexer);
+  }
+
+  if (is_comment(token) && !memchr(writer->sql + writer->pos, '\n', token.start - writer->pos)) {
+    fputc(' ', writer->out);
+    fwrite(writer->sql + token.start, 1, token.end - token.start, writer->out);
+    writer->pos = token.end;
+  }
+}
+
+static char *deparse_statement(PgQuery__ParseResult *tree, size_t index, PgQueryError **error) {
+  PgQuery__ParseResult single = PG_QUERY__PARSE_RESULT__INIT;
+  single.version = tree->version;
+  single.n_stmts = 1;
+  single.stmts = &tree->stmts[index];
+
+  PgQueryProtobuf protobuf;
+  protobuf.len = pg_query__parse_result__get_packed_size(&single);
+  protobuf.data = (char *)malloc(protobuf.len ? protobuf.len : 1);
+
+  if (!protobuf.data) {
+    *error = pg_make_error("out of memory formatting query");
+    return NULL;
+  }
+
+  pg_query__parse_result__pack(&single, (uint8_t *)protobuf.data);
+
+  PgQueryDeparseResult deparsed = pg_query_deparse_protobuf(protobuf);
+  free(protobuf.data);
+
+  char *query = deparsed.query;
+  *error = deparsed.error;
+  deparsed.query = NULL;
+  deparsed.error = NULL;
+  pg_query_free_deparse_result(deparsed);
+
+  return query;
+}
+
+static void format_statements(const char *sql, PgQueryProtobuf protobuf, const PgFormatOptions *options, PgFormatResult *result) {
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, protobuf.len, (const uint8_t *)protobuf.data);
+
+  if (!tree) {
+    result->error = pg_make_error("failed to unpack parse tree");
+    return;
+  }
+
+  char *data = NULL;
+  size_t size = 0;
+  FormatWriter writer = {open_memstream(&data, &size), sql, 0, 0};
+
+  if (!writer.out) {
+    pg_query__parse_result__free_unpacked(tree, NULL);
+    result->error = pg_make_error("out of memory formatting query");
+    return;
+  }
+
+  int32_t length = (int32_t)strlen(sql);
+
+  for (size_t i = 0; i < tree->n_stmts && !result->error; i++) {
+    PgQuery__RawStmt *stmt = tree->stmts[i];
+    int32_t end = stmt->stmt_len ? stmt->stmt_location + stmt->stmt_len : length;
+
+    // Comments inside a statement can't be placed in single-line
+    // output, so they move up with the ones before it
+    write_comments(&writer, end);
+
+    char *query = deparse_statement(tree, i, &result->error);
+    if (!query) {
+      break;
+    }
+
+    begin_block(&writer);
+    fputs(query, writer.out);
+    fputc(';', writer.out);
+    free(query);
+
+    write_trailing_comment(&writer, length);
+    fputc('\n', writer.out);
+    writer.separate = 1;
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+
+  if (!result->error) {
+    write_comments(&writer, length);
+  }
+
+  fclose(writer.out);
+
+  if (result->error) {
+    free(data);
+    return;
+  }
+
+  if (!options->trailing_newline && size > 0 && data[size - 1] == '\n') {
+    data[size - 1] = '\0';
+  }
+  result->sql = data;
+}
+
+#endif
+
+EXPORT("format_sql")
+PgFormatResult *format_sql(char *sql, int32_t indent_size, int32_t max_line_length, int32_t commas_start_of_line, int32_t trailing_newline) {
+  PgFormatResult *result = (PgFormatResult *)calloc(1, sizeof(PgFormatResult));
+  PgFormatOptions options = {indent_size, max_line_length, commas_start_of_line, trailing_newline};
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    result->error = parsed.error;
+    return result;
+  }
+
+  result->parsed = 1;
+
+#if PG_VERSION_NUM >= 170000
+  format_pretty(sql, parsed.parse_tree, &options, result);
+#else
+  format_statements(sql, parsed.parse_tree, &options, result);
+#endif
+
+  free(parsed.parse_tree.data);
+  return result;
+}
+
+EXPORT("free_format_result")
+void free_format_result(PgFormatResult *result) {
+  free(result->sql);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
@@ -0,0 +1,22 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdint.h>
+
+// The distinct queries of a batch export's input: `sql` holding `count`
+// null-terminated queries back to back. Query logs repeat the same text
+// many times over, so batch exports can process each text once.
+typedef struct {
+  int32_t n_unique;
+  const char **unique;  // each distinct query, in order of first occurrence
+  int32_t *first;       // input index of each distinct query's first occurrence
+  int32_t *indexes;     // for each input query, its position in `unique`
+} PgBatch;
+
+// Hashes every query once and matches equal texts. Returns 0 on
+// success, -1 if out of memory.
+int pg_batch_dedupe(const char *sql, int32_t count, PgBatch *batch);
+
+void pg_batch_free(PgBatch *batch);
+
+#endif  // BATCH_H
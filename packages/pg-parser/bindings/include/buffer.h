@@ -0,0 +1,43 @@
+#ifndef BUFFER_H
+#define BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// A growable little-endian byte buffer, for bindings that write a binary
+// format (archives, Arrow IPC).
+//
+// Writes never fail loudly: once an allocation fails the buffer is marked
+// `failed` and ignores further writes, so a writer can check once at the
+// end instead of after every call.
+
+typedef struct {
+  uint8_t *data;
+  size_t length;
+  size_t capacity;
+  int failed;
+} PgBuffer;
+
+// Makes room for `size` more bytes. Returns 0 on success, -1 on failure.
+int pg_buffer_reserve(PgBuffer *buffer, size_t size);
+
+void pg_buffer_put_bytes(PgBuffer *buffer, const void *bytes, size_t size);
+void pg_buffer_put_zeros(PgBuffer *buffer, size_t size);
+
+// Unsigned integers of `size` bytes (at most 8)
+void pg_buffer_put_uint(PgBuffer *buffer, uint64_t value, size_t size);
+void pg_buffer_set_uint(PgBuffer *buffer, size_t position, uint64_t value, size_t size);
+
+void pg_buffer_put_u8(PgBuffer *buffer, uint8_t value);
+void pg_buffer_put_u16(PgBuffer *buffer, uint16_t value);
+void pg_buffer_put_u32(PgBuffer *buffer, uint32_t value);
+void pg_buffer_put_u64(PgBuffer *buffer, uint64_t value);
+void pg_buffer_put_f64(PgBuffer *buffer, double value);
+
+// Unsigned LEB128
+void pg_buffer_put_varint(PgBuffer *buffer, uint64_t value);
+
+// Zero-pads to a multiple of `alignment`.
+void pg_buffer_pad_to(PgBuffer *buffer, size_t alignment);
+
+#endif  // BUFFER_H
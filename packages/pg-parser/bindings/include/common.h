@@ -0,0 +1,21 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Helpers shared by the bindings that build their own results from an
+// unpacked protobuf tree.
+
+// Forward-declare from pg_query.c (not in public header).
+void pg_query_free_error(PgQueryError *error);
+
+// A PgQueryError with a copy of `message` and no position, freed with
+// pg_query_free_error(). Returns NULL if out of memory.
+PgQueryError *pg_make_error(const char *message);
+
+// The text of a String node (e.g. an element of a qualified name), or NULL
+// for any other node.
+const char *pg_string_value(PgQuery__Node *node);
+
+#endif  // COMMON_H
@@ -0,0 +1,47 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <stdint.h>
+
+// A small, allocation-free SQL lexer.
+//
+// This is not the Postgres scanner: it only recognizes token boundaries
+// (quoting, comments, dollar quotes, numbers, operators), which is enough
+// for cheap pre-parse passes over untrusted input. Token boundaries match
+// the Postgres scanner for well-formed SQL with standard_conforming_strings
+// on. Use pg_query_scan() when exact token kinds are needed.
+
+typedef enum {
+  PG_LEX_EOF = 0,
+  PG_LEX_IDENT,          // identifiers and keywords
+  PG_LEX_QUOTED_IDENT,   // "ident", U&"ident"
+  PG_LEX_STRING,         // 'str', E'str', B'..', X'..', N'..', U&'..'
+  PG_LEX_DOLLAR_STRING,  // $tag$str$tag$
+  PG_LEX_NUMBER,
+  PG_LEX_PARAM,          // $1
+  PG_LEX_OPERATOR,
+  PG_LEX_PUNCT,          // ( ) [ ] , ; . :
+  PG_LEX_LINE_COMMENT,   // -- comment
+  PG_LEX_BLOCK_COMMENT,  // /* comment */ (nestable)
+  PG_LEX_UNTERMINATED,   // unterminated quote or comment, runs to EOF
+} PgLexTokenKind;
+
+typedef struct {
+  PgLexTokenKind kind;
+  int32_t start;  // byte offset, inclusive
+  int32_t end;    // byte offset, exclusive
+} PgLexToken;
+
+typedef struct {
+  const char *sql;
+  int32_t length;
+  int32_t pos;
+} PgLexer;
+
+void pg_lexer_init(PgLexer *lexer, const char *sql, int32_t length);
+
+// Returns the next token, skipping whitespace. Comments are returned as
+// tokens so callers can decide whether they matter.
+PgLexToken pg_lexer_next(PgLexer *lexer);
+
+#endif  // LEXER_H
@@ -1,6 +1,12 @@
 #ifndef MACROS_H
 #define MACROS_H
 
+#if defined(__EMSCRIPTEN__) || defined(__wasi__)
+// WASI builds (WASI=1) export the same names for non-JS runtimes.
 #define EXPORT(name) __attribute__((export_name(name)))
+#else
+// Native builds (NATIVE=1) link the bindings directly into a host binary.
+#define EXPORT(name)
+#endif
 
-#endif  // MACROS_H
\ No newline at end of file
+#endif  // MACROS_H
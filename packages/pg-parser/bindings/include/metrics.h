@@ -0,0 +1,25 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+#include "node-walker.h"
+
+// Index of each metric within a statement's row. Order is ABI: JS reads
+// these by index (see QueryMetric in src/constants.ts).
+enum {
+  PG_METRIC_NODES = 0,
+  PG_METRIC_DEPTH,
+  PG_METRIC_JOINS,
+  PG_METRIC_SUBQUERIES,
+  PG_METRIC_CTES,
+  PG_METRIC_SET_OPERATIONS,
+  PG_METRIC_FUNCTIONS,
+  PG_METRIC_COUNT,
+};
+
+// pg_walk() callback that adds `message` to the metrics in `context`, an
+// int32_t[PG_METRIC_COUNT] row that starts zeroed.
+PgWalkAction pg_count_metrics(ProtobufCMessage *message, int32_t depth, void *context);
+
+#endif  // METRICS_H
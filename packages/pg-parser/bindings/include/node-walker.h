@@ -0,0 +1,33 @@
+#ifndef NODE_WALKER_H
+#define NODE_WALKER_H
+
+#include <stdint.h>
+
+#include "protobuf/pg_query.pb-c.h"
+
+// Generic walker over an unpacked pg_query protobuf tree.
+//
+// Visits every message in pre-order, in field order. `Node` oneof wrappers
+// are unwrapped transparently: the callback sees the wrapped message (e.g.
+// PgQuery__SelectStmt), never the wrapper itself. Depth counts visited
+// messages above the current one, starting at 0 for the root.
+//
+// The walk is iterative, so arbitrarily deep trees can't overflow the
+// (small) WASM stack.
+
+typedef enum {
+  PG_WALK_CONTINUE = 0,
+  PG_WALK_SKIP_CHILDREN = 1,
+  PG_WALK_STOP = 2,
+} PgWalkAction;
+
+typedef PgWalkAction (*PgWalkCallback)(ProtobufCMessage *message, int32_t depth, void *context);
+
+// Returns 0 on success, -1 if the walk ran out of memory.
+int pg_walk(ProtobufCMessage *root, PgWalkCallback callback, void *context);
+
+// Whether `message` is of the given message type, e.g.
+// pg_is_message(message, &pg_query__select_stmt__descriptor)
+#define pg_is_message(message, desc) ((message)->descriptor == (desc))
+
+#endif  // NODE_WALKER_H
@@ -0,0 +1,26 @@
+#ifndef PARSE_LIMITS_H
+#define PARSE_LIMITS_H
+
+#include <stdint.h>
+
+typedef enum {
+  PG_LIMIT_BYTES = 1,
+  PG_LIMIT_TOKENS = 2,
+  PG_LIMIT_STATEMENTS = 3,
+  PG_LIMIT_DEPTH = 4,
+} PgLimitKind;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8).
+typedef struct {
+  int32_t kind;      // PgLimitKind
+  int32_t max;       // the configured limit that was exceeded
+  int32_t position;  // byte offset where the limit was exceeded
+} PgLimitViolation;
+
+// Returns NULL when the input is within all limits. A limit of 0 means
+// unlimited.
+PgLimitViolation *check_limits(const char *sql, int32_t max_bytes, int32_t max_tokens, int32_t max_statements, int32_t max_depth);
+
+void free_limit_violation(PgLimitViolation *result);
+
+#endif  // PARSE_LIMITS_H
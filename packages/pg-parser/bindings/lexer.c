@@ -0,0 +1,249 @@
+#include "lexer.h"
+
+#include <string.h>
+
+static int is_space(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+// Matches Postgres' ident_start: letters, underscore and any non-ASCII byte
+static int is_ident_start(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || (unsigned char)c >= 0x80;
+}
+
+static int is_ident_cont(char c) {
+  return is_ident_start(c) || is_digit(c) || c == '$';
+}
+
+static int is_op_char(char c) {
+  return c != '\0' && strchr("~!@#^&|`?+-*/%<>=", c) != NULL;
+}
+
+static char peek(const PgLexer *lexer, int32_t offset) {
+  int32_t pos = lexer->pos + offset;
+  return pos < lexer->length ? lexer->sql[pos] : '\0';
+}
+
+static PgLexToken finish(PgLexer *lexer, PgLexTokenKind kind, int32_t start) {
+  PgLexToken token = {kind, start, lexer->pos};
+  return token;
+}
+
+// Consumes a quoted run up to and including the closing quote. Doubled quotes
+// are escapes; backslash escapes only apply to E'' strings.
+static int lex_quoted(PgLexer *lexer, char quote, int backslash_escapes) {
+  lexer->pos++;  // opening quote
+  while (lexer->pos < lexer->length) {
+    char c = lexer->sql[lexer->pos];
+    if (backslash_escapes && c == '\\') {
+      lexer->pos += 2;
+      continue;
+    }
+    lexer->pos++;
+    if (c == quote) {
+      if (peek(lexer, 0) != quote) {
+        return 1;
+      }
+      lexer->pos++;  // doubled quote
+    }
+  }
+  lexer->pos = lexer->length;
+  return 0;
+}
+
+static int lex_block_comment(PgLexer *lexer) {
+  int depth = 0;
+  while (lexer->pos < lexer->length) {
+    if (peek(lexer, 0) == '/' && peek(lexer, 1) == '*') {
+      depth++;
+      lexer->pos += 2;
+    } else if (peek(lexer, 0) == '*' && peek(lexer, 1) == '/') {
+      lexer->pos += 2;
+      if (--depth == 0) {
+        return 1;
+      }
+    } else {
+      lexer->pos++;
+    }
+  }
+  return 0;
+}
+
+// Returns the length of a $tag$ delimiter at the current position, or 0
+static int32_t dollar_tag_length(const PgLexer *lexer) {
+  int32_t i = 1;
+  if (is_digit(peek(lexer, i))) {
+    return 0;
+  }
+  while (is_ident_start(peek(lexer, i)) || is_digit(peek(lexer, i))) {
+    i++;
+  }
+  return peek(lexer, i) == '$' ? i + 1 : 0;
+}
+
+static int lex_dollar_string(PgLexer *lexer, int32_t tag_length) {
+  const char *tag = lexer->sql + lexer->pos;
+  lexer->pos += tag_length;
+  while (lexer->pos + tag_length <= lexer->length) {
+    if (lexer->sql[lexer->pos] == '$' && memcmp(lexer->sql + lexer->pos, tag, tag_length) == 0) {
+      lexer->pos += tag_length;
+      return 1;
+    }
+    lexer->pos++;
+  }
+  lexer->pos = lexer->length;
+  return 0;
+}
+
+static void lex_number(PgLexer *lexer) {
+  while (is_digit(peek(lexer, 0)) || peek(lexer, 0) == '_') {
+    lexer->pos++;
+  }
+  // Don't swallow the first dot of a `1..2` range-like sequence
+  if (peek(lexer, 0) == '.' && peek(lexer, 1) != '.') {
+    lexer->pos++;
+    while (is_digit(peek(lexer, 0)) || peek(lexer, 0) == '_') {
+      lexer->pos++;
+    }
+  }
+  if ((peek(lexer, 0) == 'e' || peek(lexer, 0) == 'E') &&
+      (is_digit(peek(lexer, 1)) || ((peek(lexer, 1) == '+' || peek(lexer, 1) == '-') && is_digit(peek(lexer, 2))))) {
+    lexer->pos += 2;
+    while (is_digit(peek(lexer, 0))) {
+      lexer->pos++;
+    }
+  }
+  // Postgres rejects trailing junk like `123abc`, but it is still one token
+  // boundary for our purposes
+  while (is_ident_cont(peek(lexer, 0))) {
+    lexer->pos++;
+  }
+}
+
+static void lex_operator(PgLexer *lexer) {
+  int32_t start = lexer->pos;
+  int has_special = 0;
+
+  while (is_op_char(peek(lexer, 0))) {
+    // Comment starts terminate an operator, e.g. `*/*`
+    if (lexer->pos > start && ((peek(lexer, 0) == '-' && peek(lexer, 1) == '-') || (peek(lexer, 0) == '/' && peek(lexer, 1) == '*'))) {
+      break;
+    }
+    if (strchr("~!@#^&|`?%", peek(lexer, 0)) != NULL) {
+      has_special = 1;
+    }
+    lexer->pos++;
+  }
+
+  // Like scan.l, a multi-character operator can only end in + or - if it
+  // contains one of ~!@#^&|`?%, so `<>-1` lexes as `<>` `-` `1`
+  if (!has_special) {
+    while (lexer->pos - start > 1 && (lexer->sql[lexer->pos - 1] == '+' || lexer->sql[lexer->pos - 1] == '-')) {
+      lexer->pos--;
+    }
+  }
+}
+
+void pg_lexer_init(PgLexer *lexer, const char *sql, int32_t length) {
+  lexer->sql = sql;
+  lexer->length = length;
+  lexer->pos = 0;
+}
+
+PgLexToken pg_lexer_next(PgLexer *lexer) {
+  while (lexer->pos < lexer->length && is_space(lexer->sql[lexer->pos])) {
+    lexer->pos++;
+  }
+
+  int32_t start = lexer->pos;
+  if (start >= lexer->length) {
+    return finish(lexer, PG_LEX_EOF, start);
+  }
+
+  char c = peek(lexer, 0);
+  char next = peek(lexer, 1);
+
+  if (c == '-' && next == '-') {
+    while (lexer->pos < lexer->length && lexer->sql[lexer->pos] != '\n' && lexer->sql[lexer->pos] != '\r') {
+      lexer->pos++;
+    }
+    return finish(lexer, PG_LEX_LINE_COMMENT, start);
+  }
+
+  if (c == '/' && next == '*') {
+    return finish(lexer, lex_block_comment(lexer) ? PG_LEX_BLOCK_COMMENT : PG_LEX_UNTERMINATED, start);
+  }
+
+  if (c == '\'') {
+    return finish(lexer, lex_quoted(lexer, '\'', 0) ? PG_LEX_STRING : PG_LEX_UNTERMINATED, start);
+  }
+
+  if (c == '"') {
+    return finish(lexer, lex_quoted(lexer, '"', 0) ? PG_LEX_QUOTED_IDENT : PG_LEX_UNTERMINATED, start);
+  }
+
+  // E'', B'', X'', N'' string prefixes
+  if (next == '\'' && strchr("eEbBxXnN", c) != NULL) {
+    lexer->pos++;
+    int escapes = c == 'e' || c == 'E';
+    return finish(lexer, lex_quoted(lexer, '\'', escapes) ? PG_LEX_STRING : PG_LEX_UNTERMINATED, start);
+  }
+
+  // U&'' and U&""
+  if ((c == 'u' || c == 'U') && next == '&' && (peek(lexer, 2) == '\'' || peek(lexer, 2) == '"')) {
+    char quote = peek(lexer, 2);
+    lexer->pos += 2;
+    PgLexTokenKind kind = quote == '\'' ? PG_LEX_STRING : PG_LEX_QUOTED_IDENT;
+    return finish(lexer, lex_quoted(lexer, quote, 0) ? kind : PG_LEX_UNTERMINATED, start);
+  }
+
+  if (c == '$') {
+    if (is_digit(next)) {
+      lexer->pos++;
+      while (is_digit(peek(lexer, 0))) {
+        lexer->pos++;
+      }
+      return finish(lexer, PG_LEX_PARAM, start);
+    }
+    int32_t tag_length = dollar_tag_length(lexer);
+    if (tag_length > 0) {
+      return finish(lexer, lex_dollar_string(lexer, tag_length) ? PG_LEX_DOLLAR_STRING : PG_LEX_UNTERMINATED, start);
+    }
+  }
+
+  if (is_ident_start(c)) {
+    while (is_ident_cont(peek(lexer, 0))) {
+      lexer->pos++;
+    }
+    return finish(lexer, PG_LEX_IDENT, start);
+  }
+
+  if (is_digit(c) || (c == '.' && is_digit(next))) {
+    lex_number(lexer);
+    return finish(lexer, PG_LEX_NUMBER, start);
+  }
+
+  if (c == ':' && (next == ':' || next == '=')) {
+    lexer->pos += 2;
+    return finish(lexer, PG_LEX_PUNCT, start);
+  }
+
+  if (strchr("()[],;.:", c) != NULL) {
+    lexer->pos++;
+    return finish(lexer, PG_LEX_PUNCT, start);
+  }
+
+  if (is_op_char(c)) {
+    lex_operator(lexer);
+    return finish(lexer, PG_LEX_OPERATOR, start);
+  }
+
+  // Anything else (stray `$`, `\`, control characters) is a single-byte
+  // token; the real parser will reject it
+  lexer->pos++;
+  return finish(lexer, PG_LEX_OPERATOR, start);
+}
@@ -0,0 +1,103 @@
+// Throughput benchmark for libpgparser, linked against the static library
+// through the public header only:
+//
+//   make lib LIBPG_QUERY_TAG=17-6.1.0
+//   native/17/libpgparser-bench test/fixtures/dump.sql 200
+//
+// Prints ms/iter and MB/s for each entry point. `json` does the same work
+// as PgParser.parse() minus the JS boundary, so comparing it with the
+// "dump.sql parse" row of `pnpm bench` shows what WASM and the JS glue
+// cost on top of native code.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pgparser.h"
+
+typedef pgparser_result *(*EntryPoint)(const char *sql);
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *data = (char *)malloc(size + 1);
+  if (fread(data, 1, size, file) != (size_t)size) {
+    perror(path);
+    fclose(file);
+    free(data);
+    return NULL;
+  }
+
+  data[size] = '\0';
+  fclose(file);
+  *length = (size_t)size;
+  return data;
+}
+
+static int run(const char *name, EntryPoint entry_point, const char *sql, size_t length, int iterations) {
+  // Warm up once, and fail fast on input the parser rejects
+  pgparser_result *result = entry_point(sql);
+  if (!result || pgparser_result_status(result) != PGPARSER_OK) {
+    fprintf(stderr, "%s: %s\n", name, result ? pgparser_result_error_message(result) : "out of memory");
+    pgparser_result_free(result);
+    return 1;
+  }
+  pgparser_result_free(result);
+
+  double start = now_ms();
+  for (int i = 0; i < iterations; i++) {
+    pgparser_result_free(entry_point(sql));
+  }
+  double elapsed = now_ms() - start;
+
+  printf("%-12s %8.3f ms/iter %8.1f MB/s\n",
+         name, elapsed / iterations, (length * (double)iterations / 1e6) / (elapsed / 1000.0));
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <file.sql> [iterations]\n", argv[0]);
+    return 2;
+  }
+
+  if (pgparser_abi_version() != PGPARSER_ABI_VERSION) {
+    fprintf(stderr, "ABI mismatch: header %d, library %d\n", PGPARSER_ABI_VERSION, pgparser_abi_version());
+    return 1;
+  }
+
+  int iterations = argc > 2 ? atoi(argv[2]) : 100;
+  size_t length;
+  char *sql = read_file(argv[1], &length);
+  if (!sql) {
+    return 1;
+  }
+
+  printf("libpgparser %s (PG %d), %zu bytes, %d iterations\n",
+         pgparser_version(), pgparser_postgres_version(), length, iterations);
+
+  int status = run("json", pgparser_parse_json, sql, length, iterations) ||
+               run("protobuf", pgparser_parse_protobuf, sql, length, iterations) ||
+               run("scan", pgparser_scan, sql, length, iterations) ||
+               run("fingerprint", pgparser_fingerprint, sql, length, iterations);
+
+  free(sql);
+  return status;
+}
@@ -0,0 +1,261 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pgparser.h"
+#include "pg_query.h"
+#include "protobuf-json.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Forward-declare from pg_query.c (not in public header).
+void pg_query_free_error(PgQueryError *error);
+
+// Public wrapper around the bindings for native callers. The struct is
+// private to this file, so fields can move freely between releases.
+
+typedef struct {
+  int32_t start;
+  int32_t end;
+  const char *kind;  // static enum name from the protobuf descriptor
+  int32_t keyword_kind;
+} Token;
+
+struct pgparser_result {
+  pgparser_status status;
+  char *data;
+  size_t length;
+  uint64_t fingerprint;
+  Token *tokens;
+  size_t n_tokens;
+  char *error_message;
+  int32_t error_position;
+};
+
+static pgparser_result *new_result(void) {
+  pgparser_result *result = (pgparser_result *)calloc(1, sizeof(pgparser_result));
+  if (result) {
+    result->error_position = -1;
+  }
+  return result;
+}
+
+static void set_error(pgparser_result *result, pgparser_status status, const char *message) {
+  result->status = status;
+  result->error_message = strdup(message ? message : "unknown error");
+}
+
+// Postgres reports `cursorpos` as a 1-based character position. Walk
+// the UTF-8 input to turn it into a 0-based byte offset, matching the
+// token offsets, and stop at the end of `sql` if it points past it.
+static int32_t cursor_to_byte_offset(const char *sql, int cursorpos) {
+  if (cursorpos <= 0) {
+    return -1;
+  }
+
+  int32_t offset = 0;
+  for (int chars = 1; chars < cursorpos && sql[offset] != '\0'; chars++) {
+    offset++;
+    while (((unsigned char)sql[offset] & 0xC0) == 0x80) {
+      offset++;
+    }
+  }
+  return offset;
+}
+
+// Takes ownership of `error`.
+static void set_parse_error(pgparser_result *result, const char *sql, PgQueryError *error) {
+  set_error(result, PGPARSER_PARSE_ERROR, error->message);
+  result->error_position = cursor_to_byte_offset(sql, error->cursorpos);
+  pg_query_free_error(error);
+}
+
+PGPARSER_API int32_t pgparser_abi_version(void) {
+  return PGPARSER_ABI_VERSION;
+}
+
+PGPARSER_API const char *pgparser_version(void) {
+  return PGPARSER_VERSION;
+}
+
+PGPARSER_API int32_t pgparser_postgres_version(void) {
+  return PG_VERSION_NUM;
+}
+
+PGPARSER_API pgparser_result *pgparser_parse_protobuf(const char *sql) {
+  pgparser_result *result = new_result();
+  if (!result) {
+    return NULL;
+  }
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    set_parse_error(result, sql, parsed.error);
+    return result;
+  }
+
+  result->data = parsed.parse_tree.data;
+  result->length = parsed.parse_tree.len;
+  return result;
+}
+
+PGPARSER_API pgparser_result *pgparser_parse_json(const char *sql) {
+  pgparser_result *result = new_result();
+  if (!result) {
+    return NULL;
+  }
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    set_parse_error(result, sql, parsed.error);
+    return result;
+  }
+
+  ProtobufToJsonResult *json_result = protobuf_to_json(&parsed.parse_tree);
+  free(parsed.parse_tree.data);
+
+  if (json_result->json_string == NULL) {
+    set_error(result, PGPARSER_ERROR, json_result->error);
+  } else {
+    result->data = json_result->json_string;
+    result->length = strlen(json_result->json_string);
+    json_result->json_string = NULL;
+  }
+
+  free_protobuf_to_json_result(json_result);
+  return result;
+}
+
+PGPARSER_API pgparser_result *pgparser_scan(const char *sql) {
+  pgparser_result *result = new_result();
+  if (!result) {
+    return NULL;
+  }
+
+  PgQueryScanResult scanned = pg_query_scan(sql);
+  free(scanned.stderr_buffer);
+
+  if (scanned.error) {
+    free(scanned.pbuf.data);
+    set_parse_error(result, sql, scanned.error);
+    return result;
+  }
+
+  PgQuery__ScanResult *scan = pg_query__scan_result__unpack(
+    NULL, scanned.pbuf.len, (uint8_t *)scanned.pbuf.data);
+  free(scanned.pbuf.data);
+
+  if (!scan) {
+    set_error(result, PGPARSER_ERROR, "failed to unpack scan result");
+    return result;
+  }
+
+  result->tokens = (Token *)malloc((scan->n_tokens ? scan->n_tokens : 1) * sizeof(Token));
+  if (!result->tokens) {
+    set_error(result, PGPARSER_ERROR, "out of memory");
+    pg_query__scan_result__free_unpacked(scan, NULL);
+    return result;
+  }
+
+  for (size_t i = 0; i < scan->n_tokens; i++) {
+    const ProtobufCEnumValue *token_val = protobuf_c_enum_descriptor_get_value(
+      &pg_query__token__descriptor, scan->tokens[i]->token);
+
+    result->tokens[i].start = scan->tokens[i]->start;
+    result->tokens[i].end = scan->tokens[i]->end;
+    result->tokens[i].kind = token_val ? token_val->name : "UNKNOWN";
+    result->tokens[i].keyword_kind = scan->tokens[i]->keyword_kind;
+  }
+  result->n_tokens = scan->n_tokens;
+
+  pg_query__scan_result__free_unpacked(scan, NULL);
+  return result;
+}
+
+PGPARSER_API pgparser_result *pgparser_fingerprint(const char *sql) {
+  pgparser_result *result = new_result();
+  if (!result) {
+    return NULL;
+  }
+
+  PgQueryFingerprintResult fingerprinted = pg_query_fingerprint(sql);
+
+  if (fingerprinted.error) {
+    set_parse_error(result, sql, fingerprinted.error);
+    fingerprinted.error = NULL;
+  } else {
+    result->fingerprint = fingerprinted.fingerprint;
+    result->data = fingerprinted.fingerprint_str;
+    result->length = strlen(fingerprinted.fingerprint_str);
+    fingerprinted.fingerprint_str = NULL;
+  }
+
+  pg_query_free_fingerprint_result(fingerprinted);
+  return result;
+}
+
+PGPARSER_API pgparser_status pgparser_result_status(const pgparser_result *result) {
+  return result->status;
+}
+
+PGPARSER_API const char *pgparser_result_data(const pgparser_result *result, size_t *length) {
+  if (length) {
+    *length = result->length;
+  }
+  return result->data;
+}
+
+PGPARSER_API uint64_t pgparser_result_fingerprint(const pgparser_result *result) {
+  return result->fingerprint;
+}
+
+PGPARSER_API size_t pgparser_result_token_count(const pgparser_result *result) {
+  return result->n_tokens;
+}
+
+PGPARSER_API int pgparser_result_token(const pgparser_result *result, size_t index, pgparser_token *token) {
+  if (index >= result->n_tokens) {
+    return -1;
+  }
+
+  const Token *source = &result->tokens[index];
+  pgparser_token copy = {
+    sizeof(pgparser_token),
+    source->start,
+    source->end,
+    source->kind,
+    source->keyword_kind,
+  };
+
+  // Never write past what the caller's version of the struct holds
+  size_t size = token->size < sizeof(copy) ? token->size : sizeof(copy);
+  if (size > sizeof(copy.size)) {
+    memcpy((char *)token + sizeof(copy.size), (const char *)&copy + sizeof(copy.size), size - sizeof(copy.size));
+  }
+  return 0;
+}
+
+PGPARSER_API const char *pgparser_result_error_message(const pgparser_result *result) {
+  return result->error_message;
+}
+
+PGPARSER_API int32_t pgparser_result_error_position(const pgparser_result *result) {
+  return result->error_position;
+}
+
+PGPARSER_API void pgparser_result_free(pgparser_result *result) {
+  if (!result) {
+    return;
+  }
+  free(result->data);
+  free(result->tokens);
+  free(result->error_message);
+  free(result);
+}
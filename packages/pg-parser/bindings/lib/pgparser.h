@@ -0,0 +1,108 @@
+// libpgparser: the pg-parser bindings as a native C library.
+//
+// This is the only public header. Everything it declares is part of the
+// stable ABI: results are opaque and only read through accessor
+// functions, structs that cross the boundary start with their own size,
+// and every symbol is versioned (see libpgparser.map). Internal binding
+// entry points (parse_sql, scan_sql, ...) are not exported.
+//
+// Build with `make lib NATIVE=1 LIBPG_QUERY_TAG=17-6.1.0`, which writes
+// libpgparser.a and libpgparser.so to native/<pg-version>/.
+
+#ifndef PGPARSER_H
+#define PGPARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PGPARSER_VERSION_MAJOR 1
+#define PGPARSER_VERSION_MINOR 0
+#define PGPARSER_VERSION_PATCH 0
+#define PGPARSER_VERSION "1.0.0"
+
+// Bumped on any incompatible change; matches the SONAME (libpgparser.so.1).
+#define PGPARSER_ABI_VERSION 1
+
+#if defined(_WIN32)
+#define PGPARSER_API __declspec(dllexport)
+#else
+#define PGPARSER_API __attribute__((visibility("default")))
+#endif
+
+typedef struct pgparser_result pgparser_result;
+
+typedef enum {
+  PGPARSER_OK = 0,
+  PGPARSER_PARSE_ERROR = 1,  // the input isn't valid SQL
+  PGPARSER_ERROR = 2,        // anything else (allocation, serialization)
+} pgparser_status;
+
+// One token from pgparser_scan(). Set `size` to sizeof(pgparser_token)
+// before calling pgparser_result_token(); fields past `size` are left
+// untouched, so older callers keep working when fields are added.
+typedef struct {
+  size_t size;
+  int32_t start;         // byte offset of the first character
+  int32_t end;           // byte offset past the last character
+  const char *kind;      // token name, e.g. "SELECT" or "IDENT"
+  int32_t keyword_kind;  // 0 unless the token is a keyword
+} pgparser_token;
+
+// ABI version of the loaded library; compare with PGPARSER_ABI_VERSION.
+PGPARSER_API int32_t pgparser_abi_version(void);
+
+// Library version string, e.g. "1.0.0".
+PGPARSER_API const char *pgparser_version(void);
+
+// PG_VERSION_NUM of the bundled parser, e.g. 170004.
+PGPARSER_API int32_t pgparser_postgres_version(void);
+
+// Each entry point returns a result that must be released with
+// pgparser_result_free(), even on error. NULL is only returned when the
+// result itself can't be allocated.
+
+// Parse tree as JSON, in the same shape PgParser.parse() returns.
+PGPARSER_API pgparser_result *pgparser_parse_json(const char *sql);
+
+// Parse tree as packed pg_query.ParseResult protobuf.
+PGPARSER_API pgparser_result *pgparser_parse_protobuf(const char *sql);
+
+// Tokens, read with pgparser_result_token().
+PGPARSER_API pgparser_result *pgparser_scan(const char *sql);
+
+// Statement fingerprint, read with pgparser_result_fingerprint().
+PGPARSER_API pgparser_result *pgparser_fingerprint(const char *sql);
+
+PGPARSER_API pgparser_status pgparser_result_status(const pgparser_result *result);
+
+// Output bytes: JSON (NUL-terminated), protobuf, or the fingerprint as hex
+// text. NULL on error. `length` may be NULL.
+PGPARSER_API const char *pgparser_result_data(const pgparser_result *result, size_t *length);
+
+// 0 unless the result came from pgparser_fingerprint().
+PGPARSER_API uint64_t pgparser_result_fingerprint(const pgparser_result *result);
+
+PGPARSER_API size_t pgparser_result_token_count(const pgparser_result *result);
+
+// Copies token `index` into `token`. Returns 0, or -1 if out of range.
+PGPARSER_API int pgparser_result_token(const pgparser_result *result, size_t index, pgparser_token *token);
+
+// NULL unless the status is an error.
+PGPARSER_API const char *pgparser_result_error_message(const pgparser_result *result);
+
+// 0-based byte offset of a parse error in the UTF-8 input, or -1 if it has
+// none. Postgres counts characters; this is converted to bytes like the
+// token offsets.
+PGPARSER_API int32_t pgparser_result_error_position(const pgparser_result *result);
+
+PGPARSER_API void pgparser_result_free(pgparser_result *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // PGPARSER_H
@@ -0,0 +1,92 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "macros.h"
+#include "parse-limits.h"
+
+// Pre-parse admission limits.
+//
+// A single lexer pass that rejects oversized or pathological input before
+// pg_query_parse_protobuf() runs, so rejected input never allocates a tree.
+// A limit of 0 means unlimited.
+
+static PgLimitViolation *violation(PgLimitKind kind, int32_t max, int32_t position) {
+  PgLimitViolation *result = (PgLimitViolation *)malloc(sizeof(PgLimitViolation));
+  result->kind = kind;
+  result->max = max;
+  result->position = position;
+  return result;
+}
+
+// Returns NULL when the input is within all limits.
+EXPORT("check_limits")
+PgLimitViolation *check_limits(const char *sql, int32_t max_bytes, int32_t max_tokens, int32_t max_statements, int32_t max_depth) {
+  size_t length = strlen(sql);
+
+  if (max_bytes > 0 && length > (size_t)max_bytes) {
+    return violation(PG_LIMIT_BYTES, max_bytes, max_bytes);
+  }
+
+  // Nothing left to check, skip the lexer pass
+  if (max_tokens <= 0 && max_statements <= 0 && max_depth <= 0) {
+    return NULL;
+  }
+
+  PgLexer lexer;
+  pg_lexer_init(&lexer, sql, (int32_t)length);
+
+  int32_t tokens = 0;
+  int32_t statements = 0;
+  int32_t depth = 0;
+  int in_statement = 0;
+
+  for (;;) {
+    PgLexToken token = pg_lexer_next(&lexer);
+
+    if (token.kind == PG_LEX_EOF || token.kind == PG_LEX_UNTERMINATED) {
+      // Let the parser report unterminated input
+      return NULL;
+    }
+
+    if (token.kind == PG_LEX_LINE_COMMENT || token.kind == PG_LEX_BLOCK_COMMENT) {
+      continue;
+    }
+
+    if (max_tokens > 0 && ++tokens > max_tokens) {
+      return violation(PG_LIMIT_TOKENS, max_tokens, token.start);
+    }
+
+    if (token.kind == PG_LEX_PUNCT) {
+      char c = sql[token.start];
+
+      if (c == ';' && depth == 0) {
+        // Only top-level semicolons end a statement. BEGIN ATOMIC bodies
+        // also contain top-level semicolons, so those count conservatively.
+        in_statement = 0;
+        continue;
+      }
+
+      if (c == '(' || c == '[') {
+        if (max_depth > 0 && ++depth > max_depth) {
+          return violation(PG_LIMIT_DEPTH, max_depth, token.start);
+        }
+      } else if ((c == ')' || c == ']') && depth > 0) {
+        depth--;
+      }
+    }
+
+    if (!in_statement) {
+      in_statement = 1;
+      if (max_statements > 0 && ++statements > max_statements) {
+        return violation(PG_LIMIT_STATEMENTS, max_statements, token.start);
+      }
+    }
+  }
+}
+
+EXPORT("free_limit_violation")
+void free_limit_violation(PgLimitViolation *result) {
+  free(result);
+}
@@ -0,0 +1,102 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "macros.h"
+#include "metrics.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Query complexity metrics, computed in one walk of the protobuf tree
+// without ever producing JSON.
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  int32_t n_stmts;
+  int32_t n_metrics;  // PG_METRIC_COUNT, so JS can detect a mismatch
+  int32_t *values;    // n_stmts rows of n_metrics values
+  PgQueryError *error;
+} PgMetricsResult;
+
+PgWalkAction pg_count_metrics(ProtobufCMessage *message, int32_t depth, void *context) {
+  int32_t *row = (int32_t *)context;
+
+  row[PG_METRIC_NODES]++;
+  if (depth + 1 > row[PG_METRIC_DEPTH]) {
+    row[PG_METRIC_DEPTH] = depth + 1;
+  }
+
+  if (pg_is_message(message, &pg_query__select_stmt__descriptor)) {
+    PgQuery__SelectStmt *select = (PgQuery__SelectStmt *)message;
+
+    if (select->op != PG_QUERY__SET_OPERATION__SETOP_NONE && select->op != PG_QUERY__SET_OPERATION__SET_OPERATION_UNDEFINED) {
+      row[PG_METRIC_SET_OPERATIONS]++;
+    }
+
+    // `FROM a, b, c` is two implicit joins
+    if (select->n_from_clause > 1) {
+      row[PG_METRIC_JOINS] += (int32_t)select->n_from_clause - 1;
+    }
+  } else if (pg_is_message(message, &pg_query__join_expr__descriptor)) {
+    row[PG_METRIC_JOINS]++;
+  } else if (pg_is_message(message, &pg_query__sub_link__descriptor) ||
+             pg_is_message(message, &pg_query__range_subselect__descriptor)) {
+    row[PG_METRIC_SUBQUERIES]++;
+  } else if (pg_is_message(message, &pg_query__common_table_expr__descriptor)) {
+    row[PG_METRIC_CTES]++;
+  } else if (pg_is_message(message, &pg_query__func_call__descriptor)) {
+    row[PG_METRIC_FUNCTIONS]++;
+  }
+
+  return PG_WALK_CONTINUE;
+}
+
+EXPORT("metrics_sql")
+PgMetricsResult *metrics_sql(char *sql) {
+  PgMetricsResult *result = (PgMetricsResult *)calloc(1, sizeof(PgMetricsResult));
+  result->n_metrics = PG_METRIC_COUNT;
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    result->error = parsed.error;
+    return result;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    result->error = pg_make_error("failed to unpack parse tree");
+    return result;
+  }
+
+  result->n_stmts = (int32_t)tree->n_stmts;
+  result->values = (int32_t *)calloc(tree->n_stmts * PG_METRIC_COUNT + 1, sizeof(int32_t));
+
+  for (size_t i = 0; i < tree->n_stmts; i++) {
+    int32_t *row = result->values + i * PG_METRIC_COUNT;
+    ProtobufCMessage *stmt = (ProtobufCMessage *)tree->stmts[i]->stmt;
+
+    if (pg_walk(stmt, pg_count_metrics, row) != 0) {
+      result->error = pg_make_error("out of memory walking parse tree");
+      break;
+    }
+  }
+
+  pg_query__parse_result__free_unpacked(tree, NULL);
+  return result;
+}
+
+EXPORT("free_metrics_result")
+void free_metrics_result(PgMetricsResult *result) {
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->values);
+  free(result);
+}
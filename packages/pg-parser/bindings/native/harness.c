@@ -0,0 +1,260 @@
+// Native driver for the WASM bindings, used to profile them with perf:
+//
+//   make native LIBPG_QUERY_TAG=17-6.1.0
+//   perf record -g native/17/pg-parser-harness parse test/fixtures/dump.sql 200
+//   perf report
+//
+// It calls the exact same entry points JS calls (parse_sql, deparse_sql,
+// scan_sql, ...) so hot spots map 1:1 to the WASM build.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pg_query.h"
+
+// Forward-declare the bindings (they have no header; JS binds them by name).
+PgQueryParseResult *parse_sql(char *sql);
+PgQueryDeparseResult *deparse_sql(char *parse_tree_json);
+void free_parse_result(PgQueryParseResult *result);
+void free_deparse_result(PgQueryDeparseResult *result);
+void *scan_sql(char *sql);
+void free_scan_result(void *result);
+PgQuerySplitResult *split_sql(char *sql);
+void free_split_result(PgQuerySplitResult *result);
+void *metrics_sql(char *sql);
+void free_metrics_result(void *result);
+void *build_catalog(char *sql);
+void free_catalog_result(void *result);
+void *build_dependency_graph(char *sql);
+void free_dependency_result(void *result);
+void *rewrite_sql(char *sql, int count, char *operations);
+void free_rewrite_result(void *result);
+void *parameterize_sql(char *sql, int count);
+void free_parameterize_result(void *result);
+void *format_sql(char *sql, int indent_size, int max_line_length, int commas_start_of_line, int trailing_newline);
+void free_format_result(void *result);
+void *verify_round_trip(char *input, int is_tree);
+void free_round_trip_result(void *result);
+void *compile_template(char *sql);
+void free_template_result(void *result);
+void free_template(void *template);
+void *render_template(void *template, char *identifiers_json, char *values_json);
+void free_render_result(void *result);
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *data = (char *)malloc(size + 1);
+  if (fread(data, 1, size, file) != (size_t)size) {
+    perror(path);
+    fclose(file);
+    free(data);
+    return NULL;
+  }
+
+  data[size] = '\0';
+  fclose(file);
+  return data;
+}
+
+static int run_parse(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    PgQueryParseResult *result = parse_sql(sql);
+    if (result->error) {
+      fprintf(stderr, "parse error: %s\n", result->error->message);
+      free_parse_result(result);
+      return 1;
+    }
+    free_parse_result(result);
+  }
+  return 0;
+}
+
+static int run_deparse(char *sql, int iterations) {
+  PgQueryParseResult *parsed = parse_sql(sql);
+  if (parsed->error) {
+    fprintf(stderr, "parse error: %s\n", parsed->error->message);
+    free_parse_result(parsed);
+    return 1;
+  }
+
+  int status = 0;
+  for (int i = 0; i < iterations; i++) {
+    PgQueryDeparseResult *result = deparse_sql(parsed->parse_tree);
+    if (result->error) {
+      fprintf(stderr, "deparse error: %s\n", result->error->message);
+      status = 1;
+    }
+    free_deparse_result(result);
+    if (status) break;
+  }
+
+  free_parse_result(parsed);
+  return status;
+}
+
+static int run_scan(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_scan_result(scan_sql(sql));
+  }
+  return 0;
+}
+
+static int run_split(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_split_result(split_sql(sql));
+  }
+  return 0;
+}
+
+static int run_metrics(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_metrics_result(metrics_sql(sql));
+  }
+  return 0;
+}
+
+static int run_catalog(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_catalog_result(build_catalog(sql));
+  }
+  return 0;
+}
+
+static int run_dependencies(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_dependency_result(build_dependency_graph(sql));
+  }
+  return 0;
+}
+
+// The multi-tenant proxy rewrite: qualify everything, filter by tenant
+static int run_rewrite(char *sql, int iterations) {
+  char operations[] =
+      "[{\"type\":\"qualifySchema\",\"schema\":\"tenant\"},"
+      "{\"type\":\"injectPredicate\",\"column\":\"tenant_id\",\"param\":1}]";
+
+  for (int i = 0; i < iterations; i++) {
+    free_rewrite_result(rewrite_sql(sql, 1, operations));
+  }
+  return 0;
+}
+
+static int run_parameterize(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_parameterize_result(parameterize_sql(sql, 1));
+  }
+  return 0;
+}
+
+static int run_format(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_format_result(format_sql(sql, 4, 80, 0, 0));
+  }
+  return 0;
+}
+
+static int run_roundtrip(char *sql, int iterations) {
+  for (int i = 0; i < iterations; i++) {
+    free_round_trip_result(verify_round_trip(sql, 0));
+  }
+  return 0;
+}
+
+// Compiles the file once, then renders it with a value for $1
+static int run_render(char *sql, int iterations) {
+  void *result = compile_template(sql);
+  void *template = *(void **)result;  // PgTemplateResult.template
+  free_template_result(result);
+
+  if (!template) {
+    fprintf(stderr, "template failed to compile\n");
+    return 1;
+  }
+
+  char identifiers[] = "{}";
+  char values[] = "[{\"number\":\"42\"}]";
+
+  for (int i = 0; i < iterations; i++) {
+    free_render_result(render_template(template, identifiers, values));
+  }
+
+  free_template(template);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <parse|deparse|scan|split|metrics|catalog|dependencies|rewrite|parameterize|format|roundtrip|render> <file.sql> [iterations]\n", argv[0]);
+    return 2;
+  }
+
+  const char *operation = argv[1];
+  int iterations = argc > 3 ? atoi(argv[3]) : 100;
+
+  char *sql = read_file(argv[2]);
+  if (!sql) {
+    return 1;
+  }
+
+  int (*run)(char *, int) = NULL;
+  if (strcmp(operation, "parse") == 0) {
+    run = run_parse;
+  } else if (strcmp(operation, "deparse") == 0) {
+    run = run_deparse;
+  } else if (strcmp(operation, "scan") == 0) {
+    run = run_scan;
+  } else if (strcmp(operation, "split") == 0) {
+    run = run_split;
+  } else if (strcmp(operation, "metrics") == 0) {
+    run = run_metrics;
+  } else if (strcmp(operation, "catalog") == 0) {
+    run = run_catalog;
+  } else if (strcmp(operation, "dependencies") == 0) {
+    run = run_dependencies;
+  } else if (strcmp(operation, "rewrite") == 0) {
+    run = run_rewrite;
+  } else if (strcmp(operation, "parameterize") == 0) {
+    run = run_parameterize;
+  } else if (strcmp(operation, "format") == 0) {
+    run = run_format;
+  } else if (strcmp(operation, "roundtrip") == 0) {
+    run = run_roundtrip;
+  } else if (strcmp(operation, "render") == 0) {
+    run = run_render;
+  } else {
+    fprintf(stderr, "unknown operation: %s\n", operation);
+    free(sql);
+    return 2;
+  }
+
+  double start = now_ms();
+  int status = run(sql, iterations);
+  double elapsed = now_ms() - start;
+
+  if (status == 0) {
+    printf("%s: %d iterations in %.1f ms (%.3f ms/iter)\n",
+           operation, iterations, elapsed, elapsed / iterations);
+  }
+
+  free(sql);
+  return status;
+}
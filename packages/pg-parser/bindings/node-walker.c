@@ -0,0 +1,105 @@
+#include "node-walker.h"
+
+#include <stdlib.h>
+
+typedef struct {
+  ProtobufCMessage *message;
+  int32_t depth;
+} WalkEntry;
+
+typedef struct {
+  WalkEntry *entries;
+  size_t length;
+  size_t capacity;
+} WalkStack;
+
+static int push(WalkStack *stack, ProtobufCMessage *message, int32_t depth) {
+  if (stack->length == stack->capacity) {
+    size_t capacity = stack->capacity ? stack->capacity * 2 : 64;
+    WalkEntry *entries = (WalkEntry *)realloc(stack->entries, capacity * sizeof(WalkEntry));
+    if (!entries) {
+      return -1;
+    }
+    stack->entries = entries;
+    stack->capacity = capacity;
+  }
+
+  stack->entries[stack->length].message = message;
+  stack->entries[stack->length].depth = depth;
+  stack->length++;
+  return 0;
+}
+
+// Pushes child messages in reverse field order so they pop in field order.
+static int push_children(WalkStack *stack, ProtobufCMessage *message, int32_t depth) {
+  const ProtobufCMessageDescriptor *descriptor = message->descriptor;
+  char *base = (char *)message;
+
+  for (unsigned i = descriptor->n_fields; i-- > 0;) {
+    const ProtobufCFieldDescriptor *field = &descriptor->fields[i];
+
+    if (field->type != PROTOBUF_C_TYPE_MESSAGE) {
+      continue;
+    }
+
+    // Only the active member of a oneof is set
+    if ((field->flags & PROTOBUF_C_FIELD_FLAG_ONEOF) && *(uint32_t *)(base + field->quantifier_offset) != field->id) {
+      continue;
+    }
+
+    if (field->label == PROTOBUF_C_LABEL_REPEATED) {
+      size_t count = *(size_t *)(base + field->quantifier_offset);
+      ProtobufCMessage **items = *(ProtobufCMessage ***)(base + field->offset);
+
+      for (size_t j = count; j-- > 0;) {
+        if (items[j] && push(stack, items[j], depth) != 0) {
+          return -1;
+        }
+      }
+    } else {
+      ProtobufCMessage *child = *(ProtobufCMessage **)(base + field->offset);
+
+      if (child && push(stack, child, depth) != 0) {
+        return -1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int pg_walk(ProtobufCMessage *root, PgWalkCallback callback, void *context) {
+  WalkStack stack = {NULL, 0, 0};
+  int status = 0;
+
+  if (root && push(&stack, root, 0) != 0) {
+    return -1;
+  }
+
+  while (stack.length > 0) {
+    WalkEntry entry = stack.entries[--stack.length];
+
+    // Node wrappers are transparent: their single child takes their place
+    if (pg_is_message(entry.message, &pg_query__node__descriptor)) {
+      if (push_children(&stack, entry.message, entry.depth) != 0) {
+        status = -1;
+        break;
+      }
+      continue;
+    }
+
+    PgWalkAction action = callback(entry.message, entry.depth, context);
+
+    if (action == PG_WALK_STOP) {
+      break;
+    }
+
+    if (action == PG_WALK_CONTINUE && push_children(&stack, entry.message, entry.depth + 1) != 0) {
+      status = -1;
+      break;
+    }
+  }
+
+  free(stack.entries);
+  return status;
+}
@@ -2,7 +2,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "batch.h"
 #include "macros.h"
+#include "parse-limits.h"
 #include "pg_query.h"
 #include "protobuf-json.h"
 #include "protobuf/pg_query.pb-c.h"
@@ -115,6 +117,66 @@ void free_deparse_result(PgQueryDeparseResult *result) {
   free(result);
 }
 
+// --- Batches ---
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12).
+typedef struct {
+  int32_t n_unique;
+  PgQueryParseResult **results;   // per distinct query, NULL if it broke a limit
+  PgLimitViolation **violations;  // per distinct query, NULL if within limits
+  int32_t *indexes;               // per input query, its distinct query
+} PgParseManyResult;
+
+// `sql` holds `count` null-terminated queries back to back. Each distinct
+// text is checked against the limits (0 means unlimited) and parsed once.
+EXPORT("parse_many")
+PgParseManyResult *parse_many(char *sql, int32_t count, int32_t max_bytes, int32_t max_tokens, int32_t max_statements, int32_t max_depth) {
+  PgBatch batch;
+
+  if (pg_batch_dedupe(sql, count, &batch) != 0) {
+    return NULL;
+  }
+
+  PgParseManyResult *result = (PgParseManyResult *)malloc(sizeof(PgParseManyResult));
+  int has_limits = max_bytes > 0 || max_tokens > 0 || max_statements > 0 || max_depth > 0;
+
+  result->n_unique = batch.n_unique;
+  result->results = (PgQueryParseResult **)calloc(batch.n_unique + 1, sizeof(PgQueryParseResult *));
+  result->violations = (PgLimitViolation **)calloc(batch.n_unique + 1, sizeof(PgLimitViolation *));
+  result->indexes = batch.indexes;  // Transfer ownership
+  batch.indexes = NULL;
+
+  for (int32_t i = 0; i < batch.n_unique; i++) {
+    char *query = (char *)batch.unique[i];
+
+    if (has_limits) {
+      result->violations[i] = check_limits(query, max_bytes, max_tokens, max_statements, max_depth);
+    }
+    if (!result->violations[i]) {
+      result->results[i] = parse_sql(query);
+    }
+  }
+
+  pg_batch_free(&batch);
+  return result;
+}
+
+EXPORT("free_parse_many_result")
+void free_parse_many_result(PgParseManyResult *result) {
+  for (int32_t i = 0; i < result->n_unique; i++) {
+    if (result->results[i]) {
+      free_parse_result(result->results[i]);
+    }
+    if (result->violations[i]) {
+      free_limit_violation(result->violations[i]);
+    }
+  }
+  free(result->results);
+  free(result->violations);
+  free(result->indexes);
+  free(result);
+}
+
 // --- Scanner ---
 
 typedef struct {
@@ -183,3 +245,18 @@ void free_scan_result(PgScanResult *result) {
   free(result->tokens);
   free(result);
 }
+
+// --- Splitter ---
+
+EXPORT("split_sql")
+PgQuerySplitResult *split_sql(char *sql) {
+  PgQuerySplitResult *result = (PgQuerySplitResult *)malloc(sizeof(PgQuerySplitResult));
+  *result = pg_query_split_with_scanner(sql);
+  return result;
+}
+
+EXPORT("free_split_result")
+void free_split_result(PgQuerySplitResult *result) {
+  pg_query_free_split_result(*result);
+  free(result);
+}
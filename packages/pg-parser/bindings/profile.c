@@ -0,0 +1,86 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#else
+#include <time.h>
+#endif
+
+#include "macros.h"
+#include "pg_query.h"
+#include "protobuf-json.h"
+
+// Forward-declare from pg_query.c (not in public header).
+void pg_query_free_error(PgQueryError *error);
+
+static double now_ms(void) {
+#ifdef __EMSCRIPTEN__
+  return emscripten_get_now();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
+}
+
+// Per-phase timings for a single parse_sql() call.
+// Field order is ABI: JS reads these by byte offset (0, 8, 16, 20, 24).
+typedef struct {
+  double parse_ms;      // pg_query_parse_protobuf()
+  double json_ms;       // protobuf_to_json()
+  int32_t json_length;  // bytes of JSON handed to JS
+  PgQueryError *error;
+  char *json;           // the parse tree, so callers don't parse twice
+} PgProfileResult;
+
+// Runs the same pipeline as parse_sql() but times each phase. Used by
+// the `pg-parser profile` CLI.
+EXPORT("profile_sql")
+PgProfileResult *profile_sql(char *sql) {
+  PgProfileResult *result = (PgProfileResult *)calloc(1, sizeof(PgProfileResult));
+
+  double start = now_ms();
+  PgQueryProtobufParseResult protobuf_result = pg_query_parse_protobuf(sql);
+  result->parse_ms = now_ms() - start;
+
+  free(protobuf_result.stderr_buffer);
+
+  if (protobuf_result.error) {
+    free(protobuf_result.parse_tree.data);
+    result->error = protobuf_result.error;
+    return result;
+  }
+
+  start = now_ms();
+  ProtobufToJsonResult *json_result = protobuf_to_json(&protobuf_result.parse_tree);
+  result->json_ms = now_ms() - start;
+
+  free(protobuf_result.parse_tree.data);
+
+  if (json_result->json_string == NULL) {
+    PgQueryError *error = (PgQueryError *)calloc(1, sizeof(PgQueryError));
+    error->message = json_result->error ? json_result->error : strdup("protobuf to json failed");
+    json_result->error = NULL;  // Ownership transferred
+    result->error = error;
+  } else {
+    result->json_length = (int32_t)strlen(json_result->json_string);
+    result->json = json_result->json_string;
+    json_result->json_string = NULL;  // Ownership transferred
+  }
+
+  free_protobuf_to_json_result(json_result);
+  return result;
+}
+
+EXPORT("free_profile_result")
+void free_profile_result(PgProfileResult *result) {
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->json);
+  free(result);
+}
@@ -0,0 +1,913 @@
+#include <jansson.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "macros.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Applies declarative rewrite operations (schema-qualify relations,
+// rename relations and columns, inject `column = $n` predicates) to the
+// unpacked protobuf tree, then deparses it, so a rewrite never round-trips
+// the AST through JSON. Queries are rewritten in batches.
+//
+// Operations run in order, each as one walk over every statement. Names
+// are matched as they appear in the tree: unquoted identifiers are
+// already folded to lower case by the parser.
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8).
+typedef struct {
+  char *sql;
+  PgQueryError *error;
+  int32_t parsed;  // whether `error` happened after parsing (rewrite or deparse)
+} PgRewriteQuery;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8).
+typedef struct {
+  int32_t n_queries;
+  PgRewriteQuery *queries;
+  PgQueryError *error;  // invalid operations, no queries were rewritten
+} PgRewriteResult;
+
+typedef enum {
+  PG_REWRITE_QUALIFY_SCHEMA,
+  PG_REWRITE_RENAME_RELATION,
+  PG_REWRITE_RENAME_COLUMN,
+  PG_REWRITE_INJECT_PREDICATE,
+} PgRewriteKind;
+
+typedef struct {
+  const char *schema;  // NULL matches any schema
+  const char *name;
+} RelationName;
+
+typedef struct {
+  PgRewriteKind kind;
+  const char *schema;        // qualifySchema
+  RelationName from;         // renameRelation
+  const char *from_column;   // renameColumn
+  const char *to;            // renameRelation, renameColumn
+  const char *column;        // injectPredicate
+  int32_t param;             // injectPredicate
+  RelationName *relations;   // injectPredicate, NULL for every relation
+  size_t n_relations;
+} PgRewriteOp;
+
+typedef struct {
+  PgRewriteOp *ops;
+  size_t n_ops;
+  char *names;  // backing storage for split `schema.name` pairs
+} PgRewriteOps;
+
+// A WITH clause whose CTEs are visible below the message at `depth`.
+// Inside the body of a non-recursive CTE only the CTEs before it are.
+typedef struct {
+  PgQuery__WithClause *with;
+  size_t n_visible;
+  int32_t depth;
+} CteScope;
+
+// A FROM item (or DML target) of the query at `depth`, which a
+// `table.column` reference below it can resolve to.
+typedef struct {
+  PgQuery__RangeVar *relation;  // NULL for subqueries, functions and joins
+  const char *alias;            // NULL when referenced by relation name
+  int renamed;                  // renamed by the current renameRelation
+  int32_t depth;
+} RangeEntry;
+
+typedef struct {
+  const PgRewriteOp *op;
+  CteScope *scopes;  // innermost last, kept up to date as the walk goes
+  size_t n_scopes;
+  size_t scopes_capacity;
+  RangeEntry *ranges;  // innermost last, like `scopes`
+  size_t n_ranges;
+  size_t ranges_capacity;
+  PgQuery__RangeVar *target;  // of the current INSERT, UPDATE, DELETE or MERGE
+  const char *error;          // static message; set on failure
+} RewriteContext;
+
+// Replaces a string field of the unpacked tree. Unset fields point at
+// protobuf-c's shared empty string, which must not be freed.
+static int set_string(char **field, const char *value) {
+  char *copy = strdup(value);
+  if (!copy) {
+    return -1;
+  }
+  if (*field && *field != protobuf_c_empty_string) {
+    free(*field);
+  }
+  *field = copy;
+  return 0;
+}
+
+// Splits `schema.name` in place. A name without a dot matches any schema.
+static RelationName split_relation_name(char *value) {
+  RelationName name = {NULL, value};
+  char *dot = strchr(value, '.');
+  if (dot) {
+    *dot = '\0';
+    name.schema = value;
+    name.name = dot + 1;
+  }
+  return name;
+}
+
+static const char *get_string(json_t *object, const char *key) {
+  json_t *value = json_object_get(object, key);
+  return json_is_string(value) ? json_string_value(value) : NULL;
+}
+
+// Compiles the JSON operations list. Strings point into `json` (or into
+// `ops->names` when split), so `json` must outlive the ops.
+static const char *compile_ops(json_t *json, PgRewriteOps *ops) {
+  if (!json_is_array(json)) {
+    return "rewrite operations must be an array";
+  }
+
+  // Every `schema.name` string that may be split, copied once up front
+  size_t names_size = 0;
+  size_t index;
+  json_t *item;
+  json_array_foreach(json, index, item) {
+    json_t *relations = json_object_get(item, "relations");
+    const char *from = get_string(item, "from");
+    names_size += from ? strlen(from) + 1 : 0;
+
+    size_t r;
+    json_t *relation;
+    json_array_foreach(relations, r, relation) {
+      names_size += json_is_string(relation) ? json_string_length(relation) + 1 : 0;
+    }
+  }
+
+  size_t n_ops = json_array_size(json);
+  ops->ops = (PgRewriteOp *)calloc(n_ops ? n_ops : 1, sizeof(PgRewriteOp));
+  ops->names = (char *)malloc(names_size ? names_size : 1);
+  if (!ops->ops || !ops->names) {
+    return "out of memory compiling rewrite operations";
+  }
+  ops->n_ops = n_ops;
+
+  char *names = ops->names;
+
+  json_array_foreach(json, index, item) {
+    PgRewriteOp *op = &ops->ops[index];
+    const char *type = get_string(item, "type");
+
+    if (!type) {
+      return "rewrite operation is missing its type";
+    }
+
+    if (strcmp(type, "qualifySchema") == 0) {
+      op->kind = PG_REWRITE_QUALIFY_SCHEMA;
+      op->schema = get_string(item, "schema");
+      if (!op->schema || !*op->schema) {
+        return "qualifySchema requires a schema";
+      }
+    } else if (strcmp(type, "renameRelation") == 0 || strcmp(type, "renameColumn") == 0) {
+      const char *from = get_string(item, "from");
+      op->to = get_string(item, "to");
+      if (!from || !*from || !op->to || !*op->to) {
+        return "rename operations require from and to";
+      }
+
+      if (strcmp(type, "renameRelation") == 0) {
+        op->kind = PG_REWRITE_RENAME_RELATION;
+        strcpy(names, from);
+        op->from = split_relation_name(names);
+        names += strlen(from) + 1;
+      } else {
+        op->kind = PG_REWRITE_RENAME_COLUMN;
+        op->from_column = from;
+      }
+    } else if (strcmp(type, "injectPredicate") == 0) {
+      json_t *param = json_object_get(item, "param");
+      json_t *relations = json_object_get(item, "relations");
+
+      op->kind = PG_REWRITE_INJECT_PREDICATE;
+      op->column = get_string(item, "column");
+      if (!op->column || !*op->column) {
+        return "injectPredicate requires a column";
+      }
+      if (!json_is_integer(param) || json_integer_value(param) < 1 || json_integer_value(param) > INT32_MAX) {
+        return "injectPredicate requires a positive integer param";
+      }
+      op->param = (int32_t)json_integer_value(param);
+
+      if (json_is_array(relations)) {
+        op->n_relations = json_array_size(relations);
+        op->relations = (RelationName *)calloc(op->n_relations ? op->n_relations : 1, sizeof(RelationName));
+        if (!op->relations) {
+          return "out of memory compiling rewrite operations";
+        }
+
+        size_t r;
+        json_t *relation;
+        json_array_foreach(relations, r, relation) {
+          if (!json_is_string(relation)) {
+            return "injectPredicate relations must be strings";
+          }
+          strcpy(names, json_string_value(relation));
+          op->relations[r] = split_relation_name(names);
+          names += json_string_length(relation) + 1;
+        }
+      }
+    } else {
+      return "unknown rewrite operation type";
+    }
+  }
+
+  return NULL;
+}
+
+static void free_ops(PgRewriteOps *ops) {
+  for (size_t i = 0; i < ops->n_ops; i++) {
+    free(ops->ops[i].relations);
+  }
+  free(ops->ops);
+  free(ops->names);
+}
+
+// Whether `relation` names a CTE in scope rather than a table. The
+// target of a data-modifying statement is always a table.
+static int is_cte(RewriteContext *context, PgQuery__RangeVar *relation) {
+  if ((relation->schemaname && *relation->schemaname) || relation == context->target) {
+    return 0;
+  }
+
+  for (size_t i = context->n_scopes; i-- > 0;) {
+    const CteScope *scope = &context->scopes[i];
+
+    // Shadowed by the narrower scope of one of its own CTE bodies
+    if (i + 1 < context->n_scopes && context->scopes[i + 1].with == scope->with) {
+      continue;
+    }
+
+    for (size_t j = 0; j < scope->n_visible; j++) {
+      PgQuery__Node *cte = scope->with->ctes[j];
+      if (cte->node_case == PG_QUERY__NODE__NODE_COMMON_TABLE_EXPR &&
+          strcmp(cte->common_table_expr->ctename, relation->relname) == 0) {
+        return 1;
+      }
+    }
+  }
+  return 0;
+}
+
+static int relation_matches(const RelationName *name, PgQuery__RangeVar *relation) {
+  if (strcmp(name->name, relation->relname) != 0) {
+    return 0;
+  }
+  return !name->schema || strcmp(name->schema, relation->schemaname ? relation->schemaname : "") == 0;
+}
+
+static PgQuery__WithClause *with_clause_of(ProtobufCMessage *message) {
+  if (pg_is_message(message, &pg_query__select_stmt__descriptor)) {
+    return ((PgQuery__SelectStmt *)message)->with_clause;
+  }
+  if (pg_is_message(message, &pg_query__insert_stmt__descriptor)) {
+    return ((PgQuery__InsertStmt *)message)->with_clause;
+  }
+  if (pg_is_message(message, &pg_query__update_stmt__descriptor)) {
+    return ((PgQuery__UpdateStmt *)message)->with_clause;
+  }
+  if (pg_is_message(message, &pg_query__delete_stmt__descriptor)) {
+    return ((PgQuery__DeleteStmt *)message)->with_clause;
+  }
+  if (pg_is_message(message, &pg_query__merge_stmt__descriptor)) {
+    return ((PgQuery__MergeStmt *)message)->with_clause;
+  }
+  return NULL;
+}
+
+static int push_scope(RewriteContext *context, PgQuery__WithClause *with, size_t n_visible, int32_t depth) {
+  if (context->n_scopes == context->scopes_capacity) {
+    size_t capacity = context->scopes_capacity ? context->scopes_capacity * 2 : 4;
+    CteScope *scopes = (CteScope *)realloc(context->scopes, capacity * sizeof(CteScope));
+    if (!scopes) {
+      return -1;
+    }
+    context->scopes = scopes;
+    context->scopes_capacity = capacity;
+  }
+
+  context->scopes[context->n_scopes++] = (CteScope){with, n_visible, depth};
+  return 0;
+}
+
+static const char *alias_name(PgQuery__Alias *alias) {
+  return alias && alias->aliasname && *alias->aliasname ? alias->aliasname : NULL;
+}
+
+static int push_range(RewriteContext *context, PgQuery__RangeVar *relation, const char *alias, int32_t depth) {
+  if (context->n_ranges == context->ranges_capacity) {
+    size_t capacity = context->ranges_capacity ? context->ranges_capacity * 2 : 8;
+    RangeEntry *ranges = (RangeEntry *)realloc(context->ranges, capacity * sizeof(RangeEntry));
+    if (!ranges) {
+      return -1;
+    }
+    context->ranges = ranges;
+    context->ranges_capacity = capacity;
+  }
+
+  // Decided before the walk reaches (and renames) the relation itself
+  int renamed = relation && context->op->kind == PG_REWRITE_RENAME_RELATION && !is_cte(context, relation) &&
+                relation_matches(&context->op->from, relation);
+
+  context->ranges[context->n_ranges++] = (RangeEntry){relation, alias, renamed, depth};
+  return 0;
+}
+
+static int push_from_item(RewriteContext *context, PgQuery__Node *item, int32_t depth) {
+  if (!item) {
+    return 0;
+  }
+
+  switch (item->node_case) {
+    case PG_QUERY__NODE__NODE_RANGE_VAR:
+      return push_range(context, item->range_var, alias_name(item->range_var->alias), depth);
+    case PG_QUERY__NODE__NODE_RANGE_SUBSELECT:
+      return push_range(context, NULL, alias_name(item->range_subselect->alias), depth);
+    case PG_QUERY__NODE__NODE_RANGE_FUNCTION:
+      return push_range(context, NULL, alias_name(item->range_function->alias), depth);
+    case PG_QUERY__NODE__NODE_JOIN_EXPR: {
+      PgQuery__JoinExpr *join = item->join_expr;
+      if (push_from_item(context, join->larg, depth) != 0 || push_from_item(context, join->rarg, depth) != 0) {
+        return -1;
+      }
+      return alias_name(join->alias) ? push_range(context, NULL, alias_name(join->alias), depth) : 0;
+    }
+    default:
+      return 0;
+  }
+}
+
+static int push_from_clause(RewriteContext *context, PgQuery__Node **items, size_t n_items, int32_t depth) {
+  for (size_t i = 0; i < n_items; i++) {
+    if (push_from_item(context, items[i], depth) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static int push_target(RewriteContext *context, PgQuery__RangeVar *relation, int32_t depth) {
+  return relation ? push_range(context, relation, alias_name(relation->alias), depth) : 0;
+}
+
+// Records the relations a query brings into scope for `table.column`
+// references, before the walk descends into (and renames) them.
+static int enter_ranges(RewriteContext *context, ProtobufCMessage *message, int32_t depth) {
+  while (context->n_ranges > 0 && context->ranges[context->n_ranges - 1].depth >= depth) {
+    context->n_ranges--;
+  }
+
+  if (pg_is_message(message, &pg_query__select_stmt__descriptor)) {
+    PgQuery__SelectStmt *select = (PgQuery__SelectStmt *)message;
+    return push_from_clause(context, select->from_clause, select->n_from_clause, depth);
+  }
+  if (pg_is_message(message, &pg_query__insert_stmt__descriptor)) {
+    return push_target(context, ((PgQuery__InsertStmt *)message)->relation, depth);
+  }
+  if (pg_is_message(message, &pg_query__update_stmt__descriptor)) {
+    PgQuery__UpdateStmt *update = (PgQuery__UpdateStmt *)message;
+    if (push_target(context, update->relation, depth) != 0) {
+      return -1;
+    }
+    return push_from_clause(context, update->from_clause, update->n_from_clause, depth);
+  }
+  if (pg_is_message(message, &pg_query__delete_stmt__descriptor)) {
+    PgQuery__DeleteStmt *delete_stmt = (PgQuery__DeleteStmt *)message;
+    if (push_target(context, delete_stmt->relation, depth) != 0) {
+      return -1;
+    }
+    return push_from_clause(context, delete_stmt->using_clause, delete_stmt->n_using_clause, depth);
+  }
+  if (pg_is_message(message, &pg_query__merge_stmt__descriptor)) {
+    PgQuery__MergeStmt *merge = (PgQuery__MergeStmt *)message;
+    if (push_target(context, merge->relation, depth) != 0) {
+      return -1;
+    }
+    return push_from_item(context, merge->source_relation, depth);
+  }
+  return 0;
+}
+
+// Whether a `[schema.]table.column` reference resolves to the relation
+// renameRelation renames: the innermost FROM item it names is that
+// relation, referenced by its name rather than an alias.
+static int references_renamed(RewriteContext *context, const char *schema, const char *name) {
+  for (size_t i = context->n_ranges; i-- > 0;) {
+    const RangeEntry *entry = &context->ranges[i];
+
+    if (entry->alias) {
+      if (!schema && strcmp(entry->alias, name) == 0) {
+        return 0;
+      }
+      continue;
+    }
+
+    PgQuery__RangeVar *relation = entry->relation;
+    if (!relation) {
+      continue;
+    }
+
+    // A renamed relation may already carry its new name
+    const char *relname = entry->renamed ? context->op->from.name : relation->relname;
+    if (strcmp(relname, name) != 0) {
+      continue;
+    }
+    if (schema && relation->schemaname && *relation->schemaname && strcmp(schema, relation->schemaname) != 0) {
+      continue;
+    }
+    return entry->renamed;
+  }
+  return 0;
+}
+
+// Tracks which CTEs are visible at `message`. The walk is pre-order, so a
+// scope ends at the first message that is no deeper than its owner.
+static int enter_message(RewriteContext *context, ProtobufCMessage *message, int32_t depth) {
+  while (context->n_scopes > 0 && context->scopes[context->n_scopes - 1].depth >= depth) {
+    context->n_scopes--;
+  }
+
+  if (pg_is_message(message, &pg_query__common_table_expr__descriptor) && context->n_scopes > 0) {
+    PgQuery__WithClause *with = context->scopes[context->n_scopes - 1].with;
+
+    for (size_t i = 0; i < with->n_ctes; i++) {
+      if (with->ctes[i]->node_case == PG_QUERY__NODE__NODE_COMMON_TABLE_EXPR &&
+          (ProtobufCMessage *)with->ctes[i]->common_table_expr == message) {
+        return push_scope(context, with, with->recursive ? with->n_ctes : i, depth);
+      }
+    }
+    return 0;
+  }
+
+  if (pg_is_message(message, &pg_query__insert_stmt__descriptor)) {
+    context->target = ((PgQuery__InsertStmt *)message)->relation;
+  } else if (pg_is_message(message, &pg_query__update_stmt__descriptor)) {
+    context->target = ((PgQuery__UpdateStmt *)message)->relation;
+  } else if (pg_is_message(message, &pg_query__delete_stmt__descriptor)) {
+    context->target = ((PgQuery__DeleteStmt *)message)->relation;
+  } else if (pg_is_message(message, &pg_query__merge_stmt__descriptor)) {
+    context->target = ((PgQuery__MergeStmt *)message)->relation;
+  }
+
+  PgQuery__WithClause *with = with_clause_of(message);
+  if (with && push_scope(context, with, with->n_ctes, depth) != 0) {
+    return -1;
+  }
+  return context->op->kind == PG_REWRITE_RENAME_RELATION ? enter_ranges(context, message, depth) : 0;
+}
+
+// Node constructors for injected predicates. Everything is allocated with
+// malloc, like protobuf-c's default allocator, so the tree can still be
+// released with free_unpacked.
+
+static PgQuery__Node *new_node(PgQuery__Node__NodeCase node_case, void *message) {
+  PgQuery__Node *node = (PgQuery__Node *)malloc(sizeof(PgQuery__Node));
+  if (!node) {
+    return NULL;
+  }
+  pg_query__node__init(node);
+  node->node_case = node_case;
+  // Every member of the oneof is a message pointer
+  node->string = (PgQuery__String *)message;
+  return node;
+}
+
+static PgQuery__Node *make_string(const char *value) {
+  PgQuery__String *string = (PgQuery__String *)malloc(sizeof(PgQuery__String));
+  if (!string) {
+    return NULL;
+  }
+  pg_query__string__init(string);
+  string->sval = strdup(value);
+
+  PgQuery__Node *node = string->sval ? new_node(PG_QUERY__NODE__NODE_STRING, string) : NULL;
+  if (!node) {
+    free(string->sval);
+    free(string);
+  }
+  return node;
+}
+
+static int append_node(PgQuery__Node ***items, size_t *n_items, PgQuery__Node *node) {
+  if (!node) {
+    return -1;
+  }
+  PgQuery__Node **grown = (PgQuery__Node **)realloc(*items, (*n_items + 1) * sizeof(PgQuery__Node *));
+  if (!grown) {
+    pg_query__node__free_unpacked(node, NULL);
+    return -1;
+  }
+  grown[(*n_items)++] = node;
+  *items = grown;
+  return 0;
+}
+
+// Builds `qualifier.column = $param`.
+static PgQuery__Node *make_predicate(const char *qualifier, const char *column, int32_t param) {
+  PgQuery__AExpr *expr = (PgQuery__AExpr *)malloc(sizeof(PgQuery__AExpr));
+  if (!expr) {
+    return NULL;
+  }
+  pg_query__a__expr__init(expr);
+  expr->kind = PG_QUERY__A__EXPR__KIND__AEXPR_OP;
+  expr->location = -1;
+
+  // Owned by `node` from here, so one free_unpacked releases everything
+  PgQuery__Node *node = new_node(PG_QUERY__NODE__NODE_A_EXPR, expr);
+  if (!node) {
+    free(expr);
+    return NULL;
+  }
+
+  PgQuery__ColumnRef *column_ref = (PgQuery__ColumnRef *)malloc(sizeof(PgQuery__ColumnRef));
+  PgQuery__ParamRef *param_ref = (PgQuery__ParamRef *)malloc(sizeof(PgQuery__ParamRef));
+  if (column_ref) {
+    pg_query__column_ref__init(column_ref);
+    column_ref->location = -1;
+    expr->lexpr = new_node(PG_QUERY__NODE__NODE_COLUMN_REF, column_ref);
+    if (!expr->lexpr) {
+      free(column_ref);
+    }
+  }
+  if (param_ref) {
+    pg_query__param_ref__init(param_ref);
+    param_ref->number = param;
+    param_ref->location = -1;
+    expr->rexpr = new_node(PG_QUERY__NODE__NODE_PARAM_REF, param_ref);
+    if (!expr->rexpr) {
+      free(param_ref);
+    }
+  }
+
+  if (!expr->lexpr || !expr->rexpr || append_node(&expr->name, &expr->n_name, make_string("=")) != 0 ||
+      append_node(&column_ref->fields, &column_ref->n_fields, make_string(qualifier)) != 0 ||
+      append_node(&column_ref->fields, &column_ref->n_fields, make_string(column)) != 0) {
+    pg_query__node__free_unpacked(node, NULL);
+    return NULL;
+  }
+
+  return node;
+}
+
+// ANDs `predicate` into `*where`, flattening into an existing AND.
+static int and_into(PgQuery__Node **where, PgQuery__Node *predicate) {
+  if (!predicate) {
+    return -1;
+  }
+
+  if (!*where) {
+    *where = predicate;
+    return 0;
+  }
+
+  if ((*where)->node_case == PG_QUERY__NODE__NODE_BOOL_EXPR &&
+      (*where)->bool_expr->boolop == PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR) {
+    return append_node(&(*where)->bool_expr->args, &(*where)->bool_expr->n_args, predicate);
+  }
+
+  PgQuery__BoolExpr *bool_expr = (PgQuery__BoolExpr *)malloc(sizeof(PgQuery__BoolExpr));
+  PgQuery__Node *node = bool_expr ? new_node(PG_QUERY__NODE__NODE_BOOL_EXPR, bool_expr) : NULL;
+  if (!node) {
+    free(bool_expr);
+    pg_query__node__free_unpacked(predicate, NULL);
+    return -1;
+  }
+  pg_query__bool_expr__init(bool_expr);
+  bool_expr->boolop = PG_QUERY__BOOL_EXPR_TYPE__AND_EXPR;
+  bool_expr->location = -1;
+
+  if (append_node(&bool_expr->args, &bool_expr->n_args, *where) != 0) {
+    pg_query__node__free_unpacked(node, NULL);
+    pg_query__node__free_unpacked(predicate, NULL);
+    return -1;
+  }
+  *where = node;
+  return append_node(&bool_expr->args, &bool_expr->n_args, predicate);
+}
+
+static int predicate_applies(const PgRewriteOp *op, PgQuery__RangeVar *relation) {
+  if (!op->relations) {
+    return 1;
+  }
+  for (size_t i = 0; i < op->n_relations; i++) {
+    if (relation_matches(&op->relations[i], relation)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int is_target(RewriteContext *context, PgQuery__RangeVar *relation) {
+  return relation && !is_cte(context, relation) && predicate_applies(context->op, relation);
+}
+
+// Whether any relation in a FROM item would get a predicate.
+static int has_target(RewriteContext *context, PgQuery__Node *item) {
+  if (!item) {
+    return 0;
+  }
+  if (item->node_case == PG_QUERY__NODE__NODE_RANGE_VAR) {
+    return is_target(context, item->range_var);
+  }
+  if (item->node_case == PG_QUERY__NODE__NODE_JOIN_EXPR) {
+    return has_target(context, item->join_expr->larg) || has_target(context, item->join_expr->rarg);
+  }
+  return 0;
+}
+
+static void inject_relation(RewriteContext *context, PgQuery__RangeVar *relation, PgQuery__Node **where) {
+  const PgRewriteOp *op = context->op;
+
+  if (!is_target(context, relation)) {
+    return;
+  }
+
+  const char *qualifier = relation->alias && relation->alias->aliasname && *relation->alias->aliasname
+                              ? relation->alias->aliasname
+                              : relation->relname;
+
+  if (and_into(where, make_predicate(qualifier, op->column, op->param)) != 0) {
+    context->error = "out of memory rewriting query";
+  }
+}
+
+// Adds predicates for the relations of a FROM item. Relations on the
+// nullable side of an outer join are filtered in the join condition, so
+// the join keeps its outer semantics; everything else goes to `where`.
+static void inject_from_item(RewriteContext *context, PgQuery__Node *item, PgQuery__Node **where) {
+  if (!item || context->error) {
+    return;
+  }
+
+  if (item->node_case == PG_QUERY__NODE__NODE_RANGE_VAR) {
+    inject_relation(context, item->range_var, where);
+    return;
+  }
+
+  if (item->node_case != PG_QUERY__NODE__NODE_JOIN_EXPR) {
+    // Subqueries and functions in FROM; subqueries get their own visit
+    return;
+  }
+
+  PgQuery__JoinExpr *join = item->join_expr;
+  int left_nullable = join->jointype == PG_QUERY__JOIN_TYPE__JOIN_RIGHT || join->jointype == PG_QUERY__JOIN_TYPE__JOIN_FULL;
+  int right_nullable = join->jointype == PG_QUERY__JOIN_TYPE__JOIN_LEFT || join->jointype == PG_QUERY__JOIN_TYPE__JOIN_FULL;
+
+  // USING and NATURAL joins have no condition to add to
+  if ((join->n_using_clause > 0 || join->is_natural) &&
+      ((left_nullable && has_target(context, join->larg)) || (right_nullable && has_target(context, join->rarg)))) {
+    context->error = "cannot inject a predicate into the nullable side of an outer join with USING or NATURAL";
+    return;
+  }
+
+  inject_from_item(context, join->larg, left_nullable ? &join->quals : where);
+  inject_from_item(context, join->rarg, right_nullable ? &join->quals : where);
+}
+
+static void inject_from_clause(RewriteContext *context, PgQuery__Node **items, size_t n_items, PgQuery__Node **where) {
+  for (size_t i = 0; i < n_items; i++) {
+    inject_from_item(context, items[i], where);
+  }
+}
+
+static void rename_targets(RewriteContext *context, PgQuery__Node **targets, size_t n_targets) {
+  for (size_t i = 0; i < n_targets && !context->error; i++) {
+    if (targets[i]->node_case != PG_QUERY__NODE__NODE_RES_TARGET) {
+      continue;
+    }
+    PgQuery__ResTarget *target = targets[i]->res_target;
+    if (target->name && strcmp(target->name, context->op->from_column) == 0 &&
+        set_string(&target->name, context->op->to) != 0) {
+      context->error = "out of memory rewriting query";
+    }
+  }
+}
+
+static PgWalkAction apply_op(ProtobufCMessage *message, int32_t depth, void *data) {
+  RewriteContext *context = (RewriteContext *)data;
+  const PgRewriteOp *op = context->op;
+
+  if (enter_message(context, message, depth) != 0) {
+    context->error = "out of memory rewriting query";
+    return PG_WALK_STOP;
+  }
+
+  switch (op->kind) {
+    case PG_REWRITE_QUALIFY_SCHEMA:
+      if (pg_is_message(message, &pg_query__range_var__descriptor)) {
+        PgQuery__RangeVar *relation = (PgQuery__RangeVar *)message;
+        // Temporary relations live in their own schema
+        if ((!relation->schemaname || !*relation->schemaname) && strcmp(relation->relpersistence, "t") != 0 &&
+            !is_cte(context, relation) &&
+            set_string(&relation->schemaname, op->schema) != 0) {
+          context->error = "out of memory rewriting query";
+        }
+      }
+      break;
+
+    case PG_REWRITE_RENAME_RELATION:
+      if (pg_is_message(message, &pg_query__range_var__descriptor)) {
+        PgQuery__RangeVar *relation = (PgQuery__RangeVar *)message;
+        if (!is_cte(context, relation) && relation_matches(&op->from, relation) &&
+            set_string(&relation->relname, op->to) != 0) {
+          context->error = "out of memory rewriting query";
+        }
+      } else if (pg_is_message(message, &pg_query__column_ref__descriptor)) {
+        // `[schema.]table.column` references follow the table they resolve
+        // to, not CTEs or aliases that share its name
+        PgQuery__ColumnRef *column_ref = (PgQuery__ColumnRef *)message;
+        if (column_ref->n_fields >= 2) {
+          PgQuery__Node *table = column_ref->fields[column_ref->n_fields - 2];
+          const char *name = pg_string_value(table);
+          const char *schema = column_ref->n_fields >= 3 ? pg_string_value(column_ref->fields[column_ref->n_fields - 3]) : NULL;
+
+          if (name && references_renamed(context, schema, name) &&
+              set_string(&table->string->sval, op->to) != 0) {
+            context->error = "out of memory rewriting query";
+          }
+        }
+      }
+      break;
+
+    case PG_REWRITE_RENAME_COLUMN:
+      if (pg_is_message(message, &pg_query__column_ref__descriptor)) {
+        PgQuery__ColumnRef *column_ref = (PgQuery__ColumnRef *)message;
+        PgQuery__Node *column = column_ref->n_fields > 0 ? column_ref->fields[column_ref->n_fields - 1] : NULL;
+        const char *name = pg_string_value(column);
+
+        if (name && strcmp(name, op->from_column) == 0 && set_string(&column->string->sval, op->to) != 0) {
+          context->error = "out of memory rewriting query";
+        }
+      } else if (pg_is_message(message, &pg_query__insert_stmt__descriptor)) {
+        PgQuery__InsertStmt *insert = (PgQuery__InsertStmt *)message;
+        rename_targets(context, insert->cols, insert->n_cols);
+      } else if (pg_is_message(message, &pg_query__update_stmt__descriptor)) {
+        PgQuery__UpdateStmt *update = (PgQuery__UpdateStmt *)message;
+        rename_targets(context, update->target_list, update->n_target_list);
+      } else if (pg_is_message(message, &pg_query__on_conflict_clause__descriptor)) {
+        PgQuery__OnConflictClause *on_conflict = (PgQuery__OnConflictClause *)message;
+        rename_targets(context, on_conflict->target_list, on_conflict->n_target_list);
+      } else if (pg_is_message(message, &pg_query__index_elem__descriptor)) {
+        PgQuery__IndexElem *elem = (PgQuery__IndexElem *)message;
+        if (elem->name && strcmp(elem->name, op->from_column) == 0 && set_string(&elem->name, op->to) != 0) {
+          context->error = "out of memory rewriting query";
+        }
+      }
+      break;
+
+    case PG_REWRITE_INJECT_PREDICATE:
+      if (pg_is_message(message, &pg_query__select_stmt__descriptor)) {
+        PgQuery__SelectStmt *select = (PgQuery__SelectStmt *)message;
+        inject_from_clause(context, select->from_clause, select->n_from_clause, &select->where_clause);
+      } else if (pg_is_message(message, &pg_query__update_stmt__descriptor)) {
+        PgQuery__UpdateStmt *update = (PgQuery__UpdateStmt *)message;
+        inject_relation(context, update->relation, &update->where_clause);
+        inject_from_clause(context, update->from_clause, update->n_from_clause, &update->where_clause);
+      } else if (pg_is_message(message, &pg_query__delete_stmt__descriptor)) {
+        PgQuery__DeleteStmt *delete_stmt = (PgQuery__DeleteStmt *)message;
+        inject_relation(context, delete_stmt->relation, &delete_stmt->where_clause);
+        inject_from_clause(context, delete_stmt->using_clause, delete_stmt->n_using_clause, &delete_stmt->where_clause);
+      } else if (pg_is_message(message, &pg_query__merge_stmt__descriptor)) {
+        // Neither side of a MERGE has a WHERE clause to filter
+        PgQuery__MergeStmt *merge = (PgQuery__MergeStmt *)message;
+        if (is_target(context, merge->relation) || has_target(context, merge->source_relation)) {
+          context->error = "cannot inject a predicate into MERGE";
+        }
+      } else if (pg_is_message(message, &pg_query__copy_stmt__descriptor)) {
+        // `COPY (query)` is a SELECT like any other; `COPY table` is not
+        PgQuery__CopyStmt *copy = (PgQuery__CopyStmt *)message;
+        if (is_target(context, copy->relation)) {
+          context->error = "cannot inject a predicate into COPY of a table";
+        }
+      }
+      break;
+  }
+
+  return context->error ? PG_WALK_STOP : PG_WALK_CONTINUE;
+}
+
+static void rewrite_query(const char *sql, const PgRewriteOps *ops, PgRewriteQuery *query) {
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    query->error = parsed.error;
+    return;
+  }
+
+  PgQuery__ParseResult *tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!tree) {
+    query->error = pg_make_error("failed to unpack parse tree");
+    return;
+  }
+
+  query->parsed = 1;
+
+  RewriteContext context = {NULL, NULL, 0, 0, NULL, 0, 0, NULL, NULL};
+
+  for (size_t i = 0; i < tree->n_stmts && !context.error; i++) {
+    ProtobufCMessage *stmt = (ProtobufCMessage *)tree->stmts[i]->stmt;
+
+    for (size_t j = 0; j < ops->n_ops && !context.error; j++) {
+      context.op = &ops->ops[j];
+      context.n_scopes = 0;
+      context.n_ranges = 0;
+      context.target = NULL;
+      if (pg_walk(stmt, apply_op, &context) != 0 && !context.error) {
+        context.error = "out of memory rewriting query";
+      }
+    }
+  }
+
+  free(context.scopes);
+  free(context.ranges);
+
+  if (context.error) {
+    pg_query__parse_result__free_unpacked(tree, NULL);
+    query->error = pg_make_error(context.error);
+    return;
+  }
+
+  PgQueryProtobuf protobuf;
+  protobuf.len = pg_query__parse_result__get_packed_size(tree);
+  protobuf.data = (char *)malloc(protobuf.len ? protobuf.len : 1);
+
+  if (!protobuf.data) {
+    pg_query__parse_result__free_unpacked(tree, NULL);
+    query->error = pg_make_error("out of memory rewriting query");
+    return;
+  }
+
+  pg_query__parse_result__pack(tree, (uint8_t *)protobuf.data);
+  pg_query__parse_result__free_unpacked(tree, NULL);
+
+  PgQueryDeparseResult deparsed = pg_query_deparse_protobuf(protobuf);
+  free(protobuf.data);
+
+  if (deparsed.error) {
+    query->error = deparsed.error;
+    deparsed.error = NULL;
+  } else {
+    query->sql = deparsed.query;
+    deparsed.query = NULL;
+  }
+  pg_query_free_deparse_result(deparsed);
+}
+
+// `sql` holds `count` null-terminated queries back to back, like
+// extract_constants. `operations` is a JSON array of operations.
+EXPORT("rewrite_sql")
+PgRewriteResult *rewrite_sql(char *sql, int32_t count, char *operations) {
+  PgRewriteResult *result = (PgRewriteResult *)calloc(1, sizeof(PgRewriteResult));
+
+  json_t *json = json_loads(operations, 0, NULL);
+  PgRewriteOps ops = {NULL, 0, NULL};
+  const char *error = json ? compile_ops(json, &ops) : "rewrite operations are not valid JSON";
+
+  if (error) {
+    result->error = pg_make_error(error);
+  } else {
+    result->n_queries = count;
+    result->queries = (PgRewriteQuery *)calloc(count > 0 ? count : 1, sizeof(PgRewriteQuery));
+
+    for (int32_t i = 0; i < count; i++) {
+      rewrite_query(sql, &ops, &result->queries[i]);
+      sql += strlen(sql) + 1;
+    }
+  }
+
+  free_ops(&ops);
+  json_decref(json);
+  return result;
+}
+
+EXPORT("free_rewrite_result")
+void free_rewrite_result(PgRewriteResult *result) {
+  for (int32_t i = 0; i < result->n_queries; i++) {
+    PgRewriteQuery *query = &result->queries[i];
+
+    free(query->sql);
+    if (query->error) {
+      pg_query_free_error(query->error);
+    }
+  }
+
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result->queries);
+  free(result);
+}
@@ -0,0 +1,317 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "macros.h"
+#include "pg_query.h"
+#include "protobuf-json.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// Checks that a query survives parse -> deparse -> reparse unchanged, all
+// in one call: neither tree nor the deparsed SQL cross into JS unless the
+// check fails.
+//
+// The two trees are compared field by field through their protobuf
+// descriptors, ignoring source locations (which move whenever the
+// deparser formats differently). The first difference is reported as a
+// path in the JSON tree, e.g. `stmts[0].stmt.SelectStmt.limitCount`.
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12, 16).
+typedef struct {
+  int32_t equal;
+  char *path;           // first differing path, "" if the deparsed SQL didn't parse
+  char *sql;            // deparsed SQL, set when !equal
+  PgQueryError *error;
+  int32_t parsed;       // whether `error` happened after parsing (deparse)
+} PgRoundTripResult;
+
+typedef struct {
+  const char *name;
+  int32_t index;  // -1 unless the segment is a list item
+} PathSegment;
+
+typedef struct {
+  PathSegment *segments;
+  int32_t length;
+  int32_t capacity;
+  int failed;
+} Path;
+
+static int push_segment(Path *path, const char *name, int32_t index) {
+  if (path->length == path->capacity) {
+    int32_t capacity = path->capacity ? path->capacity * 2 : 64;
+    PathSegment *segments = (PathSegment *)realloc(path->segments, capacity * sizeof(PathSegment));
+    if (!segments) {
+      path->failed = 1;
+      return -1;
+    }
+    path->segments = segments;
+    path->capacity = capacity;
+  }
+
+  path->segments[path->length].name = name;
+  path->segments[path->length].index = index;
+  path->length++;
+  return 0;
+}
+
+// Renders the path the way it reads in the JSON tree.
+static char *format_path(const Path *path) {
+  char *data = NULL;
+  size_t size = 0;
+  FILE *out = open_memstream(&data, &size);
+
+  if (!out) {
+    return NULL;
+  }
+
+  for (int32_t i = 0; i < path->length; i++) {
+    const PathSegment *segment = &path->segments[i];
+    if (segment->index >= 0) {
+      fprintf(out, "[%d]", segment->index);
+    } else {
+      fprintf(out, i > 0 ? ".%s" : "%s", segment->name);
+    }
+  }
+
+  fclose(out);
+  return data;
+}
+
+// JSON key of a field, as protobuf2json writes it
+static const char *json_name(const ProtobufCFieldDescriptor *field) {
+  return field->reserved2 ? (const char *)field->reserved2 : field->name;
+}
+
+static int is_location(const ProtobufCFieldDescriptor *field) {
+  size_t length = strlen(field->name);
+
+  return strcmp(field->name, "location") == 0 ||
+         strcmp(field->name, "stmt_len") == 0 ||
+         (length > 9 && strcmp(field->name + length - 9, "_location") == 0);
+}
+
+static size_t value_size(ProtobufCType type) {
+  switch (type) {
+    case PROTOBUF_C_TYPE_INT64:
+    case PROTOBUF_C_TYPE_SINT64:
+    case PROTOBUF_C_TYPE_SFIXED64:
+    case PROTOBUF_C_TYPE_UINT64:
+    case PROTOBUF_C_TYPE_FIXED64:
+      return sizeof(uint64_t);
+    case PROTOBUF_C_TYPE_DOUBLE:
+      return sizeof(double);
+    case PROTOBUF_C_TYPE_FLOAT:
+      return sizeof(float);
+    case PROTOBUF_C_TYPE_BOOL:
+      return sizeof(protobuf_c_boolean);
+    case PROTOBUF_C_TYPE_ENUM:
+      return sizeof(int);
+    case PROTOBUF_C_TYPE_STRING:
+      return sizeof(char *);
+    case PROTOBUF_C_TYPE_BYTES:
+      return sizeof(ProtobufCBinaryData);
+    case PROTOBUF_C_TYPE_MESSAGE:
+      return sizeof(ProtobufCMessage *);
+    default:
+      return sizeof(uint32_t);
+  }
+}
+
+static int messages_equal(const ProtobufCMessage *a, const ProtobufCMessage *b, Path *path);
+
+// Compares one value of `field`. Returns 1 if equal, 0 if not, leaving
+// `path` at the difference.
+static int values_equal(const ProtobufCFieldDescriptor *field, const void *a, const void *b, Path *path) {
+  switch (field->type) {
+    case PROTOBUF_C_TYPE_STRING: {
+      // Unset proto3 strings may unpack as NULL or ""
+      const char *string_a = *(char *const *)a;
+      const char *string_b = *(char *const *)b;
+      return strcmp(string_a ? string_a : "", string_b ? string_b : "") == 0;
+    }
+    case PROTOBUF_C_TYPE_BYTES: {
+      const ProtobufCBinaryData *bytes_a = (const ProtobufCBinaryData *)a;
+      const ProtobufCBinaryData *bytes_b = (const ProtobufCBinaryData *)b;
+      return bytes_a->len == bytes_b->len && (bytes_a->len == 0 || memcmp(bytes_a->data, bytes_b->data, bytes_a->len) == 0);
+    }
+    case PROTOBUF_C_TYPE_MESSAGE: {
+      const ProtobufCMessage *message_a = *(ProtobufCMessage *const *)a;
+      const ProtobufCMessage *message_b = *(ProtobufCMessage *const *)b;
+      if (!message_a || !message_b) {
+        return message_a == message_b;
+      }
+      return messages_equal(message_a, message_b, path);
+    }
+    default:
+      return memcmp(a, b, value_size(field->type)) == 0;
+  }
+}
+
+static int messages_equal(const ProtobufCMessage *a, const ProtobufCMessage *b, Path *path) {
+  const ProtobufCMessageDescriptor *descriptor = a->descriptor;
+  const char *base_a = (const char *)a;
+  const char *base_b = (const char *)b;
+
+  if (b->descriptor != descriptor) {
+    return 0;
+  }
+
+  for (unsigned i = 0; i < descriptor->n_fields; i++) {
+    const ProtobufCFieldDescriptor *field = &descriptor->fields[i];
+
+    if (field->flags & PROTOBUF_C_FIELD_FLAG_ONEOF) {
+      uint32_t case_a = *(const uint32_t *)(base_a + field->quantifier_offset);
+      uint32_t case_b = *(const uint32_t *)(base_b + field->quantifier_offset);
+
+      // A different member is set, e.g. a SelectStmt became an InsertStmt
+      if (case_a != case_b) {
+        return 0;
+      }
+      if (case_a != field->id) {
+        continue;
+      }
+    }
+
+    if (is_location(field)) {
+      continue;
+    }
+
+    if (push_segment(path, json_name(field), -1) != 0) {
+      return 0;
+    }
+
+    if (field->label == PROTOBUF_C_LABEL_REPEATED) {
+      size_t count = *(const size_t *)(base_a + field->quantifier_offset);
+
+      if (count != *(const size_t *)(base_b + field->quantifier_offset)) {
+        return 0;
+      }
+
+      const char *items_a = *(char *const *)(base_a + field->offset);
+      const char *items_b = *(char *const *)(base_b + field->offset);
+      size_t size = value_size(field->type);
+
+      for (size_t j = 0; j < count; j++) {
+        if (push_segment(path, NULL, (int32_t)j) != 0 ||
+            !values_equal(field, items_a + j * size, items_b + j * size, path)) {
+          return 0;
+        }
+        path->length--;
+      }
+    } else if (!values_equal(field, base_a + field->offset, base_b + field->offset, path)) {
+      return 0;
+    }
+
+    path->length--;
+  }
+
+  return 1;
+}
+
+// Compares the two packed trees, setting `result->path` on a difference.
+static void compare_trees(PgQueryProtobuf original, PgQueryProtobuf reparsed, PgRoundTripResult *result) {
+  PgQuery__ParseResult *tree_a = pg_query__parse_result__unpack(NULL, original.len, (const uint8_t *)original.data);
+  PgQuery__ParseResult *tree_b = pg_query__parse_result__unpack(NULL, reparsed.len, (const uint8_t *)reparsed.data);
+
+  if (!tree_a || !tree_b) {
+    result->error = pg_make_error("failed to unpack parse tree");
+    result->parsed = 1;
+  } else {
+    Path path = {NULL, 0, 0, 0};
+    result->equal = messages_equal(&tree_a->base, &tree_b->base, &path);
+
+    if (path.failed) {
+      result->error = pg_make_error("out of memory comparing parse trees");
+      result->parsed = 1;
+    } else if (!result->equal) {
+      result->path = format_path(&path);
+    }
+    free(path.segments);
+  }
+
+  if (tree_a) {
+    pg_query__parse_result__free_unpacked(tree_a, NULL);
+  }
+  if (tree_b) {
+    pg_query__parse_result__free_unpacked(tree_b, NULL);
+  }
+}
+
+// `input` is SQL, or a JSON parse tree if `is_tree` is set.
+EXPORT("verify_round_trip")
+PgRoundTripResult *verify_round_trip(char *input, int32_t is_tree) {
+  PgRoundTripResult *result = (PgRoundTripResult *)calloc(1, sizeof(PgRoundTripResult));
+  PgQueryProtobuf original;
+
+  if (is_tree) {
+    JsonToProtobufResult *protobuf_result = json_to_protobuf(input);
+
+    if (protobuf_result->error) {
+      result->error = (PgQueryError *)calloc(1, sizeof(PgQueryError));
+      result->error->message = protobuf_result->error; // Transfer ownership of string
+      result->parsed = 1;
+      free(protobuf_result);
+      return result;
+    }
+
+    original = protobuf_result->protobuf;
+    free(protobuf_result);
+  } else {
+    PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(input);
+    free(parsed.stderr_buffer);
+
+    if (parsed.error) {
+      free(parsed.parse_tree.data);
+      result->error = parsed.error;
+      return result;
+    }
+
+    original = parsed.parse_tree;
+  }
+
+  result->parsed = 1;
+
+  PgQueryDeparseResult deparsed = pg_query_deparse_protobuf(original);
+
+  if (deparsed.error) {
+    result->error = deparsed.error;
+    deparsed.error = NULL;
+    pg_query_free_deparse_result(deparsed);
+    free(original.data);
+    return result;
+  }
+
+  PgQueryProtobufParseResult reparsed = pg_query_parse_protobuf(deparsed.query);
+  free(reparsed.stderr_buffer);
+
+  if (reparsed.error) {
+    // The deparser wrote SQL it can't read back: fails at the root
+    pg_query_free_error(reparsed.error);
+    result->path = strdup("");
+  } else {
+    compare_trees(original, reparsed.parse_tree, result);
+  }
+
+  if (!result->equal && !result->error) {
+    result->sql = deparsed.query;
+    deparsed.query = NULL;
+  }
+
+  free(reparsed.parse_tree.data);
+  pg_query_free_deparse_result(deparsed);
+  free(original.data);
+  return result;
+}
+
+EXPORT("free_round_trip_result")
+void free_round_trip_result(PgRoundTripResult *result) {
+  free(result->path);
+  free(result->sql);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
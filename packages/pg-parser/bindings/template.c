@@ -0,0 +1,481 @@
+#include <ctype.h>
+#include <errno.h>
+#include <jansson.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+#include "macros.h"
+#include "node-walker.h"
+#include "pg_query.h"
+#include "protobuf/pg_query.pb-c.h"
+
+// SQL templates: a statement is parsed once into an unpacked protobuf
+// tree that stays in WASM memory, and every render swaps the bound values
+// into the tree, packs it and deparses it. Nothing is reparsed and no
+// tree crosses into JS.
+//
+// Placeholders are plain SQL, so templates parse as is:
+// - `$n` parameters take values, which are rendered as literals.
+//   Parameters without a value stay parameters.
+// - Quoted identifiers of the form `"{name}"` take identifiers, anywhere
+//   an identifier can go (relations, columns, aliases, functions, ...).
+//
+// Renders swap pointers in the tree and restore them before returning,
+// so the template is never modified.
+
+typedef struct {
+  char **field;    // string field in the tree holding the placeholder
+  char *original;  // its original value, `{name}`
+  char *name;
+} IdentifierSlot;
+
+typedef struct {
+  PgQuery__Node *node;  // Node wrapper whose ParamRef is swapped for an A_Const
+  PgQuery__ParamRef *param_ref;
+} ValueSlot;
+
+typedef struct {
+  PgQuery__ParseResult *tree;
+  IdentifierSlot *identifiers;
+  int32_t n_identifiers;
+  int32_t identifiers_capacity;
+  ValueSlot *values;
+  int32_t n_values;
+  int32_t values_capacity;
+  int32_t n_params;  // highest $n
+  int failed;
+} PgTemplate;
+
+// Field order is ABI: JS reads these by byte offset (0, 4, 8, 12, 16).
+typedef struct {
+  PgTemplate *template;
+  char *identifiers;  // distinct placeholder names, null-terminated back to back
+  int32_t n_identifiers;
+  int32_t n_params;
+  PgQueryError *error;
+} PgTemplateResult;
+
+// Field order is ABI: JS reads these by byte offset (0, 4).
+typedef struct {
+  char *sql;
+  PgQueryError *error;
+} PgRenderResult;
+
+// A literal swapped in for a ParamRef while rendering
+typedef struct {
+  PgQuery__AConst a_const;
+  PgQuery__Integer ival;
+  PgQuery__Float fval;
+  PgQuery__Boolean boolval;
+  PgQuery__String sval;
+} ConstValue;
+
+// Returns the name in a `{name}` placeholder, or NULL.
+static char *placeholder_name(const char *value) {
+  size_t length = value ? strlen(value) : 0;
+
+  if (length < 3 || value[0] != '{' || value[length - 1] != '}' ||
+      memchr(value + 1, '{', length - 2) || memchr(value + 1, '}', length - 2)) {
+    return NULL;
+  }
+
+  char *name = (char *)malloc(length - 1);
+  if (name) {
+    memcpy(name, value + 1, length - 2);
+    name[length - 2] = '\0';
+  }
+  return name;
+}
+
+static void add_identifier(PgTemplate *template, char **field) {
+  char *name = placeholder_name(*field);
+
+  if (!name) {
+    return;
+  }
+
+  if (template->n_identifiers == template->identifiers_capacity) {
+    int32_t capacity = template->identifiers_capacity ? template->identifiers_capacity * 2 : 8;
+    IdentifierSlot *identifiers = (IdentifierSlot *)realloc(template->identifiers, capacity * sizeof(IdentifierSlot));
+    if (!identifiers) {
+      free(name);
+      template->failed = 1;
+      return;
+    }
+    template->identifiers = identifiers;
+    template->identifiers_capacity = capacity;
+  }
+
+  IdentifierSlot *slot = &template->identifiers[template->n_identifiers++];
+  slot->field = field;
+  slot->original = *field;
+  slot->name = name;
+}
+
+static void add_value(PgTemplate *template, PgQuery__Node *node) {
+  if (!node || node->node_case != PG_QUERY__NODE__NODE_PARAM_REF) {
+    return;
+  }
+
+  if (template->n_values == template->values_capacity) {
+    int32_t capacity = template->values_capacity ? template->values_capacity * 2 : 8;
+    ValueSlot *values = (ValueSlot *)realloc(template->values, capacity * sizeof(ValueSlot));
+    if (!values) {
+      template->failed = 1;
+      return;
+    }
+    template->values = values;
+    template->values_capacity = capacity;
+  }
+
+  ValueSlot *slot = &template->values[template->n_values++];
+  slot->node = node;
+  slot->param_ref = node->param_ref;
+
+  if (node->param_ref->number > template->n_params) {
+    template->n_params = node->param_ref->number;
+  }
+}
+
+// Records the placeholders among `message`'s own fields.
+static PgWalkAction collect_slots(ProtobufCMessage *message, int32_t depth, void *data) {
+  PgTemplate *template = (PgTemplate *)data;
+  const ProtobufCMessageDescriptor *descriptor = message->descriptor;
+  char *base = (char *)message;
+  (void)depth;
+
+  // String literals are values, not identifiers
+  if (pg_is_message(message, &pg_query__a__const__descriptor)) {
+    return PG_WALK_SKIP_CHILDREN;
+  }
+
+  for (unsigned i = 0; i < descriptor->n_fields; i++) {
+    const ProtobufCFieldDescriptor *field = &descriptor->fields[i];
+
+    if ((field->flags & PROTOBUF_C_FIELD_FLAG_ONEOF) && *(uint32_t *)(base + field->quantifier_offset) != field->id) {
+      continue;
+    }
+
+    if (field->type == PROTOBUF_C_TYPE_STRING && field->label != PROTOBUF_C_LABEL_REPEATED) {
+      add_identifier(template, (char **)(base + field->offset));
+    } else if (field->type == PROTOBUF_C_TYPE_MESSAGE && field->descriptor == &pg_query__node__descriptor) {
+      if (field->label == PROTOBUF_C_LABEL_REPEATED) {
+        size_t count = *(size_t *)(base + field->quantifier_offset);
+        PgQuery__Node **items = *(PgQuery__Node ***)(base + field->offset);
+
+        for (size_t j = 0; j < count; j++) {
+          add_value(template, items[j]);
+        }
+      } else {
+        add_value(template, *(PgQuery__Node **)(base + field->offset));
+      }
+    }
+  }
+
+  return template->failed ? PG_WALK_STOP : PG_WALK_CONTINUE;
+}
+
+static void free_template_slots(PgTemplate *template) {
+  for (int32_t i = 0; i < template->n_identifiers; i++) {
+    free(template->identifiers[i].name);
+  }
+  free(template->identifiers);
+  free(template->values);
+}
+
+// Distinct placeholder names, null-terminated back to back.
+static char *distinct_names(const PgTemplate *template, int32_t *count) {
+  size_t size = 1;
+  for (int32_t i = 0; i < template->n_identifiers; i++) {
+    size += strlen(template->identifiers[i].name) + 1;
+  }
+
+  char *names = (char *)malloc(size);
+  if (!names) {
+    return NULL;
+  }
+
+  char *end = names;
+  *count = 0;
+
+  for (int32_t i = 0; i < template->n_identifiers; i++) {
+    const char *name = template->identifiers[i].name;
+    int seen = 0;
+
+    for (int32_t j = 0; j < i && !seen; j++) {
+      seen = strcmp(template->identifiers[j].name, name) == 0;
+    }
+
+    if (!seen) {
+      size_t length = strlen(name) + 1;
+      memcpy(end, name, length);
+      end += length;
+      (*count)++;
+    }
+  }
+
+  *end = '\0';
+  return names;
+}
+
+EXPORT("compile_template")
+PgTemplateResult *compile_template(char *sql) {
+  PgTemplateResult *result = (PgTemplateResult *)calloc(1, sizeof(PgTemplateResult));
+
+  PgQueryProtobufParseResult parsed = pg_query_parse_protobuf(sql);
+  free(parsed.stderr_buffer);
+
+  if (parsed.error) {
+    free(parsed.parse_tree.data);
+    result->error = parsed.error;
+    return result;
+  }
+
+  PgTemplate *template = (PgTemplate *)calloc(1, sizeof(PgTemplate));
+  template->tree = pg_query__parse_result__unpack(NULL, parsed.parse_tree.len, (const uint8_t *)parsed.parse_tree.data);
+  free(parsed.parse_tree.data);
+
+  if (!template->tree) {
+    free(template);
+    result->error = pg_make_error("failed to unpack parse tree");
+    return result;
+  }
+
+  if (pg_walk(&template->tree->base, collect_slots, template) != 0) {
+    template->failed = 1;
+  }
+
+  result->identifiers = template->failed ? NULL : distinct_names(template, &result->n_identifiers);
+
+  if (!result->identifiers) {
+    free_template_slots(template);
+    pg_query__parse_result__free_unpacked(template->tree, NULL);
+    free(template);
+    result->error = pg_make_error("out of memory compiling template");
+    return result;
+  }
+
+  result->template = template;
+  result->n_params = template->n_params;
+  return result;
+}
+
+// Leaves `result->template` alone: JS owns it until free_template().
+EXPORT("free_template_result")
+void free_template_result(PgTemplateResult *result) {
+  free(result->identifiers);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
+
+EXPORT("free_template")
+void free_template(PgTemplate *template) {
+  free_template_slots(template);
+  pg_query__parse_result__free_unpacked(template->tree, NULL);
+  free(template);
+}
+
+// Whether `text` is a plain decimal numeric literal: an optional minus
+// sign, digits with at most one decimal point, and an optional exponent.
+// Anything else would be deparsed verbatim into the query.
+static int is_numeric_literal(const char *text) {
+  int digits = 0;
+
+  if (*text == '-') {
+    text++;
+  }
+  for (; isdigit((unsigned char)*text); text++) {
+    digits++;
+  }
+  if (*text == '.') {
+    for (text++; isdigit((unsigned char)*text); text++) {
+      digits++;
+    }
+  }
+  if (!digits) {
+    return 0;
+  }
+
+  if (*text == 'e' || *text == 'E') {
+    text++;
+    if (*text == '+' || *text == '-') {
+      text++;
+    }
+    if (!isdigit((unsigned char)*text)) {
+      return 0;
+    }
+    while (isdigit((unsigned char)*text)) {
+      text++;
+    }
+  }
+
+  return *text == '\0';
+}
+
+// Fills `value` from a JSON binding: null, a boolean, a string, or
+// {"number": "<text>"}. Integers that fit in 32 bits become Integer
+// nodes and other numbers Float nodes, as the Postgres lexer does.
+static const char *make_const(json_t *binding, ConstValue *value) {
+  pg_query__a__const__init(&value->a_const);
+  value->a_const.location = -1;
+
+  if (json_is_null(binding)) {
+    value->a_const.isnull = 1;
+  } else if (json_is_boolean(binding)) {
+    pg_query__boolean__init(&value->boolval);
+    value->boolval.boolval = json_is_true(binding);
+    value->a_const.val_case = PG_QUERY__A__CONST__VAL_BOOLVAL;
+    value->a_const.boolval = &value->boolval;
+  } else if (json_is_string(binding)) {
+    pg_query__string__init(&value->sval);
+    value->sval.sval = (char *)json_string_value(binding);
+    value->a_const.val_case = PG_QUERY__A__CONST__VAL_SVAL;
+    value->a_const.sval = &value->sval;
+  } else if (json_is_string(json_object_get(binding, "number"))) {
+    const char *text = json_string_value(json_object_get(binding, "number"));
+    char *end;
+
+    if (!is_numeric_literal(text)) {
+      return "template numbers must be decimal numeric literals";
+    }
+
+    errno = 0;
+    long number = strtol(text, &end, 10);
+
+    if (*text && !*end && errno == 0 && number >= INT32_MIN && number <= INT32_MAX) {
+      pg_query__integer__init(&value->ival);
+      value->ival.ival = (int32_t)number;
+      value->a_const.val_case = PG_QUERY__A__CONST__VAL_IVAL;
+      value->a_const.ival = &value->ival;
+    } else {
+      pg_query__float__init(&value->fval);
+      value->fval.fval = (char *)text;
+      value->a_const.val_case = PG_QUERY__A__CONST__VAL_FVAL;
+      value->a_const.fval = &value->fval;
+    }
+  } else {
+    return "template values must be null, booleans, strings or numbers";
+  }
+
+  return NULL;
+}
+
+static void restore(PgTemplate *template, int32_t n_identifiers, int32_t n_values) {
+  for (int32_t i = 0; i < n_identifiers; i++) {
+    *template->identifiers[i].field = template->identifiers[i].original;
+  }
+  for (int32_t i = 0; i < n_values; i++) {
+    template->values[i].node->node_case = PG_QUERY__NODE__NODE_PARAM_REF;
+    template->values[i].node->param_ref = template->values[i].param_ref;
+  }
+}
+
+// `identifiers` is a JSON object of placeholder names to identifiers, and
+// `values` a JSON array of values for $1, $2, ...
+static const char *bind(PgTemplate *template, json_t *identifiers, json_t *values, ConstValue *consts) {
+  int32_t i = 0;
+
+  for (; i < template->n_identifiers; i++) {
+    IdentifierSlot *slot = &template->identifiers[i];
+    json_t *binding = json_object_get(identifiers, slot->name);
+
+    if (!json_is_string(binding)) {
+      restore(template, i, 0);
+      return "missing identifier for template placeholder";
+    }
+
+    *slot->field = (char *)json_string_value(binding);
+  }
+
+  for (int32_t j = 0; j < template->n_values; j++) {
+    ValueSlot *slot = &template->values[j];
+    json_t *binding = json_array_get(values, slot->param_ref->number - 1);
+
+    if (!binding) {
+      continue;  // unbound, stays a parameter
+    }
+
+    const char *error = make_const(binding, &consts[j]);
+    if (error) {
+      restore(template, i, j);
+      return error;
+    }
+
+    slot->node->node_case = PG_QUERY__NODE__NODE_A_CONST;
+    slot->node->a_const = &consts[j].a_const;
+  }
+
+  return NULL;
+}
+
+EXPORT("render_template")
+PgRenderResult *render_template(PgTemplate *template, char *identifiers_json, char *values_json) {
+  PgRenderResult *result = (PgRenderResult *)calloc(1, sizeof(PgRenderResult));
+
+  json_t *identifiers = json_loads(identifiers_json, 0, NULL);
+  json_t *values = json_loads(values_json, 0, NULL);
+  ConstValue *consts = (ConstValue *)malloc((template->n_values ? template->n_values : 1) * sizeof(ConstValue));
+  const char *error = NULL;
+
+  if (!json_is_object(identifiers) || !json_is_array(values)) {
+    error = "template bindings are not valid JSON";
+  } else if (!consts) {
+    error = "out of memory rendering template";
+  } else {
+    error = bind(template, identifiers, values, consts);
+  }
+
+  PgQueryProtobuf protobuf = {0, NULL};
+
+  if (!error) {
+    protobuf.len = pg_query__parse_result__get_packed_size(template->tree);
+    protobuf.data = (char *)malloc(protobuf.len ? protobuf.len : 1);
+
+    if (protobuf.data) {
+      pg_query__parse_result__pack(template->tree, (uint8_t *)protobuf.data);
+    } else {
+      error = "out of memory rendering template";
+    }
+
+    // Unbound slots still hold their ParamRef, so restoring them is a no-op
+    restore(template, template->n_identifiers, template->n_values);
+  }
+
+  // Packed copies of the bound strings are in `protobuf` now
+  json_decref(identifiers);
+  json_decref(values);
+  free(consts);
+
+  if (error) {
+    free(protobuf.data);
+    result->error = pg_make_error(error);
+    return result;
+  }
+
+  PgQueryDeparseResult deparsed = pg_query_deparse_protobuf(protobuf);
+  free(protobuf.data);
+
+  if (deparsed.error) {
+    result->error = deparsed.error;
+    deparsed.error = NULL;
+  } else {
+    result->sql = deparsed.query;
+    deparsed.query = NULL;
+  }
+  pg_query_free_deparse_result(deparsed);
+
+  return result;
+}
+
+EXPORT("free_render_result")
+void free_render_result(PgRenderResult *result) {
+  free(result->sql);
+  if (result->error) {
+    pg_query_free_error(result->error);
+  }
+  free(result);
+}
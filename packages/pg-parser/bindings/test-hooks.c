@@ -0,0 +1,29 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "macros.h"
+
+// Failure injection for the WASM recovery tests (src/recovery.test.ts).
+//
+// When built with PG_PARSER_TEST_HOOKS (the default for non-release WASM
+// builds, see Makefile), test_trap() kills the instance from inside C the
+// way a real bug would, so JS recovery runs against genuine traps rather
+// than simulated ones. Without it (release builds) test_trap() isn't
+// exported at all, and JS feature-detects it.
+
+typedef enum {
+  TEST_TRAP_UNREACHABLE = 0,  // wasm `unreachable` instruction
+  TEST_TRAP_ABORT = 1,        // abort(), as libc and Emscripten do on fatal errors
+} TestTrapKind;
+
+#ifdef PG_PARSER_TEST_HOOKS
+
+EXPORT("test_trap")
+int32_t test_trap(int32_t kind) {
+  if (kind == TEST_TRAP_ABORT) {
+    abort();
+  }
+  __builtin_trap();
+}
+
+#endif
@@ -0,0 +1,245 @@
+// Throughput benchmark for the WASI build under wasmtime, the way an
+// isolated multi-threaded host would run it: one compiled module shared by
+// all threads, one store + instance per thread.
+//
+//   make wasi-bench LIBPG_QUERY_TAG=17-6.1.0
+//   wasi/17/pg-parser-wasi-bench wasi/17/pg-parser.wasm test/fixtures/dump.sql 200 4
+//
+// Each iteration is parse_sql() + free_parse_result() on the whole file,
+// i.e. the same work as PgParser.parse() minus the JS boundary. See
+// docs/wasi.md for the ABI this relies on.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <wasi.h>
+#include <wasmtime.h>
+
+typedef struct {
+  const wasm_engine_t *engine;
+  const wasmtime_module_t *module;
+  const char *sql;
+  size_t length;
+  int iterations;
+  int status;
+  double elapsed_ms;
+} Worker;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static char *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    perror(path);
+    return NULL;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+
+  char *data = (char *)malloc(size + 1);
+  if (fread(data, 1, size, file) != (size_t)size) {
+    perror(path);
+    fclose(file);
+    free(data);
+    return NULL;
+  }
+
+  data[size] = '\0';
+  fclose(file);
+  *length = (size_t)size;
+  return data;
+}
+
+static int report(const char *what, wasmtime_error_t *error, wasm_trap_t *trap) {
+  wasm_byte_vec_t message;
+
+  if (error) {
+    wasmtime_error_message(error, &message);
+    wasmtime_error_delete(error);
+  } else if (trap) {
+    wasm_trap_message(trap, &message);
+    wasm_trap_delete(trap);
+  } else {
+    return 0;
+  }
+
+  fprintf(stderr, "%s: %.*s\n", what, (int)message.size, message.data);
+  wasm_byte_vec_delete(&message);
+  return 1;
+}
+
+static int get_func(wasmtime_context_t *context, wasmtime_instance_t *instance, const char *name, wasmtime_func_t *func) {
+  wasmtime_extern_t item;
+
+  if (!wasmtime_instance_export_get(context, instance, name, strlen(name), &item) ||
+      item.kind != WASMTIME_EXTERN_FUNC) {
+    fprintf(stderr, "missing export: %s\n", name);
+    return 1;
+  }
+
+  *func = item.of.func;
+  return 0;
+}
+
+// Calls an (i32...) -> i32? export.
+static int call(wasmtime_context_t *context, const wasmtime_func_t *func, int32_t arg, int has_arg, int32_t *result) {
+  wasmtime_val_t params[1] = {{.kind = WASMTIME_I32, .of.i32 = arg}};
+  wasmtime_val_t results[1];
+  wasm_trap_t *trap = NULL;
+  wasmtime_error_t *error = wasmtime_func_call(context, func, params, has_arg ? 1 : 0, results, result ? 1 : 0, &trap);
+
+  if (report("call", error, trap)) {
+    return 1;
+  }
+  if (result) {
+    *result = results[0].of.i32;
+  }
+  return 0;
+}
+
+static void *run_worker(void *arg) {
+  Worker *worker = (Worker *)arg;
+  worker->status = 1;
+
+  wasmtime_store_t *store = wasmtime_store_new((wasm_engine_t *)worker->engine, NULL, NULL);
+  wasmtime_context_t *context = wasmtime_store_context(store);
+  wasmtime_linker_t *linker = wasmtime_linker_new((wasm_engine_t *)worker->engine);
+  wasmtime_instance_t instance;
+  wasm_trap_t *trap = NULL;
+
+  if (report("wasi", wasmtime_linker_define_wasi(linker), NULL) ||
+      report("wasi", wasmtime_context_set_wasi(context, wasi_config_new()), NULL) ||
+      report("instantiate", wasmtime_linker_instantiate(linker, context, worker->module, &instance, &trap), trap)) {
+    goto done;
+  }
+
+  wasmtime_func_t initialize, wasm_malloc, wasm_free, parse_sql, free_parse_result;
+  wasmtime_extern_t memory;
+
+  if (get_func(context, &instance, "_initialize", &initialize) ||
+      get_func(context, &instance, "malloc", &wasm_malloc) ||
+      get_func(context, &instance, "free", &wasm_free) ||
+      get_func(context, &instance, "parse_sql", &parse_sql) ||
+      get_func(context, &instance, "free_parse_result", &free_parse_result) ||
+      !wasmtime_instance_export_get(context, &instance, "memory", 6, &memory) ||
+      call(context, &initialize, 0, 0, NULL)) {
+    goto done;
+  }
+
+  // Copy the SQL in once, NUL-terminated
+  int32_t sql_ptr;
+  if (call(context, &wasm_malloc, (int32_t)worker->length + 1, 1, &sql_ptr) || !sql_ptr) {
+    goto done;
+  }
+  memcpy(wasmtime_memory_data(context, &memory.of.memory) + sql_ptr, worker->sql, worker->length + 1);
+
+  double start = now_ms();
+  for (int i = 0; i < worker->iterations; i++) {
+    int32_t result_ptr;
+    if (call(context, &parse_sql, sql_ptr, 1, &result_ptr)) {
+      goto done;
+    }
+
+    // PgQueryParseResult.error is at offset 8 (see docs/wasi.md). Memory
+    // may have grown during the call, so re-read the base pointer.
+    int32_t error_ptr;
+    memcpy(&error_ptr, wasmtime_memory_data(context, &memory.of.memory) + result_ptr + 8, sizeof(error_ptr));
+    if (error_ptr) {
+      fprintf(stderr, "parse error\n");
+      goto done;
+    }
+
+    if (call(context, &free_parse_result, result_ptr, 1, NULL)) {
+      goto done;
+    }
+  }
+  worker->elapsed_ms = now_ms() - start;
+
+  call(context, &wasm_free, sql_ptr, 1, NULL);
+  worker->status = 0;
+
+done:
+  wasmtime_linker_delete(linker);
+  wasmtime_store_delete(store);
+  return NULL;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <pg-parser.wasm> <file.sql> [iterations] [threads]\n", argv[0]);
+    return 2;
+  }
+
+  int iterations = argc > 3 ? atoi(argv[3]) : 100;
+  int threads = argc > 4 ? atoi(argv[4]) : 1;
+  size_t wasm_length, sql_length;
+  char *wasm = read_file(argv[1], &wasm_length);
+  char *sql = read_file(argv[2], &sql_length);
+
+  if (!wasm || !sql || threads < 1) {
+    free(wasm);
+    free(sql);
+    return 1;
+  }
+
+  // setjmp/longjmp in the module are built on Wasm exception handling
+  wasm_config_t *config = wasm_config_new();
+  wasmtime_config_wasm_exceptions_set(config, true);
+  wasm_engine_t *engine = wasm_engine_new_with_config(config);
+  wasmtime_module_t *module = NULL;
+
+  double compile_start = now_ms();
+  if (report("compile", wasmtime_module_new(engine, (const uint8_t *)wasm, wasm_length, &module), NULL)) {
+    wasm_engine_delete(engine);
+    free(wasm);
+    free(sql);
+    return 1;
+  }
+  printf("compiled %s in %.1f ms\n", argv[1], now_ms() - compile_start);
+  free(wasm);
+
+  Worker *workers = (Worker *)calloc(threads, sizeof(Worker));
+  pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+
+  double start = now_ms();
+  for (int i = 0; i < threads; i++) {
+    workers[i] = (Worker){engine, module, sql, sql_length, iterations, 1, 0};
+    pthread_create(&ids[i], NULL, run_worker, &workers[i]);
+  }
+
+  int status = 0;
+  double slowest_ms = 0;
+  for (int i = 0; i < threads; i++) {
+    pthread_join(ids[i], NULL);
+    status |= workers[i].status;
+    if (workers[i].elapsed_ms > slowest_ms) {
+      slowest_ms = workers[i].elapsed_ms;
+    }
+  }
+  double elapsed = now_ms() - start;
+
+  if (status == 0) {
+    double total_bytes = (double)sql_length * iterations * threads;
+    printf("parse: %d threads x %d iterations in %.1f ms (%.3f ms/iter, %.1f MB/s)\n",
+           threads, iterations, elapsed, slowest_ms / iterations, (total_bytes / 1e6) / (elapsed / 1000.0));
+  }
+
+  free(ids);
+  free(workers);
+  wasmtime_module_delete(module);
+  wasm_engine_delete(engine);
+  free(sql);
+  return status;
+}
@@ -0,0 +1,65 @@
+/// <reference types="node" />
+
+import { mkdir, writeFile } from 'node:fs/promises';
+import { join } from 'node:path';
+import { parseArgs } from 'node:util';
+import { getWorkload, WORKLOADS } from '../test/corpus/workloads.js';
+
+const {
+  values: { workload: workloadNames, size, ['output-dir']: outDir },
+} = parseArgs({
+  options: {
+    workload: {
+      type: 'string',
+      short: 'w',
+      multiple: true,
+    },
+    size: {
+      type: 'string',
+      short: 's',
+    },
+    ['output-dir']: {
+      type: 'string',
+      short: 'o',
+      default: 'test/fixtures/generated',
+    },
+  },
+});
+
+const workloads = workloadNames?.length
+  ? workloadNames.map(getWorkload)
+  : WORKLOADS;
+
+const sizeOverride = size !== undefined ? parseInt(size, 10) : undefined;
+
+if (sizeOverride !== undefined && !(sizeOverride > 0)) {
+  throw new Error(`invalid size: ${size}`);
+}
+
+await mkdir(outDir, { recursive: true });
+
+const manifest = [];
+
+for (const workload of workloads) {
+  const workloadSize = sizeOverride ?? workload.defaultSize;
+  const file = `${workload.name}-${workloadSize}.sql`;
+  const sql = workload.generate(workloadSize);
+
+  await writeFile(join(outDir, file), sql);
+
+  manifest.push({
+    file,
+    workload: workload.name,
+    description: workload.description,
+    size: workloadSize,
+    bytes: Buffer.byteLength(sql),
+    expect: workload.expect(workloadSize),
+  });
+
+  console.log(`${file}: ${Buffer.byteLength(sql)} bytes`);
+}
+
+await writeFile(
+  join(outDir, 'manifest.json'),
+  JSON.stringify(manifest, null, 2) + '\n'
+);
@@ -0,0 +1,74 @@
+import { describe, expect, it } from 'vitest';
+import { countAllocations } from '../test/utils/allocations.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapParseResult } from './util.js';
+
+/**
+ * Operations whose WASM heap allocations (malloc/calloc/aligned allocs)
+ * are pinned, per supported Postgres version.
+ *
+ * The budget for each is the exact count recorded in
+ * `__snapshots__/allocations.test.ts.snap`, so any new allocation fails
+ * the test. If a change moves a count, either find the allocation or
+ * re-record with `vitest -u` in the same PR and explain why.
+ */
+const OPERATIONS = [
+  'parse SELECT 1',
+  'parse SELECT with WHERE',
+  'parse rejected by limits',
+  'deparse SELECT with WHERE',
+  'deparse node (A_Expr)',
+  'scan SELECT 1',
+  'split two statements',
+] as const;
+
+type Operation = (typeof OPERATIONS)[number];
+
+describe.each([15, 16, 17])('allocation budgets (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  const query = 'SELECT id, name FROM users WHERE active = true AND age > 18';
+
+  const operations: Record<Operation, () => Promise<unknown>> = {
+    'parse SELECT 1': () => pgParser.parse('SELECT 1'),
+    'parse SELECT with WHERE': () => pgParser.parse(query),
+    'parse rejected by limits': () =>
+      pgParser.parse(query, { limits: { maxTokens: 3 } }),
+    'deparse SELECT with WHERE': async () => {
+      const tree = await unwrapParseResult(pgParser.parse(query));
+      await pgParser.resetAllocationStats();
+      return pgParser.deparse(tree);
+    },
+    'deparse node (A_Expr)': () =>
+      pgParser.deparse({
+        A_Expr: {
+          kind: 'AEXPR_OP',
+          name: [{ String: { sval: '>' } }],
+          lexpr: { ColumnRef: { fields: [{ String: { sval: 'age' } }] } },
+          rexpr: { A_Const: { ival: { ival: 18 } } },
+        },
+      }),
+    'scan SELECT 1': () => pgParser.scan('SELECT 1'),
+    'split two statements': () => pgParser.split('SELECT 1; SELECT 2'),
+  };
+
+  it.for(OPERATIONS)('%s stays within budget', async (operation, ctx) => {
+    const stats = await countAllocations(pgParser, operations[operation]);
+
+    if (!stats) {
+      return ctx.skip();
+    }
+
+    expect(stats.mallocs, `${operation} allocations`).toMatchSnapshot();
+  });
+
+  it.for(OPERATIONS)('%s frees every allocation', async (operation, ctx) => {
+    const stats = await countAllocations(pgParser, operations[operation]);
+
+    if (!stats) {
+      return ctx.skip();
+    }
+
+    expect(stats.frees).toBe(stats.mallocs);
+  });
+});
@@ -0,0 +1,129 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { PgArchive, type ArchiveFileHandle } from './archive.js';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapArchiveResult, unwrapParseResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('archives (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('decodes statements exactly as parse() returns them', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    const archive = await PgArchive.open(
+      await unwrapArchiveResult(pgParser.createArchive(sqlDump)),
+    );
+
+    expect(archive.version).toBe(tree.version);
+    expect(archive.queryCount).toBe(1);
+    expect(archive.size).toBe(tree.stmts!.length);
+
+    for (let n = 0; n < archive.size; n++) {
+      expect(await archive.statement(n)).toStrictEqual(tree.stmts![n]);
+    }
+  });
+
+  it('indexes statements across queries', async () => {
+    const archive = await PgArchive.open(
+      await unwrapArchiveResult(
+        pgParser.createArchive([
+          'SELECT 1; INSERT INTO t VALUES (1)',
+          '',
+          'DELETE FROM t',
+        ]),
+      ),
+    );
+
+    expect(archive.queryCount).toBe(3);
+    expect(archive.size).toBe(3);
+    expect(archive.entry(0)).toStrictEqual({
+      query: 0,
+      location: 0,
+      length: 8,
+      type: 'SelectStmt',
+    });
+    expect(archive.entry(1)).toMatchObject({ query: 0, type: 'InsertStmt' });
+    expect(archive.entry(2)).toMatchObject({ query: 2, type: 'DeleteStmt' });
+    expect(() => archive.entry(3)).toThrow(RangeError);
+  });
+
+  it('finds statements by node type', async () => {
+    const archive = await PgArchive.open(
+      await unwrapArchiveResult(
+        pgParser.createArchive([
+          'SELECT * FROM a JOIN b ON a.id = b.id',
+          'SELECT 1',
+          'UPDATE t SET x = (SELECT max(y) FROM a JOIN b USING (id))',
+        ]),
+      ),
+    );
+
+    expect(await archive.findStatements('JoinExpr')).toStrictEqual([0, 2]);
+    expect(await archive.findStatements('SelectStmt')).toStrictEqual([0, 1, 2]);
+    expect(await archive.findStatements('FuncCall')).toStrictEqual([2]);
+    expect(await archive.findStatements('CreateStmt')).toStrictEqual([]);
+  });
+
+  it('reads statements lazily', async () => {
+    const bytes = await unwrapArchiveResult(pgParser.createArchive(sqlDump));
+    const reads: [number, number][] = [];
+
+    const handle: ArchiveFileHandle = {
+      stat: async () => ({ size: BigInt(bytes.byteLength) }),
+      read: async (buffer, offset, length, position) => {
+        reads.push([position, length]);
+        buffer.set(bytes.subarray(position, position + length), offset);
+        return { bytesRead: Math.min(length, bytes.byteLength - position) };
+      },
+    };
+
+    const archive = await PgArchive.fromFileHandle(handle);
+    const opened = reads.length;
+    const last = archive.size - 1;
+
+    expect(await archive.statement(last)).toStrictEqual(
+      await PgArchive.open(bytes).then((archive) => archive.statement(last)),
+    );
+
+    // The record, which is a small part of the archive, then any string
+    // table pages it needs that aren't loaded yet
+    const [, length] = reads[opened]!;
+    expect(length).toBeLessThan(bytes.byteLength / 10);
+
+    // Pages stay loaded, so a second read is just the record
+    const before = reads.length;
+    await archive.statement(last);
+    expect(reads).toHaveLength(before + 1);
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.createArchive([
+      'SELECT 1',
+      'select from where',
+    ]);
+
+    expect(result.archive).toBeUndefined();
+    expect(result.error).toBeInstanceOf(ParseError);
+    expect(result.error).toMatchObject({ query: 1, position: 7 });
+  });
+
+  it('rejects data that is not an archive', async () => {
+    await expect(
+      PgArchive.open(new TextEncoder().encode('SELECT 1 -- not an archive')),
+    ).rejects.toThrow('not a pg-parser archive');
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.createArchive(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.createArchive(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
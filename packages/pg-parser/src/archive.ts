@@ -0,0 +1,494 @@
+import type {
+  ArchiveEntry,
+  ArchiveSource,
+  ParseResult,
+} from './types/index.js';
+
+const textDecoder = new TextDecoder();
+
+// Layout constants, see bindings/archive.c
+const MAGIC = 'PGAR';
+const FORMAT = 1;
+const HEADER_SIZE = 48;
+const ENTRY_SIZE = 36;
+const NO_TYPE = 0xffffffff;
+
+// Strings are read from the string table this many at a time
+const STRING_PAGE_SIZE = 1024;
+
+// Value tags, matching PgArchiveTag in bindings/archive.c
+const TAG_NULL = 0;
+const TAG_FALSE = 1;
+const TAG_TRUE = 2;
+const TAG_INTEGER = 3;
+const TAG_REAL = 4;
+const TAG_STRING = 5;
+const TAG_ARRAY = 6;
+const TAG_OBJECT = 7;
+
+export type ArchiveStatement = NonNullable<ParseResult['stmts']>[number];
+
+/**
+ * Minimal shape of a Node.js `FileHandle` (from `fs.promises.open()`),
+ * so this module doesn't depend on Node types.
+ */
+export interface ArchiveFileHandle {
+  stat(): Promise<{ size: number | bigint }>;
+  read(
+    buffer: Uint8Array,
+    offset: number,
+    length: number,
+    position: number
+  ): Promise<{ bytesRead: number }>;
+}
+
+function readU64(view: DataView, offset: number) {
+  return (
+    view.getUint32(offset, true) + view.getUint32(offset + 4, true) * 2 ** 32
+  );
+}
+
+function toView(bytes: Uint8Array) {
+  return new DataView(bytes.buffer, bytes.byteOffset, bytes.byteLength);
+}
+
+/**
+ * A cursor over an encoded value.
+ */
+class ValueReader {
+  bytes: Uint8Array;
+  position = 0;
+
+  constructor(bytes: Uint8Array) {
+    this.bytes = bytes;
+  }
+
+  varint() {
+    let value = 0;
+    let scale = 1;
+    let byte: number;
+
+    do {
+      byte = this.bytes[this.position++]!;
+      value += (byte & 0x7f) * scale;
+      scale *= 128;
+    } while (byte & 0x80);
+
+    return value;
+  }
+}
+
+type StringPage = {
+  /** Offsets of the page's strings, plus the end of the last one */
+  offsets: DataView;
+  /** Bytes from the start of the page's first string */
+  bytes: Uint8Array;
+};
+
+/**
+ * Reads an archive written by `PgParser.createArchive()`.
+ *
+ * Only the header and statement index are read up front. Statements are
+ * read and decoded one at a time, the string table is read in pages as
+ * statements need its strings, and filtering by node type only reads the
+ * per-statement type lists, so opening a file-backed archive with
+ * millions of statements costs a few small reads.
+ */
+export class PgArchive {
+  /** Postgres version the trees were parsed with, e.g. 170004 */
+  readonly version: number;
+
+  /** Number of queries passed to `createArchive()` */
+  readonly queryCount: number;
+
+  /** Number of statements in the archive */
+  readonly size: number;
+
+  #source: ArchiveSource;
+  #index: DataView;
+  #stringsOffset: number;
+  #stringBytesOffset: number;
+  #stringCount: number;
+  #stringPages = new Map<number, Promise<StringPage>>();
+  #loadedPages = new Map<number, StringPage>();
+  #strings: (string | undefined)[];
+  #typesOffset: number;
+  #typesLength: number;
+  #types?: Promise<DataView>;
+
+  private constructor(
+    source: ArchiveSource,
+    header: DataView,
+    index: Uint8Array
+  ) {
+    this.version = header.getUint32(8, true);
+    this.size = header.getUint32(12, true);
+    this.queryCount = header.getUint32(20, true);
+
+    this.#source = source;
+    this.#index = toView(index);
+    this.#stringCount = header.getUint32(16, true);
+    this.#stringsOffset = readU64(header, 24);
+    this.#stringBytesOffset =
+      this.#stringsOffset + (this.#stringCount + 1) * 4;
+    this.#strings = new Array(this.#stringCount);
+    this.#typesOffset = readU64(header, 32);
+    this.#typesLength = readU64(header, 40) - this.#typesOffset;
+  }
+
+  /**
+   * Opens an archive held in memory or behind a random-access source.
+   */
+  static async open(input: Uint8Array | ArchiveSource) {
+    const source: ArchiveSource =
+      input instanceof Uint8Array
+        ? {
+            size: input.byteLength,
+            read: async (offset, length) =>
+              input.subarray(offset, offset + length),
+          }
+        : input;
+
+    if (source.size < HEADER_SIZE) {
+      throw new Error('not a pg-parser archive');
+    }
+
+    const headerBytes = await source.read(0, HEADER_SIZE);
+    const header = toView(headerBytes);
+
+    if (textDecoder.decode(headerBytes.subarray(0, 4)) !== MAGIC) {
+      throw new Error('not a pg-parser archive');
+    }
+
+    const format = header.getUint32(4, true);
+    if (format !== FORMAT) {
+      throw new Error(`unsupported archive format: ${format}`);
+    }
+
+    const indexOffset = readU64(header, 40);
+    const indexLength = header.getUint32(12, true) * ENTRY_SIZE;
+
+    if (indexOffset + indexLength > source.size) {
+      throw new Error('archive is truncated');
+    }
+
+    const index = await source.read(indexOffset, indexLength);
+    const archive = new PgArchive(source, header, index);
+
+    // So that entry() can name statement types without a read
+    const typeIds = new Set<number>();
+    for (let n = 0; n < archive.size; n++) {
+      const type = archive.#index.getUint32(n * ENTRY_SIZE + 24, true);
+      if (type !== NO_TYPE) {
+        typeIds.add(type);
+      }
+    }
+    await archive.#loadStrings(typeIds);
+
+    return archive;
+  }
+
+  /**
+   * Opens an archive file lazily through a Node.js `FileHandle`. The
+   * handle must stay open while the archive is in use.
+   *
+   * ```ts
+   * const handle = await open('queries.pgar');
+   * const archive = await PgArchive.fromFileHandle(handle);
+   * ```
+   */
+  static async fromFileHandle(handle: ArchiveFileHandle) {
+    const { size } = await handle.stat();
+
+    return PgArchive.open({
+      size: Number(size),
+      async read(offset, length) {
+        const buffer = new Uint8Array(length);
+        let read = 0;
+
+        while (read < length) {
+          const { bytesRead } = await handle.read(
+            buffer,
+            read,
+            length - read,
+            offset + read
+          );
+          if (bytesRead === 0) {
+            throw new Error('archive is truncated');
+          }
+          read += bytesRead;
+        }
+
+        return buffer;
+      },
+    });
+  }
+
+  /**
+   * Returns the index entry of statement `n` without reading the
+   * statement itself.
+   */
+  entry(n: number): ArchiveEntry {
+    const base = this.#entryOffset(n);
+    const type = this.#index.getUint32(base + 24, true);
+
+    return {
+      query: this.#index.getUint32(base + 12, true),
+      location: this.#index.getUint32(base + 16, true),
+      length: this.#index.getUint32(base + 20, true),
+      type: type === NO_TYPE ? undefined : this.#string(type),
+    };
+  }
+
+  /**
+   * Reads and decodes statement `n`, in the same shape as an element of
+   * `parse()`'s `stmts`.
+   */
+  async statement(n: number): Promise<ArchiveStatement> {
+    const base = this.#entryOffset(n);
+    const offset = readU64(this.#index, base);
+    const length = this.#index.getUint32(base + 8, true);
+    const bytes = await this.#source.read(offset, length);
+
+    await this.#loadStrings(this.#stringIds(bytes));
+    return this.#decode(bytes) as ArchiveStatement;
+  }
+
+  /**
+   * Returns the indexes of the statements whose tree contains a node of
+   * type `nodeType` (e.g. `JoinExpr`), reading only the type lists.
+   */
+  async findStatements(nodeType: string): Promise<number[]> {
+    const types = await this.#loadTypes();
+    const id = await this.#findTypeId(types, nodeType);
+    const matches: number[] = [];
+
+    if (id === undefined) {
+      return matches;
+    }
+
+    for (let n = 0; n < this.size; n++) {
+      const base = n * ENTRY_SIZE;
+      let low = this.#index.getUint32(base + 28, true);
+      let high = low + this.#index.getUint32(base + 32, true) - 1;
+
+      // Each statement's type ids are sorted
+      while (low <= high) {
+        const middle = (low + high) >>> 1;
+        const value = types.getUint32(middle * 4, true);
+
+        if (value === id) {
+          matches.push(n);
+          break;
+        }
+        if (value < id) {
+          low = middle + 1;
+        } else {
+          high = middle - 1;
+        }
+      }
+    }
+
+    return matches;
+  }
+
+  #entryOffset(n: number) {
+    if (!Number.isInteger(n) || n < 0 || n >= this.size) {
+      throw new RangeError(`statement ${n} out of range (size ${this.size})`);
+    }
+    return n * ENTRY_SIZE;
+  }
+
+  #loadTypes() {
+    this.#types ??= this.#source
+      .read(this.#typesOffset, this.#typesLength)
+      .then(toView);
+    return this.#types;
+  }
+
+  // Only node type names appear in the types section, so search those
+  // instead of decoding the whole string table.
+  async #findTypeId(types: DataView, nodeType: string) {
+    const ids = new Set<number>();
+    for (let i = 0; i < types.byteLength; i += 4) {
+      ids.add(types.getUint32(i, true));
+    }
+
+    await this.#loadStrings(ids);
+
+    for (const id of ids) {
+      if (this.#string(id) === nodeType) {
+        return id;
+      }
+    }
+
+    return undefined;
+  }
+
+  /**
+   * Reads the pages of the string table that hold `ids`, if they haven't
+   * been read yet.
+   */
+  async #loadStrings(ids: Iterable<number>) {
+    const pages = new Set<number>();
+    for (const id of ids) {
+      if (id >= this.#stringCount) {
+        throw new Error(`corrupt archive: string ${id} out of range`);
+      }
+      pages.add(Math.floor(id / STRING_PAGE_SIZE));
+    }
+
+    await Promise.all([...pages].map((page) => this.#loadPage(page)));
+  }
+
+  #loadPage(page: number) {
+    let loading = this.#stringPages.get(page);
+
+    if (!loading) {
+      loading = (async () => {
+        const first = page * STRING_PAGE_SIZE;
+        const count = Math.min(STRING_PAGE_SIZE, this.#stringCount - first);
+        const offsets = toView(
+          await this.#source.read(
+            this.#stringsOffset + first * 4,
+            (count + 1) * 4
+          )
+        );
+
+        const start = offsets.getUint32(0, true);
+        const end = offsets.getUint32(count * 4, true);
+        const bytes = await this.#source.read(
+          this.#stringBytesOffset + start,
+          end - start
+        );
+
+        const loaded = { offsets, bytes };
+        this.#loadedPages.set(page, loaded);
+        return loaded;
+      })();
+
+      // A failed read can be retried by the next caller
+      loading.catch(() => this.#stringPages.delete(page));
+      this.#stringPages.set(page, loading);
+    }
+
+    return loading;
+  }
+
+  // The string's page must have been loaded with #loadStrings()
+  #string(id: number) {
+    let string = this.#strings[id];
+
+    if (string === undefined) {
+      const page = this.#loadedPages.get(Math.floor(id / STRING_PAGE_SIZE))!;
+      const slot = (id % STRING_PAGE_SIZE) * 4;
+      const base = page.offsets.getUint32(0, true);
+      const start = page.offsets.getUint32(slot, true) - base;
+      const end = page.offsets.getUint32(slot + 4, true) - base;
+
+      string = textDecoder.decode(page.bytes.subarray(start, end));
+      this.#strings[id] = string;
+    }
+
+    return string;
+  }
+
+  /**
+   * Collects the string ids (values and object keys) in an encoded value,
+   * so their pages can be loaded before decoding it.
+   */
+  #stringIds(bytes: Uint8Array) {
+    const reader = new ValueReader(bytes);
+    const ids = new Set<number>();
+
+    const skipValue = (): void => {
+      const tag = bytes[reader.position++];
+
+      switch (tag) {
+        case TAG_NULL:
+        case TAG_FALSE:
+        case TAG_TRUE:
+          return;
+        case TAG_INTEGER:
+          reader.varint();
+          return;
+        case TAG_REAL:
+          reader.position += 8;
+          return;
+        case TAG_STRING:
+          ids.add(reader.varint());
+          return;
+        case TAG_ARRAY: {
+          const length = reader.varint();
+          for (let i = 0; i < length; i++) {
+            skipValue();
+          }
+          return;
+        }
+        case TAG_OBJECT: {
+          const length = reader.varint();
+          for (let i = 0; i < length; i++) {
+            ids.add(reader.varint());
+            skipValue();
+          }
+          return;
+        }
+        default:
+          throw new Error(`corrupt archive: unknown value tag ${tag}`);
+      }
+    };
+
+    skipValue();
+    return ids;
+  }
+
+  #decode(bytes: Uint8Array): unknown {
+    const view = toView(bytes);
+    const reader = new ValueReader(bytes);
+
+    const readValue = (): unknown => {
+      const tag = bytes[reader.position++];
+
+      switch (tag) {
+        case TAG_NULL:
+          return null;
+        case TAG_FALSE:
+          return false;
+        case TAG_TRUE:
+          return true;
+        case TAG_INTEGER: {
+          const zigzag = reader.varint();
+          return zigzag % 2 === 0 ? zigzag / 2 : -(zigzag + 1) / 2;
+        }
+        case TAG_REAL: {
+          const value = view.getFloat64(reader.position, true);
+          reader.position += 8;
+          return value;
+        }
+        case TAG_STRING:
+          return this.#string(reader.varint());
+        case TAG_ARRAY: {
+          const length = reader.varint();
+          const array: unknown[] = new Array(length);
+          for (let i = 0; i < length; i++) {
+            array[i] = readValue();
+          }
+          return array;
+        }
+        case TAG_OBJECT: {
+          const length = reader.varint();
+          const object: Record<string, unknown> = {};
+          for (let i = 0; i < length; i++) {
+            const key = this.#string(reader.varint());
+            object[key] = readValue();
+          }
+          return object;
+        }
+        default:
+          throw new Error(`corrupt archive: unknown value tag ${tag}`);
+      }
+    };
+
+    return readValue();
+  }
+}
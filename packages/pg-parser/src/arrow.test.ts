@@ -0,0 +1,221 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { tableFromIPC, Vector } from 'apache-arrow';
+import { describe, expect, it } from 'vitest';
+import { QueryMetric } from './constants.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapArrowResult, unwrapMetricsResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+const COLUMNS: [string, string][] = [
+  ['query', 'Int32'],
+  ['statement_type', 'Utf8'],
+  ['fingerprint', 'Uint64'],
+  ['tables', 'List<Utf8>'],
+  ['params', 'Int32'],
+  ['nodes', 'Int32'],
+  ['depth', 'Int32'],
+  ['joins', 'Int32'],
+  ['subqueries', 'Int32'],
+  ['ctes', 'Int32'],
+  ['set_operations', 'Int32'],
+  ['functions', 'Int32'],
+  ['error', 'Utf8'],
+];
+
+type Row = Record<string, unknown>;
+
+/**
+ * Reads the stream `exportArrow()` writes with Apache Arrow, checks the
+ * schema, and returns plain rows per record batch.
+ */
+function readArrow(bytes: Uint8Array) {
+  const table = tableFromIPC(bytes);
+  const fields = table.schema.fields.map((field) => field.name);
+
+  expect(
+    table.schema.fields.map((field) => [field.name, String(field.type)]),
+  ).toStrictEqual(COLUMNS);
+
+  const batches = table.batches.map((batch) =>
+    Array.from({ length: batch.numRows }, (_, i) => {
+      const row: Row = {};
+      for (const name of fields) {
+        const value = batch.getChild(name)!.get(i);
+        row[name] = value instanceof Vector ? [...value] : value;
+      }
+      return row;
+    }),
+  );
+
+  return { fields, batches, rows: batches.flat() };
+}
+
+describe.each([15, 16, 17])('exportArrow (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('writes one row per statement', async () => {
+    const { fields, rows } = readArrow(
+      await unwrapArrowResult(
+        pgParser.exportArrow([
+          'SELECT * FROM public.users u JOIN orders o ON o.user_id = u.id WHERE u.id = $1',
+          'INSERT INTO t VALUES ($1, $2); SELECT count(*) FROM t',
+        ]),
+      ),
+    );
+
+    expect(fields).toStrictEqual(COLUMNS.map(([name]) => name));
+    expect(rows).toMatchObject([
+      {
+        query: 0,
+        statement_type: 'SelectStmt',
+        tables: ['public.users', 'orders'],
+        params: 1,
+        joins: 1,
+        functions: 0,
+        error: null,
+      },
+      {
+        query: 1,
+        statement_type: 'InsertStmt',
+        tables: ['t'],
+        params: 2,
+        error: null,
+      },
+      {
+        query: 1,
+        statement_type: 'SelectStmt',
+        tables: ['t'],
+        params: 0,
+        functions: 1,
+        error: null,
+      },
+    ]);
+  });
+
+  it('fingerprints statements on their own', async () => {
+    const { rows } = readArrow(
+      await unwrapArrowResult(
+        pgParser.exportArrow([
+          'SELECT a FROM t WHERE b = 1',
+          'SELECT 1; select a from t where b = 2',
+        ]),
+      ),
+    );
+
+    expect(typeof rows[0]!.fingerprint).toBe('bigint');
+    expect(rows[2]!.fingerprint).toBe(rows[0]!.fingerprint);
+    expect(rows[1]!.fingerprint).not.toBe(rows[0]!.fingerprint);
+  });
+
+  it('leaves CTE references out of tables', async () => {
+    const { rows } = readArrow(
+      await unwrapArrowResult(
+        pgParser.exportArrow(
+          'WITH recent AS (SELECT * FROM orders) SELECT * FROM recent, archive.recent',
+        ),
+      ),
+    );
+
+    expect(rows[0]).toMatchObject({
+      tables: ['orders', 'archive.recent'],
+      ctes: 1,
+    });
+  });
+
+  it('matches metrics()', async () => {
+    const metrics = await unwrapMetricsResult(pgParser.metrics(sqlDump));
+    const { rows } = readArrow(
+      await unwrapArrowResult(pgParser.exportArrow(sqlDump)),
+    );
+
+    expect(rows).toHaveLength(metrics.length);
+    rows.forEach((row, i) => {
+      expect(row.nodes).toBe(metrics[i]![QueryMetric.nodes]);
+      expect(row.depth).toBe(metrics[i]![QueryMetric.depth]);
+      expect(row.joins).toBe(metrics[i]![QueryMetric.joins]);
+      expect(row.subqueries).toBe(metrics[i]![QueryMetric.subqueries]);
+      expect(row.ctes).toBe(metrics[i]![QueryMetric.ctes]);
+      expect(row.set_operations).toBe(metrics[i]![QueryMetric.setOperations]);
+      expect(row.functions).toBe(metrics[i]![QueryMetric.functions]);
+    });
+  });
+
+  it('writes a row for queries that fail to parse', async () => {
+    const result = await pgParser.exportArrow([
+      'select from where',
+      'SELECT 1',
+    ]);
+    const { rows } = readArrow(await unwrapArrowResult(result));
+
+    expect(result.rows).toBe(2);
+    expect(rows[0]).toMatchObject({
+      query: 0,
+      statement_type: null,
+      fingerprint: null,
+      tables: null,
+      nodes: null,
+    });
+    expect(rows[0]!.error).toMatch(/syntax error/);
+    expect(rows[1]).toMatchObject({ query: 1, error: null });
+  });
+
+  it('splits rows into record batches', async () => {
+    const queries = ['SELECT 1', 'SELECT 2; SELECT 3', 'oops', 'SELECT 4'];
+    const result = await pgParser.exportArrow(queries, { batchSize: 2 });
+    const { batches } = readArrow(await unwrapArrowResult(result));
+
+    expect(result.rows).toBe(5);
+    expect(batches.map((rows) => rows.length)).toStrictEqual([2, 2, 1]);
+    expect(batches.flat().map((row) => row.query)).toStrictEqual([
+      0, 1, 1, 2, 3,
+    ]);
+  });
+
+  it('writes distinct queries once', async () => {
+    const queries = ['SELECT 1', 'oops', 'SELECT 1', 'SELECT 2; SELECT 3'];
+    const result = await pgParser.exportArrow(
+      [...queries, 'oops', 'SELECT 1'],
+      { distinct: true },
+    );
+    const { rows } = readArrow(await unwrapArrowResult(result));
+
+    expect(result.rows).toBe(4);
+    expect(rows.map((row) => row.query)).toStrictEqual([0, 1, 3, 3]);
+    expect(Array.from(result.duplicateOf!)).toStrictEqual([0, 1, 0, 3, 1, 0]);
+  });
+
+  it('maps no duplicates without distinct', async () => {
+    const result = await pgParser.exportArrow(['SELECT 1', 'SELECT 1']);
+
+    expect(result.rows).toBe(2);
+    expect(result.duplicateOf).toBeUndefined();
+  });
+
+  it('writes an empty stream for no statements', async () => {
+    const result = await pgParser.exportArrow([]);
+    const { fields, rows } = readArrow(await unwrapArrowResult(result));
+
+    expect(result.rows).toBe(0);
+    expect(fields).toHaveLength(COLUMNS.length);
+    expect(rows).toHaveLength(0);
+  });
+
+  it('rejects invalid batch sizes', async () => {
+    await expect(
+      pgParser.exportArrow('SELECT 1', { batchSize: -1 }),
+    ).rejects.toThrow('invalid batchSize: -1');
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.exportArrow(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.exportArrow(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,353 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { PgParser } from './pg-parser.js';
+import { unwrapCatalogResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('buildCatalog (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function catalogOf(sql: string) {
+    return await unwrapCatalogResult(pgParser.buildCatalog(sql));
+  }
+
+  it('collects tables and columns', async () => {
+    const catalog = await catalogOf(`
+      CREATE TABLE app.users (
+        id integer PRIMARY KEY,
+        email varchar(255) NOT NULL,
+        tags text[],
+        created_at timestamp DEFAULT now()
+      );
+    `);
+
+    expect(catalog.tables).toStrictEqual([
+      {
+        schema: 'app',
+        name: 'users',
+        kind: 'table',
+        columns: [
+          { name: 'id', type: 'int', notNull: true, default: null },
+          {
+            name: 'email',
+            type: 'varchar(255)',
+            notNull: true,
+            default: null,
+          },
+          { name: 'tags', type: 'text[]', notNull: false, default: null },
+          {
+            name: 'created_at',
+            type: 'timestamp',
+            notNull: false,
+            default: 'now()',
+          },
+        ],
+        constraints: [
+          {
+            name: null,
+            type: 'primary_key',
+            columns: ['id'],
+            expression: null,
+            references: null,
+          },
+        ],
+      },
+    ]);
+  });
+
+  it('defaults unqualified names to the public schema', async () => {
+    const catalog = await catalogOf('CREATE TABLE users (id int)');
+
+    expect(catalog.tables[0]!.schema).toBe('public');
+  });
+
+  it('places unqualified objects in a surrounding CREATE SCHEMA', async () => {
+    const catalog = await catalogOf(
+      'CREATE SCHEMA billing CREATE TABLE invoices (id int)',
+    );
+
+    expect(catalog.schemas).toStrictEqual(['billing']);
+    expect(catalog.tables[0]!.schema).toBe('billing');
+  });
+
+  it('collects table constraints', async () => {
+    const catalog = await catalogOf(`
+      CREATE TABLE orders (
+        id int,
+        user_id int REFERENCES app.users (id),
+        price numeric CHECK (price > 0),
+        CONSTRAINT orders_pkey PRIMARY KEY (id),
+        UNIQUE (user_id, price)
+      );
+    `);
+
+    const [table] = catalog.tables;
+
+    expect(table!.constraints).toStrictEqual([
+      {
+        name: null,
+        type: 'foreign_key',
+        columns: ['user_id'],
+        expression: null,
+        references: { schema: 'app', table: 'users', columns: ['id'] },
+      },
+      {
+        name: null,
+        type: 'check',
+        columns: ['price'],
+        expression: 'price > 0',
+        references: null,
+      },
+      {
+        name: 'orders_pkey',
+        type: 'primary_key',
+        columns: ['id'],
+        expression: null,
+        references: null,
+      },
+      {
+        name: null,
+        type: 'unique',
+        columns: ['user_id', 'price'],
+        expression: null,
+        references: null,
+      },
+    ]);
+    expect(table!.columns[0]!.notNull).toBe(true);
+  });
+
+  it('applies ALTER TABLE in order', async () => {
+    const catalog = await catalogOf(`
+      CREATE TABLE users (id int, name text, legacy text);
+      ALTER TABLE users ADD COLUMN email text NOT NULL;
+      ALTER TABLE users DROP COLUMN legacy;
+      ALTER TABLE users ALTER COLUMN name SET NOT NULL;
+      ALTER TABLE users ALTER COLUMN id TYPE bigint;
+      ALTER TABLE users ALTER COLUMN id SET DEFAULT 1;
+      ALTER TABLE ONLY users ADD CONSTRAINT users_pkey PRIMARY KEY (id);
+      ALTER TABLE users ADD CONSTRAINT users_email_key UNIQUE (email);
+      ALTER TABLE users DROP CONSTRAINT users_email_key;
+    `);
+
+    const [table] = catalog.tables;
+
+    expect(table!.columns).toStrictEqual([
+      { name: 'id', type: 'bigint', notNull: true, default: '1' },
+      { name: 'name', type: 'text', notNull: true, default: null },
+      { name: 'email', type: 'text', notNull: true, default: null },
+    ]);
+    expect(table!.constraints.map((c) => c.name)).toStrictEqual([
+      'users_pkey',
+    ]);
+  });
+
+  it('ignores ALTER TABLE on unknown tables', async () => {
+    const catalog = await catalogOf('ALTER TABLE missing ADD COLUMN id int');
+
+    expect(catalog.tables).toStrictEqual([]);
+  });
+
+  it('collects indexes', async () => {
+    const catalog = await catalogOf(`
+      CREATE UNIQUE INDEX users_email_idx ON app.users USING btree (lower(email)) WHERE deleted_at IS NULL;
+      CREATE INDEX ON users USING gin (tags);
+    `);
+
+    expect(catalog.indexes).toStrictEqual([
+      {
+        schema: 'app',
+        name: 'users_email_idx',
+        table: 'users',
+        method: 'btree',
+        unique: true,
+        columns: ['lower(email)'],
+        predicate: 'deleted_at IS NULL',
+      },
+      {
+        schema: 'public',
+        name: null,
+        table: 'users',
+        method: 'gin',
+        unique: false,
+        columns: ['tags'],
+        predicate: null,
+      },
+    ]);
+  });
+
+  it('collects views', async () => {
+    const catalog = await catalogOf(`
+      CREATE VIEW active_users AS SELECT 1;
+      CREATE MATERIALIZED VIEW app.stats AS SELECT 1;
+    `);
+
+    expect(
+      catalog.tables.map(({ schema, name, kind }) => ({ schema, name, kind })),
+    ).toStrictEqual([
+      { schema: 'public', name: 'active_users', kind: 'view' },
+      { schema: 'app', name: 'stats', kind: 'materialized_view' },
+    ]);
+  });
+
+  it('collects types', async () => {
+    const catalog = await catalogOf(`
+      CREATE TYPE app.mood AS ENUM ('sad', 'happy');
+      CREATE TYPE point2d AS (x float8, y float8);
+      CREATE DOMAIN app.email AS text;
+    `);
+
+    expect(catalog.types).toStrictEqual([
+      { schema: 'app', name: 'mood', kind: 'enum', values: ['sad', 'happy'] },
+      {
+        schema: 'public',
+        name: 'point2d',
+        kind: 'composite',
+        attributes: [
+          { name: 'x', type: 'double precision' },
+          { name: 'y', type: 'double precision' },
+        ],
+      },
+      { schema: 'app', name: 'email', kind: 'domain', baseType: 'text' },
+    ]);
+  });
+
+  it('collects sequences and their owners', async () => {
+    const catalog = await catalogOf(`
+      CREATE SEQUENCE app.users_id_seq;
+      ALTER SEQUENCE app.users_id_seq OWNED BY app.users.id;
+      CREATE SEQUENCE counter;
+    `);
+
+    expect(catalog.sequences).toStrictEqual([
+      {
+        schema: 'app',
+        name: 'users_id_seq',
+        ownedBy: { schema: 'app', table: 'users', column: 'id' },
+      },
+      { schema: 'public', name: 'counter', ownedBy: null },
+    ]);
+  });
+
+  it('collects functions', async () => {
+    const catalog = await catalogOf(`
+      CREATE FUNCTION app.add(a int, b int) RETURNS int LANGUAGE sql AS 'SELECT a + b';
+      CREATE PROCEDURE cleanup(OUT removed int) LANGUAGE sql AS 'SELECT 1';
+    `);
+
+    expect(catalog.functions).toStrictEqual([
+      {
+        schema: 'app',
+        name: 'add',
+        kind: 'function',
+        arguments: [
+          { name: 'a', type: 'int', mode: 'in' },
+          { name: 'b', type: 'int', mode: 'in' },
+        ],
+        returns: 'int',
+      },
+      {
+        schema: 'public',
+        name: 'cleanup',
+        kind: 'procedure',
+        arguments: [{ name: 'removed', type: 'int', mode: 'out' }],
+        returns: null,
+      },
+    ]);
+  });
+
+  it('replaces objects created again instead of duplicating them', async () => {
+    const catalog = await catalogOf(`
+      CREATE VIEW active_users AS SELECT 1 AS id;
+      CREATE OR REPLACE VIEW active_users AS SELECT 1 AS id, 2 AS n;
+      CREATE FUNCTION add(a int, b int) RETURNS int LANGUAGE sql AS 'SELECT a + b';
+      CREATE FUNCTION add(a text) RETURNS text LANGUAGE sql AS 'SELECT a';
+      CREATE OR REPLACE FUNCTION add(x int, y int) RETURNS int LANGUAGE sql AS 'SELECT x + y';
+    `);
+
+    expect(catalog.tables.map(({ name }) => name)).toStrictEqual([
+      'active_users',
+    ]);
+    expect(
+      catalog.functions.map(({ arguments: args }) =>
+        args.map(({ name }) => name),
+      ),
+    ).toStrictEqual([['x', 'y'], ['a']]);
+  });
+
+  it('keeps the first definition for IF NOT EXISTS', async () => {
+    const catalog = await catalogOf(`
+      CREATE TABLE users (id int);
+      CREATE TABLE IF NOT EXISTS users (id int, name text);
+      ALTER TABLE users ADD COLUMN email text;
+      CREATE SEQUENCE counter;
+      CREATE SEQUENCE IF NOT EXISTS counter;
+      CREATE INDEX users_id_idx ON users (id);
+      CREATE INDEX IF NOT EXISTS users_id_idx ON users (id);
+    `);
+
+    expect(catalog.tables).toHaveLength(1);
+    expect(catalog.tables[0]!.columns.map(({ name }) => name)).toStrictEqual([
+      'id',
+      'email',
+    ]);
+    expect(catalog.sequences).toHaveLength(1);
+    expect(catalog.indexes).toHaveLength(1);
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.buildCatalog('CREATE TABLE (');
+
+    expect(result.catalog).toBeUndefined();
+    expect(result.error?.message).toMatch(/syntax error/);
+  });
+
+  it('builds a catalog from a pg_dump schema', async () => {
+    const catalog = await catalogOf(sqlDump);
+
+    expect(catalog.schemas).toHaveLength(10);
+    expect(catalog.tables).toHaveLength(35);
+    expect(catalog.indexes).toHaveLength(54);
+    expect(catalog.types).toHaveLength(10);
+    expect(catalog.sequences).toHaveLength(2);
+    expect(catalog.functions).toHaveLength(47);
+
+    const refreshTokens = catalog.tables.find(
+      (table) => table.schema === 'auth' && table.name === 'refresh_tokens',
+    );
+
+    expect(refreshTokens!.columns.find((c) => c.name === 'id')).toStrictEqual({
+      name: 'id',
+      type: 'bigint',
+      notNull: true,
+      default: "nextval('auth.refresh_tokens_id_seq'::regclass)",
+    });
+    const constraintTypes = refreshTokens!.constraints.map((c) => c.type);
+    expect(constraintTypes.sort()).toStrictEqual([
+      'foreign_key',
+      'primary_key',
+      'unique',
+    ]);
+
+    const sequence = catalog.sequences.find(
+      (sequence) => sequence.name === 'refresh_tokens_id_seq',
+    );
+    expect(sequence!.ownedBy).toStrictEqual({
+      schema: 'auth',
+      table: 'refresh_tokens',
+      column: 'id',
+    });
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.buildCatalog(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.buildCatalog(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,189 @@
+/// <reference types="node" />
+
+import { mkdir, mkdtemp, rm, writeFile } from 'node:fs/promises';
+import { tmpdir } from 'node:os';
+import { join } from 'node:path';
+import { afterAll, beforeAll, describe, expect, it } from 'vitest';
+import { createInlineWorker, HANG } from '../../test/utils/pool.js';
+import { PgParserPool } from '../pool.js';
+import {
+  checkFiles,
+  findSqlFiles,
+  formatCheckSummary,
+  formatNdjsonResult,
+  type FileResult,
+} from './check.js';
+
+describe('check', () => {
+  let dir: string;
+
+  beforeAll(async () => {
+    dir = await mkdtemp(join(tmpdir(), 'pg-parser-check-'));
+    await mkdir(join(dir, 'nested'));
+    await writeFile(join(dir, 'a.sql'), 'SELECT 1; SELECT 2;');
+    await writeFile(join(dir, 'b.sql'), 'SELECT FROM WHERE');
+    await writeFile(join(dir, 'nested', 'c.sql'), 'CREATE TABLE t (id int);');
+    await writeFile(join(dir, 'notes.txt'), 'not sql');
+  });
+
+  afterAll(async () => {
+    await rm(dir, { recursive: true, force: true });
+  });
+
+  it('finds sql files recursively', async () => {
+    expect(await findSqlFiles(dir)).toStrictEqual([
+      join(dir, 'a.sql'),
+      join(dir, 'b.sql'),
+      join(dir, 'nested', 'c.sql'),
+    ]);
+  });
+
+  it.each([15, 16, 17])('reports results and errors (v%i)', async (version) => {
+    const pool = new PgParserPool({
+      version,
+      size: 2,
+      createWorker: createInlineWorker(),
+    });
+    const streamed: FileResult[] = [];
+
+    try {
+      const report = await checkFiles(pool, await findSqlFiles(dir), {
+        onResult: (result) => streamed.push(result),
+      });
+
+      expect(report.version).toBe(version);
+      expect(report.jobs).toBe(2);
+      expect(report.fileCount).toBe(3);
+      expect(report.errorCount).toBe(1);
+      expect(report.bytes).toBe(19 + 17 + 24);
+      expect(report.filesPerSecond).toBeGreaterThan(0);
+      expect(report.slowest).toHaveLength(3);
+      expect(streamed).toHaveLength(3);
+
+      const byName = (name: string) =>
+        streamed.find((result) => result.file.endsWith(name))!;
+
+      expect(byName('a.sql').statements).toBe(2);
+      expect(byName('c.sql').statements).toBe(1);
+      expect(byName('b.sql').statements).toBeUndefined();
+      expect(byName('b.sql').error).toStrictEqual({
+        message: 'syntax error at or near "FROM"',
+        position: 7,
+      });
+    } finally {
+      await pool.destroy();
+    }
+  });
+
+  it('reports a file that times out and keeps going', async () => {
+    const hangDir = await mkdtemp(join(tmpdir(), 'pg-parser-check-'));
+    await writeFile(join(hangDir, 'a.sql'), `SELECT 1 ${HANG}`);
+    await writeFile(join(hangDir, 'b.sql'), 'SELECT 1; SELECT 2;');
+
+    const pool = new PgParserPool({
+      size: 1,
+      createWorker: createInlineWorker(),
+    });
+    const streamed: FileResult[] = [];
+
+    try {
+      const report = await checkFiles(pool, await findSqlFiles(hangDir), {
+        timeoutMs: 50,
+        onResult: (result) => streamed.push(result),
+      });
+
+      expect(report.fileCount).toBe(2);
+      expect(report.errorCount).toBe(1);
+      expect(
+        streamed.map(({ statements, error }) => ({ statements, error })),
+      ).toStrictEqual([
+        {
+          statements: undefined,
+          error: { message: 'countStatements timed out after 50ms' },
+        },
+        { statements: 2, error: undefined },
+      ]);
+    } finally {
+      await pool.destroy();
+      await rm(hangDir, { recursive: true, force: true });
+    }
+  });
+
+  it('reports a file that cannot be read and keeps going', async () => {
+    const pool = new PgParserPool({
+      size: 1,
+      createWorker: createInlineWorker(),
+    });
+    const missing = join(dir, 'missing.sql');
+    const streamed: FileResult[] = [];
+
+    try {
+      const report = await checkFiles(pool, [missing, join(dir, 'a.sql')], {
+        onResult: (result) => streamed.push(result),
+      });
+
+      expect(report.fileCount).toBe(2);
+      expect(report.errorCount).toBe(1);
+      expect(streamed[0]).toMatchObject({
+        file: missing,
+        bytes: 0,
+        statements: undefined,
+        error: { message: expect.stringContaining('ENOENT') },
+      });
+      expect(streamed[1]!.statements).toBe(2);
+    } finally {
+      await pool.destroy();
+    }
+  });
+
+  it('limits slowest files to top', async () => {
+    const pool = new PgParserPool({
+      size: 1,
+      createWorker: createInlineWorker(),
+    });
+    const streamed: FileResult[] = [];
+
+    try {
+      const report = await checkFiles(pool, await findSqlFiles(dir), {
+        top: 1,
+        onResult: (result) => streamed.push(result),
+      });
+
+      expect(report.fileCount).toBe(3);
+      expect(report.slowest).toHaveLength(1);
+      expect(report.slowest[0]!.ms).toBe(
+        Math.max(...streamed.map(({ ms }) => ms)),
+      );
+    } finally {
+      await pool.destroy();
+    }
+  });
+
+  it('formats ndjson results and a summary', async () => {
+    const pool = new PgParserPool({
+      size: 2,
+      createWorker: createInlineWorker(),
+    });
+
+    try {
+      const results: FileResult[] = [];
+      const report = await checkFiles(pool, await findSqlFiles(dir), {
+        onResult: (result) => results.push(result),
+      });
+
+      const lines = results.map(formatNdjsonResult);
+      for (const line of lines) {
+        expect(line).not.toContain('\n');
+        expect(JSON.parse(line).file).toMatch(/\.sql$/);
+      }
+
+      const summary = formatCheckSummary(report);
+      expect(summary).toContain('Checked 3 files (60 bytes) with 2 workers');
+      expect(summary).toContain('1 failed');
+      expect(summary).toMatch(/files\/s, [\d.]+ MB\/s/);
+      expect(summary).toContain('Top 3 slowest files:');
+    } finally {
+      await pool.destroy();
+    }
+  });
+});
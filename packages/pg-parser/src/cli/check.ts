@@ -0,0 +1,204 @@
+/// <reference types="node" />
+
+import { readdir, readFile } from 'node:fs/promises';
+import { join } from 'node:path';
+import { ParseError } from '../errors.js';
+import type { PgParserPool } from '../pool.js';
+import type { SupportedVersion } from '../types/index.js';
+
+export type CheckOptions = {
+  /**
+   * Number of slowest files to include in the report.
+   * Defaults to 10.
+   */
+  top?: number;
+
+  /**
+   * Maximum time in milliseconds to spend on one file. A file that times
+   * out is reported as failed and its worker is replaced.
+   */
+  timeoutMs?: number;
+
+  /**
+   * Called with each file's result as soon as it is parsed,
+   * in completion order.
+   */
+  onResult?: (result: FileResult) => void;
+};
+
+export type FileResult = {
+  /** Path of the file, as passed in */
+  file: string;
+  /** Size of the file in bytes */
+  bytes: number;
+  /** Time from sending the file to a worker to getting its result, in ms */
+  ms: number;
+  /** Number of statements, if the file parsed */
+  statements: number | undefined;
+  /**
+   * Parse error, if any. Failures other than syntax errors (an unreadable
+   * file, a timeout, a crashed worker) have no position.
+   */
+  error: { message: string; position?: number } | undefined;
+};
+
+export type CheckReport = {
+  version: SupportedVersion;
+  jobs: number;
+  fileCount: number;
+  errorCount: number;
+  bytes: number;
+  /** Wall-clock time for the whole run in ms */
+  elapsedMs: number;
+  filesPerSecond: number;
+  megabytesPerSecond: number;
+  slowest: FileResult[];
+};
+
+/**
+ * Recursively lists the `.sql` files under `dir`, sorted by path.
+ */
+export async function findSqlFiles(dir: string) {
+  const files: string[] = [];
+
+  async function visit(dir: string) {
+    const entries = await readdir(dir, { withFileTypes: true });
+
+    for (const entry of entries) {
+      const path = join(dir, entry.name);
+      if (entry.isDirectory()) {
+        await visit(path);
+      } else if (entry.isFile() && entry.name.endsWith('.sql')) {
+        files.push(path);
+      }
+    }
+  }
+
+  await visit(dir);
+  return files.sort();
+}
+
+/**
+ * Parses every file on the pool's workers and reports throughput and
+ * the `top` slowest files.
+ *
+ * One file per worker is in flight at a time, so files are read from
+ * disk only as workers free up and per-file times don't include time
+ * spent queued behind other files.
+ */
+export async function checkFiles<Version extends SupportedVersion>(
+  pool: PgParserPool<Version>,
+  files: string[],
+  { top = 10, timeoutMs, onResult }: CheckOptions = {}
+): Promise<CheckReport> {
+  const results: FileResult[] = [];
+  const start = performance.now();
+  let next = 0;
+
+  async function checkFile(file: string): Promise<FileResult> {
+    let data: Buffer;
+    try {
+      data = await readFile(file);
+    } catch (error) {
+      // A file that vanished or can't be read fails on its own
+      // instead of aborting the whole run
+      return {
+        file,
+        bytes: 0,
+        ms: 0,
+        statements: undefined,
+        error: { message: (error as Error).message },
+      };
+    }
+
+    const parseStart = performance.now();
+    const { statements, error } = await pool
+      .countStatements(data.toString('utf8'), { timeoutMs })
+      .catch((error: Error) => ({ statements: undefined, error }));
+    const ms = performance.now() - parseStart;
+
+    return {
+      file,
+      bytes: data.byteLength,
+      ms,
+      statements,
+      error: error
+        ? error instanceof ParseError
+          ? { message: error.message, position: error.position }
+          : { message: error.message }
+        : undefined,
+    };
+  }
+
+  async function runLane() {
+    while (next < files.length) {
+      const result = await checkFile(files[next++]!);
+      results.push(result);
+      onResult?.(result);
+    }
+  }
+
+  const lanes = Math.min(pool.size, files.length);
+  await Promise.all(Array.from({ length: lanes }, runLane));
+
+  const elapsedMs = performance.now() - start;
+  const bytes = results.reduce((sum, result) => sum + result.bytes, 0);
+  const seconds = elapsedMs / 1000;
+
+  return {
+    version: pool.version,
+    jobs: pool.size,
+    fileCount: results.length,
+    errorCount: results.filter((result) => result.error).length,
+    bytes,
+    elapsedMs,
+    filesPerSecond: seconds > 0 ? results.length / seconds : 0,
+    megabytesPerSecond: seconds > 0 ? bytes / 1_000_000 / seconds : 0,
+    slowest: [...results].sort((a, b) => b.ms - a.ms).slice(0, top),
+  };
+}
+
+/**
+ * Formats a file result as one line of NDJSON (without the newline).
+ */
+export function formatNdjsonResult(result: FileResult) {
+  return JSON.stringify(result);
+}
+
+/**
+ * Formats the throughput summary and slowest files as text.
+ */
+export function formatCheckSummary(report: CheckReport) {
+  const lines = [
+    `Checked ${report.fileCount} files (${report.bytes} bytes) with ${report.jobs} workers (Postgres ${report.version}): ${report.errorCount} failed`,
+    `Elapsed ${report.elapsedMs.toFixed(1)} ms: ${report.filesPerSecond.toFixed(1)} files/s, ${report.megabytesPerSecond.toFixed(2)} MB/s`,
+  ];
+
+  if (report.slowest.length > 0) {
+    lines.push('', `Top ${report.slowest.length} slowest files:`);
+
+    const rows = report.slowest.map((result) => [
+      result.ms.toFixed(3),
+      String(result.bytes),
+      result.error ? 'error' : String(result.statements),
+      result.file,
+    ]);
+    const header = ['ms', 'bytes', 'stmts', 'file'];
+
+    const widths = header.map((column, i) =>
+      Math.max(column.length, ...rows.map((row) => row[i]!.length))
+    );
+
+    // Left-align the trailing file column, right-align the numbers
+    const formatRow = (row: string[]) =>
+      row
+        .map((cell, i) =>
+          i === row.length - 1 ? cell : cell.padStart(widths[i]!)
+        )
+        .join('  ');
+
+    lines.push(formatRow(header), ...rows.map(formatRow));
+  }
+
+  return lines.join('\n');
+}
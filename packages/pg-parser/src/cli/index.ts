@@ -0,0 +1,149 @@
+#!/usr/bin/env node
+/// <reference types="node" />
+
+import { readFile } from 'node:fs/promises';
+import { availableParallelism } from 'node:os';
+import { parseArgs } from 'node:util';
+import { PgParser } from '../pg-parser.js';
+import { PgParserPool } from '../pool.js';
+import { isSupportedVersion } from '../util.js';
+import {
+  checkFiles,
+  findSqlFiles,
+  formatCheckSummary,
+  formatNdjsonResult,
+} from './check.js';
+import {
+  formatJsonReport,
+  formatTextReport,
+  profileSql,
+} from './profile.js';
+
+const USAGE = `Usage: pg-parser <command> [options]
+
+Commands:
+  profile <file.sql>   Time parse, JSON generation and deparse per statement
+  check <dir>          Parse every .sql file under dir in parallel, streaming
+                       NDJSON results to stdout and a summary to stderr
+
+Options:
+  -v, --version <n>    Postgres version to parse with (15, 16, 17). Defaults to 17
+  -n, --top <n>        Number of slowest statements or files to report. Defaults to 10
+  -j, --jobs <n>       Number of parser workers for check. Defaults to the CPU count
+  -t, --timeout <ms>   Fail a file in check that takes longer than ms to parse
+  -r, --reporter <r>   Output format: text or json. Defaults to text
+  -h, --help           Show this message
+`;
+
+async function main(argv: string[]) {
+  const { values, positionals } = parseArgs({
+    args: argv,
+    allowPositionals: true,
+    options: {
+      version: { type: 'string', short: 'v', default: '17' },
+      top: { type: 'string', short: 'n', default: '10' },
+      reporter: { type: 'string', short: 'r', default: 'text' },
+      jobs: { type: 'string', short: 'j' },
+      timeout: { type: 'string', short: 't' },
+      help: { type: 'boolean', short: 'h' },
+    },
+  });
+
+  const [command, ...args] = positionals;
+
+  if (values.help || !command) {
+    process.stdout.write(USAGE);
+    return;
+  }
+
+  const version = parseInt(values.version, 10);
+  if (!isSupportedVersion(version)) {
+    throw new Error(`unsupported version: ${values.version}`);
+  }
+
+  const top = parseInt(values.top, 10);
+  if (!Number.isInteger(top) || top < 1) {
+    throw new Error(`invalid --top: ${values.top}`);
+  }
+
+  switch (command) {
+    case 'profile': {
+      const [file] = args;
+      if (!file) {
+        throw new Error('profile requires a file argument');
+      }
+
+      const sql = await readFile(file, 'utf8');
+      const parser = new PgParser({ version });
+      const report = await profileSql(parser, sql, { top });
+
+      switch (values.reporter) {
+        case 'text':
+          process.stdout.write(formatTextReport(report, file) + '\n');
+          break;
+        case 'json':
+          process.stdout.write(formatJsonReport(report) + '\n');
+          break;
+        default:
+          throw new Error(`unknown reporter: ${values.reporter}`);
+      }
+      break;
+    }
+    case 'check': {
+      const [dir] = args;
+      if (!dir) {
+        throw new Error('check requires a directory argument');
+      }
+
+      const jobs = values.jobs
+        ? parseInt(values.jobs, 10)
+        : availableParallelism();
+      if (!Number.isInteger(jobs) || jobs < 1) {
+        throw new Error(`invalid --jobs: ${values.jobs}`);
+      }
+
+      const timeoutMs = values.timeout
+        ? parseInt(values.timeout, 10)
+        : undefined;
+      if (
+        timeoutMs !== undefined &&
+        (!Number.isInteger(timeoutMs) || timeoutMs < 1)
+      ) {
+        throw new Error(`invalid --timeout: ${values.timeout}`);
+      }
+
+      const files = await findSqlFiles(dir);
+      const pool = new PgParserPool({
+        version,
+        size: Math.max(Math.min(jobs, files.length), 1),
+      });
+
+      try {
+        const report = await checkFiles(pool, files, {
+          top,
+          timeoutMs,
+          onResult: (result) =>
+            process.stdout.write(formatNdjsonResult(result) + '\n'),
+        });
+
+        process.stderr.write(formatCheckSummary(report) + '\n');
+
+        if (report.errorCount > 0) {
+          process.exitCode = 1;
+        }
+      } finally {
+        await pool.destroy();
+      }
+      break;
+    }
+    default:
+      throw new Error(`unknown command: ${command}\n\n${USAGE}`);
+  }
+}
+
+main(process.argv.slice(2)).catch((error: unknown) => {
+  process.stderr.write(
+    `pg-parser: ${error instanceof Error ? error.message : String(error)}\n`
+  );
+  process.exitCode = 1;
+});
@@ -0,0 +1,98 @@
+import { stripIndent } from 'common-tags';
+import { describe, expect, it } from 'vitest';
+import { PgParser } from '../pg-parser.js';
+import {
+  formatJsonReport,
+  formatTextReport,
+  measureTree,
+  profileSql,
+} from './profile.js';
+
+describe('measureTree', () => {
+  it('counts nodes and depth', () => {
+    const { nodeCount, maxDepth } = measureTree({
+      version: 170004,
+      stmts: [
+        {
+          stmt: {
+            SelectStmt: {
+              targetList: [
+                { ResTarget: { val: { A_Const: { ival: { ival: 1 } } } } },
+              ],
+            },
+          },
+        },
+      ],
+    });
+
+    expect(nodeCount).toBe(3);
+    expect(maxDepth).toBe(3);
+  });
+});
+
+describe.each([15, 16, 17])('profileSql (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  const sql = stripIndent`
+    SELECT 1;
+
+    SELECT a, b FROM t WHERE a = 1 AND b IN (SELECT c FROM u);
+    CREATE TABLE users (id int PRIMARY KEY, name text);
+  `;
+
+  it('reports every statement with timings and tree stats', async () => {
+    const report = await profileSql(pgParser, sql, { top: 10 });
+
+    expect(report.version).toBe(version);
+    expect(report.statementCount).toBe(3);
+    expect(report.slowest).toHaveLength(3);
+
+    for (const profile of report.slowest) {
+      expect(profile.parseMs).toBeGreaterThanOrEqual(0);
+      expect(profile.jsonMs).toBeGreaterThanOrEqual(0);
+      expect(profile.deparseMs).toBeGreaterThanOrEqual(0);
+      expect(profile.nodeCount).toBeGreaterThan(0);
+      expect(profile.jsonBytes).toBeGreaterThan(0);
+      expect(profile.error).toBeUndefined();
+    }
+
+    const select = report.slowest.find((p) => p.text.startsWith('SELECT a'));
+    expect(select?.line).toBe(3);
+    expect(select?.maxDepth).toBeGreaterThan(3);
+  });
+
+  it('skips form feeds and vertical tabs before a statement', async () => {
+    const report = await profileSql(pgParser, 'SELECT 1;\n\f\v\nSELECT 2');
+    const second = report.slowest.find((p) => p.text === 'SELECT 2');
+
+    expect(second?.line).toBe(3);
+  });
+
+  it('sorts by total time and limits to top', async () => {
+    const report = await profileSql(pgParser, sql, { top: 2 });
+
+    expect(report.slowest).toHaveLength(2);
+    expect(report.slowest[0]!.totalMs).toBeGreaterThanOrEqual(
+      report.slowest[1]!.totalMs,
+    );
+  });
+
+  it('records parse errors per statement', async () => {
+    const report = await profileSql(pgParser, 'SELECT 1; SELECT FROM WHERE;');
+    const failed = report.slowest.find((p) => p.error);
+
+    expect(failed?.error).toContain('syntax error');
+    expect(failed?.deparseMs).toBeUndefined();
+  });
+
+  it('formats text and json reports', async () => {
+    const report = await profileSql(pgParser, sql);
+
+    const text = formatTextReport(report, 'schema.sql');
+    expect(text).toContain('Profiled 3 statements in schema.sql');
+    expect(text).toContain('CREATE TABLE users');
+
+    const json = JSON.parse(formatJsonReport(report));
+    expect(json.statementCount).toBe(3);
+  });
+});
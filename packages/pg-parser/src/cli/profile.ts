@@ -0,0 +1,257 @@
+import type { PgParser } from '../pg-parser.js';
+import type { SupportedVersion } from '../types/index.js';
+
+const textEncoder = new TextEncoder();
+
+export type ProfileOptions = {
+  /**
+   * Number of slowest statements to include in the report.
+   * Defaults to 10.
+   */
+  top?: number;
+};
+
+export type StatementProfile = {
+  /** Zero-based index of the statement in the file */
+  index: number;
+  /** One-based line number where the statement starts */
+  line: number;
+  /** Start byte offset of the statement in the file */
+  start: number;
+  /** End byte offset of the statement in the file */
+  end: number;
+  /** The statement text */
+  text: string;
+  /** Native parse time (SQL to protobuf) in ms */
+  parseMs: number;
+  /** Native JSON generation time (protobuf to JSON) in ms */
+  jsonMs: number;
+  /** Deparse time (AST to SQL, including serialization) in ms */
+  deparseMs: number | undefined;
+  /** Sum of all measured phases in ms */
+  totalMs: number;
+  /** Number of AST nodes in the statement */
+  nodeCount: number;
+  /** Maximum nesting depth of AST nodes */
+  maxDepth: number;
+  /** Size of the generated JSON in bytes */
+  jsonBytes: number;
+  /** Parse or deparse error message, if any */
+  error: string | undefined;
+};
+
+export type ProfileReport = {
+  version: SupportedVersion;
+  statementCount: number;
+  totals: {
+    parseMs: number;
+    jsonMs: number;
+    deparseMs: number;
+    jsonBytes: number;
+  };
+  slowest: StatementProfile[];
+};
+
+/**
+ * Splits `sql` into statements and times parse, JSON generation and
+ * deparse for each one. Returns the `top` slowest statements.
+ */
+export async function profileSql<Version extends SupportedVersion>(
+  parser: PgParser<Version>,
+  sql: string,
+  { top = 10 }: ProfileOptions = {}
+): Promise<ProfileReport> {
+  const { statements, error } = await parser.split(sql);
+
+  if (error) {
+    throw error;
+  }
+
+  const sqlBytes = textEncoder.encode(sql);
+  const profiles: StatementProfile[] = [];
+  const totals = { parseMs: 0, jsonMs: 0, deparseMs: 0, jsonBytes: 0 };
+
+  let line = 1;
+  let lineOffset = 0;
+
+  for (const [index, statement] of statements.entries()) {
+    // Skip leading whitespace so the line points at the statement itself
+    let start = statement.start;
+    while (start < statement.end && isWhitespace(sqlBytes[start]!)) {
+      start++;
+    }
+
+    for (; lineOffset < start; lineOffset++) {
+      if (sqlBytes[lineOffset] === 0x0a) {
+        line++;
+      }
+    }
+
+    const { parseMs, jsonMs, jsonBytes, tree, error } = await parser.profile(
+      statement.text
+    );
+
+    let deparseMs: number | undefined;
+    let nodeCount = 0;
+    let maxDepth = 0;
+    let errorMessage = error?.message;
+
+    // Reuse the tree from profile() rather than parsing again
+    if (tree) {
+      ({ nodeCount, maxDepth } = measureTree(tree));
+
+      const deparseStart = performance.now();
+      const deparseResult = await parser.deparse(tree);
+      deparseMs = performance.now() - deparseStart;
+
+      errorMessage = deparseResult.error?.message;
+    }
+
+    totals.parseMs += parseMs;
+    totals.jsonMs += jsonMs;
+    totals.deparseMs += deparseMs ?? 0;
+    totals.jsonBytes += jsonBytes;
+
+    profiles.push({
+      index,
+      line,
+      start: statement.start,
+      end: statement.end,
+      text: statement.text.trim(),
+      parseMs,
+      jsonMs,
+      deparseMs,
+      totalMs: parseMs + jsonMs + (deparseMs ?? 0),
+      nodeCount,
+      maxDepth,
+      jsonBytes,
+      error: errorMessage,
+    });
+  }
+
+  profiles.sort((a, b) => b.totalMs - a.totalMs);
+
+  return {
+    version: parser.version,
+    statementCount: statements.length,
+    totals,
+    slowest: profiles.slice(0, top),
+  };
+}
+
+/**
+ * Counts wrapped AST nodes (objects with a single PascalCase key)
+ * and their maximum nesting depth.
+ */
+export function measureTree(value: unknown) {
+  let nodeCount = 0;
+  let maxDepth = 0;
+
+  function visit(value: unknown, depth: number) {
+    if (Array.isArray(value)) {
+      for (const item of value) {
+        visit(item, depth);
+      }
+      return;
+    }
+
+    if (typeof value !== 'object' || value === null) {
+      return;
+    }
+
+    const keys = Object.keys(value);
+    const isNode = keys.length === 1 && /^[A-Z]/.test(keys[0]!);
+
+    if (isNode) {
+      nodeCount++;
+      depth++;
+      maxDepth = Math.max(maxDepth, depth);
+    }
+
+    for (const key of keys) {
+      visit((value as Record<string, unknown>)[key], depth);
+    }
+  }
+
+  visit(value, 0);
+
+  return { nodeCount, maxDepth };
+}
+
+/**
+ * Formats a profile report as a human-readable table.
+ */
+export function formatTextReport(report: ProfileReport, fileName?: string) {
+  const { totals } = report;
+  const lines = [
+    `Profiled ${report.statementCount} statements${fileName ? ` in ${fileName}` : ''} (Postgres ${report.version})`,
+    `Total: parse ${ms(totals.parseMs)}, json ${ms(totals.jsonMs)}, deparse ${ms(totals.deparseMs)}, ${totals.jsonBytes} JSON bytes`,
+    '',
+    `Top ${report.slowest.length} slowest statements:`,
+  ];
+
+  const header = [
+    'line',
+    'total ms',
+    'parse ms',
+    'json ms',
+    'deparse ms',
+    'nodes',
+    'depth',
+    'json bytes',
+    'statement',
+  ];
+
+  const rows = report.slowest.map((profile) => [
+    String(profile.line),
+    profile.totalMs.toFixed(3),
+    profile.parseMs.toFixed(3),
+    profile.jsonMs.toFixed(3),
+    profile.deparseMs?.toFixed(3) ?? '-',
+    String(profile.nodeCount),
+    String(profile.maxDepth),
+    String(profile.jsonBytes),
+    preview(profile),
+  ]);
+
+  const widths = header.map((column, i) =>
+    Math.max(column.length, ...rows.map((row) => row[i]!.length))
+  );
+
+  // Left-align the trailing statement column, right-align the numbers
+  const formatRow = (row: string[]) =>
+    row
+      .map((cell, i) =>
+        i === row.length - 1 ? cell : cell.padStart(widths[i]!)
+      )
+      .join('  ');
+
+  lines.push(formatRow(header), ...rows.map(formatRow));
+
+  return lines.join('\n');
+}
+
+/**
+ * Formats a profile report as JSON.
+ */
+export function formatJsonReport(report: ProfileReport) {
+  return JSON.stringify(report, null, 2);
+}
+
+function preview({ text, error }: StatementProfile, maxLength = 60) {
+  const condensed = text.replace(/\s+/g, ' ');
+  const truncated =
+    condensed.length > maxLength
+      ? `${condensed.slice(0, maxLength - 3)}...`
+      : condensed;
+  return error ? `${truncated} [error: ${error}]` : truncated;
+}
+
+function ms(value: number) {
+  return `${value.toFixed(3)} ms`;
+}
+
+// Postgres' scanner whitespace: space, \t, \n, \v, \f and \r
+function isWhitespace(byte: number) {
+  return byte === 0x20 || (byte >= 0x09 && byte <= 0x0d);
+}
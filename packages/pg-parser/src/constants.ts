@@ -1 +1,27 @@
 export const SUPPORTED_VERSIONS = [15, 16, 17] as const;
+
+/**
+ * Index of each value in the per-statement arrays returned by `metrics()`.
+ *
+ * @example
+ * const { metrics } = await parser.metrics(sql);
+ * const joins = metrics[0][QueryMetric.joins];
+ */
+export const QueryMetric = {
+  /** Number of AST nodes */
+  nodes: 0,
+  /** Maximum nesting depth of the AST */
+  depth: 1,
+  /** Explicit `JOIN`s plus implicit joins from `FROM a, b` */
+  joins: 2,
+  /** Subqueries in expressions (`SubLink`) and in `FROM` (`RangeSubselect`) */
+  subqueries: 3,
+  /** Common table expressions (`WITH`) */
+  ctes: 4,
+  /** `UNION`, `INTERSECT` and `EXCEPT` operations */
+  setOperations: 5,
+  /** Function calls, including aggregates and window functions */
+  functions: 6,
+} as const;
+
+export type QueryMetric = (typeof QueryMetric)[keyof typeof QueryMetric];
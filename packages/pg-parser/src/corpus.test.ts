@@ -0,0 +1,75 @@
+import { describe, expect, it } from 'vitest';
+import {
+  type Complexity,
+  WORKLOADS,
+} from '../test/corpus/workloads.js';
+import { measureTree } from './cli/profile.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapParseResult } from './util.js';
+
+/**
+ * Accepted ratio of `measure(2 * size) / measure(size)` per complexity class.
+ * Loose enough to absorb constant overhead (e.g. the SELECT wrapping a
+ * deep expression), tight enough to catch accidental quadratic growth.
+ */
+const RATIO_BOUNDS: Record<Complexity, [number, number]> = {
+  constant: [0.9, 1.1],
+  linear: [1.7, 2.3],
+};
+
+function expectComplexity(
+  measurement: string,
+  complexity: Complexity,
+  small: number,
+  large: number,
+) {
+  const [min, max] = RATIO_BOUNDS[complexity];
+  const ratio = large / small;
+
+  expect(
+    ratio,
+    `${measurement} grew ${ratio.toFixed(2)}x, expected ${complexity}`,
+  ).toBeGreaterThanOrEqual(min);
+  expect(
+    ratio,
+    `${measurement} grew ${ratio.toFixed(2)}x, expected ${complexity}`,
+  ).toBeLessThanOrEqual(max);
+}
+
+describe.each([15, 16, 17])('scaling corpus (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function measure(sql: string) {
+    const tree = await unwrapParseResult(pgParser.parse(sql));
+    const { nodeCount, maxDepth } = measureTree(tree);
+    return {
+      statements: tree.stmts?.length ?? 0,
+      nodes: nodeCount,
+      depth: maxDepth,
+      jsonBytes: JSON.stringify(tree).length,
+    };
+  }
+
+  it.each(WORKLOADS.map((workload) => [workload.name, workload] as const))(
+    '%s scales as documented',
+    async (_, workload) => {
+      const size = workload.testSize;
+      const expected = workload.expect(size);
+
+      const small = await measure(workload.generate(size));
+      const large = await measure(workload.generate(size * 2));
+
+      expect(small.statements).toBe(expected.statements);
+      expect(large.statements).toBe(workload.expect(size * 2).statements);
+
+      expectComplexity('nodes', expected.nodes, small.nodes, large.nodes);
+      expectComplexity('depth', expected.depth, small.depth, large.depth);
+      expectComplexity(
+        'jsonBytes',
+        expected.jsonBytes,
+        small.jsonBytes,
+        large.jsonBytes,
+      );
+    },
+  );
+});
@@ -0,0 +1,154 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { PgParser } from './pg-parser.js';
+import { unwrapDependencyGraphResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('buildDependencyGraph (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function graphOf(sql: string) {
+    return await unwrapDependencyGraphResult(
+      pgParser.buildDependencyGraph(sql),
+    );
+  }
+
+  async function dependenciesOf(sql: string) {
+    const graph = await graphOf(sql);
+    return graph.statements.map(({ dependsOn }) => dependsOn);
+  }
+
+  it('orders statements after the objects they reference', async () => {
+    const graph = await graphOf(`
+      CREATE TABLE users (id int PRIMARY KEY);
+      CREATE TABLE orders (id int, user_id int REFERENCES users (id));
+      CREATE VIEW active_users AS SELECT * FROM users;
+      CREATE TABLE tags (id int);
+    `);
+
+    expect(graph.statements.map(({ dependsOn }) => dependsOn)).toStrictEqual([
+      [],
+      [0],
+      [0],
+      [],
+    ]);
+    expect(graph.layers).toStrictEqual([
+      [0, 3],
+      [1, 2],
+    ]);
+  });
+
+  it('returns statement text and offsets', async () => {
+    const sql = '-- users\nCREATE TABLE users (id int);\n\nSELECT 1;';
+    const graph = await graphOf(sql);
+
+    expect(
+      graph.statements.map(({ text, start, end }) => ({ text, start, end })),
+    ).toStrictEqual([
+      { text: 'CREATE TABLE users (id int)', start: 9, end: 36 },
+      { text: 'SELECT 1', start: 39, end: 47 },
+    ]);
+  });
+
+  it('orders writes after earlier reads', async () => {
+    const dependencies = await dependenciesOf(`
+      CREATE TABLE users (id int);
+      CREATE INDEX users_id_idx ON users (id);
+      ALTER TABLE users ADD COLUMN email text;
+    `);
+
+    expect(dependencies).toStrictEqual([[], [0], [0, 1]]);
+  });
+
+  it('orders foreign keys after the unique index they reference', async () => {
+    const dependencies = await dependenciesOf(`
+      CREATE TABLE users (id int, email text);
+      CREATE TABLE orders (id int, user_email text);
+      CREATE UNIQUE INDEX users_email_key ON users (email);
+      ALTER TABLE orders ADD FOREIGN KEY (user_email) REFERENCES users (email);
+    `);
+
+    expect(dependencies).toStrictEqual([[], [], [0], [1, 2]]);
+  });
+
+  it('tracks schemas, types and functions', async () => {
+    const dependencies = await dependenciesOf(`
+      CREATE SCHEMA app;
+      CREATE TYPE app.mood AS ENUM ('sad', 'happy');
+      CREATE FUNCTION app.today() RETURNS date LANGUAGE sql AS 'SELECT current_date';
+      CREATE TABLE app.entries (mood app.mood, day date DEFAULT app.today());
+    `);
+
+    expect(dependencies).toStrictEqual([[], [0], [0], [0, 1, 2]]);
+  });
+
+  it('tracks sequences referenced through regclass casts', async () => {
+    const dependencies = await dependenciesOf(`
+      CREATE SEQUENCE "Users_id_seq";
+      CREATE TABLE users (id bigint DEFAULT nextval('"Users_id_seq"'::regclass));
+    `);
+
+    expect(dependencies).toStrictEqual([[], [0]]);
+  });
+
+  it('orders barriers against all other statements', async () => {
+    const graph = await graphOf(`
+      CREATE TABLE a (id int);
+      CREATE TABLE b (id int);
+      SET search_path = app;
+      CREATE TABLE c (id int);
+      CREATE TABLE d (id int);
+    `);
+
+    expect(graph.statements.map(({ barrier }) => barrier)).toStrictEqual([
+      false,
+      false,
+      true,
+      false,
+      false,
+    ]);
+    expect(graph.layers).toStrictEqual([[0, 1], [2], [3, 4]]);
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.buildDependencyGraph('CREATE TABLE (');
+
+    expect(result.graph).toBeUndefined();
+    expect(result.error?.message).toMatch(/syntax error/);
+  });
+
+  it('builds a graph for a pg_dump schema', async () => {
+    const graph = await graphOf(sqlDump);
+    const { statements, layers } = graph;
+
+    expect(layers.length).toBeLessThan(statements.length);
+    expect(layers.flat()).toHaveLength(statements.length);
+    statements.forEach(({ dependsOn }, index) => {
+      expect(dependsOn.every((dependency) => dependency < index)).toBe(true);
+    });
+
+    const createSequence = statements.findIndex(({ text }) =>
+      text.startsWith('CREATE SEQUENCE auth.refresh_tokens_id_seq'),
+    );
+    const setDefault = statements.findIndex(({ text }) =>
+      text.includes("nextval('auth.refresh_tokens_id_seq'::regclass)"),
+    );
+
+    expect(statements[setDefault]!.layer).toBeGreaterThan(
+      statements[createSequence]!.layer,
+    );
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.buildDependencyGraph(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.buildDependencyGraph(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
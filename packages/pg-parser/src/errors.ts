@@ -1,8 +1,24 @@
-export type ParseErrorType = 'syntax' | 'semantic' | 'unknown';
+export type ParseErrorType = 'syntax' | 'semantic' | 'limit' | 'unknown';
+
+export type ParseLimitName = 'bytes' | 'tokens' | 'statements' | 'depth';
+
+export type ParseLimitViolation = {
+  /**
+   * The limit that was exceeded.
+   */
+  name: ParseLimitName;
+
+  /**
+   * The configured value of the limit.
+   */
+  max: number;
+};
 
 export type ParseErrorDetails = {
   type: ParseErrorType;
   position: number;
+  limit?: ParseLimitViolation;
+  query?: number;
 };
 
 export class ParseError extends Error {
@@ -19,6 +35,9 @@ export class ParseError extends Error {
    *   numeric range checking (e.g., column numbers must be between 1 and 32767
    *   in ALTER INDEX statements).
    *
+   * - `limit`: The input exceeded one of the `limits` passed to `parse()` and was
+   *   rejected before parsing. See `limit` for which one.
+   *
    * - `unknown`: An unknown error type, typically representing an internal parser error.
    *
    * Note: The vast majority of semantic validation (type checking, schema validation,
@@ -33,10 +52,30 @@ export class ParseError extends Error {
    */
   position: number;
 
-  constructor(message: string, { type, position }: ParseErrorDetails) {
+  /**
+   * Set when `type` is `limit`: which admission limit was exceeded.
+   */
+  limit?: ParseLimitViolation;
+
+  /**
+   * Set by batch operations that fail as a whole, like `createArchive()`:
+   * the index of the query that failed. `position` is within that query.
+   */
+  query?: number;
+
+  constructor(
+    message: string,
+    { type, position, limit, query }: ParseErrorDetails
+  ) {
     super(message);
     this.type = type;
     this.position = position;
+    if (limit) {
+      this.limit = limit;
+    }
+    if (query !== undefined) {
+      this.query = query;
+    }
   }
 }
 
@@ -85,6 +124,40 @@ export class ScanError extends Error {
   }
 }
 
+/**
+ * An error thrown when the WASM instance traps during a call (e.g. an
+ * Emscripten abort, out of memory, or stack overflow).
+ *
+ * A trapped instance can't be used again, so `PgParser` replaces it with
+ * a fresh one before throwing. Only the call that trapped fails.
+ */
+export class WasmAbortError extends Error {
+  override readonly name = 'WasmAbortError';
+}
+
+export type TimeoutErrorDetails = {
+  timeoutMs: number;
+};
+
+/**
+ * An error thrown by `PgParserPool` when an operation does not finish
+ * within its `timeoutMs`. The worker running the operation is terminated
+ * and replaced, so later operations are unaffected.
+ */
+export class TimeoutError extends Error {
+  override readonly name = 'TimeoutError';
+
+  /**
+   * The timeout that was exceeded, in milliseconds.
+   */
+  timeoutMs: number;
+
+  constructor(message: string, { timeoutMs }: TimeoutErrorDetails) {
+    super(message);
+    this.timeoutMs = timeoutMs;
+  }
+}
+
 /**
  * Get the type of parse error based on the internal file name
  * returned from libpg_query.
@@ -0,0 +1,107 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { PgParser } from './pg-parser.js';
+import { unwrapScanResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('extractComments (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('extracts sqlcommenter tags', async () => {
+    const sql =
+      "SELECT * FROM users /*controller='users',action='index',framework='rails'*/";
+    const comments = await pgParser.extractComments(sql);
+
+    expect(comments).toEqual([
+      {
+        kind: 'block',
+        text: "/*controller='users',action='index',framework='rails'*/",
+        start: sql.indexOf('/*'),
+        end: sql.length,
+        tags: { controller: 'users', action: 'index', framework: 'rails' },
+      },
+    ]);
+  });
+
+  it('decodes URL-encoded and meta-escaped values', async () => {
+    const [comment] = await pgParser.extractComments(
+      "SELECT 1 /*route='%2Fusers%2F%3Aid',traceparent='00-abc-01',name='it\\'s'*/",
+    );
+
+    expect(comment!.tags).toEqual({
+      route: '/users/:id',
+      traceparent: '00-abc-01',
+      name: "it's",
+    });
+  });
+
+  it('tolerates whitespace around tags', async () => {
+    const [comment] = await pgParser.extractComments(
+      "SELECT 1 /* a='1', b = '2' */",
+    );
+
+    expect(comment!.tags).toEqual({ a: '1', b: '2' });
+  });
+
+  it('returns plain comments without tags', async () => {
+    const comments = await pgParser.extractComments(
+      'SELECT 1 -- trailing\n/* just a note */ SELECT 2',
+    );
+
+    expect(comments).toMatchObject([
+      { kind: 'line', text: '-- trailing', tags: {} },
+      { kind: 'block', text: '/* just a note */', tags: {} },
+    ]);
+  });
+
+  it('ignores comment markers inside strings', async () => {
+    const comments = await pgParser.extractComments(
+      "SELECT '/* not a comment */', $$-- nor this$$",
+    );
+
+    expect(comments).toEqual([]);
+  });
+
+  it('handles nested block comments', async () => {
+    const comments = await pgParser.extractComments(
+      'SELECT 1 /* outer /* inner */ still outer */',
+    );
+
+    expect(comments).toHaveLength(1);
+    expect(comments[0]!.text).toBe('/* outer /* inner */ still outer */');
+  });
+
+  it('uses byte offsets', async () => {
+    const [comment] = await pgParser.extractComments(
+      "SELECT '\u{1F600}' /*a='1'*/",
+    );
+
+    expect(comment!.start).toBe(14);
+  });
+
+  it('finds the same comments as scan()', async () => {
+    const tokens = await unwrapScanResult(pgParser.scan(sqlDump));
+    const scanned = tokens.filter(
+      (token) => token.kind === 'SQL_COMMENT' || token.kind === 'C_COMMENT',
+    );
+
+    const comments = await pgParser.extractComments(sqlDump);
+
+    expect(comments.map(({ start, end }) => [start, end])).toEqual(
+      scanned.map(({ start, end }) => [start, end]),
+    );
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.extractComments(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.extractComments(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,153 @@
+import { describe, expect, it } from 'vitest';
+import { PgParser } from './pg-parser.js';
+import { unwrapConstantsResult } from './util.js';
+
+describe.each([15, 16, 17])('extractConstants (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function extract(sql: string) {
+    const constants = await unwrapConstantsResult(
+      pgParser.extractConstants(sql),
+    );
+
+    // Every span must point at the constant's source text
+    return constants.map((constant) => ({
+      ...constant,
+      text: sql.slice(constant.location, constant.location + constant.length),
+    }));
+  }
+
+  it('extracts literals of every kind in source order', async () => {
+    const constants = await extract(
+      "SELECT 42, 1.5, 'it''s', B'101', true, NULL",
+    );
+
+    expect(constants).toEqual([
+      { kind: 'integer', location: 7, length: 2, value: '42', text: '42' },
+      { kind: 'float', location: 11, length: 3, value: '1.5', text: '1.5' },
+      {
+        kind: 'string',
+        location: 16,
+        length: 7,
+        value: "it's",
+        text: "'it''s'",
+      },
+      {
+        kind: 'bitstring',
+        location: 25,
+        length: 6,
+        value: 'b101',
+        text: "B'101'",
+      },
+      {
+        kind: 'boolean',
+        location: 33,
+        length: 4,
+        value: 'true',
+        text: 'true',
+      },
+      { kind: 'null', location: 39, length: 4, value: null, text: 'NULL' },
+    ]);
+  });
+
+  it('extracts parameter references', async () => {
+    const constants = await extract(
+      'SELECT * FROM users WHERE id = $1 AND org_id = $12',
+    );
+
+    expect(constants).toMatchObject([
+      { kind: 'param', value: '1', text: '$1' },
+      { kind: 'param', value: '12', text: '$12' },
+    ]);
+  });
+
+  it('includes the sign of negative numbers', async () => {
+    const constants = await extract('SELECT -1, - 2.5');
+
+    expect(constants).toMatchObject([
+      { kind: 'integer', value: '-1', text: '-1' },
+      { kind: 'float', value: '-2.5', text: '- 2.5' },
+    ]);
+  });
+
+  it('spans escape and dollar-quoted strings', async () => {
+    const constants = await extract("SELECT E'a\\nb', $tag$x$tag$");
+
+    expect(constants).toMatchObject([
+      { kind: 'string', value: 'a\nb', text: "E'a\\nb'" },
+      { kind: 'string', value: 'x', text: '$tag$x$tag$' },
+    ]);
+  });
+
+  it('spans Unicode escape strings with their UESCAPE clause', async () => {
+    const constants = await extract("SELECT U&'d!0061t' UESCAPE '!', 1");
+
+    expect(constants).toMatchObject([
+      { kind: 'string', value: 'dat', text: "U&'d!0061t' UESCAPE '!'" },
+      { kind: 'integer', value: '1', text: '1' },
+    ]);
+  });
+
+  it('extracts constants from typed literals', async () => {
+    const constants = await extract("SELECT DATE '2024-01-01'");
+
+    expect(constants).toMatchObject([
+      { kind: 'string', value: '2024-01-01', text: "'2024-01-01'" },
+    ]);
+  });
+
+  it('uses byte offsets', async () => {
+    // The emoji is 4 bytes, so `1` starts at byte 15, not JS string index 13
+    const sql = "SELECT '\u{1F600}', 1";
+    const [, integer] = await unwrapConstantsResult(
+      pgParser.extractConstants(sql),
+    );
+
+    expect(integer).toMatchObject({ kind: 'integer', location: 15 });
+  });
+
+  it('extracts constants across multiple statements', async () => {
+    const constants = await extract('SELECT 1; INSERT INTO t VALUES ($1, 2)');
+
+    expect(constants.map((c) => c.text)).toEqual(['1', '$1', '2']);
+  });
+
+  it('processes a batch of queries in one call', async () => {
+    const results = await pgParser.extractConstants([
+      'SELECT 1',
+      'SELECT FROM WHERE',
+      "SELECT 'a', $1",
+    ]);
+
+    expect(results).toHaveLength(3);
+    expect(results[0]!.constants).toMatchObject([{ value: '1' }]);
+    expect(results[1]!.error?.type).toBe('syntax');
+    expect(results[2]!.constants).toMatchObject([
+      { kind: 'string', location: 7 },
+      { kind: 'param', location: 12 },
+    ]);
+  });
+
+  it('rejects queries containing a null character', async () => {
+    await expect(
+      pgParser.extractConstants(['SELECT 1\0', 'SELECT 2']),
+    ).rejects.toThrow('query 0 contains a null character');
+  });
+
+  it('handles an empty batch', async () => {
+    expect(await pgParser.extractConstants([])).toEqual([]);
+  });
+
+  it('does not leak memory', async () => {
+    const batch = Array.from({ length: 100 }, (_, i) => `SELECT ${i}, 'x'`);
+
+    await pgParser.extractConstants(batch);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.extractConstants(batch);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
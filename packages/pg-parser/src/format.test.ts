@@ -0,0 +1,117 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import {
+  unwrapDeparseResult,
+  unwrapFormatResult,
+  unwrapParseResult,
+} from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+const longQuery =
+  'select o.id, o.total, c.name, c.email from orders o join customers c on c.id = o.customer_id where o.status = $1 and o.total > 100 order by o.created_at desc';
+
+describe.each([15, 16, 17])('format (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function normalize(sql: string) {
+    const tree = await unwrapParseResult(pgParser.parse(sql));
+    return await unwrapDeparseResult(pgParser.deparse(tree));
+  }
+
+  it('keeps comments', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format(
+        '-- active users\nselect id from users where active; /* done */',
+      ),
+    );
+
+    expect(sql).toContain('-- active users');
+    expect(sql).toContain('/* done */');
+  });
+
+  it('formats to equivalent SQL', async () => {
+    const sql = await unwrapFormatResult(pgParser.format(sqlDump));
+
+    expect(await normalize(sql)).toBe(await normalize(sqlDump));
+  });
+
+  it('ends with a newline if asked to', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format('select 1', { trailingNewline: true }),
+    );
+
+    expect(sql.endsWith('\n')).toBe(true);
+    expect(sql.endsWith('\n\n')).toBe(false);
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.format('select from where');
+
+    expect(result.sql).toBeUndefined();
+    expect(result.error).toBeInstanceOf(ParseError);
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.format(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.format(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
+
+describe.each([15, 16])('format (v%i, single-line deparser)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('prints one statement per line with comments around it', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format(
+        '-- users\nselect id,name from users where id=1; -- one\n/* two */ select 2',
+      ),
+    );
+
+    expect(sql).toBe(
+      '-- users\nSELECT id, name FROM users WHERE id = 1; -- one\n\n/* two */\nSELECT 2;',
+    );
+  });
+
+  it('moves comments inside a statement before it', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format('select 1, -- first\n  2;\n-- the end'),
+    );
+
+    expect(sql).toBe('-- first\nSELECT 1, 2;\n\n-- the end');
+  });
+});
+
+describe('format (v17, pretty printer)', () => {
+  const pgParser = new PgParser({ version: 17 });
+
+  it('breaks long statements across indented lines', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format(longQuery, { indentSize: 2, maxLineLength: 40 }),
+    );
+    const lines = sql.split('\n');
+
+    expect(lines.length).toBeGreaterThan(1);
+    expect(lines.some((line) => /^ {2}\S/.test(line))).toBe(true);
+  });
+
+  it('puts commas at the start of lines if asked to', async () => {
+    const sql = await unwrapFormatResult(
+      pgParser.format(longQuery, {
+        maxLineLength: 20,
+        commasStartOfLine: true,
+      }),
+    );
+
+    expect(sql.split('\n').some((line) => /^\s*, /.test(line))).toBe(true);
+  });
+});
@@ -3,33 +3,127 @@ export {
   ParseError,
   type ParseErrorDetails,
   type ParseErrorType,
+  type ParseLimitName,
+  type ParseLimitViolation,
   ScanError,
   type ScanErrorDetails,
   type ScanErrorType,
+  TimeoutError,
+  type TimeoutErrorDetails,
+  WasmAbortError,
 } from './errors.js';
+export { QueryMetric } from './constants.js';
+export {
+  type ArchiveFileHandle,
+  type ArchiveStatement,
+  PgArchive,
+} from './archive.js';
 export * from './pg-parser.js';
 export type {
+  AllocationStats,
+  ArchiveEntry,
+  ArchiveSource,
+  ArrowExportOptions,
+  Catalog,
+  CatalogColumn,
+  CatalogConstraint,
+  CatalogFunction,
+  CatalogIndex,
+  CatalogSequence,
+  CatalogTable,
+  CatalogType,
+  ConstantKind,
+  DependencyGraph,
+  FormatOptions,
   KeywordKind,
   Node,
+  ParameterizedQuery,
+  ParameterType,
+  ParseLimits,
+  ParseManyResult,
+  ParseOptions,
+  ParseProfile,
   ParseResult,
+  QueryComment,
+  QueryConstant,
+  QueryParameter,
+  RewriteOperation,
+  RoundTripResult,
   ScanToken,
+  SplitStatement,
+  SqlTemplate,
+  StatementDependencies,
   SupportedVersion,
+  TemplateBindings,
+  TemplateValue,
+  WrappedArchiveError,
+  WrappedArchiveResult,
+  WrappedArchiveSuccess,
+  WrappedArrowError,
+  WrappedArrowResult,
+  WrappedArrowSuccess,
+  WrappedCatalogError,
+  WrappedCatalogResult,
+  WrappedCatalogSuccess,
+  WrappedConstantsError,
+  WrappedConstantsResult,
+  WrappedConstantsSuccess,
   WrappedDeparseError,
   WrappedDeparseResult,
   WrappedDeparseSuccess,
+  WrappedDependencyGraphError,
+  WrappedDependencyGraphResult,
+  WrappedDependencyGraphSuccess,
+  WrappedFormatError,
+  WrappedFormatResult,
+  WrappedFormatSuccess,
+  WrappedMetricsError,
+  WrappedMetricsResult,
+  WrappedMetricsSuccess,
+  WrappedParameterizeError,
+  WrappedParameterizeResult,
+  WrappedParameterizeSuccess,
   WrappedParseError,
   WrappedParseResult,
   WrappedParseSuccess,
+  WrappedRenderError,
+  WrappedRenderResult,
+  WrappedRenderSuccess,
+  WrappedRewriteError,
+  WrappedRewriteResult,
+  WrappedRewriteSuccess,
+  WrappedRoundTripError,
+  WrappedRoundTripResult,
+  WrappedRoundTripSuccess,
   WrappedScanError,
   WrappedScanResult,
   WrappedScanSuccess,
+  WrappedSplitError,
+  WrappedSplitResult,
+  WrappedSplitSuccess,
+  WrappedTemplateError,
+  WrappedTemplateResult,
+  WrappedTemplateSuccess,
 } from './types/index.js';
 export {
   getSupportedVersions,
   isParseResultVersion,
   isSupportedVersion,
+  unwrapArchiveResult,
+  unwrapArrowResult,
+  unwrapCatalogResult,
+  unwrapConstantsResult,
   unwrapDeparseResult,
+  unwrapDependencyGraphResult,
+  unwrapFormatResult,
+  unwrapMetricsResult,
   unwrapNode,
+  unwrapParameterizeResult,
   unwrapParseResult,
+  unwrapRenderResult,
+  unwrapRewriteResult,
+  unwrapRoundTripResult,
   unwrapScanResult,
+  unwrapSplitResult,
+  unwrapTemplateResult,
 } from './util.js';
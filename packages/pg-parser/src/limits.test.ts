@@ -0,0 +1,150 @@
+import { describe, expect, it } from 'vitest';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapParseResult } from './util.js';
+
+describe.each([15, 16, 17])('parse limits (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('parses input within all limits', async () => {
+    const result = await unwrapParseResult(
+      pgParser.parse('SELECT (1 + 2) * 3; SELECT 4', {
+        limits: { maxBytes: 100, maxTokens: 20, maxStatements: 2, maxDepth: 1 },
+      }),
+    );
+
+    expect(result.stmts).toHaveLength(2);
+  });
+
+  it('rejects input over maxBytes', async () => {
+    const { error } = await pgParser.parse('SELECT 1234567890', {
+      limits: { maxBytes: 10 },
+    });
+
+    expect(error).toBeInstanceOf(ParseError);
+    expect(error).toMatchObject({
+      type: 'limit',
+      position: 10,
+      limit: { name: 'bytes', max: 10 },
+    });
+  });
+
+  it('counts bytes, not characters', async () => {
+    // 10 characters, 13 UTF-8 bytes
+    const { error } = await pgParser.parse("SELECT '\u{1F600}'", {
+      limits: { maxBytes: 11 },
+    });
+
+    expect(error?.limit?.name).toBe('bytes');
+  });
+
+  it('rejects input over maxTokens', async () => {
+    const sql = 'SELECT a, b, c FROM t';
+    const { error } = await pgParser.parse(sql, { limits: { maxTokens: 5 } });
+
+    expect(error).toMatchObject({
+      type: 'limit',
+      message: 'input exceeds limit of 5 tokens',
+      position: sql.indexOf(' c') + 1,
+      limit: { name: 'tokens', max: 5 },
+    });
+  });
+
+  it('does not count comments as tokens', async () => {
+    const { error } = await pgParser.parse(
+      '/* a long comment */ SELECT 1 -- trailing',
+      { limits: { maxTokens: 2 } },
+    );
+
+    expect(error).toBeUndefined();
+  });
+
+  it('rejects input over maxStatements', async () => {
+    const sql = 'SELECT 1; SELECT 2; SELECT 3;';
+    const { error } = await pgParser.parse(sql, {
+      limits: { maxStatements: 2 },
+    });
+
+    expect(error).toMatchObject({
+      type: 'limit',
+      position: sql.indexOf('SELECT 3'),
+      limit: { name: 'statements', max: 2 },
+    });
+  });
+
+  it('reports positions in characters, not bytes', async () => {
+    const sql = "SELECT 'ü\u{1F600}'; SELECT 2";
+    const position = [...sql.slice(0, sql.indexOf('SELECT 2'))].length;
+
+    const { error } = await pgParser.parse(sql, {
+      limits: { maxStatements: 1 },
+    });
+    expect(error?.position).toBe(position);
+
+    const { results } = await pgParser.parseMany(['SELECT 1', sql], {
+      limits: { maxStatements: 1 },
+    });
+    expect(results[1]!.error?.position).toBe(position);
+  });
+
+  it('reports the maxBytes position in characters', async () => {
+    // The 10th byte is inside 'ü', which starts at character 8
+    const { error } = await pgParser.parse("SELECT 'üü'", {
+      limits: { maxBytes: 9 },
+    });
+
+    expect(error).toMatchObject({ position: 8, limit: { name: 'bytes' } });
+  });
+
+  it('ignores semicolons inside strings, comments and dollar quotes', async () => {
+    const { error } = await pgParser.parse(
+      `SELECT ';', $$;$$, E'\\';' /* ; */; -- ;`,
+      { limits: { maxStatements: 1 } },
+    );
+
+    expect(error).toBeUndefined();
+  });
+
+  it('rejects input nested deeper than maxDepth', async () => {
+    const sql = 'SELECT ((((1))))';
+    const { error } = await pgParser.parse(sql, { limits: { maxDepth: 3 } });
+
+    expect(error).toMatchObject({
+      type: 'limit',
+      message: 'input exceeds maximum nesting depth of 3',
+      position: 10,
+      limit: { name: 'depth', max: 3 },
+    });
+  });
+
+  it('rejects deeply nested input before it can exhaust the parser', async () => {
+    const depth = 100_000;
+    const sql = `SELECT ${'('.repeat(depth)}1${')'.repeat(depth)}`;
+    const { error } = await pgParser.parse(sql, { limits: { maxDepth: 64 } });
+
+    expect(error?.limit?.name).toBe('depth');
+  });
+
+  it('uses limits from the constructor by default', async () => {
+    const limitedParser = new PgParser({
+      version,
+      limits: { maxStatements: 1 },
+    }) as PgParser;
+
+    const { error } = await limitedParser.parse('SELECT 1; SELECT 2');
+    expect(error?.limit?.name).toBe('statements');
+
+    const overridden = await limitedParser.parse('SELECT 1; SELECT 2', {
+      limits: {},
+    });
+    expect(overridden.error).toBeUndefined();
+  });
+
+  it('leaves syntax errors to the parser', async () => {
+    const { error } = await pgParser.parse("SELECT 'unterminated", {
+      limits: { maxTokens: 100 },
+    });
+
+    expect(error?.type).toBe('syntax');
+  });
+});
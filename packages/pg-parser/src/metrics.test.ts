@@ -0,0 +1,125 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { QueryMetric } from './constants.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapMetricsResult, unwrapParseResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('metrics (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function metricsOf(sql: string) {
+    const [metrics] = await unwrapMetricsResult(pgParser.metrics(sql));
+    return metrics!;
+  }
+
+  it('returns one row per statement', async () => {
+    const metrics = await unwrapMetricsResult(
+      pgParser.metrics('SELECT 1; SELECT 2; SELECT 3'),
+    );
+
+    expect(metrics).toHaveLength(3);
+    for (const row of metrics) {
+      expect(row).toBeInstanceOf(Int32Array);
+      expect(row).toHaveLength(Object.keys(QueryMetric).length);
+    }
+  });
+
+  it('counts nodes and depth', async () => {
+    const simple = await metricsOf('SELECT 1');
+    const nested = await metricsOf('SELECT (1 + (2 * (3 - 4)))');
+
+    expect(simple[QueryMetric.nodes]).toBeGreaterThan(0);
+    expect(simple[QueryMetric.depth]).toBeGreaterThan(0);
+    expect(nested[QueryMetric.nodes]).toBeGreaterThan(
+      simple[QueryMetric.nodes]!,
+    );
+    expect(nested[QueryMetric.depth]).toBeGreaterThan(
+      simple[QueryMetric.depth]!,
+    );
+  });
+
+  it('counts explicit and implicit joins', async () => {
+    const metrics = await metricsOf(
+      'SELECT * FROM a JOIN b ON a.id = b.id LEFT JOIN c USING (id), d, e',
+    );
+
+    expect(metrics[QueryMetric.joins]).toBe(4);
+  });
+
+  it('counts subqueries', async () => {
+    const metrics = await metricsOf(
+      'SELECT (SELECT 1) FROM (SELECT 2) s WHERE EXISTS (SELECT 3)',
+    );
+
+    expect(metrics[QueryMetric.subqueries]).toBe(3);
+  });
+
+  it('counts CTEs', async () => {
+    const metrics = await metricsOf(
+      'WITH a AS (SELECT 1), b AS (SELECT 2) SELECT * FROM a, b',
+    );
+
+    expect(metrics[QueryMetric.ctes]).toBe(2);
+    expect(metrics[QueryMetric.joins]).toBe(1);
+  });
+
+  it('counts set operations', async () => {
+    const metrics = await metricsOf(
+      'SELECT 1 UNION SELECT 2 INTERSECT SELECT 3 EXCEPT SELECT 4',
+    );
+
+    expect(metrics[QueryMetric.setOperations]).toBe(3);
+  });
+
+  it('counts function calls', async () => {
+    const metrics = await metricsOf(
+      'SELECT count(*), lower(name), row_number() OVER () FROM users',
+    );
+
+    expect(metrics[QueryMetric.functions]).toBe(3);
+  });
+
+  it('counts nothing extra for simple statements', async () => {
+    const metrics = await metricsOf('SELECT 1');
+
+    expect(metrics[QueryMetric.joins]).toBe(0);
+    expect(metrics[QueryMetric.subqueries]).toBe(0);
+    expect(metrics[QueryMetric.ctes]).toBe(0);
+    expect(metrics[QueryMetric.setOperations]).toBe(0);
+    expect(metrics[QueryMetric.functions]).toBe(0);
+  });
+
+  it('measures depth of deep trees', async () => {
+    const sql = `SELECT ${Array.from({ length: 500 }, () => '1').join(' + ')}`;
+    const metrics = await metricsOf(sql);
+
+    expect(metrics[QueryMetric.depth]).toBeGreaterThan(500);
+  });
+
+  it('returns parse errors', async () => {
+    const { error } = await pgParser.metrics('SELECT FROM WHERE');
+
+    expect(error?.type).toBe('syntax');
+  });
+
+  it('matches the statement count of parse() on dump.sql', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    const metrics = await unwrapMetricsResult(pgParser.metrics(sqlDump));
+
+    expect(metrics).toHaveLength(tree.stmts!.length);
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.metrics(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.metrics(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,150 @@
+import { describe, expect, it } from 'vitest';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapParameterizeResult } from './util.js';
+
+describe.each([15, 16, 17])('parameterize (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function parameterize(sql: string) {
+    return await unwrapParameterizeResult(pgParser.parameterize(sql));
+  }
+
+  it('replaces literals with parameters', async () => {
+    const query = await parameterize(
+      "SELECT * FROM users WHERE id = 42 AND name = 'bob' AND active = true",
+    );
+
+    expect(query).toStrictEqual({
+      sql: 'SELECT * FROM users WHERE id = $1 AND name = $2 AND active = $3',
+      params: [
+        { number: 1, value: 42, type: 'int4' },
+        { number: 2, value: 'bob', type: 'unknown' },
+        { number: 3, value: true, type: 'bool' },
+      ],
+    });
+  });
+
+  it('types numbers the way Postgres does', async () => {
+    const query = await parameterize(
+      "SELECT -7, 3000000000, 1.5, 99999999999999999999, B'101'",
+    );
+
+    expect(query.sql).toBe('SELECT $1, $2, $3, $4, $5');
+    expect(query.params).toStrictEqual([
+      { number: 1, value: -7, type: 'int4' },
+      { number: 2, value: '3000000000', type: 'int8' },
+      { number: 3, value: '1.5', type: 'numeric' },
+      { number: 4, value: '99999999999999999999', type: 'numeric' },
+      { number: 5, value: 'b101', type: 'bit' },
+    ]);
+  });
+
+  it('types the int4 and int8 boundaries by their signed value', async () => {
+    const query = await parameterize(
+      'SELECT -2147483648, 2147483648, -9223372036854775808',
+    );
+
+    expect(query.params).toStrictEqual([
+      { number: 1, value: -2147483648, type: 'int4' },
+      { number: 2, value: '2147483648', type: 'int8' },
+      { number: 3, value: '-9223372036854775808', type: 'int8' },
+    ]);
+  });
+
+  it('numbers parameters after existing ones', async () => {
+    const query = await parameterize(
+      'UPDATE users SET name = $1 WHERE id = 7',
+    );
+
+    expect(query).toStrictEqual({
+      sql: 'UPDATE users SET name = $1 WHERE id = $2',
+      params: [{ number: 2, value: 7, type: 'int4' }],
+    });
+  });
+
+  it('keeps the original text', async () => {
+    const query = await parameterize(
+      "select *\n  from users -- 'comment'\n where email = 'a@b.co'",
+    );
+
+    expect(query.sql).toBe(
+      "select *\n  from users -- 'comment'\n where email = $1",
+    );
+  });
+
+  it('leaves literals that must stay literal', async () => {
+    const query = await parameterize(
+      "SELECT date '2024-01-01', x::varchar(10), extract(year FROM ts), NULL FROM t GROUP BY 1 ORDER BY 2 LIMIT 5",
+    );
+
+    expect(query).toStrictEqual({
+      sql: "SELECT date '2024-01-01', x::varchar(10), extract(year FROM ts), NULL FROM t GROUP BY 1 ORDER BY 2 LIMIT $1",
+      params: [{ number: 1, value: 5, type: 'int4' }],
+    });
+  });
+
+  it('replaces continued strings as one literal', async () => {
+    const query = await parameterize("SELECT 'foo'\n  'bar', 'baz'");
+
+    expect(query).toStrictEqual({
+      sql: 'SELECT $1, $2',
+      params: [
+        { number: 1, value: 'foobar', type: 'unknown' },
+        { number: 2, value: 'baz', type: 'unknown' },
+      ],
+    });
+  });
+
+  it('replaces Unicode escape strings with their UESCAPE clause', async () => {
+    const query = await parameterize("SELECT U&'d!0061t' UESCAPE '!', 'x'");
+
+    expect(query).toStrictEqual({
+      sql: 'SELECT $1, $2',
+      params: [
+        { number: 1, value: 'dat', type: 'unknown' },
+        { number: 2, value: 'x', type: 'unknown' },
+      ],
+    });
+  });
+
+  it('leaves utility statements alone', async () => {
+    const query = await parameterize(
+      "SET statement_timeout = 5000; SELECT 'x'",
+    );
+
+    expect(query.sql).toBe('SET statement_timeout = 5000; SELECT $1');
+  });
+
+  it('parameterizes batches', async () => {
+    const results = await pgParser.parameterize([
+      'SELECT 1',
+      'SELECT FROM WHERE',
+      "INSERT INTO t VALUES (2, 'two')",
+    ]);
+
+    expect(results.map(({ query }) => query?.sql)).toStrictEqual([
+      'SELECT $1',
+      undefined,
+      'INSERT INTO t VALUES ($1, $2)',
+    ]);
+    expect(results[1]!.error).toBeInstanceOf(ParseError);
+  });
+
+  it('does not leak memory', async () => {
+    const queries = Array.from(
+      { length: 100 },
+      (_, i) =>
+        `SELECT * FROM orders WHERE id = ${i} AND status = 'open' ORDER BY 1 LIMIT 10`,
+    );
+
+    await pgParser.parameterize(queries);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.parameterize(queries);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,98 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapParseResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('parseMany (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('parses each distinct query once', async () => {
+    const { results, indexes } = await pgParser.parseMany([
+      'SELECT 1',
+      'SELECT 2',
+      'SELECT 1',
+      'select from where',
+      'SELECT 2',
+      'SELECT 1',
+    ]);
+
+    expect(results).toHaveLength(3);
+    expect(Array.from(indexes)).toStrictEqual([0, 1, 0, 2, 1, 0]);
+
+    expect(results[0]!.tree).toStrictEqual(
+      await unwrapParseResult(pgParser.parse('SELECT 1')),
+    );
+    expect(results[1]!.tree).toStrictEqual(
+      await unwrapParseResult(pgParser.parse('SELECT 2')),
+    );
+    expect(results[2]!.error).toBeInstanceOf(ParseError);
+  });
+
+  it('only treats identical texts as duplicates', async () => {
+    const { results, indexes } = await pgParser.parseMany([
+      'SELECT 1',
+      'select 1',
+      'SELECT 1 ',
+      '',
+      'SELECT 1',
+      '',
+    ]);
+
+    expect(results).toHaveLength(4);
+    expect(Array.from(indexes)).toStrictEqual([0, 1, 2, 3, 0, 3]);
+  });
+
+  it('matches parse() for large queries', async () => {
+    const { results, indexes } = await pgParser.parseMany([sqlDump, sqlDump]);
+
+    expect(results).toHaveLength(1);
+    expect(Array.from(indexes)).toStrictEqual([0, 0]);
+    expect(results[0]!.tree).toStrictEqual(
+      await unwrapParseResult(pgParser.parse(sqlDump)),
+    );
+  });
+
+  it('applies limits to every query', async () => {
+    const { results, indexes } = await pgParser.parseMany(
+      ['SELECT 1', 'SELECT 1; SELECT 2', 'SELECT 1'],
+      { limits: { maxStatements: 1 } },
+    );
+
+    expect(Array.from(indexes)).toStrictEqual([0, 1, 0]);
+    expect(results[0]!.error).toBeUndefined();
+    expect(results[1]!.error).toMatchObject({
+      type: 'limit',
+      limit: { name: 'statements', max: 1 },
+    });
+  });
+
+  it('handles an empty batch', async () => {
+    const { results, indexes } = await pgParser.parseMany([]);
+
+    expect(results).toHaveLength(0);
+    expect(indexes).toHaveLength(0);
+  });
+
+  it('rejects queries containing a null character', async () => {
+    await expect(
+      pgParser.parseMany(['SELECT 1', 'SELECT 2\0DROP TABLE t']),
+    ).rejects.toThrow('query 1 contains a null character');
+  });
+
+  it('does not leak memory', async () => {
+    const queries = Array.from({ length: 100 }, (_, i) => `SELECT ${i % 7}`);
+
+    await pgParser.parseMany(queries);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.parseMany(queries);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -0,0 +1,386 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { afterAll, bench, describe } from 'vitest';
+import { getWorkload, WORKLOADS } from '../test/corpus/workloads.js';
+import { createThreadWorker } from '../test/utils/pool.js';
+import { measureTree } from './cli/profile.js';
+import { PgParser } from './pg-parser.js';
+import { PgParserPool } from './pool.js';
+import type { RewriteOperation } from './types/index.js';
+import {
+  unwrapDeparseResult,
+  unwrapParseResult,
+  unwrapScanResult,
+  unwrapSplitResult,
+  unwrapTemplateResult,
+} from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+const pgParser = new PgParser();
+
+/**
+ * The JS-side equivalent of `extractConstants()`, for comparison.
+ */
+function collectConstants(value: unknown, constants: unknown[]) {
+  if (Array.isArray(value)) {
+    for (const item of value) {
+      collectConstants(item, constants);
+    }
+  } else if (value && typeof value === 'object') {
+    for (const [key, child] of Object.entries(value)) {
+      if (key === 'A_Const' || key === 'ParamRef') {
+        constants.push(child);
+      } else {
+        collectConstants(child, constants);
+      }
+    }
+  }
+}
+
+/**
+ * The JS-side equivalent of the `rewrite()` benchmark below: qualifies
+ * relations and ANDs `o.tenant_id = $2` into every SELECT.
+ */
+function rewriteInJs(value: unknown, schema: string) {
+  if (Array.isArray(value)) {
+    for (const item of value) {
+      rewriteInJs(item, schema);
+    }
+  } else if (value && typeof value === 'object') {
+    for (const [key, child] of Object.entries(value)) {
+      if (key === 'RangeVar') {
+        (child as { schemaname?: string }).schemaname ??= schema;
+      } else if (key === 'SelectStmt') {
+        const select = child as { whereClause?: unknown };
+        const predicate = {
+          A_Expr: {
+            kind: 'AEXPR_OP',
+            name: [{ String: { sval: '=' } }],
+            lexpr: {
+              ColumnRef: {
+                fields: [
+                  { String: { sval: 'o' } },
+                  { String: { sval: 'tenant_id' } },
+                ],
+              },
+            },
+            rexpr: { ParamRef: { number: 2 } },
+          },
+        };
+        select.whereClause = select.whereClause
+          ? {
+              BoolExpr: {
+                boolop: 'AND_EXPR',
+                args: [select.whereClause, predicate],
+              },
+            }
+          : predicate;
+      }
+      rewriteInJs(child, schema);
+    }
+  }
+}
+
+/**
+ * Deletes source locations, which change when SQL is deparsed, so trees
+ * can be compared as JSON.
+ */
+function stripLocations(value: unknown) {
+  if (Array.isArray(value)) {
+    for (const item of value) {
+      stripLocations(item);
+    }
+  } else if (value && typeof value === 'object') {
+    const record = value as Record<string, unknown>;
+    for (const key in record) {
+      if (
+        key === 'location' ||
+        key === 'stmt_location' ||
+        key === 'stmt_len'
+      ) {
+        delete record[key];
+      } else {
+        stripLocations(record[key]);
+      }
+    }
+  }
+}
+
+describe('dump.sql', async () => {
+  const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+
+  bench('parse', async () => {
+    await pgParser.parse(sqlDump);
+  });
+
+  bench('deparse', async () => {
+    await pgParser.deparse(tree);
+  });
+
+  bench('scan', async () => {
+    await pgParser.scan(sqlDump);
+  });
+
+  bench('split', async () => {
+    await pgParser.split(sqlDump);
+  });
+});
+
+// Fixed per-call cost dominates tiny queries. Compare a default build
+// with STDERR_CAPTURE=1 to see what the stderr pipe costs.
+describe('per-call overhead (SELECT 1)', () => {
+  bench('parse', async () => {
+    await pgParser.parse('SELECT 1');
+  });
+
+  bench('parse with diagnostics', async () => {
+    await pgParser.parse('SELECT 1', { diagnostics: true });
+  });
+
+  bench('scan', async () => {
+    await pgParser.scan('SELECT 1');
+  });
+});
+
+describe('metrics (dump.sql)', () => {
+  bench('metrics', async () => {
+    await pgParser.metrics(sqlDump);
+  });
+
+  bench('parse + walk in JS', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    for (const stmt of tree.stmts ?? []) {
+      measureTree(stmt);
+    }
+  });
+});
+
+describe('extractConstants (dump.sql statements)', async () => {
+  const statements = (await unwrapSplitResult(pgParser.split(sqlDump))).map(
+    ({ text }) => text
+  );
+
+  bench('extractConstants (batched)', async () => {
+    await pgParser.extractConstants(statements);
+  });
+
+  bench('parse + walk in JS', async () => {
+    for (const statement of statements) {
+      const tree = await unwrapParseResult(pgParser.parse(statement));
+      collectConstants(tree, []);
+    }
+  });
+});
+
+describe('catalog (dump.sql)', () => {
+  bench('buildCatalog', async () => {
+    await pgParser.buildCatalog(sqlDump);
+  });
+
+  // Lower bound for a JS catalog builder: it needs the full AST first
+  bench('parse + collect tables in JS', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    const tables = [];
+    for (const { stmt } of tree.stmts ?? []) {
+      if (stmt && 'CreateStmt' in stmt) {
+        tables.push(stmt.CreateStmt.relation);
+      }
+    }
+  });
+});
+
+describe('dependencies (dump.sql)', () => {
+  bench('buildDependencyGraph', async () => {
+    await pgParser.buildDependencyGraph(sqlDump);
+  });
+
+  // Lower bound for a JS implementation: it needs the full AST first
+  bench('parse + collect relations in JS', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    const relations = [];
+    for (const { stmt } of tree.stmts ?? []) {
+      if (stmt && 'CreateStmt' in stmt) {
+        relations.push(stmt.CreateStmt.relation);
+      }
+    }
+  });
+});
+
+describe('rewrite (1000 queries)', () => {
+  const queries = Array.from(
+    { length: 1000 },
+    (_, i) =>
+      `SELECT o.id, o.total FROM orders o JOIN customers c ON c.id = o.customer_id WHERE o.id = $1 AND c.region = 'eu-${i}'`
+  );
+  const operations: RewriteOperation[] = [
+    { type: 'qualifySchema', schema: 'tenant_42' },
+    {
+      type: 'injectPredicate',
+      column: 'tenant_id',
+      param: 2,
+      relations: ['orders'],
+    },
+  ];
+
+  bench('rewrite (batched)', async () => {
+    await pgParser.rewrite(queries, operations);
+  });
+
+  bench('rewrite (per query)', async () => {
+    for (const query of queries) {
+      await pgParser.rewrite(query, operations);
+    }
+  });
+
+  bench('parse + rewrite in JS + deparse', async () => {
+    for (const query of queries) {
+      const tree = await unwrapParseResult(pgParser.parse(query));
+      rewriteInJs(tree, 'tenant_42');
+      await pgParser.deparse(tree);
+    }
+  });
+});
+
+describe('parameterize (1000 queries)', () => {
+  const queries = Array.from(
+    { length: 1000 },
+    (_, i) =>
+      `SELECT o.id, o.total FROM orders o WHERE o.customer_id = ${i} AND o.status IN ('open', 'paid') AND o.total > 10.5 ORDER BY 1 LIMIT 50`
+  );
+
+  bench('parameterize (batched)', async () => {
+    await pgParser.parameterize(queries);
+  });
+
+  bench('parameterize (per query)', async () => {
+    for (const query of queries) {
+      await pgParser.parameterize(query);
+    }
+  });
+
+  // Splices every literal, so it does less than parameterize(). The
+  // queries are ASCII, so byte locations are string indexes.
+  bench('extractConstants (batched) + splice in JS', async () => {
+    const results = await pgParser.extractConstants(queries);
+    results.forEach(({ constants = [] }, i) => {
+      let sql = '';
+      let pos = 0;
+      let number = 0;
+      for (const { kind, location, length } of constants) {
+        if (kind !== 'param' && kind !== 'null') {
+          sql += queries[i]!.slice(pos, location) + `$${++number}`;
+          pos = location + length;
+        }
+      }
+      sql += queries[i]!.slice(pos);
+    });
+  });
+});
+
+describe('render (1000 queries)', async () => {
+  const template = await unwrapTemplateResult(
+    pgParser.compileTemplate(
+      'SELECT o.id, o.total FROM "{table}" o WHERE o.customer_id = $1 AND o.status = $2 ORDER BY o.created_at DESC LIMIT $3'
+    )
+  );
+  const bindings = Array.from({ length: 1000 }, (_, i) => ({
+    identifiers: { table: `orders_${i % 16}` },
+    values: [i, 'open', 50],
+  }));
+
+  afterAll(() => pgParser.releaseTemplate(template));
+
+  bench('render', async () => {
+    for (const binding of bindings) {
+      await pgParser.render(template, binding);
+    }
+  });
+
+  // What a query builder does without templates: concatenate, then
+  // validate with a full parse
+  bench('string concatenation + parse', async () => {
+    for (const { identifiers, values } of bindings) {
+      await pgParser.parse(
+        `SELECT o.id, o.total FROM ${identifiers.table} o WHERE o.customer_id = ${values[0]} AND o.status = '${values[1]}' ORDER BY o.created_at DESC LIMIT ${values[2]}`
+      );
+    }
+  });
+});
+
+describe('comments (dump.sql)', () => {
+  bench('extractComments', async () => {
+    await pgParser.extractComments(sqlDump);
+  });
+
+  bench('scan + filter in JS', async () => {
+    const tokens = await unwrapScanResult(pgParser.scan(sqlDump));
+    tokens.filter(
+      (token) => token.kind === 'SQL_COMMENT' || token.kind === 'C_COMMENT'
+    );
+  });
+});
+
+// Multiply ops/s by the size of dump.sql for throughput
+describe('format (dump.sql)', () => {
+  bench('format', async () => {
+    await pgParser.format(sqlDump);
+  });
+
+  // What format() saves over: the AST crossing into JS and back
+  bench('parse + deparse', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    await pgParser.deparse(tree);
+  });
+});
+
+describe('verifyRoundTrip (dump.sql)', () => {
+  bench('verifyRoundTrip', async () => {
+    await pgParser.verifyRoundTrip(sqlDump);
+  });
+
+  // The JS equivalent: two JSON trees cross the boundary and get compared
+  bench('parse + deparse + parse + compare in JS', async () => {
+    const tree = await unwrapParseResult(pgParser.parse(sqlDump));
+    const sql = await unwrapDeparseResult(pgParser.deparse(tree));
+    const reparsed = await unwrapParseResult(pgParser.parse(sql));
+    stripLocations(tree);
+    stripLocations(reparsed);
+    JSON.stringify(tree) === JSON.stringify(reparsed);
+  });
+});
+
+// Speedup over a single instance should approach the number of workers
+describe('parseScriptParallel (100k statements)', () => {
+  const sql = getWorkload('many-statements').generate(100_000);
+  const pool = new PgParserPool({ createWorker: createThreadWorker });
+
+  afterAll(() => pool.destroy());
+
+  bench('parse (single instance)', async () => {
+    await pgParser.parse(sql);
+  });
+
+  bench(`parseScriptParallel (${pool.size} workers)`, async () => {
+    await pool.parseScriptParallel(sql);
+  });
+});
+
+for (const workload of WORKLOADS) {
+  describe(`${workload.name} (size ${workload.benchSize})`, async () => {
+    const sql = workload.generate(workload.benchSize);
+    const tree = await unwrapParseResult(pgParser.parse(sql));
+
+    bench('parse', async () => {
+      await pgParser.parse(sql);
+    });
+
+    bench('deparse', async () => {
+      await pgParser.deparse(tree);
+    });
+
+    bench('scan', async () => {
+      await pgParser.scan(sql);
+    });
+  });
+}
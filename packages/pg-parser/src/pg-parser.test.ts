@@ -1,7 +1,7 @@
 /// <reference path="../test/types/sql.d.ts" />
 
 import { stripIndent } from 'common-tags';
-import { describe, expect, it } from 'vitest';
+import { describe, expect, it, vi } from 'vitest';
 import { PgParser } from './pg-parser.js';
 import type { ParseResult } from './types/index.js';
 import {
@@ -184,6 +184,39 @@ describe.each([15, 16, 17])('parser (v%i)', (version) => {
     const expectedPosition = sql.indexOf('FROM', sql.indexOf('my_table_1'));
     expect(result.error.position).toBe(expectedPosition);
   });
+
+  it('returns parser warnings as diagnostics when requested', async () => {
+    const sql = 'CREATE GLOBAL TEMPORARY TABLE t (a int)';
+    const result = await pgParser.parse(sql, { diagnostics: true });
+
+    expect(result.error).toBeUndefined();
+    expect(result.diagnostics?.join('\n')).toMatch(
+      'GLOBAL is deprecated in temporary table creation',
+    );
+  });
+
+  it('returns empty diagnostics for queries without warnings', async () => {
+    const result = await pgParser.parse('SELECT 1', { diagnostics: true });
+
+    expect(result.diagnostics).toStrictEqual([]);
+  });
+
+  it('leaves diagnostics out unless requested', async () => {
+    const consoleError = vi
+      .spyOn(console, 'error')
+      .mockImplementation(() => {});
+
+    try {
+      const result = await pgParser.parse(
+        'CREATE GLOBAL TEMPORARY TABLE t (a int)',
+      );
+
+      expect(result).not.toHaveProperty('diagnostics');
+      expect(consoleError).not.toHaveBeenCalled();
+    } finally {
+      consoleError.mockRestore();
+    }
+  });
 });
 
 describe.each([15, 16, 17])('deparser (v%i)', (version) => {
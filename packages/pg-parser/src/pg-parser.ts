@@ -3,28 +3,90 @@ import {
   getParseErrorType,
   ParseError,
   type ParseErrorType,
+  type ParseLimitName,
   ScanError,
   type ScanErrorType,
+  WasmAbortError,
 } from './errors.js';
 import type {
+  AllocationStats,
+  ArrowExportOptions,
+  Catalog,
+  ConstantKind,
+  FormatOptions,
   KeywordKind,
   MainModule,
   Node,
+  ParameterizedQuery,
+  ParseLimits,
+  ParseManyResult,
+  ParseOptions,
+  ParseProfile,
   ParseResult,
   PgParserModule,
+  QueryComment,
+  QueryConstant,
+  QueryParameter,
+  RewriteOperation,
   ScanToken,
+  SplitStatement,
+  SqlTemplate,
+  StatementDependencies,
   SupportedVersion,
+  TemplateBindings,
+  TemplateValue,
+  WrappedArchiveResult,
+  WrappedArrowResult,
+  WrappedCatalogResult,
+  WrappedConstantsResult,
   WrappedDeparseResult,
+  WrappedDependencyGraphResult,
+  WrappedFormatResult,
+  WrappedMetricsResult,
+  WrappedParameterizeResult,
   WrappedParseResult,
+  WrappedRenderResult,
+  WrappedRewriteResult,
+  WrappedRoundTripResult,
   WrappedScanResult,
+  WrappedSplitResult,
+  WrappedTemplateResult,
 } from './types/index.js';
+import { QueryMetric } from './constants.js';
 import { isSupportedVersion } from './util.js';
 
 type Pointer = number;
 
+// Exports that only non-release builds have, so callers feature-detect them
+type DebugExports = {
+  _alloc_stats?: () => Pointer;
+  _alloc_stats_reset?: () => void;
+  _test_trap?: (kind: number) => number;
+};
+
 const textEncoder = new TextEncoder();
 const textDecoder = new TextDecoder();
 
+// Indexed by PgLimitKind in bindings/limits.c
+const LIMIT_NAMES: (ParseLimitName | undefined)[] = [
+  undefined,
+  'bytes',
+  'tokens',
+  'statements',
+  'depth',
+];
+
+// Indexed by PgConstantKind in bindings/extract-constants.c
+const CONSTANT_KINDS: ConstantKind[] = [
+  'integer',
+  'float',
+  'string',
+  'bitstring',
+  'boolean',
+  'null',
+  'param',
+];
+
 const KEYWORD_KINDS: KeywordKind[] = [
   'none',
   'unreserved',
@@ -33,6 +95,147 @@ const KEYWORD_KINDS: KeywordKind[] = [
   'reserved',
 ];
 
+// Compiled WASM modules by file path, shared by all instances that need
+// to re-instantiate after a trap (Node.js only)
+const compiledModules = new Map<string, Promise<WebAssembly.Module>>();
+
+/**
+ * Encodes queries and packs them back to back, each null-terminated, the
+ * way the batch functions in bindings/ walk them. A query containing a
+ * null character would split in two on the C side, so it is rejected.
+ */
+function packQueries(queries: string[]) {
+  const encoded = queries.map((query, i) => {
+    if (query.includes('\0')) {
+      throw new Error(`query ${i} contains a null character`);
+    }
+    return textEncoder.encode(query);
+  });
+
+  const batch = new Uint8Array(
+    encoded.reduce((size, bytes) => size + bytes.length + 1, 0)
+  );
+
+  let offset = 0;
+  for (const bytes of encoded) {
+    batch.set(bytes, offset);
+    offset += bytes.length + 1;
+  }
+
+  return { batch, encoded };
+}
+
+/**
+ * Copies bytes into the WASM heap as a null-terminated string.
+ */
+function copyToHeap<Version extends SupportedVersion>(
+  module: MainModule<Version>,
+  bytes: Uint8Array
+): Pointer {
+  const ptr = module._malloc(bytes.length + 1); // +1 for null terminator
+
+  if (!ptr) {
+    // The heap can't grow any further. Handle it like an abort so the
+    // instance, and all of its memory, gets replaced.
+    throw new WasmAbortError('out of memory copying input into WASM');
+  }
+
+  module.HEAP8.set(bytes, ptr);
+  module.HEAP8[ptr + bytes.length] = 0; // null terminator
+  return ptr;
+}
+
+/**
+ * Decodes a sqlcommenter key or value: meta-escaped (`\'`), then
+ * URL-encoded. Falls back to the unescaped text if it isn't valid
+ * URL encoding.
+ */
+function decodeCommentTag(bytes: Uint8Array, start: number, end: number) {
+  const unescaped = textDecoder
+    .decode(bytes.subarray(start, end))
+    .replace(/\\(.)/g, '$1');
+
+  try {
+    return decodeURIComponent(unescaped);
+  } catch {
+    return unescaped;
+  }
+}
+
+const INT4_MIN = BigInt('-2147483648');
+const INT4_MAX = BigInt('2147483647');
+const INT8_MIN = BigInt('-9223372036854775808');
+const INT8_MAX = BigInt('9223372036854775807');
+
+/**
+ * Types a literal extracted by `parameterize()` the way Postgres types
+ * constants: integers that overflow int4 become int8, then numeric.
+ */
+function typeLiteral(
+  kind: ConstantKind,
+  value: string
+): Pick<QueryParameter, 'value' | 'type'> {
+  switch (kind) {
+    case 'integer':
+      return { value: Number(value), type: 'int4' };
+    case 'float': {
+      const match = /^(-?)(\d+|0x[\da-f]+|0o[0-7]+|0b[01]+)$/i.exec(value);
+      if (match) {
+        // The sign is part of the literal here (the parser folds negation
+        // of an overflowing integer into the constant), so compare the
+        // signed value: `-2147483648` still fits int4.
+        const magnitude = BigInt(match[2]!);
+        const signed = match[1] ? -magnitude : magnitude;
+        if (signed >= INT4_MIN && signed <= INT4_MAX) {
+          return { value: Number(signed), type: 'int4' };
+        }
+        if (signed >= INT8_MIN && signed <= INT8_MAX) {
+          return { value, type: 'int8' };
+        }
+      }
+      return { value, type: 'numeric' };
+    }
+    case 'boolean':
+      return { value: value === 'true', type: 'bool' };
+    case 'bitstring':
+      return { value, type: 'bit' };
+    default:
+      return { value, type: 'unknown' };
+  }
+}
+
+/**
+ * Whether an error means the WASM instance trapped and can't be reused.
+ */
+function isWasmTrap(error: unknown) {
+  return (
+    error instanceof WasmAbortError ||
+    // Emscripten aborts and wasm traps (unreachable, out of bounds)
+    error instanceof WebAssembly.RuntimeError ||
+    // V8 reports wasm stack overflow as a RangeError
+    (error instanceof RangeError && /call stack/i.test(error.message))
+  );
+}
+
+/**
+ * Compiles the WASM file at `path` once and caches the result.
+ */
+function compileWasm(path: string) {
+  let compiled = compiledModules.get(path);
+
+  if (!compiled) {
+    compiled = import(/* webpackIgnore: true */ 'node:fs/promises')
+      .then(({ readFile }) => readFile(path))
+      .then((bytes) => WebAssembly.compile(bytes));
+    compiledModules.set(path, compiled);
+
+    // Don't cache failures
+    compiled.catch(() => compiledModules.delete(path));
+  }
+
+  return compiled;
+}
+
 /**
  * Reads a null-terminated UTF-8 string from the WASM heap.
  */
@@ -42,8 +245,82 @@ function readString(heap: Int8Array, ptr: number): string {
   return textDecoder.decode(new Uint8Array(heap.buffer, ptr, end - ptr));
 }
 
+/**
+ * Encodes a template value for `render_template` in bindings/template.c.
+ * Numbers travel as text so big and precise ones survive JSON.
+ */
+function encodeTemplateValue(value: TemplateValue) {
+  switch (typeof value) {
+    case 'number':
+      if (!Number.isFinite(value)) {
+        throw new Error(`cannot render ${value} as a literal`);
+      }
+      return { number: String(value) };
+    case 'bigint':
+      return { number: value.toString() };
+    case 'string':
+    case 'boolean':
+      return value;
+    default:
+      if (value === null) {
+        return null;
+      }
+      throw new Error(`unsupported template value: ${String(value)}`);
+  }
+}
+
+/**
+ * Converts a byte offset into UTF-8 `bytes` to a character (code point)
+ * index, the unit of `ParseError` positions. An offset inside a
+ * multi-byte character maps to that character.
+ */
+function byteToCharOffset(bytes: Uint8Array, offset: number) {
+  const end = Math.min(offset, bytes.length);
+  let chars = 0;
+
+  for (let i = 0; i < end; i++) {
+    // Count lead bytes, skipping continuation bytes (10xxxxxx)
+    if ((bytes[i]! & 0xc0) !== 0x80) {
+      chars++;
+    }
+  }
+
+  if (end < bytes.length && (bytes[end]! & 0xc0) === 0x80) {
+    chars--;
+  }
+
+  return chars;
+}
+
+/**
+ * Creates a `limit` error. `position` is a byte offset into `sqlBytes`,
+ * reported as a character index like every other `ParseError`.
+ */
+function createLimitError(
+  name: ParseLimitName,
+  max: number,
+  sqlBytes: Uint8Array,
+  position: number
+) {
+  const message =
+    name === 'depth'
+      ? `input exceeds maximum nesting depth of ${max}`
+      : `input exceeds limit of ${max} ${name}`;
+
+  return new ParseError(message, {
+    type: 'limit',
+    position: byteToCharOffset(sqlBytes, position),
+    limit: { name, max },
+  });
+}
+
 export type PgParserOptions<Version extends SupportedVersion> = {
   version?: Version | number;
+
+  /**
+   * Default admission limits for `parse()`. Can be overridden per call.
+   */
+  limits?: ParseLimits;
 };
 
 export class PgParser<Version extends SupportedVersion = 17> {
@@ -51,20 +328,46 @@ export class PgParser<Version extends SupportedVersion = 17> {
   readonly version: Version;
 
   #module: Promise<MainModule<Version>>;
+  #limits?: ParseLimits;
+  #wasmPath?: string;
+  #recoveries = 0;
+
+  // In-memory sink for the parser's stderr, only set while a call that
+  // asked for `diagnostics` is inside WASM. Anything written outside such
+  // a call is dropped, so warnings stay off the console by default, as
+  // they did when libpg_query captured stderr itself.
+  #diagnostics?: string[];
+  #printErr = (line: string) => {
+    this.#diagnostics?.push(line);
+  };
+
+  // Native trees behind the templates from compileTemplate(), with the
+  // WASM instance they live in
+  #templates = new WeakMap<SqlTemplate, { module: unknown; ptr: Pointer }>();
 
   /**
    * Creates a new PgParser instance with the given options.
    */
-  constructor({ version = 17 }: PgParserOptions<Version> = {}) {
+  constructor({ version = 17, limits }: PgParserOptions<Version> = {}) {
     if (!isSupportedVersion(version)) {
       throw new Error(`unsupported version: ${version}`);
     }
 
+    this.#limits = limits;
     this.#module = this.#init(version);
     this.ready = this.#module.then();
     this.version = version as Version;
   }
 
+  /**
+   * Number of times the WASM instance trapped and was replaced.
+   * Each recovery corresponds to one call that failed with a
+   * `WasmAbortError`.
+   */
+  get recoveries() {
+    return this.#recoveries;
+  }
+
   /**
    * Returns the current WASM heap size in bytes.
    * Useful for detecting memory leaks in tests.
@@ -74,6 +377,57 @@ export class PgParser<Version extends SupportedVersion = 17> {
     return module.HEAP8.length;
   }
 
+  /**
+   * Returns heap allocation counts inside WASM since the last call to
+   * `resetAllocationStats()`, or `undefined` if the WASM binary was built
+   * without allocation tracking (release builds).
+   * Useful for allocation-budget tests.
+   */
+  async getAllocationStats(): Promise<AllocationStats | undefined> {
+    const module = (await this.#module) as MainModule<Version> & DebugExports;
+    const statsPtr = module._alloc_stats?.();
+
+    if (!statsPtr) {
+      return undefined;
+    }
+
+    // AllocStats struct: mallocs(4) + frees(4) + reallocs(4) + bytes(4)
+    return {
+      mallocs: module.getValue(statsPtr, 'i32'),
+      frees: module.getValue(statsPtr + 4, 'i32'),
+      reallocs: module.getValue(statsPtr + 8, 'i32'),
+      bytes: module.getValue(statsPtr + 12, 'i32'),
+    };
+  }
+
+  /**
+   * Resets the heap allocation counters reported by `getAllocationStats()`.
+   */
+  async resetAllocationStats() {
+    const module = (await this.#module) as MainModule<Version> & DebugExports;
+    module._alloc_stats_reset?.();
+  }
+
+  /**
+   * Traps the WASM instance from inside C (`unreachable` or `abort()`),
+   * so tests can exercise recovery with a real trap. Fails with a
+   * `WasmAbortError` like any trapping call, or resolves to `false` if
+   * the WASM binary was built without test hooks (release builds).
+   *
+   * @internal
+   */
+  async trapForTesting(kind: 'unreachable' | 'abort'): Promise<boolean> {
+    return await this.#guard(async (module) => {
+      const { _test_trap } = module as MainModule<Version> & DebugExports;
+
+      if (!_test_trap) {
+        return false;
+      }
+
+      return _test_trap(kind === 'abort' ? 1 : 0) !== 0;
+    });
+  }
+
   /**
    * Initializes the WASM module.
    */
@@ -92,13 +446,104 @@ export class PgParser<Version extends SupportedVersion = 17> {
     return await createModule(
       isNode
         ? {
-            locateFile: (path: string, scriptDirectory: string) =>
-              scriptDirectory + path,
+            locateFile: (path: string, scriptDirectory: string) => {
+              // Remembered so recovery can reuse the compiled module
+              if (path.endsWith('.wasm')) {
+                this.#wasmPath = scriptDirectory + path;
+              }
+              return scriptDirectory + path;
+            },
+            printErr: this.#printErr,
           }
-        : undefined
+        : { printErr: this.#printErr }
     );
   }
 
+  /**
+   * Creates a fresh WASM instance to replace one that trapped.
+   *
+   * In Node.js the compiled `WebAssembly.Module` is cached, so this only
+   * pays for instantiation. Elsewhere the glue code fetches and compiles
+   * the binary again, which the runtime's HTTP and code caches make cheap.
+   */
+  async #reinit(version: SupportedVersion) {
+    const wasmPath = this.#wasmPath;
+
+    if (!wasmPath) {
+      return await this.#init(version);
+    }
+
+    const createModule = await this.#loadFactory(version);
+
+    return await new Promise<MainModule<Version>>((resolve, reject) => {
+      createModule({
+        locateFile: (path: string, scriptDirectory: string) =>
+          scriptDirectory + path,
+        instantiateWasm: (
+          imports: WebAssembly.Imports,
+          receiveInstance: (
+            instance: WebAssembly.Instance,
+            module: WebAssembly.Module
+          ) => void
+        ) => {
+          compileWasm(wasmPath)
+            .then(async (wasmModule) => {
+              const instance = await WebAssembly.instantiate(
+                wasmModule,
+                imports
+              );
+              receiveInstance(instance, wasmModule);
+            })
+            .catch(reject);
+
+          // Tells Emscripten instantiation is async
+          return {};
+        },
+        printErr: this.#printErr,
+      }).then(resolve, reject);
+    });
+  }
+
+  /**
+   * Runs `operation` against the current WASM instance.
+   *
+   * If the instance traps, it is replaced and the call fails with a
+   * `WasmAbortError`. Calls that were in flight on the trapped instance
+   * are retried on the new one, so only the offending call fails.
+   */
+  async #guard<T>(
+    operation: (module: MainModule<Version>) => Promise<T>
+  ): Promise<T> {
+    const instance = this.#module;
+    const module = await instance;
+
+    try {
+      return await operation(module);
+    } catch (error) {
+      if (!isWasmTrap(error)) {
+        throw error;
+      }
+
+      if (this.#module !== instance) {
+        // Another call already trapped and replaced this instance
+        return await this.#guard(operation);
+      }
+
+      this.#module = this.#reinit(this.version);
+      this.#recoveries++;
+
+      if (error instanceof WasmAbortError) {
+        throw error;
+      }
+
+      const message = error instanceof Error ? error.message : String(error);
+      throw new WasmAbortError(
+        `WASM instance aborted (${message}), parser was reset`,
+        { cause: error }
+      );
+    }
+  }
+
   /**
    * Loads the WASM module factory for the given version.
    *
@@ -126,33 +571,212 @@ export class PgParser<Version extends SupportedVersion = 17> {
 
   /**
    * Parses the given SQL string to a Postgres AST.
+   *
+   * When `limits` are given (or set on the constructor), the input is
+   * checked in a single lexer pass first and rejected with a `limit`
+   * error without building a tree.
+   *
+   * With `diagnostics: true`, anything the parser writes to stderr during
+   * the call is returned as `diagnostics` on the result.
    */
-  async parse(sql: string) {
-    const module = await this.#module;
+  async parse(
+    sql: string,
+    { limits = this.#limits, diagnostics = false }: ParseOptions = {}
+  ): Promise<WrappedParseResult<Version>> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+
+      // Checked before copying so oversized input never grows the WASM heap
+      if (limits?.maxBytes !== undefined && sqlBytes.length > limits.maxBytes) {
+        return {
+          tree: undefined,
+          error: createLimitError(
+            'bytes',
+            limits.maxBytes,
+            sqlBytes,
+            limits.maxBytes
+          ),
+        };
+      }
 
-    const sqlBytes = textEncoder.encode(sql);
-    const sqlPtr = module._malloc(sqlBytes.length + 1); // +1 for null terminator
-    module.HEAP8.set(sqlBytes, sqlPtr);
-    module.HEAP8[sqlPtr + sqlBytes.length] = 0; // null terminator
+      const sqlPtr = copyToHeap(module, sqlBytes);
 
-    const resultPtr = module._parse_sql(sqlPtr);
-    module._free(sqlPtr);
+      if (limits) {
+        const error = this.#checkLimits(module, sqlPtr, sqlBytes, limits);
+
+        if (error) {
+          module._free(sqlPtr);
+          return { tree: undefined, error };
+        }
+      }
+
+      const output: string[] | undefined = diagnostics ? [] : undefined;
+      let resultPtr: Pointer;
+
+      this.#diagnostics = output;
+      try {
+        resultPtr = module._parse_sql(sqlPtr);
+      } finally {
+        this.#diagnostics = undefined;
+        module._free(sqlPtr);
+      }
+
+      try {
+        return this.#parsePgQueryParseResult(module, resultPtr, output);
+      } finally {
+        module._free_parse_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Parses a batch of queries to Postgres ASTs in a single WASM call.
+   *
+   * Query logs repeat the same text many times, so queries are hashed
+   * inside WASM and each distinct text is parsed and converted to JSON
+   * only once. `results` has one entry per distinct query, and `indexes`
+   * maps every input query to its entry. Equal texts share their result
+   * object. `limits` apply to every query as in `parse()`.
+   *
+   * @example
+   * const { results, indexes } = await parser.parseMany(queries);
+   * const { tree, error } = results[indexes[i]]; // Result of queries[i]
+   */
+  async parseMany(
+    sql: string[],
+    { limits = this.#limits }: Omit<ParseOptions, 'diagnostics'> = {}
+  ): Promise<ParseManyResult<Version>> {
+    return await this.#guard(async (module) => {
+      const { batch, encoded } = packQueries(sql);
+
+      const batchPtr = copyToHeap(module, batch);
+
+      // 0 means unlimited on the C side
+      const resultPtr = module._parse_many(
+        batchPtr,
+        sql.length,
+        limits?.maxBytes ?? 0,
+        limits?.maxTokens ?? 0,
+        limits?.maxStatements ?? 0,
+        limits?.maxDepth ?? 0
+      );
+      module._free(batchPtr);
+
+      if (!resultPtr) {
+        throw new Error('parseMany failed: null result pointer');
+      }
+
+      try {
+        // PgParseManyResult struct: n_unique(4) + results_ptr(4) +
+        // violations_ptr(4) + indexes_ptr(4)
+        const nUnique = module.getValue(resultPtr, 'i32');
+        const resultsPtr = module.getValue(resultPtr + 4, 'i32');
+        const violationsPtr = module.getValue(resultPtr + 8, 'i32');
+        const indexesPtr = module.getValue(resultPtr + 12, 'i32');
+
+        const indexes = new Int32Array(
+          module.HEAP8.buffer,
+          indexesPtr,
+          sql.length
+        ).slice();
+
+        // Input text of each distinct query, for limit positions
+        const uniqueBytes: Uint8Array[] = [];
+        indexes.forEach((index, i) => {
+          uniqueBytes[index] ??= encoded[i]!;
+        });
+
+        const results: WrappedParseResult<Version>[] = [];
+        for (let i = 0; i < nUnique; i++) {
+          const violationPtr = module.getValue(violationsPtr + i * 4, 'i32');
+
+          if (violationPtr) {
+            const error = this.#parseLimitViolation(
+              module,
+              violationPtr,
+              uniqueBytes[i]!
+            );
+            results.push({ tree: undefined, error });
+            continue;
+          }
+
+          results.push(
+            this.#parsePgQueryParseResult(
+              module,
+              module.getValue(resultsPtr + i * 4, 'i32')
+            )
+          );
+        }
+
+        return { results, indexes };
+      } finally {
+        module._free_parse_many_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Runs the admission limit pass over SQL already copied into WASM.
+   */
+  #checkLimits(
+    module: MainModule<Version>,
+    sqlPtr: Pointer,
+    sqlBytes: Uint8Array,
+    limits: ParseLimits
+  ) {
+    // 0 means unlimited on the C side
+    const violationPtr = module._check_limits(
+      sqlPtr,
+      limits.maxBytes ?? 0,
+      limits.maxTokens ?? 0,
+      limits.maxStatements ?? 0,
+      limits.maxDepth ?? 0
+    );
+
+    if (!violationPtr) {
+      return undefined;
+    }
 
     try {
-      return await this.#parsePgQueryParseResult(resultPtr);
+      return this.#parseLimitViolation(module, violationPtr, sqlBytes);
     } finally {
-      module._free_parse_result(resultPtr);
+      module._free_limit_violation(violationPtr);
     }
   }
 
   /**
-   * Parses a PgQueryParseResult struct from a pointer
+   * Parses a PgLimitViolation struct from a pointer. `sqlBytes` is the
+   * checked input, for converting the byte position to characters.
    */
-  async #parsePgQueryParseResult(
-    resultPtr: number
-  ): Promise<WrappedParseResult<Version>> {
-    const module = await this.#module;
+  #parseLimitViolation(
+    module: MainModule<Version>,
+    violationPtr: Pointer,
+    sqlBytes: Uint8Array
+  ) {
+    // PgLimitViolation struct: kind(4) + max(4) + position(4)
+    const kind = module.getValue(violationPtr, 'i32');
+    const max = module.getValue(violationPtr + 4, 'i32');
+    const position = module.getValue(violationPtr + 8, 'i32');
+
+    const name = LIMIT_NAMES[kind];
+    if (!name) {
+      throw new Error(`unknown limit kind: ${kind}`);
+    }
 
+    return createLimitError(name, max, sqlBytes, position);
+  }
+
+  /**
+   * Parses a PgQueryParseResult struct from a pointer.
+   *
+   * `diagnostics` holds the stderr lines collected during the call, and
+   * is only passed when the caller asked for them.
+   */
+  #parsePgQueryParseResult(
+    module: MainModule<Version>,
+    resultPtr: number,
+    diagnostics?: string[]
+  ): WrappedParseResult<Version> {
     if (!resultPtr) {
       throw new Error('result pointer is null (protobuf to json failed)');
     }
@@ -165,19 +789,22 @@ export class PgParser<Version extends SupportedVersion = 17> {
       ? JSON.parse(readString(module.HEAP8, parseTreePtr))
       : undefined;
 
-    // TODO: add debug mode + print this to stdout/stderr
-    const stderrBuffer = stderrBufferPtr
-      ? readString(module.HEAP8, stderrBufferPtr)
-      : undefined;
+    // Only STDERR_CAPTURE=1 builds fill stderr_buffer, otherwise the
+    // output went to the sink and the buffer is empty
+    if (diagnostics && stderrBufferPtr) {
+      const stderrBuffer = readString(module.HEAP8, stderrBufferPtr);
+      diagnostics.push(...stderrBuffer.split('\n').filter(Boolean));
+    }
 
     const error = errorPtr
-      ? await this.#parsePgQueryError(errorPtr)
+      ? this.#parsePgQueryError(module, errorPtr)
       : undefined;
 
     if (error) {
       return {
         tree: undefined,
         error,
+        ...(diagnostics && { diagnostics }),
       };
     }
 
@@ -192,6 +819,7 @@ export class PgParser<Version extends SupportedVersion = 17> {
     return {
       tree,
       error: undefined,
+      ...(diagnostics && { diagnostics }),
     };
   }
 
@@ -225,55 +853,53 @@ export class PgParser<Version extends SupportedVersion = 17> {
   async deparse(
     input: ParseResult<Version> | Node<Version>
   ): Promise<WrappedDeparseResult> {
-    const module = await this.#module;
+    return await this.#guard(async (module) => {
+      // Node wrappers always have a single PascalCase key (e.g. 'SelectStmt'),
+      // never 'stmts' or 'version', so this safely distinguishes the two.
+      const isParseResult = 'stmts' in input || 'version' in input;
+      const json = JSON.stringify(input);
 
-    // Node wrappers always have a single PascalCase key (e.g. 'SelectStmt'),
-    // never 'stmts' or 'version', so this safely distinguishes the two.
-    const isParseResult = 'stmts' in input || 'version' in input;
-    const json = JSON.stringify(input);
+      const jsonBytes = textEncoder.encode(json);
+      const jsonPtr = copyToHeap(module, jsonBytes);
 
-    const jsonBytes = textEncoder.encode(json);
-    const jsonPtr = module._malloc(jsonBytes.length + 1); // +1 for null terminator
-    module.HEAP8.set(jsonBytes, jsonPtr);
-    module.HEAP8[jsonPtr + jsonBytes.length] = 0; // null terminator
+      const deparseResultPtr: Pointer = isParseResult
+        ? module._deparse_sql(jsonPtr)
+        : module._deparse_node(jsonPtr);
+      module._free(jsonPtr);
 
-    const deparseResultPtr: Pointer = isParseResult
-      ? module._deparse_sql(jsonPtr)
-      : module._deparse_node(jsonPtr);
-    module._free(jsonPtr);
+      if (!deparseResultPtr) {
+        throw new Error('deparse failed: null result pointer');
+      }
 
-    if (!deparseResultPtr) {
-      throw new Error('deparse failed: null result pointer');
-    }
+      try {
+        // Parse struct PgQueryDeparseResult from the pointer
+        const queryPtr = module.getValue(deparseResultPtr, 'i32');
+        const errorPtr = module.getValue(deparseResultPtr + 4, 'i32');
+        const error = errorPtr
+          ? this.#parseDeparseError(module, errorPtr)
+          : undefined;
 
-    try {
-      // Parse struct PgQueryDeparseResult from the pointer
-      const queryPtr = module.getValue(deparseResultPtr, 'i32');
-      const errorPtr = module.getValue(deparseResultPtr + 4, 'i32');
-      const error = errorPtr
-        ? await this.#parseDeparseError(errorPtr)
-        : undefined;
-
-      if (error) {
-        return {
-          sql: undefined,
-          error,
-        };
-      }
+        if (error) {
+          return {
+            sql: undefined,
+            error,
+          };
+        }
 
-      const sql = queryPtr ? readString(module.HEAP8, queryPtr) : undefined;
+        const sql = queryPtr ? readString(module.HEAP8, queryPtr) : undefined;
 
-      if (!sql) {
-        throw new Error('query is undefined');
-      }
+        if (!sql) {
+          throw new Error('query is undefined');
+        }
 
-      return {
-        sql,
-        error: undefined,
-      };
-    } finally {
-      module._free_deparse_result(deparseResultPtr);
-    }
+        return {
+          sql,
+          error: undefined,
+        };
+      } finally {
+        module._free_deparse_result(deparseResultPtr);
+      }
+    });
   }
 
   /**
@@ -291,9 +917,7 @@ export class PgParser<Version extends SupportedVersion = 17> {
    * } PgQueryError;
    * ```
    */
-  async #readPgQueryError(errorPtr: number) {
-    const module = await this.#module;
-
+  #readPgQueryError(module: MainModule<Version>, errorPtr: number) {
     const messagePtr = module.getValue(errorPtr, 'i32');
     const fileNamePtr = module.getValue(errorPtr + 8, 'i32');
     const cursorpos = module.getValue(errorPtr + 16, 'i32');
@@ -309,9 +933,11 @@ export class PgParser<Version extends SupportedVersion = 17> {
     return { message, fileName, position };
   }
 
-  async #parsePgQueryError(errorPtr: number) {
-    const { message, fileName, position } =
-      await this.#readPgQueryError(errorPtr);
+  #parsePgQueryError(module: MainModule<Version>, errorPtr: number) {
+    const { message, fileName, position } = this.#readPgQueryError(
+      module,
+      errorPtr
+    );
     const type: ParseErrorType = fileName
       ? getParseErrorType(fileName)
       : 'unknown';
@@ -323,8 +949,8 @@ export class PgParser<Version extends SupportedVersion = 17> {
    * Only reads the message field since deparse errors don't have
    * meaningful position or type information.
    */
-  async #parseDeparseError(errorPtr: number) {
-    const { message } = await this.#readPgQueryError(errorPtr);
+  #parseDeparseError(module: MainModule<Version>, errorPtr: number) {
+    const { message } = this.#readPgQueryError(module, errorPtr);
     return new DeparseError(message);
   }
 
@@ -335,61 +961,1095 @@ export class PgParser<Version extends SupportedVersion = 17> {
    * byte offsets, and keyword classification.
    */
   async scan(sql: string): Promise<WrappedScanResult> {
-    const module = await this.#module;
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._scan_sql(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('scan failed: null result pointer');
+      }
+
+      try {
+        // PgScanResult struct: n_tokens(4) + tokens_ptr(4) + error_ptr(4)
+        const nTokens = module.getValue(resultPtr, 'i32');
+        const tokensPtr = module.getValue(resultPtr + 4, 'i32');
+        const errorPtr = module.getValue(resultPtr + 8, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parseScanError(module, errorPtr);
+          return { tokens: undefined, error };
+        }
+
+        const tokens: ScanToken[] = [];
+        for (let i = 0; i < nTokens; i++) {
+          // ScanTokenData: start(4) + end(4) + name_ptr(4) + keyword_kind(4) = 16 bytes
+          const base = tokensPtr + i * 16;
+          const start = module.getValue(base, 'i32');
+          const end = module.getValue(base + 4, 'i32');
+          const namePtr = module.getValue(base + 8, 'i32');
+          const kwKind = module.getValue(base + 12, 'i32');
+
+          tokens.push({
+            kind: readString(module.HEAP8, namePtr),
+            text: textDecoder.decode(sqlBytes.slice(start, end)),
+            start,
+            end,
+            keywordKind: KEYWORD_KINDS[kwKind] ?? 'none',
+          });
+        }
+
+        return { tokens, error: undefined };
+      } finally {
+        module._free_scan_result(resultPtr);
+      }
+    });
+  }
+
+  #parseScanError(module: MainModule<Version>, errorPtr: number) {
+    const { message, fileName, position } = this.#readPgQueryError(
+      module,
+      errorPtr
+    );
+    const type: ScanErrorType = fileName
+      ? (getParseErrorType(fileName) === 'syntax' ? 'syntax' : 'unknown')
+      : 'unknown';
+    return new ScanError(message, { type, position });
+  }
+
+  /**
+   * Splits the given SQL string into individual statements using the
+   * Postgres scanner (no full parse).
+   *
+   * Offsets are byte offsets into the UTF-8 encoded input, matching
+   * `scan()` and the `stmt_location` / `stmt_len` fields of the AST.
+   */
+  async split(sql: string): Promise<WrappedSplitResult> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._split_sql(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('split failed: null result pointer');
+      }
+
+      try {
+        // PgQuerySplitResult struct: stmts_ptr(4) + n_stmts(4) + stderr_ptr(4) + error_ptr(4)
+        const stmtsPtr = module.getValue(resultPtr, 'i32');
+        const nStmts = module.getValue(resultPtr + 4, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parseScanError(module, errorPtr);
+          return { statements: undefined, error };
+        }
+
+        const statements: SplitStatement[] = [];
+        for (let i = 0; i < nStmts; i++) {
+          // PgQuerySplitStmt: stmt_location(4) + stmt_len(4)
+          const stmtPtr = module.getValue(stmtsPtr + i * 4, 'i32');
+          const start = module.getValue(stmtPtr, 'i32');
+          const end = start + module.getValue(stmtPtr + 4, 'i32');
+
+          statements.push({
+            text: textDecoder.decode(sqlBytes.subarray(start, end)),
+            start,
+            end,
+          });
+        }
+
+        return { statements, error: undefined };
+      } finally {
+        module._free_split_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Computes complexity metrics for each statement in the given SQL string.
+   *
+   * The metrics are gathered in a single walk of the parse tree inside
+   * WASM, without converting it to JSON, so this is much cheaper than
+   * `parse()` followed by a walk in JS. Each statement gets an `Int32Array`
+   * indexed by `QueryMetric`.
+   */
+  async metrics(sql: string): Promise<WrappedMetricsResult> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._metrics_sql(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('metrics failed: null result pointer');
+      }
+
+      try {
+        // PgMetricsResult struct: n_stmts(4) + n_metrics(4) + values_ptr(4) + error_ptr(4)
+        const nStmts = module.getValue(resultPtr, 'i32');
+        const nMetrics = module.getValue(resultPtr + 4, 'i32');
+        const valuesPtr = module.getValue(resultPtr + 8, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parsePgQueryError(module, errorPtr);
+          return { metrics: undefined, error };
+        }
+
+        if (nMetrics !== Object.keys(QueryMetric).length) {
+          throw new Error(`unexpected metric count: ${nMetrics}`);
+        }
 
-    const sqlBytes = textEncoder.encode(sql);
-    const sqlPtr = module._malloc(sqlBytes.length + 1);
-    module.HEAP8.set(sqlBytes, sqlPtr);
-    module.HEAP8[sqlPtr + sqlBytes.length] = 0;
+        // Copy out of the WASM heap once, then hand out views per statement
+        const values = new Int32Array(
+          module.HEAP8.buffer,
+          valuesPtr,
+          nStmts * nMetrics
+        ).slice();
 
-    const resultPtr = module._scan_sql(sqlPtr);
+        const metrics: Int32Array[] = [];
+        for (let i = 0; i < nStmts; i++) {
+          metrics.push(values.subarray(i * nMetrics, (i + 1) * nMetrics));
+        }
+
+        return { metrics, error: undefined };
+      } finally {
+        module._free_metrics_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Extracts every literal and `$n` parameter reference from the given
+   * SQL, with its byte location, length, kind and normalized value,
+   * ordered by location.
+   *
+   * Pass an array to process a batch of queries in a single WASM call.
+   * Each query gets its own result, and a query that fails to parse
+   * doesn't affect the others.
+   */
+  extractConstants(sql: string): Promise<WrappedConstantsResult>;
+  extractConstants(sql: string[]): Promise<WrappedConstantsResult[]>;
+  async extractConstants(
+    sql: string | string[]
+  ): Promise<WrappedConstantsResult | WrappedConstantsResult[]> {
+    const queries = Array.isArray(sql) ? sql : [sql];
+
+    const results = await this.#guard(async (module) => {
+      const { batch } = packQueries(queries);
+
+      const batchPtr = copyToHeap(module, batch);
+      const resultPtr = module._extract_constants(batchPtr, queries.length);
+      module._free(batchPtr);
+
+      if (!resultPtr) {
+        throw new Error('extractConstants failed: null result pointer');
+      }
+
+      try {
+        // PgConstantsResult struct: n_queries(4) + queries_ptr(4)
+        const nQueries = module.getValue(resultPtr, 'i32');
+        const queriesPtr = module.getValue(resultPtr + 4, 'i32');
+
+        const results: WrappedConstantsResult[] = [];
+        for (let i = 0; i < nQueries; i++) {
+          // PgConstantsQuery: n_constants(4) + constants_ptr(4) + error_ptr(4) = 12 bytes
+          const queryPtr = queriesPtr + i * 12;
+          const nConstants = module.getValue(queryPtr, 'i32');
+          const constantsPtr = module.getValue(queryPtr + 4, 'i32');
+          const errorPtr = module.getValue(queryPtr + 8, 'i32');
+
+          if (errorPtr) {
+            const error = this.#parsePgQueryError(module, errorPtr);
+            results.push({ constants: undefined, error });
+            continue;
+          }
+
+          const constants: QueryConstant[] = [];
+          for (let j = 0; j < nConstants; j++) {
+            // PgConstant: location(4) + length(4) + kind(4) + value_ptr(4) = 16 bytes
+            const base = constantsPtr + j * 16;
+            const valuePtr = module.getValue(base + 12, 'i32');
+
+            constants.push({
+              kind: CONSTANT_KINDS[module.getValue(base + 8, 'i32')]!,
+              location: module.getValue(base, 'i32'),
+              length: module.getValue(base + 4, 'i32'),
+              value: valuePtr ? readString(module.HEAP8, valuePtr) : null,
+            });
+          }
+
+          results.push({ constants, error: undefined });
+        }
+
+        return results;
+      } finally {
+        module._free_constants_result(resultPtr);
+      }
+    });
+
+    return Array.isArray(sql) ? results : results[0]!;
+  }
+
+  /**
+   * Replaces the literals in the given SQL with `$n` parameters and
+   * returns the rewritten text along with the literal values, in
+   * parameter order, with the type Postgres would have given each one.
+   *
+   * The original text is kept as written apart from the replaced
+   * literals. Numbering continues after any `$n` already in the query.
+   * Only SELECT, INSERT, UPDATE, DELETE and MERGE statements are
+   * parameterized, and literals that must stay literal (`NULL`, type
+   * modifiers, typed literals like `date '2024-01-01'` and positional
+   * `ORDER BY 1` / `GROUP BY 1` references) are left alone.
+   *
+   * Pass an array to process a batch of queries in a single WASM call.
+   * Each query gets its own result, and a query that fails to parse
+   * doesn't affect the others.
+   */
+  parameterize(sql: string): Promise<WrappedParameterizeResult>;
+  parameterize(sql: string[]): Promise<WrappedParameterizeResult[]>;
+  async parameterize(
+    sql: string | string[]
+  ): Promise<WrappedParameterizeResult | WrappedParameterizeResult[]> {
+    const queries = Array.isArray(sql) ? sql : [sql];
+
+    const results = await this.#guard(async (module) => {
+      const { batch } = packQueries(queries);
+
+      const batchPtr = copyToHeap(module, batch);
+      const resultPtr = module._parameterize_sql(batchPtr, queries.length);
+      module._free(batchPtr);
+
+      if (!resultPtr) {
+        throw new Error('parameterize failed: null result pointer');
+      }
+
+      try {
+        // PgParameterizeResult struct: n_queries(4) + queries_ptr(4)
+        const nQueries = module.getValue(resultPtr, 'i32');
+        const queriesPtr = module.getValue(resultPtr + 4, 'i32');
+
+        const results: WrappedParameterizeResult[] = [];
+        for (let i = 0; i < nQueries; i++) {
+          // PgParameterizedQuery: sql_ptr(4) + first_param(4) + n_params(4)
+          // + params_ptr(4) + error_ptr(4) = 20 bytes
+          const queryPtr = queriesPtr + i * 20;
+          const errorPtr = module.getValue(queryPtr + 16, 'i32');
+
+          if (errorPtr) {
+            const error = this.#parsePgQueryError(module, errorPtr);
+            results.push({ query: undefined, error });
+            continue;
+          }
+
+          const firstParam = module.getValue(queryPtr + 4, 'i32');
+          const nParams = module.getValue(queryPtr + 8, 'i32');
+          const paramsPtr = module.getValue(queryPtr + 12, 'i32');
+
+          const params: QueryParameter[] = [];
+          for (let j = 0; j < nParams; j++) {
+            // PgConstant: location(4) + length(4) + kind(4) + value_ptr(4) = 16 bytes
+            const base = paramsPtr + j * 16;
+            const kind = CONSTANT_KINDS[module.getValue(base + 8, 'i32')]!;
+            const value = readString(
+              module.HEAP8,
+              module.getValue(base + 12, 'i32')
+            );
+
+            params.push({
+              number: firstParam + j,
+              ...typeLiteral(kind, value),
+            });
+          }
+
+          const query: ParameterizedQuery = {
+            sql: readString(module.HEAP8, module.getValue(queryPtr, 'i32')),
+            params,
+          };
+          results.push({ query, error: undefined });
+        }
+
+        return results;
+      } finally {
+        module._free_parameterize_result(resultPtr);
+      }
+    });
+
+    return Array.isArray(sql) ? results : results[0]!;
+  }
+
+  /**
+   * Extracts the comments in the given SQL string, with any sqlcommenter
+   * tags (comma-separated `key='value'` pairs in a block comment) decoded.
+   *
+   * Runs a lightweight lexer inside WASM - no parse and no per-token
+   * objects - so it is cheap enough to run on every query. Comments
+   * inside string literals are correctly ignored. Throws if WASM runs out
+   * of memory building the result, rather than returning no comments.
+   */
+  async extractComments(sql: string): Promise<QueryComment[]> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._extract_comments(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('extractComments failed: null result pointer');
+      }
+
+      try {
+        // PgCommentsResult struct: n_comments(4) + length(4) + data_ptr(4) + error_ptr(4)
+        const nComments = module.getValue(resultPtr, 'i32');
+        const length = module.getValue(resultPtr + 4, 'i32');
+        const dataPtr = module.getValue(resultPtr + 8, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+
+        if (errorPtr) {
+          const { message } = this.#readPgQueryError(module, errorPtr);
+          throw new Error(message);
+        }
+
+        // Flat offsets, see bindings/extract-comments.c for the layout
+        const data = new Int32Array(module.HEAP8.buffer, dataPtr, length);
+
+        const comments: QueryComment[] = [];
+        let i = 0;
+
+        for (let n = 0; n < nComments; n++) {
+          const kind = data[i++] === 1 ? 'block' : 'line';
+          const start = data[i++]!;
+          const end = data[i++]!;
+          const nTags = data[i++]!;
+
+          const tags: Record<string, string> = {};
+          for (let t = 0; t < nTags; t++, i += 4) {
+            const key = decodeCommentTag(sqlBytes, data[i]!, data[i + 1]!);
+            tags[key] = decodeCommentTag(sqlBytes, data[i + 2]!, data[i + 3]!);
+          }
+
+          comments.push({
+            kind,
+            text: textDecoder.decode(sqlBytes.subarray(start, end)),
+            start,
+            end,
+            tags,
+          });
+        }
+
+        return comments;
+      } finally {
+        module._free_comments_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Builds a catalog of the schemas, tables (with their columns and
+   * constraints), indexes, types, sequences and functions defined by a
+   * DDL script, such as a `pg_dump --schema-only` dump.
+   *
+   * The catalog is assembled inside WASM from the protobuf tree, so only
+   * the (small) catalog is converted to JSON rather than the whole AST.
+   * Statements are applied in order: `CREATE` statements add objects and
+   * `ALTER TABLE` / `ALTER SEQUENCE` update them. `CREATE OR REPLACE`
+   * replaces an existing object and `IF NOT EXISTS` keeps it. `DROP` and
+   * `RENAME` are not modelled.
+   */
+  async buildCatalog(sql: string): Promise<WrappedCatalogResult> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._build_catalog(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('buildCatalog failed: null result pointer');
+      }
+
+      try {
+        // PgCatalogResult struct: json_ptr(4) + error_ptr(4)
+        const jsonPtr = module.getValue(resultPtr, 'i32');
+        const errorPtr = module.getValue(resultPtr + 4, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parsePgQueryError(module, errorPtr);
+          return { catalog: undefined, error };
+        }
+
+        const catalog: Catalog = JSON.parse(readString(module.HEAP8, jsonPtr));
+        return { catalog, error: undefined };
+      } finally {
+        module._free_catalog_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Computes which statements of a DDL script depend on which earlier
+   * ones, and groups them into layers that can be applied concurrently -
+   * for example to restore a `pg_dump --schema-only` dump in parallel.
+   *
+   * Each statement writes the objects it creates or alters and reads the
+   * relations, types, functions and schemas it mentions. A statement
+   * depends on the last statement that wrote anything it reads, and on
+   * every statement that read what it writes since that write. Statements
+   * whose effects can't be attributed to named objects (`SET`,
+   * `CREATE EXTENSION`, `DO`, ...) are barriers ordered against all others.
+   *
+   * Objects only referenced inside function bodies are not tracked.
+   */
+  async buildDependencyGraph(
+    sql: string
+  ): Promise<WrappedDependencyGraphResult> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._build_dependency_graph(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('buildDependencyGraph failed: null result pointer');
+      }
+
+      try {
+        // PgDependencyResult struct: n_stmts(4) + n_layers(4) + length(4) + data_ptr(4) + error_ptr(4)
+        const nStmts = module.getValue(resultPtr, 'i32');
+        const nLayers = module.getValue(resultPtr + 4, 'i32');
+        const length = module.getValue(resultPtr + 8, 'i32');
+        const dataPtr = module.getValue(resultPtr + 12, 'i32');
+        const errorPtr = module.getValue(resultPtr + 16, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parsePgQueryError(module, errorPtr);
+          return { graph: undefined, error };
+        }
+
+        // Flat records, see bindings/dependencies.c for the layout
+        const data = new Int32Array(module.HEAP8.buffer, dataPtr, length);
+
+        const statements: StatementDependencies[] = [];
+        const layers: number[][] = Array.from({ length: nLayers }, () => []);
+        let i = 0;
+
+        for (let n = 0; n < nStmts; n++) {
+          const start = data[i++]!;
+          const end = data[i++]!;
+          const layer = data[i++]!;
+          const barrier = data[i++] === 1;
+          const nDeps = data[i++]!;
+          const dependsOn = Array.from(data.subarray(i, i + nDeps));
+          i += nDeps;
+
+          layers[layer]!.push(n);
+          statements.push({
+            text: textDecoder.decode(sqlBytes.subarray(start, end)),
+            start,
+            end,
+            layer,
+            barrier,
+            dependsOn,
+          });
+        }
+
+        return { graph: { statements, layers }, error: undefined };
+      } finally {
+        module._free_dependency_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Rewrites SQL with a list of declarative operations - schema-qualifying
+   * relations, renaming relations and columns, and injecting
+   * `column = $n` predicates - and returns the rewritten SQL.
+   *
+   * The operations are applied in order to the native parse tree inside
+   * WASM, which is then deparsed, so the AST is never converted to JSON.
+   * Pass an array to rewrite a batch of queries in a single call; each
+   * query gets its own result.
+   *
+   * Throws if the operations are invalid.
+   */
+  rewrite(
+    sql: string,
+    operations: RewriteOperation[]
+  ): Promise<WrappedRewriteResult>;
+  rewrite(
+    sql: string[],
+    operations: RewriteOperation[]
+  ): Promise<WrappedRewriteResult[]>;
+  async rewrite(
+    sql: string | string[],
+    operations: RewriteOperation[]
+  ): Promise<WrappedRewriteResult | WrappedRewriteResult[]> {
+    const queries = Array.isArray(sql) ? sql : [sql];
+
+    const results = await this.#guard(async (module) => {
+      const { batch } = packQueries(queries);
+
+      const batchPtr = copyToHeap(module, batch);
+      const operationsPtr = copyToHeap(
+        module,
+        textEncoder.encode(JSON.stringify(operations))
+      );
+      const resultPtr = module._rewrite_sql(
+        batchPtr,
+        queries.length,
+        operationsPtr
+      );
+      module._free(batchPtr);
+      module._free(operationsPtr);
+
+      if (!resultPtr) {
+        throw new Error('rewrite failed: null result pointer');
+      }
+
+      try {
+        // PgRewriteResult struct: n_queries(4) + queries_ptr(4) + error_ptr(4)
+        const nQueries = module.getValue(resultPtr, 'i32');
+        const queriesPtr = module.getValue(resultPtr + 4, 'i32');
+        const errorPtr = module.getValue(resultPtr + 8, 'i32');
+
+        if (errorPtr) {
+          const { message } = this.#readPgQueryError(module, errorPtr);
+          throw new Error(message);
+        }
+
+        const results: WrappedRewriteResult[] = [];
+        for (let i = 0; i < nQueries; i++) {
+          // PgRewriteQuery: sql_ptr(4) + error_ptr(4) + parsed(4) = 12 bytes
+          const queryPtr = queriesPtr + i * 12;
+          const sqlPtr = module.getValue(queryPtr, 'i32');
+          const errorPtr = module.getValue(queryPtr + 4, 'i32');
+          const parsed = module.getValue(queryPtr + 8, 'i32');
+
+          if (errorPtr) {
+            const error = parsed
+              ? this.#parseDeparseError(module, errorPtr)
+              : this.#parsePgQueryError(module, errorPtr);
+            results.push({ sql: undefined, error });
+            continue;
+          }
+
+          results.push({
+            sql: readString(module.HEAP8, sqlPtr),
+            error: undefined,
+          });
+        }
+
+        return results;
+      } finally {
+        module._free_rewrite_result(resultPtr);
+      }
+    });
+
+    return Array.isArray(sql) ? results : results[0]!;
+  }
+
+  /**
+   * Pretty-prints the given SQL, keeping its comments. Parsing and
+   * deparsing happen in a single WASM call.
+   *
+   * On Postgres 17 this uses the deparser's pretty printing, which
+   * indents, wraps long lines and puts comments back next to the nodes
+   * they were attached to. Older versions print one statement per line,
+   * with comments on their own lines before the statement they were in.
+   */
+  async format(
+    sql: string,
+    options: FormatOptions = {}
+  ): Promise<WrappedFormatResult> {
+    const {
+      indentSize = 4,
+      maxLineLength = 80,
+      commasStartOfLine = false,
+      trailingNewline = false,
+    } = options;
+
+    return await this.#guard(async (module) => {
+      const sqlPtr = copyToHeap(module, textEncoder.encode(sql));
+      const resultPtr = module._format_sql(
+        sqlPtr,
+        indentSize,
+        maxLineLength,
+        commasStartOfLine ? 1 : 0,
+        trailingNewline ? 1 : 0
+      );
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('format failed: null result pointer');
+      }
+
+      try {
+        // PgFormatResult struct: sql_ptr(4) + error_ptr(4) + parsed(4)
+        const sqlResultPtr = module.getValue(resultPtr, 'i32');
+        const errorPtr = module.getValue(resultPtr + 4, 'i32');
+        const parsed = module.getValue(resultPtr + 8, 'i32');
+
+        if (errorPtr) {
+          const error = parsed
+            ? this.#parseDeparseError(module, errorPtr)
+            : this.#parsePgQueryError(module, errorPtr);
+          return { sql: undefined, error };
+        }
+
+        return {
+          sql: readString(module.HEAP8, sqlResultPtr),
+          error: undefined,
+        };
+      } finally {
+        module._free_format_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Checks that SQL (or a parse tree) survives a deparse and reparse
+   * unchanged. Parse, deparse, reparse and the comparison all run in a
+   * single WASM call, so neither tree is converted to JSON.
+   *
+   * Trees are compared ignoring source locations. On a mismatch, the
+   * result has the path to the first differing value and the deparsed
+   * SQL.
+   *
+   * @example
+   * const roundTrip = await unwrapRoundTripResult(
+   *   parser.verifyRoundTrip(rewrittenTree)
+   * );
+   * if (!roundTrip.equal) {
+   *   console.log(roundTrip.path); // 'stmts[0].stmt.SelectStmt.whereClause'
+   * }
+   */
+  async verifyRoundTrip(
+    input: string | ParseResult<Version>
+  ): Promise<WrappedRoundTripResult> {
+    return await this.#guard(async (module) => {
+      const isTree = typeof input !== 'string';
+      const inputBytes = textEncoder.encode(
+        isTree ? JSON.stringify(input) : input
+      );
+      const inputPtr = copyToHeap(module, inputBytes);
+      const resultPtr = module._verify_round_trip(inputPtr, isTree ? 1 : 0);
+      module._free(inputPtr);
+
+      if (!resultPtr) {
+        throw new Error('verifyRoundTrip failed: null result pointer');
+      }
+
+      try {
+        // PgRoundTripResult struct: equal(4) + path_ptr(4) + sql_ptr(4) +
+        // error_ptr(4) + parsed(4)
+        const equal = module.getValue(resultPtr, 'i32');
+        const pathPtr = module.getValue(resultPtr + 4, 'i32');
+        const sqlPtr = module.getValue(resultPtr + 8, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+        const parsed = module.getValue(resultPtr + 16, 'i32');
+
+        if (errorPtr) {
+          const error = parsed
+            ? this.#parseDeparseError(module, errorPtr)
+            : this.#parsePgQueryError(module, errorPtr);
+          return { roundTrip: undefined, error };
+        }
+
+        if (equal) {
+          return { roundTrip: { equal: true }, error: undefined };
+        }
+
+        return {
+          roundTrip: {
+            equal: false,
+            path: readString(module.HEAP8, pathPtr),
+            sql: readString(module.HEAP8, sqlPtr),
+          },
+          error: undefined,
+        };
+      } finally {
+        module._free_round_trip_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Compiles a SQL template: the statement is parsed once and its tree
+   * stays in WASM memory, so `render()` only substitutes bindings and
+   * deparses.
+   *
+   * Placeholders are plain SQL, so templates parse as they are:
+   * - `$n` parameters are bound to values, rendered as literals.
+   * - Quoted identifiers of the form `"{name}"` are bound to identifiers,
+   *   anywhere an identifier can go.
+   *
+   * Call `releaseTemplate()` to free the tree once the template is no
+   * longer needed.
+   *
+   * @example
+   * const template = await unwrapTemplateResult(
+   *   parser.compileTemplate('SELECT * FROM "{table}" WHERE id = $1')
+   * );
+   * const sql = await unwrapRenderResult(
+   *   parser.render(template, { identifiers: { table: 'users' }, values: [42] })
+   * ); // 'SELECT * FROM users WHERE id = 42'
+   */
+  async compileTemplate(sql: string): Promise<WrappedTemplateResult> {
+    return await this.#guard(async (module) => {
+      const compiled = this.#compileTemplate(module, sql);
+
+      if (compiled.error) {
+        return { template: undefined, error: compiled.error };
+      }
+
+      const { ptr, identifiers, params } = compiled;
+      const template: SqlTemplate = Object.freeze({ sql, identifiers, params });
+      this.#templates.set(template, { module, ptr });
+
+      return { template, error: undefined };
+    });
+  }
+
+  #compileTemplate(module: MainModule<Version>, sql: string) {
+    const sqlPtr = copyToHeap(module, textEncoder.encode(sql));
+    const resultPtr = module._compile_template(sqlPtr);
     module._free(sqlPtr);
 
     if (!resultPtr) {
-      throw new Error('scan failed: null result pointer');
+      throw new Error('compileTemplate failed: null result pointer');
     }
 
     try {
-      // PgScanResult struct: n_tokens(4) + tokens_ptr(4) + error_ptr(4)
-      const nTokens = module.getValue(resultPtr, 'i32');
-      const tokensPtr = module.getValue(resultPtr + 4, 'i32');
-      const errorPtr = module.getValue(resultPtr + 8, 'i32');
+      // PgTemplateResult struct: template_ptr(4) + identifiers_ptr(4) +
+      // n_identifiers(4) + n_params(4) + error_ptr(4)
+      const ptr = module.getValue(resultPtr, 'i32');
+      const identifiersPtr = module.getValue(resultPtr + 4, 'i32');
+      const nIdentifiers = module.getValue(resultPtr + 8, 'i32');
+      const params = module.getValue(resultPtr + 12, 'i32');
+      const errorPtr = module.getValue(resultPtr + 16, 'i32');
 
       if (errorPtr) {
-        const error = await this.#parseScanError(errorPtr);
-        return { tokens: undefined, error };
-      }
-
-      const tokens: ScanToken[] = [];
-      for (let i = 0; i < nTokens; i++) {
-        // ScanTokenData: start(4) + end(4) + name_ptr(4) + keyword_kind(4) = 16 bytes
-        const base = tokensPtr + i * 16;
-        const start = module.getValue(base, 'i32');
-        const end = module.getValue(base + 4, 'i32');
-        const namePtr = module.getValue(base + 8, 'i32');
-        const kwKind = module.getValue(base + 12, 'i32');
-
-        tokens.push({
-          kind: readString(module.HEAP8, namePtr),
-          text: textDecoder.decode(sqlBytes.slice(start, end)),
-          start,
-          end,
-          keywordKind: KEYWORD_KINDS[kwKind] ?? 'none',
-        });
+        return { error: this.#parsePgQueryError(module, errorPtr) };
       }
 
-      return { tokens, error: undefined };
+      // Names are packed back to back, each null-terminated
+      const identifiers: string[] = [];
+      let namePtr = identifiersPtr;
+      for (let i = 0; i < nIdentifiers; i++) {
+        const name = readString(module.HEAP8, namePtr);
+        identifiers.push(name);
+        namePtr += textEncoder.encode(name).length + 1;
+      }
+
+      return { ptr, identifiers, params, error: undefined };
     } finally {
-      module._free_scan_result(resultPtr);
+      module._free_template_result(resultPtr);
     }
   }
 
-  async #parseScanError(errorPtr: number) {
-    const { message, fileName, position } =
-      await this.#readPgQueryError(errorPtr);
-    const type: ScanErrorType = fileName
-      ? (getParseErrorType(fileName) === 'syntax' ? 'syntax' : 'unknown')
-      : 'unknown';
-    return new ScanError(message, { type, position });
+  /**
+   * Renders a template from `compileTemplate()` with the given bindings.
+   * Values replace `$n` parameters as literals, and identifiers replace
+   * `"{name}"` placeholders. The tree is deparsed in WASM, so nothing is
+   * reparsed.
+   *
+   * Throws if an identifier placeholder has no binding, or a value can't
+   * be rendered as a literal.
+   */
+  async render(
+    template: SqlTemplate,
+    { identifiers = {}, values = [] }: TemplateBindings = {}
+  ): Promise<WrappedRenderResult> {
+    const handle = this.#templates.get(template);
+
+    if (!handle) {
+      throw new Error(
+        'unknown template: it was released or compiled by another parser'
+      );
+    }
+
+    const missing = template.identifiers.find(
+      (name) => typeof identifiers[name] !== 'string'
+    );
+
+    if (missing !== undefined) {
+      throw new Error(`missing identifier for placeholder "{${missing}}"`);
+    }
+
+    const identifiersJson = textEncoder.encode(JSON.stringify(identifiers));
+    const valuesJson = textEncoder.encode(
+      JSON.stringify(values.map(encodeTemplateValue))
+    );
+
+    return await this.#guard(async (module) => {
+      // The instance the tree lived in trapped and was replaced
+      if (handle.module !== module) {
+        const compiled = this.#compileTemplate(module, template.sql);
+        if (compiled.error) {
+          throw compiled.error;
+        }
+        handle.module = module;
+        handle.ptr = compiled.ptr;
+      }
+
+      const identifiersPtr = copyToHeap(module, identifiersJson);
+      const valuesPtr = copyToHeap(module, valuesJson);
+      const resultPtr = module._render_template(
+        handle.ptr,
+        identifiersPtr,
+        valuesPtr
+      );
+      module._free(identifiersPtr);
+      module._free(valuesPtr);
+
+      if (!resultPtr) {
+        throw new Error('render failed: null result pointer');
+      }
+
+      try {
+        // PgRenderResult struct: sql_ptr(4) + error_ptr(4)
+        const sqlPtr = module.getValue(resultPtr, 'i32');
+        const errorPtr = module.getValue(resultPtr + 4, 'i32');
+
+        if (errorPtr) {
+          return {
+            sql: undefined,
+            error: this.#parseDeparseError(module, errorPtr),
+          };
+        }
+
+        return { sql: readString(module.HEAP8, sqlPtr), error: undefined };
+      } finally {
+        module._free_render_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Frees the native tree behind a template from `compileTemplate()`.
+   * The template can't be rendered afterwards.
+   */
+  async releaseTemplate(template: SqlTemplate) {
+    const handle = this.#templates.get(template);
+
+    if (!handle) {
+      return;
+    }
+
+    this.#templates.delete(template);
+
+    await this.#guard(async (module) => {
+      // Trees in a replaced instance went away with it
+      if (handle.module === module) {
+        module._free_template(handle.ptr);
+      }
+    });
+  }
+
+  /**
+   * Parses the given SQL and writes every statement's tree into a compact
+   * binary archive, to store and read back later with `PgArchive` without
+   * reparsing.
+   *
+   * Pass an array to archive a batch of queries (e.g. a query log) in a
+   * single WASM call. Statements keep the index of the query they came
+   * from. The first query that fails to parse fails the whole archive.
+   *
+   * @example
+   * const bytes = await unwrapArchiveResult(parser.createArchive(queries));
+   * const archive = await PgArchive.open(bytes);
+   * const joins = await archive.findStatements('JoinExpr');
+   * const first = await archive.statement(joins[0]);
+   */
+  async createArchive(sql: string | string[]): Promise<WrappedArchiveResult> {
+    const queries = Array.isArray(sql) ? sql : [sql];
+
+    return await this.#guard(async (module) => {
+      const { batch } = packQueries(queries);
+
+      const batchPtr = copyToHeap(module, batch);
+      const resultPtr = module._build_archive(batchPtr, queries.length);
+      module._free(batchPtr);
+
+      if (!resultPtr) {
+        throw new Error('createArchive failed: null result pointer');
+      }
+
+      try {
+        // PgArchiveResult struct: data_ptr(4) + length(4) +
+        // failed_query(4) + error_ptr(4)
+        const dataPtr = module.getValue(resultPtr, 'i32');
+        const length = module.getValue(resultPtr + 4, 'i32');
+        const failedQuery = module.getValue(resultPtr + 8, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parsePgQueryError(module, errorPtr);
+          if (failedQuery >= 0) {
+            error.query = failedQuery;
+          }
+          return { archive: undefined, error };
+        }
+
+        const archive = new Uint8Array(
+          module.HEAP8.buffer,
+          dataPtr,
+          length
+        ).slice();
+
+        return { archive, error: undefined };
+      } finally {
+        module._free_archive_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Parses a batch of queries (e.g. a query log) and returns facts about
+   * every statement as an Apache Arrow IPC stream, written natively
+   * straight from the parse tree. The bytes can be handed as they are to
+   * Arrow readers such as `tableFromIPC()` in `apache-arrow`, DuckDB or
+   * Polars (`pl.read_ipc_stream()`), with no per-row conversion.
+   *
+   * Each statement is one row, with the columns:
+   *
+   * - `query` (int32): index of the query it came from
+   * - `statement_type` (utf8): node type, e.g. `SelectStmt`
+   * - `fingerprint` (uint64): libpg_query fingerprint of the statement
+   *   on its own, so it is the same whether or not it was logged in a
+   *   multi-statement query
+   * - `tables` (list<utf8>): distinct relations it references, as
+   *   written (`schema.table` or `table`), without CTE references
+   * - `params` (int32): highest `$n` parameter number, 0 if none
+   * - `nodes`, `depth`, `joins`, `subqueries`, `ctes`, `set_operations`,
+   *   `functions` (int32): complexity metrics, as in `metrics()`
+   * - `error` (utf8): parse error message
+   *
+   * A query that fails to parse doesn't fail the batch: it becomes a
+   * single row with only `query` and `error` set.
+   *
+   * With `distinct`, each distinct query text is parsed and written once,
+   * under the index of its first occurrence, so the output scales with
+   * the number of distinct queries. `duplicateOf` maps every query to
+   * that index, e.g. to count occurrences.
+   *
+   * @example
+   * const bytes = await unwrapArrowResult(parser.exportArrow(queries));
+   * const table = tableFromIPC(bytes);
+   */
+  async exportArrow(
+    sql: string | string[],
+    options: ArrowExportOptions = {}
+  ): Promise<WrappedArrowResult> {
+    const queries = Array.isArray(sql) ? sql : [sql];
+    const { batchSize = 0, distinct = false } = options;
+
+    if (!Number.isInteger(batchSize) || batchSize < 0) {
+      throw new Error(`invalid batchSize: ${batchSize}`);
+    }
+
+    return await this.#guard(async (module) => {
+      const { batch } = packQueries(queries);
+
+      const batchPtr = copyToHeap(module, batch);
+      const resultPtr = module._export_arrow(
+        batchPtr,
+        queries.length,
+        batchSize,
+        distinct ? 1 : 0
+      );
+      module._free(batchPtr);
+
+      if (!resultPtr) {
+        throw new Error('exportArrow failed: null result pointer');
+      }
+
+      try {
+        // PgArrowResult struct: data_ptr(4) + length(4) + n_rows(4) +
+        // error_ptr(4) + duplicate_of_ptr(4)
+        const dataPtr = module.getValue(resultPtr, 'i32');
+        const length = module.getValue(resultPtr + 4, 'i32');
+        const rows = module.getValue(resultPtr + 8, 'i32');
+        const errorPtr = module.getValue(resultPtr + 12, 'i32');
+        const duplicateOfPtr = module.getValue(resultPtr + 16, 'i32');
+
+        if (errorPtr) {
+          const error = this.#parsePgQueryError(module, errorPtr);
+          return {
+            arrow: undefined,
+            rows: undefined,
+            duplicateOf: undefined,
+            error,
+          };
+        }
+
+        const arrow = new Uint8Array(
+          module.HEAP8.buffer,
+          dataPtr,
+          length
+        ).slice();
+
+        const duplicateOf = duplicateOfPtr
+          ? new Int32Array(
+              module.HEAP8.buffer,
+              duplicateOfPtr,
+              queries.length
+            ).slice()
+          : undefined;
+
+        return { arrow, rows, duplicateOf, error: undefined };
+      } finally {
+        module._free_arrow_result(resultPtr);
+      }
+    });
+  }
+
+  /**
+   * Parses the given SQL string and reports how long each native phase
+   * of `parse()` took, along with the parse tree.
+   *
+   * Used by the `pg-parser profile` CLI to find slow statements.
+   */
+  async profile(sql: string): Promise<ParseProfile<Version>> {
+    return await this.#guard(async (module) => {
+      const sqlBytes = textEncoder.encode(sql);
+      const sqlPtr = copyToHeap(module, sqlBytes);
+
+      const resultPtr = module._profile_sql(sqlPtr);
+      module._free(sqlPtr);
+
+      if (!resultPtr) {
+        throw new Error('profile failed: null result pointer');
+      }
+
+      try {
+        // PgProfileResult struct: parse_ms(8) + json_ms(8) + json_length(4) + error_ptr(4) + json_ptr(4)
+        const parseMs = module.getValue(resultPtr, 'double');
+        const jsonMs = module.getValue(resultPtr + 8, 'double');
+        const jsonBytes = module.getValue(resultPtr + 16, 'i32');
+        const errorPtr = module.getValue(resultPtr + 20, 'i32');
+        const jsonPtr = module.getValue(resultPtr + 24, 'i32');
+
+        const error = errorPtr
+          ? this.#parsePgQueryError(module, errorPtr)
+          : undefined;
+        const tree = jsonPtr
+          ? JSON.parse(readString(module.HEAP8, jsonPtr))
+          : undefined;
+
+        return { parseMs, jsonMs, jsonBytes, tree, error };
+      } finally {
+        module._free_profile_result(resultPtr);
+      }
+    });
   }
 }
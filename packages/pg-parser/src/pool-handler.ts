@@ -0,0 +1,179 @@
+import {
+  DeparseError,
+  ParseError,
+  ScanError,
+  WasmAbortError,
+} from './errors.js';
+import { PgParser } from './pg-parser.js';
+import type { ParseOptions, SupportedVersion } from './types/index.js';
+
+/**
+ * `PgParser` methods that can run on a pool worker.
+ */
+export type PoolMethod = 'parse' | 'countStatements' | 'split' | 'parseRange';
+
+export type PoolRequest =
+  | { type: 'init'; version: SupportedVersion }
+  | { type: 'call'; id: number; method: PoolMethod; args: unknown[] };
+
+export type PoolResponse =
+  | { type: 'result'; id: number; result: unknown }
+  | { type: 'error'; id: number; error: SerializedError };
+
+/**
+ * An `Error` flattened to plain data so it survives `postMessage()`.
+ * Structured clone drops custom error classes and their fields.
+ */
+export type SerializedError = {
+  name: string;
+  message: string;
+  [field: string]: unknown;
+};
+
+export function serializeError(error: unknown): SerializedError {
+  if (error instanceof Error) {
+    return { ...error, name: error.name, message: error.message };
+  }
+  return { name: 'Error', message: String(error) };
+}
+
+export function deserializeError(serialized: SerializedError): Error {
+  const { name, message, ...fields } = serialized;
+
+  switch (name) {
+    case 'ParseError':
+      return new ParseError(message, fields as any);
+    case 'DeparseError':
+      return new DeparseError(message);
+    case 'ScanError':
+      return new ScanError(message, fields as any);
+    case 'WasmAbortError':
+      return new WasmAbortError(message);
+    default: {
+      const error = new Error(message);
+      error.name = name;
+      return Object.assign(error, fields);
+    }
+  }
+}
+
+/**
+ * Serializes a `{ ..., error }` wrapped result for `postMessage()`.
+ */
+function serializeResult(result: unknown) {
+  if (result && typeof result === 'object' && 'error' in result) {
+    const { error } = result as { error: unknown };
+    return { ...result, error: error ? serializeError(error) : undefined };
+  }
+  return result;
+}
+
+/**
+ * Rehydrates a wrapped result produced by `serializeResult()`.
+ */
+export function deserializeResult<T>(result: unknown): T {
+  if (result && typeof result === 'object' && 'error' in result) {
+    const { error } = result as { error: SerializedError | undefined };
+    return {
+      ...result,
+      error: error ? deserializeError(error) : undefined,
+    } as T;
+  }
+  return result as T;
+}
+
+/**
+ * Creates the worker-side request handler. The worker owns a single
+ * `PgParser` and processes one call at a time.
+ */
+export function createPoolHandler(respond: (response: PoolResponse) => void) {
+  let parser: PgParser<SupportedVersion> | undefined;
+
+  return async (request: PoolRequest) => {
+    switch (request.type) {
+      case 'init':
+        parser = new PgParser({ version: request.version });
+        return;
+      case 'call': {
+        const { id, method, args } = request;
+
+        try {
+          if (!parser) {
+            throw new Error('pool worker received a call before init');
+          }
+
+          const result = await callMethod(parser, method, args);
+          respond({ type: 'result', id, result: serializeResult(result) });
+        } catch (error) {
+          respond({ type: 'error', id, error: serializeError(error) });
+        }
+        return;
+      }
+    }
+  };
+}
+
+/**
+ * Shifts every `location` and `*_location` field in a parse tree by
+ * `offset` bytes, for trees parsed from a range of a larger script. These
+ * are the fields round-trip.c's `is_location()` treats as offsets, less
+ * `stmt_len`, which is a length. Negative locations mean "unknown" and are
+ * left alone.
+ */
+export function shiftLocations(value: unknown, offset: number) {
+  if (Array.isArray(value)) {
+    for (const item of value) {
+      shiftLocations(item, offset);
+    }
+  } else if (value && typeof value === 'object') {
+    const record = value as Record<string, unknown>;
+    for (const key in record) {
+      const child = record[key];
+      if (typeof child === 'number') {
+        const isLocation = key === 'location' || key.endsWith('_location');
+        if (isLocation && child >= 0) {
+          record[key] = child + offset;
+        }
+      } else if (child && typeof child === 'object') {
+        shiftLocations(child, offset);
+      }
+    }
+  }
+}
+
+async function callMethod(
+  parser: PgParser<SupportedVersion>,
+  method: PoolMethod,
+  args: unknown[]
+) {
+  switch (method) {
+    case 'parse':
+      return await parser.parse(args[0] as string, args[1] as ParseOptions);
+    case 'countStatements': {
+      // Only the count crosses back, not the tree
+      const { tree, error } = await parser.parse(
+        args[0] as string,
+        args[1] as ParseOptions
+      );
+      return error
+        ? { statements: undefined, error }
+        : { statements: tree.stmts?.length ?? 0, error: undefined };
+    }
+    case 'split':
+      return await parser.split(args[0] as string);
+    case 'parseRange': {
+      // A range of a larger script starting `byteOffset` bytes
+      // (`charOffset` characters) into it
+      const [sql, byteOffset, charOffset] = args as [string, number, number];
+      const result = await parser.parse(sql);
+      if (result.error) {
+        result.error.position += charOffset;
+      } else {
+        shiftLocations(result.tree, byteOffset);
+      }
+      return result;
+    }
+    default:
+      throw new Error(`unknown pool method: ${method}`);
+  }
+}
@@ -0,0 +1,35 @@
+/// <reference types="node" />
+
+import { createPoolHandler, type PoolRequest } from './pool-handler.js';
+
+/**
+ * Worker entry point for `PgParserPool`.
+ *
+ * Runs as a Web Worker (browsers, Deno, Bun) or a Node.js
+ * `worker_threads` worker, depending on the host.
+ */
+async function start() {
+  if (typeof self !== 'undefined' && typeof self.postMessage === 'function') {
+    const handle = createPoolHandler((response) => self.postMessage(response));
+    self.addEventListener('message', (event) => {
+      handle((event as MessageEvent<PoolRequest>).data);
+    });
+    return;
+  }
+
+  const { parentPort } = await import(
+    /* webpackIgnore: true */ 'node:worker_threads'
+  );
+
+  if (!parentPort) {
+    throw new Error('pool worker must be started as a worker thread');
+  }
+
+  const port = parentPort;
+  const handle = createPoolHandler((response) => port.postMessage(response));
+  port.on('message', (request: PoolRequest) => handle(request));
+}
+
+start().catch((error) => {
+  console.error('pg-parser pool worker failed to start:', error);
+});
@@ -0,0 +1,204 @@
+import { describe, expect, it } from 'vitest';
+import { ParseError, TimeoutError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { PgParserPool } from './pool.js';
+import { unwrapParseResult } from './util.js';
+import {
+  createInlineWorker,
+  HANG,
+  type InlineWorker,
+} from '../test/utils/pool.js';
+
+describe.each([15, 16, 17])('pool (v%i)', (version) => {
+  function createPool(size = 1) {
+    const workers: InlineWorker[] = [];
+    const pool = new PgParserPool({
+      version,
+      size,
+      createWorker: createInlineWorker(workers),
+    }) as PgParserPool;
+    return { pool, workers };
+  }
+
+  it('parses on a worker', async () => {
+    const { pool } = createPool();
+    const result = await unwrapParseResult(pool.parse('SELECT 1'));
+
+    expect(Math.floor(result.version / 10000)).toBe(version);
+    expect(result.stmts).toHaveLength(1);
+
+    await pool.destroy();
+  });
+
+  it('rehydrates parse errors', async () => {
+    const { pool } = createPool();
+    const sql = 'SELECT my_column, FROM my_table;';
+    const { error } = await pool.parse(sql);
+
+    expect(error).toBeInstanceOf(ParseError);
+    expect(error).toMatchObject({
+      type: 'syntax',
+      position: sql.indexOf('FROM'),
+    });
+
+    await pool.destroy();
+  });
+
+  it('counts statements without sending the tree back', async () => {
+    const { pool } = createPool();
+
+    expect(await pool.countStatements('SELECT 1; SELECT 2')).toStrictEqual({
+      statements: 2,
+      error: undefined,
+    });
+    expect(await pool.countStatements('')).toStrictEqual({
+      statements: 0,
+      error: undefined,
+    });
+
+    const { statements, error } = await pool.countStatements('SELECT FROM');
+    expect(statements).toBeUndefined();
+    expect(error).toBeInstanceOf(ParseError);
+
+    await pool.destroy();
+  });
+
+  it('times out and replaces the worker', async () => {
+    const { pool, workers } = createPool();
+
+    await expect(
+      pool.parse(`SELECT 1 ${HANG}`, { timeoutMs: 20 })
+    ).rejects.toThrow(TimeoutError);
+
+    expect(workers[0]!.terminated).toBe(true);
+    expect(workers).toHaveLength(2);
+    expect(pool.restarts).toBe(1);
+
+    const result = await unwrapParseResult(pool.parse('SELECT 1'));
+    expect(result.stmts).toHaveLength(1);
+
+    await pool.destroy();
+  });
+
+  it('cancels a running call with an AbortSignal', async () => {
+    const { pool, workers } = createPool();
+    const controller = new AbortController();
+
+    const promise = pool.parse(`SELECT 1 ${HANG}`, {
+      signal: controller.signal,
+    });
+    controller.abort(new Error('cancelled'));
+
+    await expect(promise).rejects.toThrow('cancelled');
+    expect(workers[0]!.terminated).toBe(true);
+    expect(pool.restarts).toBe(1);
+
+    await pool.destroy();
+  });
+
+  it('rejects immediately when the signal is already aborted', async () => {
+    const { pool } = createPool();
+
+    await expect(
+      pool.parse('SELECT 1', { signal: AbortSignal.abort() })
+    ).rejects.toThrow();
+    expect(pool.restarts).toBe(0);
+
+    await pool.destroy();
+  });
+
+  it('times out queued calls without touching busy workers', async () => {
+    const { pool, workers } = createPool();
+
+    const hung = pool.parse(`SELECT 1 ${HANG}`, { timeoutMs: 100 });
+    const queued = pool.parse('SELECT 2', { timeoutMs: 10 });
+
+    await expect(queued).rejects.toThrow(TimeoutError);
+    expect(workers).toHaveLength(1);
+
+    await expect(hung).rejects.toThrow(TimeoutError);
+    expect(pool.restarts).toBe(1);
+
+    await pool.destroy();
+  });
+
+  it('runs calls concurrently across workers', async () => {
+    const { pool } = createPool(4);
+
+    const results = await Promise.all(
+      Array.from({ length: 16 }, (_, i) =>
+        unwrapParseResult(pool.parse(`SELECT ${i}`, { timeoutMs: 5000 }))
+      )
+    );
+
+    expect(results).toHaveLength(16);
+
+    await pool.destroy();
+  });
+
+  describe('parseScriptParallel', () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+    const script = [
+      '-- setup',
+      'CREATE TABLE "🐘" (id int, name text);',
+      ...Array.from(
+        { length: 30 },
+        (_, i) => `SELECT id, 'ü${i}' FROM "🐘" WHERE id = ${i};`
+      ),
+      ';',
+      "INSERT INTO \"🐘\" VALUES (1, 'one') /* trailing */;",
+      'SELECT 1',
+    ].join('\n');
+
+    it('returns the same tree as a single parse', async () => {
+      const { pool } = createPool(3);
+
+      expect(await pool.parseScriptParallel(script)).toStrictEqual(
+        await pgParser.parse(script)
+      );
+
+      await pool.destroy();
+    });
+
+    it.skipIf(version < 17)(
+      'shifts every *_location field, not just location',
+      async () => {
+        const { pool } = createPool(3);
+        const sql = `${script};\nSELECT * FROM JSON_TABLE('[]', '$[*]' AS root COLUMNS (a int PATH '$.a')) jt;`;
+
+        const expected = await pgParser.parse(sql);
+
+        expect(JSON.stringify(expected.tree)).toContain('"name_location"');
+        expect(await pool.parseScriptParallel(sql)).toStrictEqual(expected);
+
+        await pool.destroy();
+      }
+    );
+
+    it('reports errors at their position in the whole script', async () => {
+      const { pool } = createPool(3);
+      const sql = `${script};\nSELECT * FROM;\nSELECT 2;`;
+
+      const { error } = await pool.parseScriptParallel(sql);
+      const expected = (await pgParser.parse(sql)).error!;
+
+      expect(error).toBeInstanceOf(ParseError);
+      expect(error).toMatchObject({
+        message: expected.message,
+        type: expected.type,
+        position: expected.position,
+      });
+
+      await pool.destroy();
+    });
+
+    it('falls back to a single parse for scanner errors', async () => {
+      const { pool } = createPool(3);
+      const { error } = await pool.parseScriptParallel("SELECT 1; SELECT '");
+
+      expect(error).toBeInstanceOf(ParseError);
+
+      await pool.destroy();
+    });
+  });
+});
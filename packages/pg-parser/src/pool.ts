@@ -0,0 +1,536 @@
+/// <reference types="node" />
+
+import { TimeoutError, type ParseError } from './errors.js';
+import {
+  deserializeError,
+  deserializeResult,
+  type PoolMethod,
+  type PoolRequest,
+  type PoolResponse,
+} from './pool-handler.js';
+import type {
+  ParseOptions,
+  ParseResult,
+  SplitStatement,
+  SupportedVersion,
+  WrappedParseResult,
+  WrappedSplitResult,
+} from './types/index.js';
+import { isSupportedVersion } from './util.js';
+
+export type { PoolRequest, PoolResponse } from './pool-handler.js';
+
+const textEncoder = new TextEncoder();
+const textDecoder = new TextDecoder();
+
+const SEMICOLON = 0x3b;
+
+/**
+ * A minimal worker interface so the pool can run on Web Workers,
+ * Node.js `worker_threads`, or a custom implementation.
+ */
+export interface PoolWorker {
+  postMessage(request: PoolRequest): void;
+  onMessage(listener: (response: PoolResponse) => void): void;
+  onError(listener: (error: unknown) => void): void;
+  terminate(): unknown;
+}
+
+export type PgParserPoolOptions<Version extends SupportedVersion> = {
+  version?: Version | number;
+
+  /**
+   * Number of workers. Defaults to the number of logical CPUs
+   * (when the runtime exposes it), otherwise 4.
+   */
+  size?: number;
+
+  /**
+   * Creates a worker running the `pool-worker` entry point.
+   * Override this when your bundler needs the worker URL spelled out.
+   */
+  createWorker?: () => PoolWorker | Promise<PoolWorker>;
+};
+
+export type PoolCallOptions = {
+  /**
+   * Maximum time in milliseconds the call may take, including time spent
+   * waiting for a free worker. On expiry the call rejects with a
+   * `TimeoutError` and its worker is terminated and replaced.
+   */
+  timeoutMs?: number;
+
+  /**
+   * Cancels the call. Rejects with `signal.reason` and terminates the
+   * worker if the call was already running.
+   */
+  signal?: AbortSignal;
+};
+
+export type StatementCountResult =
+  | { statements: number; error: undefined }
+  | { statements: undefined; error: ParseError };
+
+type Slot = {
+  worker: Promise<PoolWorker>;
+  generation: number;
+  task?: Task;
+};
+
+type Task = {
+  id: number;
+  method: PoolMethod;
+  args: unknown[];
+  resolve: (result: unknown) => void;
+  reject: (error: unknown) => void;
+  cleanup: () => void;
+  slot?: Slot;
+  settled: boolean;
+};
+
+/**
+ * Runs `PgParser` operations on a pool of workers so that pathological
+ * input can be cut off with a timeout or an `AbortSignal`.
+ *
+ * A WASM call can't be interrupted from the outside, so cancelling a
+ * running call terminates its worker and spawns a fresh one.
+ */
+export class PgParserPool<Version extends SupportedVersion = 17> {
+  readonly version: Version;
+  readonly size: number;
+
+  #createWorker: () => PoolWorker | Promise<PoolWorker>;
+  #slots: Slot[] = [];
+  #queue: Task[] = [];
+  #nextId = 0;
+  #restarts = 0;
+  #destroyed = false;
+
+  constructor({
+    version = 17,
+    size = defaultPoolSize(),
+    createWorker = createDefaultWorker,
+  }: PgParserPoolOptions<Version> = {}) {
+    if (!isSupportedVersion(version)) {
+      throw new Error(`unsupported version: ${version}`);
+    }
+    if (!Number.isInteger(size) || size < 1) {
+      throw new Error(`invalid pool size: ${size}`);
+    }
+
+    this.version = version as Version;
+    this.size = size;
+    this.#createWorker = createWorker;
+
+    for (let i = 0; i < size; i++) {
+      const slot = { generation: 0 } as Slot;
+      slot.worker = this.#spawn(slot);
+      slot.worker.catch(() => {}); // Surfaced to the tasks that use it
+      this.#slots.push(slot);
+    }
+  }
+
+  /**
+   * Number of workers that were terminated and replaced because a call
+   * timed out, was aborted, or crashed its worker.
+   */
+  get restarts() {
+    return this.#restarts;
+  }
+
+  /**
+   * Parses a SQL string into an AST on a pool worker.
+   */
+  async parse(
+    sql: string,
+    { timeoutMs, signal, ...options }: PoolCallOptions & ParseOptions = {}
+  ): Promise<WrappedParseResult<Version>> {
+    return await this.#call('parse', [sql, options], { timeoutMs, signal });
+  }
+
+  /**
+   * Parses a SQL string on a pool worker and returns only its number of
+   * statements, for callers that don't need the AST sent back.
+   */
+  async countStatements(
+    sql: string,
+    { timeoutMs, signal, ...options }: PoolCallOptions & ParseOptions = {}
+  ): Promise<StatementCountResult> {
+    return await this.#call('countStatements', [sql, options], {
+      timeoutMs,
+      signal,
+    });
+  }
+
+  /**
+   * Parses a multi-statement script using every worker in the pool, and
+   * returns the same result as `parse()` would for the whole script.
+   *
+   * The script is split into statements once with the scanner and cut at
+   * statement boundaries into one contiguous range per worker, balanced
+   * by size. Each worker parses its range and shifts the locations in its
+   * tree to be absolute, and the statements are merged back in order. If
+   * any range fails to parse, the error from the first one is returned,
+   * with its position in the whole script.
+   *
+   * `timeoutMs` and `signal` apply to the call as a whole.
+   */
+  async parseScriptParallel(
+    sql: string,
+    { timeoutMs, signal }: PoolCallOptions = {}
+  ): Promise<WrappedParseResult<Version>> {
+    const deadline =
+      timeoutMs === undefined ? undefined : Date.now() + timeoutMs;
+    const remaining = () =>
+      deadline === undefined ? undefined : Math.max(deadline - Date.now(), 0);
+
+    const { statements } = await this.#call<WrappedSplitResult>(
+      'split',
+      [sql],
+      { timeoutMs: remaining(), signal }
+    );
+
+    // Nothing to gain, or input the scanner rejects: a single parse
+    // reports the error
+    if (!statements || statements.length < 2 || this.size < 2) {
+      return await this.#call('parse', [sql, {}], {
+        timeoutMs: remaining(),
+        signal,
+      });
+    }
+
+    const ranges = splitRanges(textEncoder.encode(sql), statements, this.size);
+
+    // A failed range cancels the others
+    const controller = new AbortController();
+    const onAbort = () => controller.abort(signal!.reason);
+    signal?.addEventListener('abort', onAbort);
+
+    try {
+      const results = await Promise.all(
+        ranges.map(({ text, byteOffset, charOffset }) =>
+          this.#call<WrappedParseResult<Version>>(
+            'parseRange',
+            [text, byteOffset, charOffset],
+            { timeoutMs: remaining(), signal: controller.signal }
+          ).catch((error) => {
+            controller.abort(error);
+            throw error;
+          })
+        )
+      );
+
+      const failed = results.find(({ error }) => error);
+      if (failed) {
+        return failed;
+      }
+
+      const tree = {
+        ...results[0]!.tree,
+        stmts: results.flatMap(({ tree }) => tree?.stmts ?? []),
+      } as ParseResult<Version>;
+
+      return { tree, error: undefined };
+    } finally {
+      signal?.removeEventListener('abort', onAbort);
+    }
+  }
+
+  /**
+   * Terminates all workers. Pending calls are rejected.
+   */
+  async destroy() {
+    this.#destroyed = true;
+
+    const error = new Error('pool destroyed');
+    for (const task of [...this.#queue]) {
+      this.#settle(task, () => task.reject(error));
+    }
+    for (const slot of this.#slots) {
+      if (slot.task) {
+        const task = slot.task;
+        this.#settle(task, () => task.reject(error));
+      }
+    }
+
+    await Promise.allSettled(
+      this.#slots.map(async (slot) => (await slot.worker).terminate())
+    );
+  }
+
+  #call<T>(
+    method: PoolMethod,
+    args: unknown[],
+    { timeoutMs, signal }: PoolCallOptions
+  ): Promise<T> {
+    if (this.#destroyed) {
+      return Promise.reject(new Error('pool destroyed'));
+    }
+    if (signal?.aborted) {
+      return Promise.reject(signal.reason);
+    }
+
+    return new Promise<T>((resolve, reject) => {
+      let timer: ReturnType<typeof setTimeout> | undefined;
+
+      const task: Task = {
+        id: this.#nextId++,
+        method,
+        args,
+        resolve: (result) => resolve(deserializeResult<T>(result)),
+        reject,
+        cleanup: () => {
+          clearTimeout(timer);
+          signal?.removeEventListener('abort', onAbort);
+        },
+        settled: false,
+      };
+
+      const onAbort = () => this.#cancel(task, signal!.reason);
+      signal?.addEventListener('abort', onAbort);
+
+      if (timeoutMs !== undefined) {
+        timer = setTimeout(() => {
+          this.#cancel(
+            task,
+            new TimeoutError(`${method} timed out after ${timeoutMs}ms`, {
+              timeoutMs,
+            })
+          );
+        }, timeoutMs);
+      }
+
+      this.#queue.push(task);
+      this.#dispatch();
+    });
+  }
+
+  /**
+   * Hands queued tasks to idle workers.
+   */
+  #dispatch() {
+    for (const slot of this.#slots) {
+      if (slot.task) {
+        continue;
+      }
+
+      const task = this.#queue.shift();
+      if (!task) {
+        return;
+      }
+
+      slot.task = task;
+      task.slot = slot;
+
+      const { id, method, args } = task;
+      slot.worker.then(
+        (worker) => {
+          // The task may have been cancelled while the worker was starting
+          if (slot.task === task) {
+            worker.postMessage({ type: 'call', id, method, args });
+          }
+        },
+        (error) => this.#settle(task, () => task.reject(error))
+      );
+    }
+  }
+
+  /**
+   * Rejects a task early. A running task takes its worker down with it.
+   */
+  #cancel(task: Task, reason: unknown) {
+    const { slot } = task;
+
+    this.#settle(task, () => task.reject(reason));
+
+    if (slot) {
+      this.#restart(slot);
+    }
+
+    this.#dispatch();
+  }
+
+  #settle(task: Task, settle: () => void) {
+    if (task.settled) {
+      return;
+    }
+
+    task.settled = true;
+    task.cleanup();
+
+    if (task.slot) {
+      task.slot.task = undefined;
+    } else {
+      const index = this.#queue.indexOf(task);
+      if (index !== -1) {
+        this.#queue.splice(index, 1);
+      }
+    }
+
+    settle();
+  }
+
+  #restart(slot: Slot) {
+    if (this.#destroyed) {
+      return;
+    }
+
+    const previous = slot.worker;
+    slot.generation++;
+    slot.worker = this.#spawn(slot);
+    slot.worker.catch(() => {}); // Surfaced to the tasks that use it
+    this.#restarts++;
+
+    previous.then(
+      (worker) => worker.terminate(),
+      () => {}
+    );
+  }
+
+  async #spawn(slot: Slot): Promise<PoolWorker> {
+    // Captured before the first await, so replies from a worker that has
+    // since been replaced can be told apart
+    const { generation } = slot;
+    const current = () => slot.generation === generation;
+
+    const worker = await this.#createWorker();
+
+    worker.onMessage((response) => {
+      const task = slot.task;
+
+      // Ignore late replies from terminated workers and stale calls
+      if (!current() || !task || task.id !== response.id) {
+        return;
+      }
+
+      switch (response.type) {
+        case 'result':
+          this.#settle(task, () => task.resolve(response.result));
+          break;
+        case 'error':
+          this.#settle(task, () =>
+            task.reject(deserializeError(response.error))
+          );
+          break;
+      }
+
+      this.#dispatch();
+    });
+
+    worker.onError((error) => {
+      if (!current()) {
+        return;
+      }
+
+      const task = slot.task;
+      if (task) {
+        this.#settle(task, () => task.reject(error));
+      }
+
+      this.#restart(slot);
+      this.#dispatch();
+    });
+
+    worker.postMessage({ type: 'init', version: this.version });
+
+    return worker;
+  }
+}
+
+type ScriptRange = {
+  text: string;
+  byteOffset: number;
+  /** In characters (code points), the unit of `ParseError` positions */
+  charOffset: number;
+};
+
+/**
+ * Cuts a script into at most `count` contiguous ranges of whole statements
+ * with roughly equal byte sizes.
+ *
+ * Ranges end right after a statement's semicolon, which is where the
+ * parser starts the next statement, so each range parses to exactly the
+ * statements it would have in the whole script.
+ */
+function splitRanges(
+  bytes: Uint8Array,
+  statements: SplitStatement[],
+  count: number
+) {
+  const ranges: ScriptRange[] = [];
+  let start = 0;
+  let charOffset = 0;
+
+  const push = (end: number) => {
+    const text = textDecoder.decode(bytes.subarray(start, end));
+    ranges.push({ text, byteOffset: start, charOffset });
+    charOffset += countCodePoints(text);
+    start = end;
+  };
+
+  // The last statement always ends the last range
+  for (const { end } of statements.slice(0, -1)) {
+    if (ranges.length === count - 1) {
+      break;
+    }
+
+    const target = (bytes.length * (ranges.length + 1)) / count;
+    if (end >= target && bytes[end] === SEMICOLON) {
+      push(end + 1);
+    }
+  }
+
+  push(bytes.length);
+  return ranges;
+}
+
+function countCodePoints(text: string) {
+  let count = text.length;
+  for (let i = 0; i < text.length; i++) {
+    const code = text.charCodeAt(i);
+    // Count each surrogate pair once
+    if (code >= 0xd800 && code <= 0xdbff) {
+      count--;
+    }
+  }
+  return count;
+}
+
+function defaultPoolSize() {
+  const navigator = (globalThis as { navigator?: Navigator }).navigator;
+  return navigator?.hardwareConcurrency || 4;
+}
+
+/**
+ * Starts the bundled `pool-worker` entry point using whichever worker
+ * API the runtime provides.
+ */
+async function createDefaultWorker(): Promise<PoolWorker> {
+  const url = new URL('./pool-worker.js', import.meta.url);
+
+  if (typeof Worker !== 'undefined') {
+    const worker = new Worker(url, { type: 'module' });
+    return {
+      postMessage: (request) => worker.postMessage(request),
+      onMessage: (listener) =>
+        worker.addEventListener('message', (event) => listener(event.data)),
+      onError: (listener) =>
+        worker.addEventListener('error', (event) =>
+          listener(event.error ?? new Error(event.message))
+        ),
+      terminate: () => worker.terminate(),
+    };
+  }
+
+  const { Worker: NodeWorker } = await import(
+    /* webpackIgnore: true */ 'node:worker_threads'
+  );
+
+  const worker = new NodeWorker(url);
+  return {
+    postMessage: (request) => worker.postMessage(request),
+    onMessage: (listener) => worker.on('message', listener),
+    onError: (listener) => worker.on('error', listener),
+    terminate: () => worker.terminate(),
+  };
+}
@@ -0,0 +1,116 @@
+import { afterEach, describe, expect, it, vi } from 'vitest';
+import { WasmAbortError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapDeparseResult, unwrapParseResult } from './util.js';
+
+const TRAP = 'SELECT /* trap */ 1';
+
+/**
+ * Makes calls with `TRAP` as input throw the way a trapped WASM
+ * instance would, for traps that are hard to cause on demand. The throw
+ * happens inside the parser's guarded section, so recovery runs against
+ * the real module. Real traps from C are covered by `trapForTesting()`.
+ */
+function simulateTrap(error: unknown) {
+  const encode = TextEncoder.prototype.encode;
+
+  vi.spyOn(TextEncoder.prototype, 'encode').mockImplementation(function (
+    this: TextEncoder,
+    input?: string,
+  ) {
+    if (input === TRAP) {
+      throw error;
+    }
+    return encode.call(this, input);
+  });
+}
+
+describe.each([15, 16, 17])('recovery (v%i)', (version) => {
+  afterEach(() => {
+    vi.restoreAllMocks();
+  });
+
+  it('fails the trapping call with a WasmAbortError', async () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+    simulateTrap(new WebAssembly.RuntimeError('unreachable'));
+
+    const promise = pgParser.parse(TRAP);
+
+    await expect(promise).rejects.toThrow(WasmAbortError);
+    await expect(promise).rejects.toThrow('unreachable');
+    expect(pgParser.recoveries).toBe(1);
+  });
+
+  it('keeps working after a trap', async () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+    simulateTrap(new WebAssembly.RuntimeError('Aborted(OOM)'));
+
+    await expect(pgParser.parse(TRAP)).rejects.toThrow(WasmAbortError);
+
+    const tree = await unwrapParseResult(pgParser.parse('SELECT 1'));
+    expect(tree.stmts).toHaveLength(1);
+
+    const { sql } = await pgParser.deparse(tree);
+    expect(sql).toBe('SELECT 1');
+  });
+
+  it('recovers repeatedly', async () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+    simulateTrap(new WebAssembly.RuntimeError('unreachable'));
+
+    for (let i = 0; i < 3; i++) {
+      await expect(pgParser.parse(TRAP)).rejects.toThrow(WasmAbortError);
+      await unwrapParseResult(pgParser.parse('SELECT 1'));
+    }
+
+    expect(pgParser.recoveries).toBe(3);
+  });
+
+  it('releases grown memory when replacing the instance', async () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+
+    await pgParser.parse(`SELECT '${'x'.repeat(20_000_000)}'`);
+    const grownHeapSize = await pgParser.getHeapSize();
+
+    simulateTrap(new WebAssembly.RuntimeError('unreachable'));
+    await expect(pgParser.parse(TRAP)).rejects.toThrow(WasmAbortError);
+
+    expect(await pgParser.getHeapSize()).toBeLessThan(grownHeapSize);
+  });
+
+  it.for(['unreachable', 'abort'] as const)(
+    'recovers from a real %s trap',
+    async (kind, ctx) => {
+      const pgParser = new PgParser({ version }) as PgParser;
+      await pgParser.parse(`SELECT '${'x'.repeat(20_000_000)}'`);
+      const grownHeapSize = await pgParser.getHeapSize();
+
+      const promise = pgParser.trapForTesting(kind);
+      if ((await promise.catch(() => true)) === false) {
+        // Release build without test hooks
+        return ctx.skip();
+      }
+
+      await expect(promise).rejects.toThrow(WasmAbortError);
+      expect(pgParser.recoveries).toBe(1);
+      expect(await pgParser.getHeapSize()).toBeLessThan(grownHeapSize);
+
+      const tree = await unwrapParseResult(pgParser.parse('SELECT 1'));
+      expect(await unwrapDeparseResult(pgParser.deparse(tree))).toBe(
+        'SELECT 1',
+      );
+    },
+  );
+
+  it('does not recover from ordinary errors', async () => {
+    const pgParser = new PgParser({ version }) as PgParser;
+    simulateTrap(new TypeError('not a trap'));
+
+    await expect(pgParser.parse(TRAP)).rejects.toThrow(TypeError);
+    expect(pgParser.recoveries).toBe(0);
+
+    const { error } = await pgParser.parse('SELECT FROM WHERE');
+    expect(error?.type).toBe('syntax');
+    expect(pgParser.recoveries).toBe(0);
+  });
+});
@@ -0,0 +1,264 @@
+import { describe, expect, it } from 'vitest';
+import { DeparseError, ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import type { RewriteOperation } from './types/index.js';
+import { unwrapRewriteResult } from './util.js';
+
+describe.each([15, 16, 17])('rewrite (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function rewrite(sql: string, operations: RewriteOperation[]) {
+    return await unwrapRewriteResult(pgParser.rewrite(sql, operations));
+  }
+
+  it('qualifies unqualified relations', async () => {
+    const sql = await rewrite(
+      'WITH recent AS (SELECT * FROM orders) SELECT * FROM recent JOIN app.users ON true',
+      [{ type: 'qualifySchema', schema: 'tenant_42' }],
+    );
+
+    expect(sql).toBe(
+      'WITH recent AS (SELECT * FROM tenant_42.orders) SELECT * FROM recent JOIN app.users ON true',
+    );
+  });
+
+  it('renames relations and qualified column references', async () => {
+    const sql = await rewrite(
+      'SELECT users.id, name FROM users WHERE users.active',
+      [{ type: 'renameRelation', from: 'users', to: 'accounts' }],
+    );
+
+    expect(sql).toBe(
+      'SELECT accounts.id, name FROM accounts WHERE accounts.active',
+    );
+  });
+
+  it('leaves column references to a CTE of the same name alone', async () => {
+    const sql = await rewrite(
+      'WITH users AS (SELECT id FROM users) SELECT users.id FROM users',
+      [{ type: 'renameRelation', from: 'users', to: 'accounts' }],
+    );
+
+    expect(sql).toBe(
+      'WITH users AS (SELECT id FROM accounts) SELECT users.id FROM users',
+    );
+  });
+
+  it('leaves column references through aliases alone', async () => {
+    const sql = await rewrite(
+      'SELECT users.id, u.name FROM orders users JOIN users u ON u.id = users.user_id',
+      [{ type: 'renameRelation', from: 'users', to: 'accounts' }],
+    );
+
+    expect(sql).toBe(
+      'SELECT users.id, u.name FROM orders users JOIN accounts u ON u.id = users.user_id',
+    );
+  });
+
+  it('renames column references that resolve to an outer query', async () => {
+    const sql = await rewrite(
+      'SELECT * FROM users WHERE EXISTS (SELECT 1 FROM orders WHERE orders.user_id = users.id)',
+      [{ type: 'renameRelation', from: 'users', to: 'accounts' }],
+    );
+
+    expect(sql).toBe(
+      'SELECT * FROM accounts WHERE EXISTS (SELECT 1 FROM orders WHERE orders.user_id = accounts.id)',
+    );
+  });
+
+  it('only renames relations in the given schema', async () => {
+    const sql = await rewrite('SELECT * FROM app.users, users', [
+      { type: 'renameRelation', from: 'app.users', to: 'accounts' },
+    ]);
+
+    expect(sql).toBe('SELECT * FROM app.accounts, users');
+  });
+
+  it('renames columns', async () => {
+    const sql = await rewrite(
+      'INSERT INTO users (email) VALUES ($1) ON CONFLICT (email) DO UPDATE SET email = excluded.email',
+      [{ type: 'renameColumn', from: 'email', to: 'address' }],
+    );
+
+    expect(sql).toBe(
+      'INSERT INTO users (address) VALUES ($1) ON CONFLICT (address) DO UPDATE SET address = excluded.address',
+    );
+  });
+
+  it('injects predicates into SELECT', async () => {
+    const sql = await rewrite(
+      "SELECT * FROM orders o JOIN items ON items.order_id = o.id WHERE o.status = 'open'",
+      [{ type: 'injectPredicate', column: 'tenant_id', param: 1 }],
+    );
+
+    expect(sql).toBe(
+      "SELECT * FROM orders o JOIN items ON items.order_id = o.id WHERE o.status = 'open' AND o.tenant_id = $1 AND items.tenant_id = $1",
+    );
+  });
+
+  it('filters the nullable side of outer joins in the join condition', async () => {
+    const sql = await rewrite(
+      'SELECT * FROM orders LEFT JOIN items ON items.order_id = orders.id',
+      [{ type: 'injectPredicate', column: 'tenant_id', param: 1 }],
+    );
+
+    expect(sql).toBe(
+      'SELECT * FROM orders LEFT JOIN items ON items.order_id = orders.id AND items.tenant_id = $1 WHERE orders.tenant_id = $1',
+    );
+  });
+
+  it('injects predicates into subqueries, UPDATE and DELETE', async () => {
+    const operations: RewriteOperation[] = [
+      { type: 'injectPredicate', column: 'tenant_id', param: 3 },
+    ];
+
+    expect(
+      await rewrite('SELECT * FROM (SELECT * FROM orders) sub', operations),
+    ).toBe(
+      'SELECT * FROM (SELECT * FROM orders WHERE orders.tenant_id = $3) sub',
+    );
+    expect(
+      await rewrite('UPDATE users SET name = $1 WHERE id = $2', operations),
+    ).toBe('UPDATE users SET name = $1 WHERE id = $2 AND users.tenant_id = $3');
+    expect(await rewrite('DELETE FROM sessions', operations)).toBe(
+      'DELETE FROM sessions WHERE sessions.tenant_id = $3',
+    );
+  });
+
+  it('only injects predicates for the given relations', async () => {
+    const sql = await rewrite('SELECT * FROM orders, countries', [
+      {
+        type: 'injectPredicate',
+        column: 'tenant_id',
+        param: 1,
+        relations: ['orders'],
+      },
+    ]);
+
+    expect(sql).toBe(
+      'SELECT * FROM orders, countries WHERE orders.tenant_id = $1',
+    );
+  });
+
+  it('applies operations in order', async () => {
+    const sql = await rewrite('SELECT * FROM orders', [
+      { type: 'qualifySchema', schema: 'tenant_42' },
+      {
+        type: 'injectPredicate',
+        column: 'tenant_id',
+        param: 1,
+        relations: ['tenant_42.orders'],
+      },
+    ]);
+
+    expect(sql).toBe(
+      'SELECT * FROM tenant_42.orders WHERE orders.tenant_id = $1',
+    );
+  });
+
+  it('rejects predicates that would change a USING join', async () => {
+    const result = await pgParser.rewrite(
+      'SELECT * FROM orders LEFT JOIN items USING (order_id)',
+      [{ type: 'injectPredicate', column: 'tenant_id', param: 1 }],
+    );
+
+    expect(result.error).toBeInstanceOf(DeparseError);
+    expect(result.error?.message).toMatch(/nullable side/);
+  });
+
+  it('scopes CTE names to their WITH clause', async () => {
+    const operations: RewriteOperation[] = [
+      { type: 'injectPredicate', column: 'tenant_id', param: 1 },
+    ];
+
+    // A non-recursive CTE can't see itself, so its body reads the table
+    expect(
+      await rewrite(
+        'WITH orders AS (SELECT * FROM orders) SELECT * FROM orders',
+        operations,
+      ),
+    ).toBe(
+      'WITH orders AS (SELECT * FROM orders WHERE orders.tenant_id = $1) SELECT * FROM orders',
+    );
+
+    // A CTE in one subquery doesn't hide the table elsewhere
+    expect(
+      await rewrite(
+        'SELECT * FROM (WITH items AS (SELECT 1) SELECT * FROM items) a, items',
+        operations,
+      ),
+    ).toBe(
+      'SELECT * FROM (WITH items AS (SELECT 1) SELECT * FROM items) a, items WHERE items.tenant_id = $1',
+    );
+
+    expect(
+      await rewrite(
+        'WITH orders AS (SELECT * FROM orders) SELECT * FROM orders',
+        [{ type: 'qualifySchema', schema: 's' }],
+      ),
+    ).toBe('WITH orders AS (SELECT * FROM s.orders) SELECT * FROM orders');
+  });
+
+  it('lets recursive CTEs refer to themselves', async () => {
+    const sql = await rewrite(
+      'WITH RECURSIVE tree AS (SELECT id FROM nodes UNION ALL SELECT nodes.id FROM nodes JOIN tree ON nodes.parent = tree.id) SELECT * FROM tree',
+      [{ type: 'qualifySchema', schema: 's' }],
+    );
+
+    expect(sql).toBe(
+      'WITH RECURSIVE tree AS (SELECT id FROM s.nodes UNION ALL SELECT nodes.id FROM s.nodes JOIN tree ON nodes.parent = tree.id) SELECT * FROM tree',
+    );
+  });
+
+  it('rejects predicates on MERGE', async () => {
+    const result = await pgParser.rewrite(
+      'MERGE INTO orders USING staged ON orders.id = staged.id WHEN MATCHED THEN DELETE',
+      [{ type: 'injectPredicate', column: 'tenant_id', param: 1 }],
+    );
+
+    expect(result.error).toBeInstanceOf(DeparseError);
+    expect(result.error?.message).toMatch(/MERGE/);
+  });
+
+  it('rewrites batches', async () => {
+    const results = await pgParser.rewrite(
+      ['SELECT * FROM a', 'SELECT * FROM', 'SELECT * FROM b'],
+      [{ type: 'qualifySchema', schema: 's' }],
+    );
+
+    expect(results.map(({ sql }) => sql)).toStrictEqual([
+      'SELECT * FROM s.a',
+      undefined,
+      'SELECT * FROM s.b',
+    ]);
+    expect(results[1]!.error).toBeInstanceOf(ParseError);
+  });
+
+  it('throws on invalid operations', async () => {
+    await expect(
+      pgParser.rewrite('SELECT 1', [{ type: 'unknown' } as never]),
+    ).rejects.toThrow('unknown rewrite operation type');
+  });
+
+  it('does not leak memory', async () => {
+    const queries = Array.from(
+      { length: 100 },
+      (_, i) =>
+        `SELECT * FROM orders o LEFT JOIN items ON items.order_id = o.id WHERE o.id = ${i}`,
+    );
+    const operations: RewriteOperation[] = [
+      { type: 'qualifySchema', schema: 'tenant_42' },
+      { type: 'renameColumn', from: 'id', to: 'order_id' },
+      { type: 'injectPredicate', column: 'tenant_id', param: 1 },
+    ];
+
+    await pgParser.rewrite(queries, operations);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.rewrite(queries, operations);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
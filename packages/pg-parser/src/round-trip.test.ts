@@ -0,0 +1,95 @@
+/// <reference path="../test/types/sql.d.ts" />
+
+import { describe, expect, it } from 'vitest';
+import { DeparseError, ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import type { ParseResult } from './types/index.js';
+import { unwrapParseResult, unwrapRoundTripResult } from './util.js';
+
+import sqlDump from '../test/fixtures/dump.sql';
+
+describe.each([15, 16, 17])('verifyRoundTrip (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('passes SQL that round-trips', async () => {
+    const roundTrip = await unwrapRoundTripResult(
+      pgParser.verifyRoundTrip(
+        'select u.id,\n       count(*)\n  from users u\n where u.active -- live only\n group by 1',
+      ),
+    );
+
+    expect(roundTrip).toStrictEqual({ equal: true });
+  });
+
+  it('passes trees that round-trip', async () => {
+    const tree = await unwrapParseResult(
+      pgParser.parse('INSERT INTO t (a, b) VALUES ($1, 2) RETURNING a'),
+    );
+
+    expect(
+      await unwrapRoundTripResult(pgParser.verifyRoundTrip(tree)),
+    ).toStrictEqual({ equal: true });
+  });
+
+  it('reports the first path that differs', async () => {
+    const tree = {
+      version: (await unwrapParseResult(pgParser.parse('SELECT 1'))).version,
+      stmts: [
+        {
+          stmt: {
+            SelectStmt: {
+              targetList: [
+                {
+                  ResTarget: {
+                    // Deparses as `1`, which parses back as an integer
+                    val: { A_Const: { fval: { fval: '1' } } },
+                  },
+                },
+              ],
+              limitOption: 'LIMIT_OPTION_DEFAULT',
+              op: 'SETOP_NONE',
+            },
+          },
+        },
+      ],
+    } as ParseResult;
+
+    const roundTrip = await unwrapRoundTripResult(
+      pgParser.verifyRoundTrip(tree),
+    );
+
+    expect(roundTrip).toStrictEqual({
+      equal: false,
+      path: 'stmts[0].stmt.SelectStmt.targetList[0].ResTarget.val.A_Const',
+      sql: 'SELECT 1',
+    });
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.verifyRoundTrip('SELECT FROM WHERE');
+
+    expect(result.roundTrip).toBeUndefined();
+    expect(result.error).toBeInstanceOf(ParseError);
+  });
+
+  it('returns deparse errors for invalid trees', async () => {
+    const result = await pgParser.verifyRoundTrip({
+      version: 0,
+      stmts: [{ stmt: { NotANode: {} } }],
+    } as unknown as ParseResult);
+
+    expect(result.roundTrip).toBeUndefined();
+    expect(result.error).toBeInstanceOf(DeparseError);
+  });
+
+  it('does not leak memory', async () => {
+    await pgParser.verifyRoundTrip(sqlDump);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      await pgParser.verifyRoundTrip(sqlDump);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -2,7 +2,7 @@
 
 import { describe, expect, it } from 'vitest';
 import { PgParser } from './pg-parser.js';
-import { unwrapScanResult } from './util.js';
+import { unwrapScanResult, unwrapSplitResult } from './util.js';
 
 import sqlDump from '../test/fixtures/dump.sql';
 
@@ -284,3 +284,55 @@ describe.each([15, 16, 17])('scanner (v%i)', (version) => {
     expect(heapAfter - heapBefore).toBeLessThan(64 * 1024);
   });
 });
+
+describe.each([15, 16, 17])('splitter (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  it('splits SQL into statements', async () => {
+    const statements = await unwrapSplitResult(
+      pgParser.split('SELECT 1; SELECT 2;'),
+    );
+
+    expect(statements).toHaveLength(2);
+    expect(statements[0]).toEqual({ text: 'SELECT 1', start: 0, end: 8 });
+    expect(statements[1]!.text.trim()).toBe('SELECT 2');
+    expect(statements[1]!.end).toBe(18);
+  });
+
+  it('does not split on semicolons inside strings or bodies', async () => {
+    const statements = await unwrapSplitResult(
+      pgParser.split(
+        "SELECT ';'; CREATE FUNCTION f() RETURNS int AS $$ SELECT 1; $$ LANGUAGE sql;",
+      ),
+    );
+
+    expect(statements).toHaveLength(2);
+    expect(statements[1]!.text).toContain('$$ SELECT 1; $$');
+  });
+
+  it('uses byte offsets for multi-byte input', async () => {
+    const sql = "SELECT '🐘'; SELECT 2";
+    const statements = await unwrapSplitResult(pgParser.split(sql));
+
+    const sqlBytes = new TextEncoder().encode(sql);
+    const decoder = new TextDecoder();
+
+    for (const statement of statements) {
+      expect(
+        decoder.decode(sqlBytes.slice(statement.start, statement.end)),
+      ).toBe(statement.text);
+    }
+  });
+
+  it('splits large SQL', async () => {
+    const statements = await unwrapSplitResult(pgParser.split(sqlDump));
+    expect(statements.length).toBeGreaterThan(0);
+  });
+
+  it('returns error for unterminated input', async () => {
+    const result = await pgParser.split("SELECT 'unterminated");
+
+    expect(result.error).toBeDefined();
+    expect(result.error!.name).toBe('ScanError');
+  });
+});
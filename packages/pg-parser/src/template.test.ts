@@ -0,0 +1,149 @@
+import { describe, expect, it } from 'vitest';
+import { ParseError } from './errors.js';
+import { PgParser } from './pg-parser.js';
+import { unwrapRenderResult, unwrapTemplateResult } from './util.js';
+
+describe.each([15, 16, 17])('templates (v%i)', (version) => {
+  const pgParser = new PgParser({ version }) as PgParser;
+
+  async function compile(sql: string) {
+    return await unwrapTemplateResult(pgParser.compileTemplate(sql));
+  }
+
+  it('reports placeholders', async () => {
+    const template = await compile(
+      'SELECT "{column}" FROM "{schema}"."{table}" WHERE "{column}" = $2',
+    );
+
+    expect(template.identifiers).toStrictEqual(['column', 'schema', 'table']);
+    expect(template.params).toBe(2);
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('renders identifiers and values', async () => {
+    const template = await compile(
+      'SELECT o.id, o."{column}" AS total FROM "{table}" o WHERE o.status = $1 AND o.total > $2 LIMIT $3',
+    );
+
+    const sql = await unwrapRenderResult(
+      pgParser.render(template, {
+        identifiers: { table: 'orders', column: 'Total' },
+        values: ['open', 10.5, 50],
+      }),
+    );
+
+    expect(sql).toBe(
+      `SELECT o.id, o."Total" AS total FROM orders o WHERE o.status = 'open' AND o.total > 10.5 LIMIT 50`,
+    );
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('renders the same template many times', async () => {
+    const template = await compile('SELECT * FROM users WHERE id = $1');
+
+    for (const id of [1, 2, 3]) {
+      expect(
+        await unwrapRenderResult(pgParser.render(template, { values: [id] })),
+      ).toBe(`SELECT * FROM users WHERE id = ${id}`);
+    }
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('renders every kind of value', async () => {
+    const template = await compile('SELECT $1, $2, $3, $4, $5, $6, $7');
+
+    const sql = await unwrapRenderResult(
+      pgParser.render(template, {
+        values: [null, true, "it's", -7, 3000000000, 12345678901234567890n],
+      }),
+    );
+
+    expect(sql).toBe(
+      `SELECT NULL, true, 'it''s', -7, 3000000000, 12345678901234567890, $7`,
+    );
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('renders numbers in exponent notation', async () => {
+    const template = await compile('SELECT $1, $2');
+
+    const sql = await unwrapRenderResult(
+      pgParser.render(template, { values: [1e21, -1.5e-7] }),
+    );
+
+    expect(sql).toBe('SELECT 1e+21, -1.5e-7');
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('leaves string literals alone', async () => {
+    const template = await compile(`SELECT '{table}' FROM "{table}"`);
+
+    expect(template.identifiers).toStrictEqual(['table']);
+    expect(
+      await unwrapRenderResult(
+        pgParser.render(template, { identifiers: { table: 't' } }),
+      ),
+    ).toBe(`SELECT '{table}' FROM t`);
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('returns parse errors', async () => {
+    const result = await pgParser.compileTemplate('SELECT FROM WHERE $1');
+
+    expect(result.template).toBeUndefined();
+    expect(result.error).toBeInstanceOf(ParseError);
+  });
+
+  it('throws on missing identifiers and bad values', async () => {
+    const template = await compile('SELECT $1 FROM "{table}"');
+
+    await expect(pgParser.render(template, { values: [1] })).rejects.toThrow(
+      'missing identifier for placeholder "{table}"',
+    );
+    await expect(
+      pgParser.render(template, {
+        identifiers: { table: 't' },
+        values: [Infinity],
+      }),
+    ).rejects.toThrow('cannot render Infinity as a literal');
+
+    await pgParser.releaseTemplate(template);
+  });
+
+  it('throws on released templates', async () => {
+    const template = await compile('SELECT 1');
+    await pgParser.releaseTemplate(template);
+
+    await expect(pgParser.render(template)).rejects.toThrow(
+      'unknown template',
+    );
+  });
+
+  it('does not leak memory', async () => {
+    const sql =
+      'SELECT "{column}" FROM "{table}" WHERE id = $1 AND name = $2 LIMIT $3';
+    const bindings = {
+      identifiers: { table: 'users', column: 'email' },
+      values: [42, 'bob', 10],
+    };
+
+    const warmup = await compile(sql);
+    await pgParser.render(warmup, bindings);
+    await pgParser.releaseTemplate(warmup);
+    const heapSize = await pgParser.getHeapSize();
+
+    for (let i = 0; i < 20; i++) {
+      const template = await compile(sql);
+      await pgParser.render(template, bindings);
+      await pgParser.releaseTemplate(template);
+    }
+
+    expect(await pgParser.getHeapSize()).toBe(heapSize);
+  });
+});
@@ -45,17 +45,31 @@ export type Node<Version extends SupportedVersion = SupportedVersion> =
 export type WrappedParseSuccess<Version extends SupportedVersion> = {
   tree: ParseResult<Version>;
   error: undefined;
+  /** Parser warnings, one per line, when `diagnostics` was requested */
+  diagnostics?: string[];
 };
 
 export type WrappedParseError = {
   tree: undefined;
   error: ParseError;
+  /** Parser warnings, one per line, when `diagnostics` was requested */
+  diagnostics?: string[];
 };
 
 export type WrappedParseResult<Version extends SupportedVersion> =
   | WrappedParseSuccess<Version>
   | WrappedParseError;
 
+/**
+ * Outcome of `parseMany()`, with each distinct query text parsed once.
+ */
+export type ParseManyResult<Version extends SupportedVersion> = {
+  /** One result per distinct query, in order of first occurrence */
+  results: WrappedParseResult<Version>[];
+  /** For each input query, the index of its result in `results` */
+  indexes: Int32Array;
+};
+
 export type WrappedDeparseSuccess = {
   sql: string;
   error: undefined;
@@ -99,3 +113,588 @@ export type WrappedScanError = {
 };
 
 export type WrappedScanResult = WrappedScanSuccess | WrappedScanError;
+
+export interface SplitStatement {
+  /** The SQL text of the statement (excluding the trailing semicolon) */
+  text: string;
+  /** Start byte offset in the input (0-based, inclusive) */
+  start: number;
+  /** End byte offset in the input (exclusive) */
+  end: number;
+}
+
+export type WrappedSplitSuccess = {
+  statements: SplitStatement[];
+  error: undefined;
+};
+
+export type WrappedSplitError = {
+  statements: undefined;
+  error: ScanError;
+};
+
+export type WrappedSplitResult = WrappedSplitSuccess | WrappedSplitError;
+
+export type WrappedMetricsSuccess = {
+  /**
+   * One array per statement, indexed by `QueryMetric`.
+   */
+  metrics: Int32Array[];
+  error: undefined;
+};
+
+export type WrappedMetricsError = {
+  metrics: undefined;
+  error: ParseError;
+};
+
+export type WrappedMetricsResult = WrappedMetricsSuccess | WrappedMetricsError;
+
+export type ConstantKind =
+  | 'integer'
+  | 'float'
+  | 'string'
+  | 'bitstring'
+  | 'boolean'
+  | 'null'
+  | 'param';
+
+export interface QueryConstant {
+  /** The kind of literal, or `param` for a `$n` parameter reference */
+  kind: ConstantKind;
+  /** Start byte offset in the query (0-based) */
+  location: number;
+  /** Length of the constant's source text in bytes */
+  length: number;
+  /**
+   * The normalized value: the unescaped contents of a string, the digits
+   * of a number, `'true'`/`'false'`, the parameter number of a `$n`
+   * reference, or `null` for SQL `NULL`
+   */
+  value: string | null;
+}
+
+export type WrappedConstantsSuccess = {
+  constants: QueryConstant[];
+  error: undefined;
+};
+
+export type WrappedConstantsError = {
+  constants: undefined;
+  error: ParseError;
+};
+
+export type WrappedConstantsResult =
+  | WrappedConstantsSuccess
+  | WrappedConstantsError;
+
+/**
+ * The type Postgres infers for a literal. String literals are `unknown`:
+ * they take their type from context, just as an untyped parameter does.
+ */
+export type ParameterType =
+  | 'int4'
+  | 'int8'
+  | 'numeric'
+  | 'bool'
+  | 'bit'
+  | 'unknown';
+
+export interface QueryParameter {
+  /** The `$n` number that replaced the literal */
+  number: number;
+  /**
+   * The literal's value: a number for `int4`, a boolean for `bool`, and
+   * otherwise text that Postgres accepts as input for the type (`int8`
+   * and `numeric` are kept as text so no precision is lost)
+   */
+  value: number | boolean | string;
+  type: ParameterType;
+}
+
+export interface ParameterizedQuery {
+  /** The query with its literals replaced by `$n` parameters */
+  sql: string;
+  /** The replaced literals, in parameter order */
+  params: QueryParameter[];
+}
+
+export type WrappedParameterizeSuccess = {
+  query: ParameterizedQuery;
+  error: undefined;
+};
+
+export type WrappedParameterizeError = {
+  query: undefined;
+  error: ParseError;
+};
+
+export type WrappedParameterizeResult =
+  | WrappedParameterizeSuccess
+  | WrappedParameterizeError;
+
+export interface QueryComment {
+  /** `line` for `--` comments, `block` for C-style block comments */
+  kind: 'line' | 'block';
+  /** The full comment, including its delimiters */
+  text: string;
+  /** Start byte offset in the input (0-based, inclusive) */
+  start: number;
+  /** End byte offset in the input (exclusive) */
+  end: number;
+  /**
+   * Decoded sqlcommenter tags (comma-separated `key='value'` pairs in a
+   * block comment). Empty if the comment isn't in sqlcommenter format.
+   */
+  tags: Record<string, string>;
+}
+
+export interface CatalogColumn {
+  name: string;
+  /** Canonical type name as deparsed, e.g. `varchar(255)` or `text[]` */
+  type: string | null;
+  notNull: boolean;
+  /** Default expression as deparsed SQL */
+  default: string | null;
+}
+
+export interface CatalogConstraint {
+  /** `null` for unnamed constraints */
+  name: string | null;
+  type: 'primary_key' | 'unique' | 'foreign_key' | 'check' | 'exclusion';
+  /** Constrained columns (or index expressions for exclusion constraints) */
+  columns: (string | null)[];
+  /** Check expression as deparsed SQL, `null` for other types */
+  expression: string | null;
+  /** Referenced table for foreign keys, `null` for other types */
+  references: {
+    schema: string;
+    table: string;
+    columns: string[];
+  } | null;
+}
+
+export interface CatalogTable {
+  schema: string;
+  name: string;
+  kind: 'table' | 'view' | 'materialized_view' | 'foreign_table';
+  /** Declared columns. Views are listed without columns. */
+  columns: CatalogColumn[];
+  constraints: CatalogConstraint[];
+}
+
+export interface CatalogIndex {
+  /** Always the schema of the indexed table */
+  schema: string;
+  /** `null` when the index name was left for Postgres to choose */
+  name: string | null;
+  table: string;
+  /** Access method, e.g. `btree` or `gin` */
+  method: string;
+  unique: boolean;
+  /** Column names, or deparsed expressions for expression indexes */
+  columns: (string | null)[];
+  /** `WHERE` clause of a partial index as deparsed SQL */
+  predicate: string | null;
+}
+
+export type CatalogType = {
+  schema: string;
+  name: string;
+} & (
+  | { kind: 'enum'; values: string[] }
+  | {
+      kind: 'composite';
+      attributes: { name: string; type: string | null }[];
+    }
+  | { kind: 'domain'; baseType: string | null }
+  | { kind: 'range'; subtype: string | null }
+);
+
+export interface CatalogSequence {
+  schema: string;
+  name: string;
+  /** Column set by `OWNED BY`. `schema` is `null` if it wasn't qualified. */
+  ownedBy: {
+    schema: string | null;
+    table: string;
+    column: string;
+  } | null;
+}
+
+export interface CatalogFunction {
+  schema: string;
+  name: string;
+  kind: 'function' | 'procedure';
+  arguments: {
+    name: string | null;
+    type: string | null;
+    mode: 'in' | 'out' | 'inout' | 'variadic' | 'table';
+  }[];
+  /** Return type as deparsed, `null` for procedures */
+  returns: string | null;
+}
+
+export interface Catalog {
+  /** Schemas created with `CREATE SCHEMA` */
+  schemas: string[];
+  /** Tables, views, materialized views and foreign tables */
+  tables: CatalogTable[];
+  indexes: CatalogIndex[];
+  types: CatalogType[];
+  sequences: CatalogSequence[];
+  functions: CatalogFunction[];
+}
+
+export type WrappedCatalogSuccess = {
+  catalog: Catalog;
+  error: undefined;
+};
+
+export type WrappedCatalogError = {
+  catalog: undefined;
+  error: ParseError;
+};
+
+export type WrappedCatalogResult = WrappedCatalogSuccess | WrappedCatalogError;
+
+export interface StatementDependencies {
+  /** Statement text, without leading comments or the trailing semicolon */
+  text: string;
+  /** Byte offset of the statement in the UTF-8 encoded input */
+  start: number;
+  /** Byte offset just past the end of the statement */
+  end: number;
+  /** Index into `DependencyGraph.layers` */
+  layer: number;
+  /**
+   * Whether the statement can't be attributed to named objects (`SET`,
+   * `CREATE EXTENSION`, `DO`, ...) and is ordered against every statement
+   */
+  barrier: boolean;
+  /** Indexes of earlier statements that must be applied first */
+  dependsOn: number[];
+}
+
+export interface DependencyGraph {
+  statements: StatementDependencies[];
+  /**
+   * Statement indexes grouped by layer. Statements in the same layer are
+   * independent of each other and can be applied concurrently once all
+   * earlier layers have been applied.
+   */
+  layers: number[][];
+}
+
+export type WrappedDependencyGraphSuccess = {
+  graph: DependencyGraph;
+  error: undefined;
+};
+
+export type WrappedDependencyGraphError = {
+  graph: undefined;
+  error: ParseError;
+};
+
+export type WrappedDependencyGraphResult =
+  | WrappedDependencyGraphSuccess
+  | WrappedDependencyGraphError;
+
+/**
+ * A rewrite applied by `rewrite()`. Relation names are `name` (any
+ * schema) or `schema.name`, matched as they appear in the AST: unquoted
+ * identifiers are lower case.
+ */
+export type RewriteOperation =
+  | {
+      /** Qualifies every unqualified relation (except CTEs and temp tables) */
+      type: 'qualifySchema';
+      schema: string;
+    }
+  | {
+      /**
+       * Renames a relation (except CTEs of the same name), along with
+       * column references qualified by its name rather than an alias
+       */
+      type: 'renameRelation';
+      from: string;
+      to: string;
+    }
+  | {
+      /**
+       * Renames a column in column references, `INSERT` column lists,
+       * `UPDATE ... SET` targets and index elements
+       */
+      type: 'renameColumn';
+      from: string;
+      to: string;
+    }
+  | {
+      /**
+       * Adds `<relation>.<column> = $<param>` for every relation read or
+       * written by a `SELECT`, `UPDATE` or `DELETE`. Fails on `MERGE` and
+       * `COPY table`, which have no `WHERE` to add it to.
+       */
+      type: 'injectPredicate';
+      column: string;
+      param: number;
+      /** Only filter these relations. Defaults to all relations. */
+      relations?: string[];
+    };
+
+export type WrappedRewriteSuccess = {
+  sql: string;
+  error: undefined;
+};
+
+export type WrappedRewriteError = {
+  sql: undefined;
+  error: ParseError | DeparseError;
+};
+
+export type WrappedRewriteResult = WrappedRewriteSuccess | WrappedRewriteError;
+
+/**
+ * Layout options for `format()`. Only the Postgres 17 deparser supports
+ * indentation and line wrapping: older versions ignore everything but
+ * `trailingNewline`.
+ */
+export interface FormatOptions {
+  /** Spaces per indentation level (default 4) */
+  indentSize?: number;
+  /** Line length to wrap at where possible (default 80) */
+  maxLineLength?: number;
+  /** Put list commas at the start of lines (default false) */
+  commasStartOfLine?: boolean;
+  /** End the output with a newline (default false) */
+  trailingNewline?: boolean;
+}
+
+export type WrappedFormatSuccess = {
+  sql: string;
+  error: undefined;
+};
+
+export type WrappedFormatError = {
+  sql: undefined;
+  error: ParseError | DeparseError;
+};
+
+export type WrappedFormatResult = WrappedFormatSuccess | WrappedFormatError;
+
+/**
+ * A statement compiled by `compileTemplate()`. Its parse tree stays in
+ * WASM memory until `releaseTemplate()` is called.
+ */
+export interface SqlTemplate {
+  /** The template SQL */
+  readonly sql: string;
+  /** Names of the `"{name}"` identifier placeholders, in order of appearance */
+  readonly identifiers: string[];
+  /** Highest `$n` parameter number, 0 if there are none */
+  readonly params: number;
+}
+
+/**
+ * A value rendered as a literal. Integers that fit in 32 bits render as
+ * integer constants, other numbers as numeric constants.
+ */
+export type TemplateValue = string | number | bigint | boolean | null;
+
+export interface TemplateBindings {
+  /** Identifiers for the `"{name}"` placeholders, by name */
+  identifiers?: Record<string, string>;
+  /**
+   * Values for `$n` parameters: `values[0]` is bound to `$1`. Parameters
+   * without a value stay parameters.
+   */
+  values?: TemplateValue[];
+}
+
+export type WrappedTemplateSuccess = {
+  template: SqlTemplate;
+  error: undefined;
+};
+
+export type WrappedTemplateError = {
+  template: undefined;
+  error: ParseError;
+};
+
+export type WrappedTemplateResult =
+  | WrappedTemplateSuccess
+  | WrappedTemplateError;
+
+export type WrappedRenderSuccess = {
+  sql: string;
+  error: undefined;
+};
+
+export type WrappedRenderError = {
+  sql: undefined;
+  error: DeparseError;
+};
+
+export type WrappedRenderResult = WrappedRenderSuccess | WrappedRenderError;
+
+/**
+ * Outcome of `verifyRoundTrip()`.
+ */
+export type RoundTripResult =
+  | {
+      equal: true;
+    }
+  | {
+      equal: false;
+      /**
+       * Path to the first value that differs between the original and the
+       * reparsed tree, e.g. `stmts[0].stmt.SelectStmt.limitCount`. Empty
+       * when the deparsed SQL didn't parse at all.
+       */
+      path: string;
+      /** The deparsed SQL that didn't round-trip */
+      sql: string;
+    };
+
+export type WrappedRoundTripSuccess = {
+  roundTrip: RoundTripResult;
+  error: undefined;
+};
+
+export type WrappedRoundTripError = {
+  roundTrip: undefined;
+  error: ParseError | DeparseError;
+};
+
+export type WrappedRoundTripResult =
+  | WrappedRoundTripSuccess
+  | WrappedRoundTripError;
+
+export type WrappedArchiveSuccess = {
+  /** The archive file contents, read back with `PgArchive.open()` */
+  archive: Uint8Array;
+  error: undefined;
+};
+
+export type WrappedArchiveError = {
+  archive: undefined;
+  /**
+   * The parse error of the first query that failed, with that query's
+   * index in `query`
+   */
+  error: ParseError;
+};
+
+export type WrappedArchiveResult = WrappedArchiveSuccess | WrappedArchiveError;
+
+/**
+ * Random-access byte source for `PgArchive.open()`, e.g. an open file.
+ */
+export interface ArchiveSource {
+  /** Total size in bytes */
+  size: number;
+  /** Reads `length` bytes starting at `offset` */
+  read(offset: number, length: number): Promise<Uint8Array>;
+}
+
+/**
+ * Index entry for one statement in an archive, available without
+ * decoding the statement.
+ */
+export interface ArchiveEntry {
+  /** Index of the query (in the `createArchive()` input) it came from */
+  query: number;
+  /** Byte offset of the statement in its query (`stmt_location`) */
+  location: number;
+  /** Byte length of the statement, 0 for "to the end" (`stmt_len`) */
+  length: number;
+  /** Node type of the statement, e.g. `SelectStmt` */
+  type: string | undefined;
+}
+
+export interface ArrowExportOptions {
+  /**
+   * Maximum number of rows per Arrow record batch. Defaults to a single
+   * batch for the whole call.
+   */
+  batchSize?: number;
+  /**
+   * Only write rows for the first occurrence of each distinct query
+   * text. `duplicateOf` then maps every query to that occurrence.
+   */
+  distinct?: boolean;
+}
+
+export type WrappedArrowSuccess = {
+  /** Arrow IPC stream bytes, one row per statement */
+  arrow: Uint8Array;
+  /** Number of rows across all record batches */
+  rows: number;
+  /**
+   * With `distinct`, for each query the index of its first occurrence,
+   * whose rows describe it (its own index if it is the first)
+   */
+  duplicateOf: Int32Array | undefined;
+  error: undefined;
+};
+
+export type WrappedArrowError = {
+  arrow: undefined;
+  rows: undefined;
+  duplicateOf: undefined;
+  error: ParseError;
+};
+
+export type WrappedArrowResult = WrappedArrowSuccess | WrappedArrowError;
+
+export interface ParseProfile<
+  Version extends SupportedVersion = SupportedVersion
+> {
+  /** Time spent in the Postgres parser producing protobuf (ms) */
+  parseMs: number;
+  /** Time spent converting the protobuf tree to JSON (ms) */
+  jsonMs: number;
+  /** Size of the JSON string handed to JavaScript (bytes) */
+  jsonBytes: number;
+  /** The parse tree, as `parse()` would return it, unless there was an error */
+  tree: ParseResult<Version> | undefined;
+  /** Set when the SQL failed to parse */
+  error: ParseError | undefined;
+}
+
+export interface AllocationStats {
+  /** Number of allocations (malloc, calloc, aligned allocs, realloc of NULL) */
+  mallocs: number;
+  /** Number of frees of non-NULL pointers */
+  frees: number;
+  /** Number of reallocs of existing allocations */
+  reallocs: number;
+  /** Total bytes requested */
+  bytes: number;
+}
+
+export interface ParseLimits {
+  /** Maximum input size in UTF-8 bytes */
+  maxBytes?: number;
+  /** Maximum number of tokens, excluding comments */
+  maxTokens?: number;
+  /** Maximum number of statements */
+  maxStatements?: number;
+  /** Maximum nesting depth of parentheses and brackets */
+  maxDepth?: number;
+}
+
+export interface ParseOptions {
+  /**
+   * Admission limits checked in a single lexer pass before parsing.
+   * Input over a limit fails with a `ParseError` of type `limit`.
+   */
+  limits?: ParseLimits;
+
+  /**
+   * Collects anything the Postgres parser writes to stderr during the
+   * call (e.g. `WARNING` messages) into `diagnostics` on the result.
+   * Output is dropped when not requested.
+   */
+  diagnostics?: boolean;
+}
@@ -3,9 +3,22 @@ import type {
   Node,
   ParseResult,
   SupportedVersion,
+  WrappedArchiveResult,
+  WrappedArrowResult,
+  WrappedCatalogResult,
+  WrappedConstantsResult,
   WrappedDeparseResult,
+  WrappedDependencyGraphResult,
+  WrappedFormatResult,
+  WrappedMetricsResult,
+  WrappedParameterizeResult,
   WrappedParseResult,
+  WrappedRenderResult,
+  WrappedRewriteResult,
+  WrappedRoundTripResult,
   WrappedScanResult,
+  WrappedSplitResult,
+  WrappedTemplateResult,
 } from './types/index.js';
 
 /**
@@ -74,6 +87,214 @@ export async function unwrapScanResult(
   return resolved.tokens;
 }
 
+/**
+ * Unwraps a `WrappedSplitResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the split statements.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapSplitResult(
+  result: WrappedSplitResult | Promise<WrappedSplitResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.statements;
+}
+
+/**
+ * Unwraps a `WrappedMetricsResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the per-statement metrics.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapMetricsResult(
+  result: WrappedMetricsResult | Promise<WrappedMetricsResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.metrics;
+}
+
+/**
+ * Unwraps a `WrappedConstantsResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the extracted constants.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapConstantsResult(
+  result: WrappedConstantsResult | Promise<WrappedConstantsResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.constants;
+}
+
+/**
+ * Unwraps a `WrappedParameterizeResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the parameterized query.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapParameterizeResult(
+  result: WrappedParameterizeResult | Promise<WrappedParameterizeResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.query;
+}
+
+/**
+ * Unwraps a `WrappedCatalogResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the catalog.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapCatalogResult(
+  result: WrappedCatalogResult | Promise<WrappedCatalogResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.catalog;
+}
+
+/**
+ * Unwraps a `WrappedDependencyGraphResult` by throwing an error if the
+ * result contains an `error`, or otherwise returning the graph.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapDependencyGraphResult(
+  result: WrappedDependencyGraphResult | Promise<WrappedDependencyGraphResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.graph;
+}
+
+/**
+ * Unwraps a `WrappedRewriteResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the rewritten SQL.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapRewriteResult(
+  result: WrappedRewriteResult | Promise<WrappedRewriteResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.sql;
+}
+
+/**
+ * Unwraps a `WrappedFormatResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the formatted SQL.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapFormatResult(
+  result: WrappedFormatResult | Promise<WrappedFormatResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.sql;
+}
+
+/**
+ * Unwraps a `WrappedRoundTripResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the round-trip outcome.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapRoundTripResult(
+  result: WrappedRoundTripResult | Promise<WrappedRoundTripResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.roundTrip;
+}
+
+/**
+ * Unwraps a `WrappedArchiveResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the archive bytes.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapArchiveResult(
+  result: WrappedArchiveResult | Promise<WrappedArchiveResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.archive;
+}
+
+/**
+ * Unwraps a `WrappedArrowResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the Arrow IPC stream bytes.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapArrowResult(
+  result: WrappedArrowResult | Promise<WrappedArrowResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.arrow;
+}
+
+/**
+ * Unwraps a `WrappedTemplateResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the compiled `template`.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapTemplateResult(
+  result: WrappedTemplateResult | Promise<WrappedTemplateResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.template;
+}
+
+/**
+ * Unwraps a `WrappedRenderResult` by throwing an error if the result
+ * contains an `error`, or otherwise returning the rendered SQL.
+ *
+ * Supports both synchronous and asynchronous results.
+ */
+export async function unwrapRenderResult(
+  result: WrappedRenderResult | Promise<WrappedRenderResult>
+) {
+  const resolved = await result;
+  if (resolved.error) {
+    throw resolved.error;
+  }
+  return resolved.sql;
+}
+
 /**
  * Gets a list of supported Postgres versions.
  */
@@ -0,0 +1,192 @@
+/**
+ * Synthetic stress workloads for benchmarks and scaling tests.
+ *
+ * Each workload generates SQL whose shape grows along a single axis
+ * (nesting depth, list width, statement count, string size or identifier
+ * length) and documents how the resulting parse tree is expected to scale
+ * with `size`. `src/corpus.test.ts` asserts these expectations by parsing
+ * each workload at `size` and `2 * size` and comparing the results.
+ */
+
+/**
+ * How a measurement grows when `size` doubles.
+ *
+ * - `constant`: stays (roughly) the same
+ * - `linear`: (roughly) doubles
+ */
+export type Complexity = 'constant' | 'linear';
+
+export type WorkloadExpectations = {
+  /** Exact number of top-level statements produced */
+  statements: number;
+  /** Growth of the number of AST nodes */
+  nodes: Complexity;
+  /** Growth of the maximum AST nesting depth */
+  depth: Complexity;
+  /** Growth of the JSON AST size in bytes */
+  jsonBytes: Complexity;
+};
+
+export type Workload = {
+  name: string;
+  description: string;
+  /** Size used by `scripts/generate-corpus.ts` when none is given */
+  defaultSize: number;
+  /** Size used by the benchmark suite */
+  benchSize: number;
+  /** Size used by the scaling assertions in `src/corpus.test.ts` */
+  testSize: number;
+  generate(size: number): string;
+  expect(size: number): WorkloadExpectations;
+};
+
+/**
+ * Alternating AND/OR expressions nested `size` levels deep:
+ * `(c = 0 AND (c = 1 OR (c = 2 AND ...)))`.
+ *
+ * Alternating the operator prevents Postgres from flattening the chain
+ * into a single BoolExpr, so every level adds one level of AST depth.
+ * Keep sizes modest: deep recursion is bounded by the WASM stack.
+ */
+const deepBoolean: Workload = {
+  name: 'deep-boolean',
+  description: 'Boolean expression nested `size` levels deep',
+  defaultSize: 200,
+  benchSize: 100,
+  testSize: 50,
+  generate(size) {
+    let expr = `c = ${size}`;
+    for (let i = size - 1; i >= 0; i--) {
+      expr = `(c = ${i} ${i % 2 === 0 ? 'AND' : 'OR'} ${expr})`;
+    }
+    return `SELECT * FROM t WHERE ${expr};\n`;
+  },
+  expect: () => ({
+    statements: 1,
+    nodes: 'linear',
+    depth: 'linear',
+    jsonBytes: 'linear',
+  }),
+};
+
+/**
+ * A single INSERT with `size` rows in its VALUES list.
+ */
+const wideValues: Workload = {
+  name: 'wide-values',
+  description: 'INSERT with `size` rows in a VALUES list',
+  defaultSize: 100_000,
+  benchSize: 10_000,
+  testSize: 1_000,
+  generate(size) {
+    const rows = new Array<string>(size);
+    for (let i = 0; i < size; i++) {
+      rows[i] = `(${i}, 'name ${i}', ${i % 2 === 0})`;
+    }
+    return `INSERT INTO t (id, name, active) VALUES\n${rows.join(',\n')};\n`;
+  },
+  expect: () => ({
+    statements: 1,
+    nodes: 'linear',
+    depth: 'constant',
+    jsonBytes: 'linear',
+  }),
+};
+
+/**
+ * A single string literal of `size` bytes.
+ */
+const hugeString: Workload = {
+  name: 'huge-string',
+  description: 'SELECT of a single `size` byte string literal',
+  defaultSize: 10_000_000,
+  benchSize: 1_000_000,
+  testSize: 100_000,
+  generate(size) {
+    // Include an escaped quote in every chunk so the scanner can't
+    // take a fast path over the whole literal
+    const chunk = "abcdefghijklmnopqrstuvwxyz0123456789 ABCDEFGHIJKLMNOPQRSTUVWX''";
+    const literal = chunk.repeat(Math.ceil(size / chunk.length)).slice(0, size);
+    // Never split an escaped quote pair at the end
+    const balanced = literal.endsWith("'") && !literal.endsWith("''")
+      ? literal.slice(0, -1)
+      : literal;
+    return `SELECT '${balanced}' AS payload;\n`;
+  },
+  expect: () => ({
+    statements: 1,
+    nodes: 'constant',
+    depth: 'constant',
+    jsonBytes: 'linear',
+  }),
+};
+
+/**
+ * `size` small, independent statements.
+ */
+const manyStatements: Workload = {
+  name: 'many-statements',
+  description: '`size` small SELECT statements',
+  defaultSize: 100_000,
+  benchSize: 10_000,
+  testSize: 1_000,
+  generate(size) {
+    const statements = new Array<string>(size);
+    for (let i = 0; i < size; i++) {
+      statements[i] = `SELECT id, name FROM users WHERE id = ${i};`;
+    }
+    return statements.join('\n') + '\n';
+  },
+  expect: (size) => ({
+    statements: size,
+    nodes: 'linear',
+    depth: 'constant',
+    jsonBytes: 'linear',
+  }),
+};
+
+/**
+ * 100 columns selected from a table, every identifier `size` bytes long.
+ *
+ * Postgres truncates identifiers to NAMEDATALEN - 1 (63) bytes, so once
+ * `size` exceeds 63 the AST stops growing even though the input does.
+ */
+const longIdentifiers: Workload = {
+  name: 'long-identifiers',
+  description: '100 column references with `size` byte identifiers',
+  defaultSize: 10_000,
+  benchSize: 10_000,
+  testSize: 100,
+  generate(size) {
+    const identifier = (prefix: string) =>
+      prefix + 'x'.repeat(Math.max(size - prefix.length, 0));
+    const columns = Array.from({ length: 100 }, (_, i) =>
+      identifier(`c${i}_`)
+    );
+    return `SELECT ${columns.join(', ')} FROM ${identifier('t_')};\n`;
+  },
+  expect: (size) => ({
+    statements: 1,
+    nodes: 'constant',
+    depth: 'constant',
+    jsonBytes: size > 63 ? 'constant' : 'linear',
+  }),
+};
+
+export const WORKLOADS: Workload[] = [
+  deepBoolean,
+  wideValues,
+  hugeString,
+  manyStatements,
+  longIdentifiers,
+];
+
+export function getWorkload(name: string) {
+  const workload = WORKLOADS.find((workload) => workload.name === name);
+  if (!workload) {
+    throw new Error(
+      `unknown workload: ${name} (expected one of ${WORKLOADS.map((w) => w.name).join(', ')})`
+    );
+  }
+  return workload;
+}
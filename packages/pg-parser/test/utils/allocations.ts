@@ -0,0 +1,28 @@
+import type { PgParser } from '../../src/pg-parser.js';
+import type {
+  AllocationStats,
+  SupportedVersion,
+} from '../../src/types/index.js';
+
+/**
+ * Runs `operation` and returns the WASM heap allocations it made, or
+ * `undefined` if the WASM binary was built without allocation tracking.
+ *
+ * The operation is run once beforehand to warm up lazily initialized
+ * state (e.g. libpg_query's top-level memory contexts), which would
+ * otherwise be attributed to the first measured call.
+ */
+export async function countAllocations<Version extends SupportedVersion>(
+  parser: PgParser<Version>,
+  operation: () => Promise<unknown>,
+): Promise<AllocationStats | undefined> {
+  if (!(await parser.getAllocationStats())) {
+    return undefined;
+  }
+
+  await operation();
+
+  await parser.resetAllocationStats();
+  await operation();
+  return await parser.getAllocationStats();
+}
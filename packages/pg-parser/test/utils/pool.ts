@@ -0,0 +1,77 @@
+/// <reference types="node" />
+
+import {
+  createPoolHandler,
+  type PoolRequest,
+  type PoolResponse,
+} from '../../src/pool-handler.js';
+import type { PoolWorker } from '../../src/pool.js';
+
+/**
+ * SQL containing this marker never gets a reply, simulating a call
+ * stuck inside WASM.
+ */
+export const HANG = '/* hang */';
+
+export type InlineWorker = PoolWorker & {
+  terminated: boolean;
+};
+
+/**
+ * Creates a `PoolWorker` that runs the real pool handler on the current
+ * thread, so pool scheduling can be tested without spawning threads.
+ */
+export function createInlineWorker(workers: InlineWorker[] = []) {
+  return (): InlineWorker => {
+    const listeners: ((response: PoolResponse) => void)[] = [];
+    const handle = createPoolHandler((response) => {
+      if (!worker.terminated) {
+        listeners.forEach((listener) => listener(response));
+      }
+    });
+
+    const worker: InlineWorker = {
+      terminated: false,
+      postMessage(request: PoolRequest) {
+        if (
+          request.type === 'call' &&
+          String(request.args[0]).includes(HANG)
+        ) {
+          return;
+        }
+        // Reply asynchronously like a real worker
+        setTimeout(() => handle(request));
+      },
+      onMessage(listener) {
+        listeners.push(listener);
+      },
+      onError() {},
+      terminate() {
+        worker.terminated = true;
+      },
+    };
+
+    workers.push(worker);
+    return worker;
+  };
+}
+
+/**
+ * Creates a `PoolWorker` on a real Node.js worker thread running the
+ * TypeScript worker entry point through tsx, for benchmarks that need
+ * actual parallelism without a build step.
+ */
+export async function createThreadWorker(): Promise<PoolWorker> {
+  const { Worker } = await import('node:worker_threads');
+  const worker = new Worker(
+    new URL('../../src/pool-worker.ts', import.meta.url),
+    { execArgv: ['--import', 'tsx'] }
+  );
+
+  return {
+    postMessage: (request) => worker.postMessage(request),
+    onMessage: (listener) => worker.on('message', listener),
+    onError: (listener) => worker.on('error', listener),
+    terminate: () => worker.terminate(),
+  };
+}
@@ -7,6 +7,9 @@ export default defineConfig([
       'src/types/15.ts',
       'src/types/16.ts',
       'src/types/17.ts',
+      'src/cli/index.ts',
+      'src/pool.ts',
+      'src/pool-worker.ts',
     ],
     format: ['cjs', 'esm'],
     outDir: 'dist',
@@ -1,4 +1,7 @@
-import { defineWorkspace } from 'vitest/config';
+import { configDefaults, defineWorkspace } from 'vitest/config';
+
+// Tests that need Node.js APIs such as the file system
+const nodeOnly = ['src/cli/check.test.ts'];
 
 export default defineWorkspace([
   {
@@ -15,6 +18,7 @@ export default defineWorkspace([
       name: 'unit:vercel-edge',
       environment: 'edge-runtime',
       include: ['src/**/*.{test,spec}.ts'],
+      exclude: [...configDefaults.exclude, ...nodeOnly],
     },
   },
   {
@@ -22,6 +26,7 @@ export default defineWorkspace([
     test: {
       name: 'unit:browser',
       include: ['src/**/*.{test,spec}.ts'],
+      exclude: [...configDefaults.exclude, ...nodeOnly],
       browser: {
         enabled: true,
         provider: 'playwright',